@@ -0,0 +1,123 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "GraphicsTypes.h"
+#include "Image.h"
+
+namespace Diligent
+{
+
+/// Encodes images and writes them to files on worker threads.
+
+/// The render thread copies the mapped pixels into a pooled buffer obtained from
+/// AcquireBuffer() and hands it over to Enqueue(). When the number of pending images
+/// reaches the maximum queue depth, Enqueue() blocks until a worker frees a slot, so
+/// that memory usage stays bounded when encoding can't keep up with capturing.
+class AsyncImageWriter
+{
+public:
+    struct ImageInfo
+    {
+        std::string       FileName;
+        Uint32            Width       = 0;
+        Uint32            Height      = 0;
+        Uint32            Stride      = 0;
+        TEXTURE_FORMAT    TexFormat   = TEX_FORMAT_UNKNOWN;
+        IMAGE_FILE_FORMAT FileFormat  = IMAGE_FILE_FORMAT_PNG;
+        int               JpegQuality = 95;
+        bool              KeepAlpha   = false;
+    };
+
+    AsyncImageWriter(Uint32 NumThreads, Uint32 MaxQueueDepth);
+    ~AsyncImageWriter();
+
+    // clang-format off
+    AsyncImageWriter           (const AsyncImageWriter&)  = delete;
+    AsyncImageWriter           (      AsyncImageWriter&&) = delete;
+    AsyncImageWriter& operator=(const AsyncImageWriter&)  = delete;
+    AsyncImageWriter& operator=(      AsyncImageWriter&&) = delete;
+    // clang-format on
+
+    /// Returns a buffer of at least Size bytes, reusing a previously released one if possible.
+    std::vector<Uint8> AcquireBuffer(size_t Size);
+
+    /// Adds the image to the queue. Blocks while the queue is full.
+    void Enqueue(ImageInfo&& Info, std::vector<Uint8>&& Pixels);
+
+    /// Blocks until all queued images are written.
+    void WaitIdle();
+
+    /// Returns the first error code reported by a worker (same codes as SampleApp::GetExitCode), or 0.
+    int GetErrorCode() const
+    {
+        return m_ErrorCode.load();
+    }
+
+    Uint32 GetNumPendingImages()
+    {
+        std::lock_guard<std::mutex> Lock{m_Mtx};
+        return m_NumPending;
+    }
+
+private:
+    struct Task
+    {
+        ImageInfo          Info;
+        std::vector<Uint8> Pixels;
+    };
+
+    void WorkerThreadFunc();
+    void ProcessTask(const Task& T);
+
+    std::mutex              m_Mtx;
+    std::condition_variable m_TaskAddedCV;    // Signaled when a task is added or on shutdown
+    std::condition_variable m_TaskFinishedCV; // Signaled when a task is complete
+
+    std::deque<Task>                m_Queue;
+    std::vector<std::vector<Uint8>> m_BufferPool;
+
+    const Uint32 m_MaxQueueDepth;
+    // The number of tasks that were enqueued, but not yet written
+    Uint32 m_NumPending = 0;
+    bool   m_Stop       = false;
+
+    std::atomic_int m_ErrorCode{0};
+
+    std::vector<std::thread> m_Workers;
+};
+
+} // namespace Diligent
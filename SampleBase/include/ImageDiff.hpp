@@ -0,0 +1,78 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+struct ImageDiffAttribs
+{
+    Uint32 Width  = 0;
+    Uint32 Height = 0;
+
+    /// First image. 8-bit RGB or RGBA pixels.
+    const Uint8* pImage1        = nullptr;
+    Uint32       Stride1        = 0;
+    Uint32       NumComponents1 = 4;
+
+    /// Second image. 8-bit RGB or RGBA pixels.
+    const Uint8* pImage2        = nullptr;
+    Uint32       Stride2        = 0;
+    Uint32       NumComponents2 = 4;
+
+    /// Pixels whose RGB channels all differ by no more than the tolerance are considered equal.
+    /// Alpha is ignored.
+    Uint8 Tolerance = 0;
+
+    /// Optional RGBA8 output image of Width x Height pixels with tightly packed rows.
+    /// Black pixels are identical, blue pixels differ within the tolerance,
+    /// red to yellow pixels exceed the tolerance.
+    Uint8* pDiffHeatmap = nullptr;
+
+    /// The number of threads to use. 0 selects the number automatically.
+    Uint32 NumThreads = 0;
+};
+
+struct ImageDiffInfo
+{
+    /// The number of pixels whose difference exceeds the tolerance.
+    Uint32 NumDiffPixels = 0;
+
+    /// The maximum per-channel difference.
+    Uint32 MaxDifference = 0;
+
+    /// Peak signal-to-noise ratio in dB. Infinity if the images are identical.
+    double PSNR = 0;
+};
+
+/// Compares two 8-bit images row-parallel using SSE2/AVX2/NEON when available.
+ImageDiffInfo ComputeImageDifference(const ImageDiffAttribs& Attribs);
+
+} // namespace Diligent
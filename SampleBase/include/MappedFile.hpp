@@ -0,0 +1,88 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Read-only view of a file's contents.
+
+/// Where the platform allows it, the file is memory-mapped, so opening is cheap and
+/// pages are loaded on first access. Otherwise (e.g. files packed into an Android APK),
+/// the whole file is read into memory.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    // clang-format off
+    MappedFile           (const MappedFile&)  = delete;
+    MappedFile           (      MappedFile&&) = delete;
+    MappedFile& operator=(const MappedFile&)  = delete;
+    MappedFile& operator=(      MappedFile&&) = delete;
+    // clang-format on
+
+    /// Opens the file. If CopyOnWrite is true, the data may be modified through
+    /// GetWritableData(); the changes are private to the process and are never
+    /// written back to the file.
+    bool Open(const Char* Path, bool CopyOnWrite = false);
+
+    void Close();
+
+    const void* GetData() const { return m_pData; }
+    size_t      GetSize() const { return m_Size; }
+
+    /// Only valid if the file was opened with CopyOnWrite.
+    void* GetWritableData() const
+    {
+        return m_IsWritable ? m_pData : nullptr;
+    }
+
+    /// Returns true if the file is memory-mapped rather than loaded into memory.
+    bool IsMapped() const { return m_pData != nullptr && m_LoadedData.empty(); }
+
+    explicit operator bool() const { return m_pData != nullptr; }
+
+private:
+    bool Map(const Char* Path, bool CopyOnWrite);
+    bool Load(const Char* Path);
+
+    void*  m_pData      = nullptr;
+    size_t m_Size       = 0;
+    bool   m_IsWritable = false;
+
+    // File contents when the file could not be mapped
+    std::vector<Uint8> m_LoadedData;
+};
+
+} // namespace Diligent
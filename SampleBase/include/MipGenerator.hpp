@@ -0,0 +1,86 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "BasicTypes.h"
+#include "GraphicsTypes.h"
+
+namespace Diligent
+{
+
+class TaskScheduler;
+
+enum MIP_FILTER_TYPE : Uint8
+{
+    /// 2x2 box filter. Integer results are truncated, i.e. (a + b + c + d) / 4.
+    MIP_FILTER_BOX = 0,
+
+    /// Separable 6-tap Kaiser-windowed sinc filter. Keeps more detail than
+    /// the box filter at the cost of slight ringing near sharp edges.
+    MIP_FILTER_KAISER
+};
+
+struct MipLevelData
+{
+    void* pData = nullptr;
+
+    /// Row stride in bytes
+    size_t Stride = 0;
+};
+
+struct GenerateMipsAttribs
+{
+    /// Dimensions of level 0. Level m has max(Width >> m, 1) x max(Height >> m, 1) pixels.
+    Uint32 Width  = 0;
+    Uint32 Height = 0;
+
+    /// VT_UINT8, VT_UINT16 or VT_FLOAT32. Integer components are treated as unnormalized values.
+    VALUE_TYPE ComponentType = VT_UINT8;
+    Uint32     NumComponents = 4;
+
+    MIP_FILTER_TYPE Filter = MIP_FILTER_BOX;
+
+    /// Level 0 pixels
+    const void* pLevel0Data  = nullptr;
+    size_t      Level0Stride  = 0;
+
+    /// The total number of levels, including level 0
+    Uint32 NumMipLevels = 0;
+
+    /// Destination of levels 1 to NumMipLevels - 1, i.e. pMipLevels[0] is level 1.
+    MipLevelData* pMipLevels = nullptr;
+
+    /// Optional scheduler that processes rows of every level in parallel.
+    TaskScheduler* pScheduler = nullptr;
+};
+
+/// Generates the mip chain on the CPU. Every level is computed from the previous one
+/// with SSE2/NEON when available.
+void GenerateMips(const GenerateMipsAttribs& Attribs);
+
+} // namespace Diligent
@@ -0,0 +1,104 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <future>
+#include <functional>
+
+#include "RenderDevice.h"
+#include "Shader.h"
+#include "PipelineState.h"
+#include "RefCntAutoPtr.hpp"
+
+namespace Diligent
+{
+
+class TaskScheduler;
+class ShaderCache;
+
+/// Creates shaders and pipeline states in parallel, e.g. all permutations a sample needs at initialization.
+
+/// Requests are added to the batch, and Execute() creates all shaders and then all pipeline
+/// states on the scheduler's threads. Every request returns a future that becomes ready
+/// before Execute() returns, so a pipeline state function may get() the futures of the
+/// shaders in the same batch without blocking. Futures must not be waited on before Execute()
+/// is called.
+///
+/// OpenGL objects can only be created on the thread that owns the GL context, so with
+/// an OpenGL device Execute() creates all objects on the calling thread.
+class PipelineStateBatch
+{
+public:
+    using ShaderFuture        = std::shared_future<RefCntAutoPtr<IShader>>;
+    using PipelineStateFuture = std::shared_future<RefCntAutoPtr<IPipelineState>>;
+
+    using ShaderFunc        = std::function<void(IShader** ppShader)>;
+    using PipelineStateFunc = std::function<void(IPipelineState** ppPSO)>;
+
+    /// If pShaderCache is not null, shaders added with AddShader(ShaderCI) are created through the cache.
+    explicit PipelineStateBatch(IRenderDevice* pDevice, ShaderCache* pShaderCache = nullptr);
+    ~PipelineStateBatch();
+
+    // clang-format off
+    PipelineStateBatch           (const PipelineStateBatch&)  = delete;
+    PipelineStateBatch           (      PipelineStateBatch&&) = delete;
+    PipelineStateBatch& operator=(const PipelineStateBatch&)  = delete;
+    PipelineStateBatch& operator=(      PipelineStateBatch&&) = delete;
+    // clang-format on
+
+    /// Adds a shader to the batch. ShaderCI is copied together with the strings, macros and
+    /// bytecode it references, so it may be modified and reused for the next shader right away.
+    ShaderFuture AddShader(const ShaderCreateInfo& ShaderCI);
+
+    /// Adds a shader that is created by the function, e.g. through a render state notation loader.
+    ShaderFuture AddShader(ShaderFunc CreateShader);
+
+    /// Adds a pipeline state that is created by the function after all shaders of the batch.
+    /// The function runs on a worker thread, so everything it references must stay
+    /// valid until Execute() returns.
+    PipelineStateFuture AddPipelineState(PipelineStateFunc CreatePSO);
+
+    /// Creates all objects in the batch and waits for completion. If pScheduler is null,
+    /// a temporary scheduler with one thread per core is used. The batch is empty afterwards.
+    void Execute(TaskScheduler* pScheduler = nullptr);
+
+private:
+    struct ShaderRequest;
+    struct PipelineStateRequest;
+
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    ShaderCache* const           m_pShaderCache;
+
+    std::vector<std::unique_ptr<ShaderRequest>>        m_Shaders;
+    std::vector<std::unique_ptr<PipelineStateRequest>> m_PipelineStates;
+};
+
+} // namespace Diligent
@@ -0,0 +1,182 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "Fence.h"
+#include "RefCntAutoPtr.hpp"
+
+namespace Diligent
+{
+
+/// Ring buffer that streams per-frame data (dynamic geometry, constants etc.) to the GPU.
+
+/// Any number of threads may sub-allocate from the buffer at the same time; the write
+/// position is advanced with a compare-and-swap, so allocation does not take locks.
+/// Memory is retired once the GPU has passed the fence signaled by FinishFrame(),
+/// so unlike a dynamic buffer, the ring is never discarded in the middle of a frame.
+/// When the ring is full, Allocate() waits for the oldest frame in flight and counts a stall.
+///
+/// If the device supports CPU-writable unified memory, the buffer is mapped once and
+/// written directly. Otherwise, data is written to a CPU-side copy of the ring and
+/// Commit() uploads the range allocated during the frame with UpdateBuffer().
+///
+/// Usage for every frame:
+///   1. Allocate() and write the data from any thread.
+///   2. Commit() on the immediate context before it executes commands that read the data.
+///   3. FinishFrame() on the immediate context after these commands have been submitted.
+///      The context must be flushed (e.g. by Present()) before the next frame.
+class RingUploadBuffer
+{
+public:
+    struct CreateInfo
+    {
+        const Char* Name = nullptr;
+
+        /// Bind flags of the buffer, e.g. BIND_VERTEX_BUFFER | BIND_INDEX_BUFFER.
+        BIND_FLAGS BindFlags = BIND_NONE;
+
+        /// Ring size in bytes. Should be large enough for all frames in flight.
+        Uint64 Size = 0;
+
+        /// Use persistently mapped unified memory when the device supports it.
+        bool AllowPersistentMapping = true;
+    };
+
+    struct Allocation
+    {
+        /// Offset of the allocation in the GPU buffer
+        Uint64 Offset = ~Uint64{0};
+
+        /// CPU address to write the data to
+        void* pData = nullptr;
+
+        explicit operator bool() const { return pData != nullptr; }
+    };
+
+    struct Statistics
+    {
+        Uint64 Capacity = 0;
+
+        /// The number of bytes allocated by the frames that the GPU has not finished yet,
+        /// including the current frame.
+        Uint64 UsedSize = 0;
+
+        /// Peak value of UsedSize at the end of a frame
+        Uint64 PeakUsedSize = 0;
+
+        /// The number of bytes allocated during the last finished frame
+        Uint64 LastFrameSize = 0;
+
+        /// The number of times Allocate() had to wait for the GPU
+        Uint32 NumStalls = 0;
+
+        /// The number of allocations that failed because a single frame needs more than the whole ring
+        Uint32 NumFailedAllocations = 0;
+    };
+
+    RingUploadBuffer(IRenderDevice* pDevice, IDeviceContext* pImmediateCtx, const CreateInfo& CI);
+    ~RingUploadBuffer();
+
+    // clang-format off
+    RingUploadBuffer           (const RingUploadBuffer&)  = delete;
+    RingUploadBuffer           (      RingUploadBuffer&&) = delete;
+    RingUploadBuffer& operator=(const RingUploadBuffer&)  = delete;
+    RingUploadBuffer& operator=(      RingUploadBuffer&&) = delete;
+    // clang-format on
+
+    /// Allocates Size bytes aligned by Alignment, which must be a power of two not greater than 256.
+    /// Thread-safe. Returns an empty allocation if the request can't be satisfied.
+    Allocation Allocate(Uint64 Size, Uint32 Alignment = 16);
+
+    /// Makes the data written since the previous Commit() visible to the GPU.
+    void Commit(IDeviceContext* pImmediateCtx);
+
+    /// Ends the frame: the memory allocated during the frame is reused after the GPU
+    /// completes the commands submitted so far.
+    void FinishFrame(IDeviceContext* pImmediateCtx);
+
+    IBuffer* GetBuffer() const { return m_pBuffer; }
+
+    bool IsPersistentlyMapped() const { return m_pMappedCtx != nullptr; }
+
+    Statistics GetStatistics() const;
+
+private:
+    // Waits until the GPU releases enough memory for an allocation that ends at RequiredEnd.
+    // Returns false if the memory can't be released by waiting for the GPU.
+    bool ReleaseMemory(Uint64 RequiredEnd);
+
+    // Retires the frames the GPU has finished. m_RetireMtx must be locked.
+    void RetireCompletedFrames();
+
+    RefCntAutoPtr<IBuffer> m_pBuffer;
+    RefCntAutoPtr<IFence>  m_pFence;
+
+    // The context the buffer is mapped with when persistent mapping is used
+    RefCntAutoPtr<IDeviceContext> m_pMappedCtx;
+
+    // CPU-side copy of the ring when persistent mapping is not available
+    std::vector<Uint8> m_CPUData;
+
+    Uint8*         m_pData     = nullptr;
+    Uint64         m_Capacity  = 0;
+    RESOURCE_STATE m_ReadState = RESOURCE_STATE_UNKNOWN;
+
+    // Head and tail are monotonically increasing positions; the offset in the
+    // buffer is the position modulo the capacity.
+    std::atomic<Uint64> m_Head{0};
+    std::atomic<Uint64> m_Tail{0};
+
+    // Accessed by the thread that owns the immediate context only
+    Uint64 m_CommittedPos   = 0;
+    Uint64 m_FrameStartPos  = 0;
+    Uint64 m_NextFenceValue = 1;
+
+    struct FrameInFlight
+    {
+        Uint64 FenceValue;
+        Uint64 EndPos;
+    };
+    mutable std::mutex        m_RetireMtx;
+    std::deque<FrameInFlight> m_FramesInFlight;
+
+    std::atomic<Uint64> m_PeakUsedSize{0};
+    std::atomic<Uint64> m_LastFrameSize{0};
+    std::atomic<Uint32> m_NumStalls{0};
+    std::atomic<Uint32> m_NumFailedAllocations{0};
+};
+
+} // namespace Diligent
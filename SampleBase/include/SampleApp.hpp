@@ -40,11 +40,13 @@
 #include "SampleBase.hpp"
 #include "ScreenCapture.hpp"
 #include "Image.h"
+#include "AsyncImageWriter.hpp"
 
 namespace Diligent
 {
 
 class ImGuiImplDiligent;
+class ShaderCache;
 
 class SampleApp : public NativeAppBase
 {
@@ -70,16 +72,18 @@ public:
         return m_GoldenImgMode;
     }
 
-    virtual int GetExitCode() const override final
-    {
-        return m_ExitCode;
-    }
+    virtual int GetExitCode() const override final;
 
     virtual bool IsReady() const override final
     {
         return m_pDevice && m_pSwapChain && m_NumImmediateContexts > 0;
     }
 
+    /// Initializes the engine without a window, renders m_BenchmarkInfo.NumFrames frames
+    /// into an offscreen swap chain, writes the timing report and releases the engine.
+    /// Returns the exit code, which is also reported by GetExitCode().
+    int RunBenchmark();
+
     IDeviceContext* GetImmediateContext(size_t Ind = 0)
     {
         VERIFY_EXPR(Ind < m_NumImmediateContexts);
@@ -105,6 +109,9 @@ protected:
     void CompareGoldenImage(const std::string& FileName, ScreenCapture::CaptureInfo& Capture);
     void SaveScreenCapture(const std::string& FileName, ScreenCapture::CaptureInfo& Capture);
 
+    void WriteBenchmarkReport();
+    void ReleaseEngine();
+
     RENDER_DEVICE_TYPE                         m_DeviceType = RENDER_DEVICE_TYPE_UNDEFINED;
     RefCntAutoPtr<IEngineFactory>              m_pEngineFactory;
     RefCntAutoPtr<IRenderDevice>               m_pDevice;
@@ -147,14 +154,39 @@ protected:
         IMAGE_FILE_FORMAT FileFormat      = IMAGE_FILE_FORMAT_PNG;
         int               JpegQuality     = 95;
         bool              KeepAlpha       = false;
+        // The maximum number of captures waiting to be encoded and written
+        Uint32 MaxQueueDepth = 8;
 
     } m_ScreenCaptureInfo;
-    std::unique_ptr<ScreenCapture> m_pScreenCapture;
+    std::unique_ptr<ScreenCapture>    m_pScreenCapture;
+    std::unique_ptr<AsyncImageWriter> m_pImageWriter;
+
+    struct BenchmarkInfo
+    {
+        Uint32      NumFrames    = 0;
+        Uint32      WarmupFrames = 0;
+        std::string OutputPath   = "benchmark.json";
+
+        // CPU times of SampleApp::Update(), Render() and Present(), in seconds
+        struct FrameTimings
+        {
+            double Update  = 0;
+            double Render  = 0;
+            double Present = 0;
+        };
+        std::vector<FrameTimings> Frames;
+        double                    TotalTime = 0;
+    } m_BenchmarkInfo;
 
     std::unique_ptr<ImGuiImplDiligent> m_pImGui;
 
+    // Shader bytecode cache directory; the cache is disabled if the directory is empty
+    std::string                  m_ShaderCacheDir;
+    std::unique_ptr<ShaderCache> m_pShaderCache;
+
     GoldenImageMode m_GoldenImgMode           = GoldenImageMode::None;
     int             m_GoldenImgPixelTolerance = 0;
+    bool            m_bWriteGoldenImgDiff     = false;
     int             m_ExitCode                = 0;
 };
 
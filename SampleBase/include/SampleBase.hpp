@@ -41,6 +41,7 @@ namespace Diligent
 {
 
 class ImGuiImplDiligent;
+class ShaderCache;
 
 struct SampleInitInfo
 {
@@ -51,6 +52,9 @@ struct SampleInitInfo
     Uint32             NumDeferredCtx  = 0;
     ISwapChain*        pSwapChain      = nullptr;
     ImGuiImplDiligent* pImGui          = nullptr;
+
+    // Null if the shader cache is disabled (see -shader_cache command line option)
+    ShaderCache* pShaderCache = nullptr;
 };
 
 class SampleBase
@@ -96,12 +100,16 @@ protected:
     // Returns pretransform matrix that matches the current screen rotation
     float4x4 GetSurfacePretransformMatrix(const float3& f3CameraViewAxis) const;
 
+    // Creates the shader through the shader cache if it is enabled, or compiles it from source otherwise
+    void CreateShader(const ShaderCreateInfo& ShaderCI, IShader** ppShader);
+
     RefCntAutoPtr<IEngineFactory>              m_pEngineFactory;
     RefCntAutoPtr<IRenderDevice>               m_pDevice;
     RefCntAutoPtr<IDeviceContext>              m_pImmediateContext;
     std::vector<RefCntAutoPtr<IDeviceContext>> m_pDeferredContexts;
     RefCntAutoPtr<ISwapChain>                  m_pSwapChain;
-    ImGuiImplDiligent*                         m_pImGui = nullptr;
+    ImGuiImplDiligent*                         m_pImGui       = nullptr;
+    ShaderCache*                               m_pShaderCache = nullptr;
 
     float  m_fSmoothFPS         = 0;
     double m_LastFPSTime        = 0;
@@ -133,7 +141,8 @@ inline void SampleBase::Initialize(const SampleInitInfo& InitInfo)
     m_pDeferredContexts.resize(InitInfo.NumDeferredCtx);
     for (Uint32 ctx = 0; ctx < InitInfo.NumDeferredCtx; ++ctx)
         m_pDeferredContexts[ctx] = InitInfo.ppContexts[InitInfo.NumImmediateCtx + ctx];
-    m_pImGui = InitInfo.pImGui;
+    m_pImGui       = InitInfo.pImGui;
+    m_pShaderCache = InitInfo.pShaderCache;
 }
 
 extern SampleBase* CreateSample();
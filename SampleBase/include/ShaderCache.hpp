@@ -0,0 +1,116 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "RenderDevice.h"
+#include "Shader.h"
+#include "RefCntAutoPtr.hpp"
+
+namespace Diligent
+{
+
+/// On-disk cache of compiled shader bytecode that is shared by all samples.
+
+/// A shader is identified by a 64-bit hash of everything that affects its bytecode:
+/// the device type, the source text together with all files it includes, macros,
+/// entry point, compiler and other compilation parameters. The bytecode is stored
+/// in <Directory>/<hash>.bin, so editing any shader file or include invalidates
+/// only the shaders that depend on it.
+///
+/// OpenGL shaders have no bytecode and are always compiled from source.
+/// All methods are thread-safe.
+class ShaderCache
+{
+public:
+    struct Statistics
+    {
+        /// The number of shaders created from the cached bytecode
+        Uint32 NumHits = 0;
+
+        /// The number of shaders that were compiled and added to the cache
+        Uint32 NumMisses = 0;
+
+        /// The number of shaders that can't be cached and were compiled from source
+        Uint32 NumBypassed = 0;
+    };
+
+    ShaderCache(IRenderDevice* pDevice, const std::string& Directory);
+
+    // clang-format off
+    ShaderCache           (const ShaderCache&)  = delete;
+    ShaderCache           (      ShaderCache&&) = delete;
+    ShaderCache& operator=(const ShaderCache&)  = delete;
+    ShaderCache& operator=(      ShaderCache&&) = delete;
+    // clang-format on
+
+    /// Creates the shader from the cached bytecode, or compiles it and adds its bytecode to the cache.
+    void CreateShader(const ShaderCreateInfo& ShaderCI, IShader** ppShader);
+
+    /// Replaces the source of ShaderCI with the cached bytecode, compiling the shader on a miss.
+    /// This is intended for render state notation loader callbacks that create shaders internally.
+    /// The bytecode remains valid for the lifetime of the cache.
+    /// Returns false if the shader can't be cached, in which case ShaderCI is not modified.
+    bool ResolveBytecode(ShaderCreateInfo& ShaderCI);
+
+    Statistics GetStatistics() const;
+
+    bool IsEnabled() const { return m_IsEnabled; }
+
+private:
+    using Bytecode = std::vector<Uint8>;
+
+    bool ComputeHash(const ShaderCreateInfo& ShaderCI, Uint64& Hash) const;
+
+    // Returns the bytecode from memory or from disk, or null if the shader is not in the cache.
+    const Bytecode* FindBytecode(Uint64 Hash);
+
+    // Adds the bytecode of the compiled shader to the cache and writes it to disk.
+    const Bytecode* AddBytecode(Uint64 Hash, IShader* pShader);
+
+    std::string GetFilePath(Uint64 Hash) const;
+
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+
+    const std::string m_Directory;
+    bool              m_IsEnabled = false;
+
+    std::mutex                           m_BytecodesMtx;
+    std::unordered_map<Uint64, Bytecode> m_Bytecodes;
+
+    std::atomic<Uint32> m_NumHits{0};
+    std::atomic<Uint32> m_NumMisses{0};
+    std::atomic<Uint32> m_NumBypassed{0};
+};
+
+} // namespace Diligent
@@ -0,0 +1,137 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Work-stealing task scheduler shared by the samples.
+
+/// Every worker thread owns a task deque. A thread pops tasks from the front of its
+/// own deque and, when it runs out of work, steals tasks from the back of the other
+/// threads' deques. Idle workers sleep on a condition variable.
+///
+/// The thread that calls ParallelFor() also executes tasks while it waits. Its thread
+/// id is GetNumWorkers(), so callbacks receive ids in the range [0, GetNumWorkers()]
+/// and can use them to index per-thread resources such as deferred contexts.
+/// ParallelFor() and RunOnEachWorker() must not be called from several threads at the same time.
+class TaskScheduler
+{
+public:
+    /// ThreadId, ChunkIndex, [Begin, End) range of the chunk
+    using RangeFunc = std::function<void(Uint32 ThreadId, Uint32 ChunkIndex, Uint32 Begin, Uint32 End)>;
+
+    explicit TaskScheduler(Uint32 NumWorkers);
+    ~TaskScheduler();
+
+    // clang-format off
+    TaskScheduler           (const TaskScheduler&)  = delete;
+    TaskScheduler           (      TaskScheduler&&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&)  = delete;
+    TaskScheduler& operator=(      TaskScheduler&&) = delete;
+    // clang-format on
+
+    Uint32 GetNumWorkers() const { return static_cast<Uint32>(m_Workers.size()); }
+
+    /// The number of threads that execute ParallelFor() chunks, including the calling thread.
+    Uint32 GetNumThreads() const { return GetNumWorkers() + 1; }
+
+    /// Returns the number of chunks to split Count items into so that every thread
+    /// gets several chunks to balance uneven per-item cost, but no chunk is smaller
+    /// than MinChunkSize items.
+    Uint32 GetRecommendedChunkCount(Uint32 Count, Uint32 MinChunkSize) const;
+
+    /// Splits [0, Count) into NumChunks contiguous chunks and executes Func for every
+    /// chunk. Chunk i covers [Count * i / NumChunks, Count * (i + 1) / NumChunks).
+    /// Blocks until all chunks are processed.
+    void ParallelFor(Uint32 Count, Uint32 NumChunks, const RangeFunc& Func);
+
+    /// Same as above, but uses GetRecommendedChunkCount() to select the number of chunks.
+    void ParallelFor(Uint32 Count, const RangeFunc& Func, Uint32 MinChunkSize = 1)
+    {
+        ParallelFor(Count, GetRecommendedChunkCount(Count, MinChunkSize), Func);
+    }
+
+    /// Executes Func(WorkerId) exactly once on every worker thread and waits for completion.
+    /// This is used for work that must happen on a particular thread, e.g. FinishFrame()
+    /// on the deferred context the thread recorded commands to.
+    void RunOnEachWorker(const std::function<void(Uint32 WorkerId)>& Func);
+
+private:
+    struct TaskGroup
+    {
+        std::atomic<Uint32> NumRemaining{0};
+    };
+
+    struct Task
+    {
+        std::function<void(Uint32 ThreadId)> Func;
+        TaskGroup*                           pGroup = nullptr;
+    };
+
+    struct alignas(64) ThreadQueue
+    {
+        std::mutex       Mtx;
+        std::deque<Task> Tasks;
+        // Tasks that must be executed by this thread and can't be stolen
+        std::deque<Task> PinnedTasks;
+    };
+
+    void WorkerThreadFunc(Uint32 WorkerId);
+
+    bool PopTask(Uint32 ThreadId, Task& T);
+    void ExecuteTask(Uint32 ThreadId, Task& T);
+    void WaitForGroup(TaskGroup& Group);
+    void WakeWorkers();
+
+    // One queue per worker plus one for the calling thread
+    std::vector<std::unique_ptr<ThreadQueue>> m_Queues;
+    std::vector<std::thread>                  m_Workers;
+
+    // The number of tasks that are in the queues and may be executed by any thread
+    std::atomic<Uint32> m_NumStealableTasks{0};
+    std::atomic<Uint32> m_NumPinnedTasks{0};
+
+    std::mutex              m_WakeMtx;
+    std::condition_variable m_WakeCV;
+    std::condition_variable m_GroupDoneCV;
+    bool                    m_Stop = false;
+};
+
+} // namespace Diligent
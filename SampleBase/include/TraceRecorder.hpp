@@ -0,0 +1,216 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <string>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Query.h"
+#include "RefCntAutoPtr.hpp"
+
+namespace Diligent
+{
+
+/// Records CPU and GPU timelines of named, nested scopes and exports them as a Chrome
+/// trace-event JSON file that can be opened in chrome://tracing or Perfetto.
+
+/// Scopes are recorded on tracks. A track usually represents a command queue or a thread.
+/// Scopes of one track must be properly nested and recorded by one thread at a time,
+/// while different tracks may be recorded from different threads.
+///
+/// Every scope produces a CPU event. If a device context is passed to BeginScope(), the scope
+/// also writes timestamp queries to the context and produces a GPU event when NextFrame()
+/// reads the queries back NumFramesInFlight frames later. GPU events of all queues share one
+/// clock that is aligned to the CPU clock at the first GPU event.
+///
+/// Finished events are written without locks to a ring that keeps the most recent MaxEvents
+/// events. Only the pointers to scope names are stored, so the names must outlive
+/// the recorder (e.g. string literals).
+///
+/// Usage:
+///   1. Initialize() and AddTrack() for every queue or thread before recording.
+///   2. BeginScope()/EndScope() or TraceRecorder::Scope from any thread.
+///   3. NextFrame() once per frame when no scopes are open.
+///   4. ExportChromeTrace() when no scopes are being recorded, e.g. between frames.
+class TraceRecorder
+{
+public:
+    struct CreateInfo
+    {
+        /// Capacity of the event ring. Must be a power of two.
+        Uint32 MaxEvents = 1u << 16;
+
+        /// The number of frames after which GPU queries are read back
+        Uint32 NumFramesInFlight = 8;
+
+        /// The maximum number of GPU scopes per track in one frame.
+        /// Other scopes only produce CPU events.
+        Uint32 MaxGpuScopesPerFrame = 16;
+    };
+
+    struct Statistics
+    {
+        /// The total number of recorded events, including overwritten ones
+        Uint64 NumEvents = 0;
+
+        /// The number of GPU scopes whose queries were not ready when they were read back
+        Uint32 NumLostGpuScopes = 0;
+    };
+
+    TraceRecorder();
+    ~TraceRecorder();
+
+    // clang-format off
+    TraceRecorder           (const TraceRecorder&)  = delete;
+    TraceRecorder           (      TraceRecorder&&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&)  = delete;
+    TraceRecorder& operator=(      TraceRecorder&&) = delete;
+    // clang-format on
+
+    /// pDevice may be null, in which case only CPU events are recorded.
+    void Initialize(IRenderDevice* pDevice, const CreateInfo& CI);
+
+    /// Adds a track and returns its index.
+    Uint32 AddTrack(const Char* Name);
+
+    /// Opens a scope on the track. If pContext is not null and the context supports
+    /// timestamp queries, the scope is also measured on the GPU.
+    void BeginScope(Uint32 Track, const Char* Name, IDeviceContext* pContext = nullptr);
+
+    /// Closes the innermost open scope of the track. pContext must be the same as in BeginScope().
+    void EndScope(Uint32 Track, IDeviceContext* pContext = nullptr);
+
+    /// Reads back GPU queries of the oldest frame in flight and starts a new frame.
+    void NextFrame();
+
+    /// Writes all events in the ring to a Chrome trace-event JSON file.
+    bool ExportChromeTrace(const Char* FilePath) const;
+
+    Statistics GetStatistics() const;
+
+    bool IsInitialized() const { return m_Events != nullptr; }
+
+    class Scope
+    {
+    public:
+        Scope(TraceRecorder& Recorder, Uint32 Track, const Char* Name, IDeviceContext* pContext = nullptr) :
+            m_Recorder{Recorder},
+            m_Track{Track},
+            m_pContext{pContext}
+        {
+            m_Recorder.BeginScope(m_Track, Name, m_pContext);
+        }
+
+        ~Scope()
+        {
+            m_Recorder.EndScope(m_Track, m_pContext);
+        }
+
+        // clang-format off
+        Scope           (const Scope&)  = delete;
+        Scope& operator=(const Scope&)  = delete;
+        // clang-format on
+
+    private:
+        TraceRecorder&        m_Recorder;
+        const Uint32          m_Track;
+        IDeviceContext* const m_pContext;
+    };
+
+private:
+    struct Event
+    {
+        const Char* Name  = nullptr;
+        Uint64      Begin = 0; // in nanoseconds
+        Uint64      End   = 0;
+        Uint32      Track = 0;
+        bool        IsGpu = false;
+
+        // Position of the event in the ring plus one; zero if the slot is empty
+        std::atomic<Uint64> Seq{0};
+    };
+
+    struct GpuScope
+    {
+        const Char* Name     = nullptr;
+        Uint64      CpuBegin = 0;
+        bool        Ended    = false;
+    };
+
+    struct GpuFrame
+    {
+        // Begin and end queries of every scope
+        std::vector<RefCntAutoPtr<IQuery>> Queries;
+        std::vector<GpuScope>              Scopes;
+        std::atomic<Uint32>                NumScopes{0};
+    };
+
+    struct OpenScope
+    {
+        const Char* Name        = nullptr;
+        Uint64      CpuBegin    = 0;
+        Uint32      GpuScopeIdx = ~0u;
+    };
+
+    struct Track
+    {
+        std::string                 Name;
+        std::vector<OpenScope>      Stack;
+        std::unique_ptr<GpuFrame[]> GpuFrames;
+    };
+
+    Uint64 GetCpuTime() const;
+    void   AddEvent(const Char* Name, Uint32 Track, Uint64 Begin, Uint64 End, bool IsGpu);
+    bool   SupportsTimestamps(IDeviceContext* pContext) const;
+
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    CreateInfo                   m_CI;
+
+    bool m_SupportsTimestamps              = false;
+    bool m_SupportsTransferQueueTimestamps = false;
+
+    std::unique_ptr<Event[]> m_Events;
+    std::atomic<Uint64>      m_WritePos{0};
+
+    std::vector<std::unique_ptr<Track>> m_Tracks;
+
+    std::atomic<Uint32> m_FrameIdx{0};
+    Uint32              m_NumLostGpuScopes = 0;
+
+    // GPU time plus the offset gives CPU time
+    Int64 m_GpuToCpuOffset    = 0;
+    bool  m_GpuToCpuOffsetSet = false;
+
+    const Uint64 m_StartTime;
+};
+
+} // namespace Diligent
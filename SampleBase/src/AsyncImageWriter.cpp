@@ -0,0 +1,167 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+
+#include "AsyncImageWriter.hpp"
+#include "RefCntAutoPtr.hpp"
+#include "FileWrapper.hpp"
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+AsyncImageWriter::AsyncImageWriter(Uint32 NumThreads, Uint32 MaxQueueDepth) :
+    m_MaxQueueDepth{std::max(MaxQueueDepth, 1u)}
+{
+    NumThreads = std::max(NumThreads, 1u);
+    m_Workers.reserve(NumThreads);
+    for (Uint32 i = 0; i < NumThreads; ++i)
+        m_Workers.emplace_back(&AsyncImageWriter::WorkerThreadFunc, this);
+}
+
+AsyncImageWriter::~AsyncImageWriter()
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_Mtx};
+        m_Stop = true;
+    }
+    m_TaskAddedCV.notify_all();
+
+    // Workers drain the queue before exiting, so no capture is lost
+    for (auto& Worker : m_Workers)
+        Worker.join();
+}
+
+std::vector<Uint8> AsyncImageWriter::AcquireBuffer(size_t Size)
+{
+    std::vector<Uint8> Buffer;
+    {
+        std::lock_guard<std::mutex> Lock{m_Mtx};
+        if (!m_BufferPool.empty())
+        {
+            Buffer = std::move(m_BufferPool.back());
+            m_BufferPool.pop_back();
+        }
+    }
+    // All captures normally have the same size, so this will not reallocate
+    Buffer.resize(Size);
+    return Buffer;
+}
+
+void AsyncImageWriter::Enqueue(ImageInfo&& Info, std::vector<Uint8>&& Pixels)
+{
+    {
+        std::unique_lock<std::mutex> Lock{m_Mtx};
+        // Apply backpressure: wait until a worker frees a slot
+        m_TaskFinishedCV.wait(Lock, [this] { return m_NumPending < m_MaxQueueDepth; });
+        m_Queue.push_back({std::move(Info), std::move(Pixels)});
+        ++m_NumPending;
+    }
+    m_TaskAddedCV.notify_one();
+}
+
+void AsyncImageWriter::WaitIdle()
+{
+    std::unique_lock<std::mutex> Lock{m_Mtx};
+    m_TaskFinishedCV.wait(Lock, [this] { return m_NumPending == 0; });
+}
+
+void AsyncImageWriter::WorkerThreadFunc()
+{
+    for (;;)
+    {
+        Task T;
+        {
+            std::unique_lock<std::mutex> Lock{m_Mtx};
+            m_TaskAddedCV.wait(Lock, [this] { return m_Stop || !m_Queue.empty(); });
+            if (m_Queue.empty())
+            {
+                VERIFY_EXPR(m_Stop);
+                return;
+            }
+            T = std::move(m_Queue.front());
+            m_Queue.pop_front();
+        }
+
+        ProcessTask(T);
+
+        {
+            std::lock_guard<std::mutex> Lock{m_Mtx};
+            m_BufferPool.emplace_back(std::move(T.Pixels));
+            VERIFY_EXPR(m_NumPending > 0);
+            --m_NumPending;
+        }
+        m_TaskFinishedCV.notify_all();
+    }
+}
+
+void AsyncImageWriter::ProcessTask(const Task& T)
+{
+    const auto& Info = T.Info;
+
+    Image::EncodeInfo EncodeInfo;
+    EncodeInfo.Width       = Info.Width;
+    EncodeInfo.Height      = Info.Height;
+    EncodeInfo.TexFormat   = Info.TexFormat;
+    EncodeInfo.KeepAlpha   = Info.KeepAlpha;
+    EncodeInfo.pData       = T.Pixels.data();
+    EncodeInfo.Stride      = Info.Stride;
+    EncodeInfo.FileFormat  = Info.FileFormat;
+    EncodeInfo.JpegQuality = Info.JpegQuality;
+
+    RefCntAutoPtr<IDataBlob> pEncodedImage;
+    Image::Encode(EncodeInfo, &pEncodedImage);
+    if (!pEncodedImage)
+    {
+        LOG_ERROR_MESSAGE("Failed to encode screen capture '", Info.FileName, "'.");
+        int Expected = 0;
+        m_ErrorCode.compare_exchange_strong(Expected, -5);
+        return;
+    }
+
+    FileWrapper pFile(Info.FileName.c_str(), EFileAccessMode::Overwrite);
+    if (pFile)
+    {
+        auto res = pFile->Write(pEncodedImage->GetDataPtr(), pEncodedImage->GetSize());
+        if (!res)
+        {
+            LOG_ERROR_MESSAGE("Failed to write screen capture file '", Info.FileName, "'.");
+            int Expected = 0;
+            m_ErrorCode.compare_exchange_strong(Expected, -5);
+        }
+        pFile.Close();
+    }
+    else
+    {
+        LOG_ERROR_MESSAGE("Failed to create screen capture file '", Info.FileName, "'. Verify that the directory exists and the app has sufficient rights to write to this directory.");
+        int Expected = 0;
+        m_ErrorCode.compare_exchange_strong(Expected, -6);
+    }
+}
+
+} // namespace Diligent
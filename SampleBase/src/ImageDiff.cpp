@@ -0,0 +1,343 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <cmath>
+#include <limits>
+
+#include "ImageDiff.hpp"
+#include "DebugUtilities.hpp"
+#include "PlatformMisc.hpp"
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#    define IMAGE_DIFF_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define IMAGE_DIFF_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define IMAGE_DIFF_NEON 1
+#endif
+
+namespace Diligent
+{
+
+namespace
+{
+
+struct DiffStats
+{
+    Uint32 NumDiffPixels = 0;
+    Uint32 MaxDifference = 0;
+    Uint64 SumSqError    = 0;
+
+    void Merge(const DiffStats& Other)
+    {
+        NumDiffPixels += Other.NumDiffPixels;
+        MaxDifference = std::max(MaxDifference, Other.MaxDifference);
+        SumSqError += Other.SumSqError;
+    }
+};
+
+// Compares two rows of RGBA8 pixels ignoring alpha. If pAbsDiff is not null,
+// per-channel absolute differences are written to it.
+void CompareRowsRGBA8(const Uint8* pRow1,
+                      const Uint8* pRow2,
+                      Uint32       Width,
+                      Uint8        Tolerance,
+                      Uint8*       pAbsDiff,
+                      DiffStats&   Stats)
+{
+    Uint32 x = 0;
+
+    Uint32 NumDiffPixels = 0;
+    Uint32 MaxDifference = 0;
+    // Per-row sums of squares fit into 32-bit lanes for rows up to 16K pixels wide
+    Uint64 SumSqError = 0;
+
+#if IMAGE_DIFF_AVX2
+    {
+        const __m256i Zero    = _mm256_setzero_si256();
+        const __m256i RGBMask = _mm256_set1_epi32(0x00FFFFFF);
+        const __m256i Tol     = _mm256_set1_epi8(static_cast<char>(Tolerance));
+
+        __m256i MaxDiff = Zero;
+        __m256i SqSum   = Zero;
+        for (; x + 8 <= Width; x += 8)
+        {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pRow1 + x * 4));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pRow2 + x * 4));
+            const __m256i d = _mm256_and_si256(_mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a)), RGBMask);
+
+            MaxDiff = _mm256_max_epu8(MaxDiff, d);
+
+            // Non-zero 32-bit lanes correspond to pixels that exceed the tolerance
+            const __m256i Over     = _mm256_subs_epu8(d, Tol);
+            const int     SameMask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(Over, Zero)));
+            NumDiffPixels += 8 - static_cast<Uint32>(PlatformMisc::CountOneBits(static_cast<Uint32>(SameMask)));
+
+            const __m256i Lo = _mm256_unpacklo_epi8(d, Zero);
+            const __m256i Hi = _mm256_unpackhi_epi8(d, Zero);
+            SqSum            = _mm256_add_epi32(SqSum, _mm256_add_epi32(_mm256_madd_epi16(Lo, Lo), _mm256_madd_epi16(Hi, Hi)));
+
+            if (pAbsDiff != nullptr)
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pAbsDiff + x * 4), d);
+        }
+
+        alignas(32) Uint8  MaxBytes[32];
+        alignas(32) Uint32 SqLanes[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(MaxBytes), MaxDiff);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(SqLanes), SqSum);
+        for (auto m : MaxBytes)
+            MaxDifference = std::max(MaxDifference, Uint32{m});
+        for (auto s : SqLanes)
+            SumSqError += s;
+    }
+#elif IMAGE_DIFF_SSE2
+    {
+        const __m128i Zero    = _mm_setzero_si128();
+        const __m128i RGBMask = _mm_set1_epi32(0x00FFFFFF);
+        const __m128i Tol     = _mm_set1_epi8(static_cast<char>(Tolerance));
+
+        __m128i MaxDiff = Zero;
+        __m128i SqSum   = Zero;
+        for (; x + 4 <= Width; x += 4)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + x * 4));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow2 + x * 4));
+            const __m128i d = _mm_and_si128(_mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a)), RGBMask);
+
+            MaxDiff = _mm_max_epu8(MaxDiff, d);
+
+            // Non-zero 32-bit lanes correspond to pixels that exceed the tolerance
+            const __m128i Over     = _mm_subs_epu8(d, Tol);
+            const int     SameMask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(Over, Zero)));
+            NumDiffPixels += 4 - static_cast<Uint32>(PlatformMisc::CountOneBits(static_cast<Uint32>(SameMask)));
+
+            const __m128i Lo = _mm_unpacklo_epi8(d, Zero);
+            const __m128i Hi = _mm_unpackhi_epi8(d, Zero);
+            SqSum            = _mm_add_epi32(SqSum, _mm_add_epi32(_mm_madd_epi16(Lo, Lo), _mm_madd_epi16(Hi, Hi)));
+
+            if (pAbsDiff != nullptr)
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pAbsDiff + x * 4), d);
+        }
+
+        alignas(16) Uint8  MaxBytes[16];
+        alignas(16) Uint32 SqLanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(MaxBytes), MaxDiff);
+        _mm_store_si128(reinterpret_cast<__m128i*>(SqLanes), SqSum);
+        for (auto m : MaxBytes)
+            MaxDifference = std::max(MaxDifference, Uint32{m});
+        for (auto s : SqLanes)
+            SumSqError += s;
+    }
+#elif IMAGE_DIFF_NEON
+    {
+        const uint8x16_t RGBMask = vreinterpretq_u8_u32(vdupq_n_u32(0x00FFFFFF));
+        const uint8x16_t Tol     = vdupq_n_u8(Tolerance);
+
+        uint8x16_t MaxDiff = vdupq_n_u8(0);
+        uint32x4_t SqSum   = vdupq_n_u32(0);
+        uint32x4_t NumDiff = vdupq_n_u32(0);
+        for (; x + 4 <= Width; x += 4)
+        {
+            const uint8x16_t a = vld1q_u8(pRow1 + x * 4);
+            const uint8x16_t b = vld1q_u8(pRow2 + x * 4);
+            const uint8x16_t d = vandq_u8(vabdq_u8(a, b), RGBMask);
+
+            MaxDiff = vmaxq_u8(MaxDiff, d);
+
+            // Non-zero 32-bit lanes correspond to pixels that exceed the tolerance
+            const uint32x4_t Over = vreinterpretq_u32_u8(vqsubq_u8(d, Tol));
+            NumDiff               = vsubq_u32(NumDiff, vtstq_u32(Over, Over));
+
+            SqSum = vpadalq_u16(SqSum, vmull_u8(vget_low_u8(d), vget_low_u8(d)));
+            SqSum = vpadalq_u16(SqSum, vmull_u8(vget_high_u8(d), vget_high_u8(d)));
+
+            if (pAbsDiff != nullptr)
+                vst1q_u8(pAbsDiff + x * 4, d);
+        }
+
+        NumDiffPixels += vaddvq_u32(NumDiff);
+        MaxDifference = vmaxvq_u8(MaxDiff);
+        SumSqError += vaddvq_u32(SqSum);
+    }
+#endif
+
+    for (; x < Width; ++x)
+    {
+        bool Differs = false;
+        for (Uint32 c = 0; c < 3; ++c)
+        {
+            const auto d = static_cast<Uint32>(std::abs(int{pRow1[x * 4 + c]} - int{pRow2[x * 4 + c]}));
+
+            Differs       = Differs || d > Tolerance;
+            MaxDifference = std::max(MaxDifference, d);
+            SumSqError += d * d;
+            if (pAbsDiff != nullptr)
+                pAbsDiff[x * 4 + c] = static_cast<Uint8>(d);
+        }
+        if (Differs)
+            ++NumDiffPixels;
+    }
+
+    Stats.NumDiffPixels += NumDiffPixels;
+    Stats.MaxDifference = std::max(Stats.MaxDifference, MaxDifference);
+    Stats.SumSqError += SumSqError;
+}
+
+// Returns a pointer to the RGBA8 row, expanding RGB8 to RGBA8 in the scratch buffer if necessary
+const Uint8* GetRowRGBA8(const Uint8* pImage, Uint32 Stride, Uint32 NumComponents, Uint32 Row, Uint32 Width, std::vector<Uint8>& Scratch)
+{
+    const Uint8* pRow = pImage + size_t{Row} * size_t{Stride};
+    if (NumComponents == 4)
+        return pRow;
+
+    VERIFY_EXPR(NumComponents == 3);
+    Scratch.resize(size_t{Width} * 4);
+    for (Uint32 x = 0; x < Width; ++x)
+    {
+        Scratch[x * 4 + 0] = pRow[x * 3 + 0];
+        Scratch[x * 4 + 1] = pRow[x * 3 + 1];
+        Scratch[x * 4 + 2] = pRow[x * 3 + 2];
+        Scratch[x * 4 + 3] = 255;
+    }
+    return Scratch.data();
+}
+
+// Converts per-channel differences into heatmap colors in place
+void AbsDiffToHeatmap(Uint8* pRow, Uint32 Width, Uint8 Tolerance)
+{
+    for (Uint32 x = 0; x < Width; ++x)
+    {
+        Uint8* pPixel = pRow + x * 4;
+
+        const auto MaxDiff = std::max(std::max(pPixel[0], pPixel[1]), pPixel[2]);
+        if (MaxDiff == 0)
+        {
+            pPixel[0] = pPixel[1] = pPixel[2] = 0;
+        }
+        else if (MaxDiff <= Tolerance)
+        {
+            pPixel[0] = 0;
+            pPixel[1] = 0;
+            pPixel[2] = 128;
+        }
+        else
+        {
+            pPixel[0] = 255;
+            pPixel[1] = static_cast<Uint8>(std::min(int{MaxDiff} * 2, 255));
+            pPixel[2] = 0;
+        }
+        pPixel[3] = 255;
+    }
+}
+
+DiffStats CompareRowRange(const ImageDiffAttribs& Attribs, Uint32 StartRow, Uint32 EndRow)
+{
+    DiffStats Stats;
+
+    std::vector<Uint8> Scratch1, Scratch2;
+    for (Uint32 row = StartRow; row < EndRow; ++row)
+    {
+        const auto* pRow1 = GetRowRGBA8(Attribs.pImage1, Attribs.Stride1, Attribs.NumComponents1, row, Attribs.Width, Scratch1);
+        const auto* pRow2 = GetRowRGBA8(Attribs.pImage2, Attribs.Stride2, Attribs.NumComponents2, row, Attribs.Width, Scratch2);
+
+        Uint8* pDiffRow = Attribs.pDiffHeatmap != nullptr ?
+            Attribs.pDiffHeatmap + size_t{row} * size_t{Attribs.Width} * 4 :
+            nullptr;
+
+        CompareRowsRGBA8(pRow1, pRow2, Attribs.Width, Attribs.Tolerance, pDiffRow, Stats);
+
+        if (pDiffRow != nullptr)
+            AbsDiffToHeatmap(pDiffRow, Attribs.Width, Attribs.Tolerance);
+    }
+
+    return Stats;
+}
+
+} // namespace
+
+ImageDiffInfo ComputeImageDifference(const ImageDiffAttribs& Attribs)
+{
+    DEV_CHECK_ERR(Attribs.pImage1 != nullptr && Attribs.pImage2 != nullptr, "Images must not be null");
+    DEV_CHECK_ERR((Attribs.NumComponents1 == 3 || Attribs.NumComponents1 == 4) &&
+                      (Attribs.NumComponents2 == 3 || Attribs.NumComponents2 == 4),
+                  "Only 3- and 4-component images are supported");
+
+    ImageDiffInfo Info;
+    if (Attribs.Width == 0 || Attribs.Height == 0)
+        return Info;
+
+    // Use at least 64 rows per thread so that small images are not split too finely
+    static constexpr Uint32 MinRowsPerThread = 64;
+
+    Uint32 NumThreads = Attribs.NumThreads != 0 ? Attribs.NumThreads : std::max(std::thread::hardware_concurrency(), 1u);
+    NumThreads        = std::max(std::min(NumThreads, (Attribs.Height + MinRowsPerThread - 1) / MinRowsPerThread), 1u);
+
+    std::vector<DiffStats>   ThreadStats(NumThreads);
+    std::vector<std::thread> Threads;
+    Threads.reserve(NumThreads - 1);
+
+    const auto GetBandStart = [&](Uint32 Band) {
+        return static_cast<Uint32>(Uint64{Attribs.Height} * Band / NumThreads);
+    };
+    for (Uint32 t = 1; t < NumThreads; ++t)
+    {
+        Threads.emplace_back([&, t]() {
+            ThreadStats[t] = CompareRowRange(Attribs, GetBandStart(t), GetBandStart(t + 1));
+        });
+    }
+    // The calling thread processes the first band
+    ThreadStats[0] = CompareRowRange(Attribs, 0, GetBandStart(1));
+
+    for (auto& Thread : Threads)
+        Thread.join();
+
+    DiffStats Total;
+    for (const auto& Stats : ThreadStats)
+        Total.Merge(Stats);
+
+    Info.NumDiffPixels = Total.NumDiffPixels;
+    Info.MaxDifference = Total.MaxDifference;
+    if (Total.SumSqError == 0)
+    {
+        Info.PSNR = std::numeric_limits<double>::infinity();
+    }
+    else
+    {
+        const auto MSE = static_cast<double>(Total.SumSqError) / (static_cast<double>(Attribs.Width) * static_cast<double>(Attribs.Height) * 3.0);
+        Info.PSNR      = 10.0 * std::log10(255.0 * 255.0 / MSE);
+    }
+
+    return Info;
+}
+
+} // namespace Diligent
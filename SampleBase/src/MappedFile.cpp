@@ -0,0 +1,176 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#include "MappedFile.hpp"
+
+#include <string>
+
+#if PLATFORM_WIN32
+#    include "WinHPreface.h"
+#    include <Windows.h>
+#    include "WinHPostface.h"
+#elif PLATFORM_LINUX || PLATFORM_MACOS || PLATFORM_ANDROID || PLATFORM_IOS || PLATFORM_TVOS
+#    define USE_POSIX_MMAP 1
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include "FileWrapper.hpp"
+#include "FileSystem.hpp"
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const Char* Path, bool CopyOnWrite)
+{
+    Close();
+
+    if (Map(Path, CopyOnWrite))
+        return true;
+
+    // Mapping is not available or failed (e.g. the file is packed into the application bundle)
+    if (Load(Path))
+    {
+        m_IsWritable = CopyOnWrite;
+        return true;
+    }
+
+    return false;
+}
+
+void MappedFile::Close()
+{
+    if (IsMapped() && m_Size > 0)
+    {
+#if PLATFORM_WIN32
+        UnmapViewOfFile(m_pData);
+#elif USE_POSIX_MMAP
+        munmap(m_pData, m_Size);
+#endif
+    }
+
+    m_pData      = nullptr;
+    m_Size       = 0;
+    m_IsWritable = false;
+    m_LoadedData.clear();
+    m_LoadedData.shrink_to_fit();
+}
+
+bool MappedFile::Map(const Char* Path, bool CopyOnWrite)
+{
+#if PLATFORM_WIN32
+    HANDLE hFile = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER FileSize = {};
+    if (!GetFileSizeEx(hFile, &FileSize) || FileSize.QuadPart == 0 || static_cast<Uint64>(FileSize.QuadPart) > SIZE_MAX)
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    HANDLE hMapping = CreateFileMappingA(hFile, nullptr, CopyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(hFile);
+    if (hMapping == nullptr)
+        return false;
+
+    // The view keeps the mapping object alive
+    void* pData = MapViewOfFile(hMapping, CopyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMapping);
+    if (pData == nullptr)
+        return false;
+
+    m_pData      = pData;
+    m_Size       = static_cast<size_t>(FileSize.QuadPart);
+    m_IsWritable = CopyOnWrite;
+    return true;
+#elif USE_POSIX_MMAP
+    std::string CorrectedPath{Path};
+    FileSystem::CorrectSlashes(CorrectedPath);
+
+    const int fd = open(CorrectedPath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat FileStat = {};
+    if (fstat(fd, &FileStat) != 0 || FileStat.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    const auto Size  = static_cast<size_t>(FileStat.st_size);
+    void*      pData = mmap(nullptr, Size, CopyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (pData == MAP_FAILED)
+        return false;
+
+    m_pData      = pData;
+    m_Size       = Size;
+    m_IsWritable = CopyOnWrite;
+    return true;
+#else
+    (void)Path;
+    (void)CopyOnWrite;
+    return false;
+#endif
+}
+
+bool MappedFile::Load(const Char* Path)
+{
+    FileWrapper pFile{Path, EFileAccessMode::Read};
+    if (!pFile)
+        return false;
+
+    const auto Size = pFile->GetSize();
+    if (Size == 0)
+        return false;
+
+    m_LoadedData.resize(Size);
+    if (!pFile->Read(m_LoadedData.data(), Size))
+    {
+        LOG_ERROR_MESSAGE("Failed to read file '", Path, "'.");
+        m_LoadedData.clear();
+        return false;
+    }
+
+    m_pData = m_LoadedData.data();
+    m_Size  = Size;
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,495 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <array>
+#include <limits>
+
+#include "MipGenerator.hpp"
+#include "TaskScheduler.hpp"
+#include "DebugUtilities.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define MIP_GENERATOR_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define MIP_GENERATOR_NEON 1
+#endif
+
+namespace Diligent
+{
+
+namespace
+{
+
+struct LevelDesc
+{
+    const Uint8* pSrc;
+    size_t       SrcStride;
+    Uint32       SrcWidth;
+    Uint32       SrcHeight;
+
+    Uint8* pDst;
+    size_t DstStride;
+    Uint32 DstWidth;
+    Uint32 DstHeight;
+
+    Uint32 NumComponents;
+};
+
+template <typename T>
+const T* GetSrcRow(const LevelDesc& Level, Uint32 Row)
+{
+    return reinterpret_cast<const T*>(Level.pSrc + Level.SrcStride * Row);
+}
+
+template <typename T>
+T* GetDstRow(const LevelDesc& Level, Uint32 Row)
+{
+    return reinterpret_cast<T*>(Level.pDst + Level.DstStride * Row);
+}
+
+template <typename T>
+struct BoxFilterTraits
+{
+    using SumType = Uint32;
+    static T Resolve(SumType Sum) { return static_cast<T>(Sum >> 2); }
+};
+
+template <>
+struct BoxFilterTraits<float>
+{
+    using SumType = float;
+    static float Resolve(float Sum) { return Sum * 0.25f; }
+};
+
+// Filters destination pixels [x, DstWidth) of one row. The rows are summed vertically first,
+// which keeps float results identical to the SIMD paths.
+template <typename T>
+void BoxFilterRowScalar(const T* pRow0, const T* pRow1, T* pDst, Uint32 x, const LevelDesc& Level)
+{
+    using Traits  = BoxFilterTraits<T>;
+    using SumType = typename Traits::SumType;
+
+    const auto C = Level.NumComponents;
+    for (; x < Level.DstWidth; ++x)
+    {
+        const auto x0 = x * 2;
+        const auto x1 = std::min(x0 + 1, Level.SrcWidth - 1);
+        for (Uint32 c = 0; c < C; ++c)
+        {
+            const auto Left  = static_cast<SumType>(pRow0[x0 * C + c]) + static_cast<SumType>(pRow1[x0 * C + c]);
+            const auto Right = static_cast<SumType>(pRow0[x1 * C + c]) + static_cast<SumType>(pRow1[x1 * C + c]);
+            pDst[x * C + c]  = Traits::Resolve(Left + Right);
+        }
+    }
+}
+
+// Returns the number of destination pixels processed
+Uint32 BoxFilterRowSIMD(const Uint8* pRow0, const Uint8* pRow1, Uint8* pDst, const LevelDesc& Level)
+{
+    Uint32 x = 0;
+    // When the source is one pixel wide, the right neighbor has to be clamped
+    if (Level.NumComponents != 4 || Level.SrcWidth < 2)
+        return x;
+
+#if MIP_GENERATOR_SSE2
+    const __m128i Zero = _mm_setzero_si128();
+    for (; x + 4 <= Level.DstWidth; x += 4)
+    {
+        // Eight source pixels from every row produce four destination pixels
+        const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow0 + x * 8));
+        const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow0 + x * 8 + 16));
+        const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + x * 8));
+        const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + x * 8 + 16));
+
+        // 16-bit vertical sums, two pixels per register
+        const __m128i v01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, Zero), _mm_unpacklo_epi8(b0, Zero));
+        const __m128i v23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, Zero), _mm_unpackhi_epi8(b0, Zero));
+        const __m128i v45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, Zero), _mm_unpacklo_epi8(b1, Zero));
+        const __m128i v67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, Zero), _mm_unpackhi_epi8(b1, Zero));
+
+        // Add even and odd pixels
+        const __m128i d01 = _mm_add_epi16(_mm_unpacklo_epi64(v01, v23), _mm_unpackhi_epi64(v01, v23));
+        const __m128i d23 = _mm_add_epi16(_mm_unpacklo_epi64(v45, v67), _mm_unpackhi_epi64(v45, v67));
+
+        const __m128i d = _mm_packus_epi16(_mm_srli_epi16(d01, 2), _mm_srli_epi16(d23, 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + x * 4), d);
+    }
+#elif MIP_GENERATOR_NEON
+    for (; x + 8 <= Level.DstWidth; x += 8)
+    {
+        // Sixteen source pixels deinterleaved into channels
+        const uint8x16x4_t a = vld4q_u8(pRow0 + x * 8);
+        const uint8x16x4_t b = vld4q_u8(pRow1 + x * 8);
+
+        uint8x8x4_t d;
+        for (int c = 0; c < 4; ++c)
+        {
+            // Pairwise sums of horizontally adjacent pixels
+            const uint16x8_t s = vpadalq_u8(vpaddlq_u8(a.val[c]), b.val[c]);
+            d.val[c]           = vshrn_n_u16(s, 2);
+        }
+        vst4_u8(pDst + x * 4, d);
+    }
+#endif
+
+    return x;
+}
+
+Uint32 BoxFilterRowSIMD(const Uint16* pRow0, const Uint16* pRow1, Uint16* pDst, const LevelDesc& Level)
+{
+    Uint32 x = 0;
+    if (Level.NumComponents != 1 || Level.SrcWidth < 2)
+        return x;
+
+#if MIP_GENERATOR_SSE2
+    const __m128i Zero = _mm_setzero_si128();
+    // SSE2 has no unsigned 32->16 pack, so the values are biased to the signed range
+    const __m128i Bias32 = _mm_set1_epi32(0x8000);
+    const __m128i Bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+
+    const auto HorzSum = [](__m128i Lo, __m128i Hi) {
+        const __m128 Even = _mm_shuffle_ps(_mm_castsi128_ps(Lo), _mm_castsi128_ps(Hi), _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 Odd  = _mm_shuffle_ps(_mm_castsi128_ps(Lo), _mm_castsi128_ps(Hi), _MM_SHUFFLE(3, 1, 3, 1));
+        return _mm_srli_epi32(_mm_add_epi32(_mm_castps_si128(Even), _mm_castps_si128(Odd)), 2);
+    };
+
+    for (; x + 8 <= Level.DstWidth; x += 8)
+    {
+        const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow0 + x * 2));
+        const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow0 + x * 2 + 8));
+        const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + x * 2));
+        const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + x * 2 + 8));
+
+        // 32-bit vertical sums
+        const __m128i v0 = _mm_add_epi32(_mm_unpacklo_epi16(a0, Zero), _mm_unpacklo_epi16(b0, Zero));
+        const __m128i v1 = _mm_add_epi32(_mm_unpackhi_epi16(a0, Zero), _mm_unpackhi_epi16(b0, Zero));
+        const __m128i v2 = _mm_add_epi32(_mm_unpacklo_epi16(a1, Zero), _mm_unpacklo_epi16(b1, Zero));
+        const __m128i v3 = _mm_add_epi32(_mm_unpackhi_epi16(a1, Zero), _mm_unpackhi_epi16(b1, Zero));
+
+        const __m128i d0 = _mm_sub_epi32(HorzSum(v0, v1), Bias32);
+        const __m128i d1 = _mm_sub_epi32(HorzSum(v2, v3), Bias32);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + x), _mm_xor_si128(_mm_packs_epi32(d0, d1), Bias16));
+    }
+#elif MIP_GENERATOR_NEON
+    for (; x + 8 <= Level.DstWidth; x += 8)
+    {
+        const uint32x4_t s0 = vpadalq_u16(vpaddlq_u16(vld1q_u16(pRow0 + x * 2)), vld1q_u16(pRow1 + x * 2));
+        const uint32x4_t s1 = vpadalq_u16(vpaddlq_u16(vld1q_u16(pRow0 + x * 2 + 8)), vld1q_u16(pRow1 + x * 2 + 8));
+        vst1q_u16(pDst + x, vcombine_u16(vshrn_n_u32(s0, 2), vshrn_n_u32(s1, 2)));
+    }
+#endif
+
+    return x;
+}
+
+Uint32 BoxFilterRowSIMD(const float* pRow0, const float* pRow1, float* pDst, const LevelDesc& Level)
+{
+    Uint32 x = 0;
+    if (Level.SrcWidth < 2)
+        return x;
+
+#if MIP_GENERATOR_SSE2
+    const __m128 Quarter = _mm_set1_ps(0.25f);
+    if (Level.NumComponents == 4)
+    {
+        for (; x < Level.DstWidth; ++x)
+        {
+            const __m128 Left  = _mm_add_ps(_mm_loadu_ps(pRow0 + x * 8), _mm_loadu_ps(pRow1 + x * 8));
+            const __m128 Right = _mm_add_ps(_mm_loadu_ps(pRow0 + x * 8 + 4), _mm_loadu_ps(pRow1 + x * 8 + 4));
+            _mm_storeu_ps(pDst + x * 4, _mm_mul_ps(_mm_add_ps(Left, Right), Quarter));
+        }
+    }
+    else if (Level.NumComponents == 1)
+    {
+        for (; x + 4 <= Level.DstWidth; x += 4)
+        {
+            const __m128 v0 = _mm_add_ps(_mm_loadu_ps(pRow0 + x * 2), _mm_loadu_ps(pRow1 + x * 2));
+            const __m128 v1 = _mm_add_ps(_mm_loadu_ps(pRow0 + x * 2 + 4), _mm_loadu_ps(pRow1 + x * 2 + 4));
+
+            const __m128 Even = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 Odd  = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(pDst + x, _mm_mul_ps(_mm_add_ps(Even, Odd), Quarter));
+        }
+    }
+#elif MIP_GENERATOR_NEON
+    if (Level.NumComponents == 4)
+    {
+        for (; x < Level.DstWidth; ++x)
+        {
+            const float32x4_t Left  = vaddq_f32(vld1q_f32(pRow0 + x * 8), vld1q_f32(pRow1 + x * 8));
+            const float32x4_t Right = vaddq_f32(vld1q_f32(pRow0 + x * 8 + 4), vld1q_f32(pRow1 + x * 8 + 4));
+            vst1q_f32(pDst + x * 4, vmulq_n_f32(vaddq_f32(Left, Right), 0.25f));
+        }
+    }
+    else if (Level.NumComponents == 1)
+    {
+        for (; x + 4 <= Level.DstWidth; x += 4)
+        {
+            const float32x4_t v0 = vaddq_f32(vld1q_f32(pRow0 + x * 2), vld1q_f32(pRow1 + x * 2));
+            const float32x4_t v1 = vaddq_f32(vld1q_f32(pRow0 + x * 2 + 4), vld1q_f32(pRow1 + x * 2 + 4));
+            vst1q_f32(pDst + x, vmulq_n_f32(vpaddq_f32(v0, v1), 0.25f));
+        }
+    }
+#endif
+
+    return x;
+}
+
+template <typename T>
+void BoxFilterRows(const LevelDesc& Level, Uint32 FirstRow, Uint32 EndRow)
+{
+    for (Uint32 y = FirstRow; y < EndRow; ++y)
+    {
+        const T* pRow0 = GetSrcRow<T>(Level, y * 2);
+        const T* pRow1 = GetSrcRow<T>(Level, std::min(y * 2 + 1, Level.SrcHeight - 1));
+        T*       pDst  = GetDstRow<T>(Level, y);
+
+        const auto x = BoxFilterRowSIMD(pRow0, pRow1, pDst, Level);
+        BoxFilterRowScalar(pRow0, pRow1, pDst, x, Level);
+    }
+}
+
+// Kaiser-windowed sinc taps for a 2:1 reduction. Source pixels 2x-2 .. 2x+3 contribute to destination pixel x.
+static constexpr Uint32 KaiserNumTaps = 6;
+
+const std::array<float, KaiserNumTaps>& GetKaiserWeights()
+{
+    static const std::array<float, KaiserNumTaps> Weights = [] {
+        constexpr double Pi    = 3.14159265358979323846;
+        constexpr double Alpha = 4;
+        constexpr double Width = 3;
+
+        // Zeroth-order modified Bessel function of the first kind
+        const auto BesselI0 = [](double x) {
+            double Sum  = 1;
+            double Term = 1;
+            for (int k = 1; k < 32; ++k)
+            {
+                Term *= (x * 0.5 / k) * (x * 0.5 / k);
+                Sum += Term;
+            }
+            return Sum;
+        };
+
+        std::array<float, KaiserNumTaps> w{};
+
+        double Total = 0;
+        double Taps[KaiserNumTaps];
+        for (Uint32 i = 0; i < KaiserNumTaps; ++i)
+        {
+            // Distance from the destination pixel center in source pixels
+            const double d    = static_cast<double>(i) - 2.5;
+            const double Sinc = std::sin(Pi * d * 0.5) / (Pi * d * 0.5);
+            const double r    = d / Width;
+            Taps[i]           = Sinc * BesselI0(Alpha * std::sqrt(std::max(1 - r * r, 0.0))) / BesselI0(Alpha);
+            Total += Taps[i];
+        }
+        for (Uint32 i = 0; i < KaiserNumTaps; ++i)
+            w[i] = static_cast<float>(Taps[i] / Total);
+        return w;
+    }();
+    return Weights;
+}
+
+template <typename T>
+T KaiserResolve(float Value)
+{
+    constexpr float MaxValue = static_cast<float>(std::numeric_limits<T>::max());
+    return static_cast<T>(std::min(std::max(Value + 0.5f, 0.f), MaxValue));
+}
+
+template <>
+float KaiserResolve<float>(float Value)
+{
+    return Value;
+}
+
+template <typename T>
+void KaiserFilterRowHorz(const T* pSrc, float* pDst, const LevelDesc& Level, const std::array<float, KaiserNumTaps>& w)
+{
+    const auto C    = Level.NumComponents;
+    const auto Last = static_cast<int>(Level.SrcWidth) - 1;
+    for (Uint32 x = 0; x < Level.DstWidth; ++x)
+    {
+        const int x0 = static_cast<int>(x * 2) - 2;
+        int       Cols[KaiserNumTaps];
+        for (Uint32 i = 0; i < KaiserNumTaps; ++i)
+            Cols[i] = std::min(std::max(x0 + static_cast<int>(i), 0), Last) * static_cast<int>(C);
+
+        for (Uint32 c = 0; c < C; ++c)
+        {
+            float Sum = 0;
+            for (Uint32 i = 0; i < KaiserNumTaps; ++i)
+                Sum += w[i] * static_cast<float>(pSrc[Cols[i] + c]);
+            pDst[x * C + c] = Sum;
+        }
+    }
+}
+
+void KaiserFilterVert(const float* const* pRows, float* pDst, size_t Count, const std::array<float, KaiserNumTaps>& w)
+{
+    size_t i = 0;
+#if MIP_GENERATOR_SSE2
+    for (; i + 4 <= Count; i += 4)
+    {
+        __m128 Sum = _mm_mul_ps(_mm_loadu_ps(pRows[0] + i), _mm_set1_ps(w[0]));
+        for (Uint32 t = 1; t < KaiserNumTaps; ++t)
+            Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_loadu_ps(pRows[t] + i), _mm_set1_ps(w[t])));
+        _mm_storeu_ps(pDst + i, Sum);
+    }
+#elif MIP_GENERATOR_NEON
+    for (; i + 4 <= Count; i += 4)
+    {
+        float32x4_t Sum = vmulq_n_f32(vld1q_f32(pRows[0] + i), w[0]);
+        for (Uint32 t = 1; t < KaiserNumTaps; ++t)
+            Sum = vmlaq_n_f32(Sum, vld1q_f32(pRows[t] + i), w[t]);
+        vst1q_f32(pDst + i, Sum);
+    }
+#endif
+    for (; i < Count; ++i)
+    {
+        float Sum = pRows[0][i] * w[0];
+        for (Uint32 t = 1; t < KaiserNumTaps; ++t)
+            Sum += pRows[t][i] * w[t];
+        pDst[i] = Sum;
+    }
+}
+
+template <typename T>
+void KaiserFilterRows(const LevelDesc& Level, Uint32 FirstRow, Uint32 EndRow)
+{
+    const auto& w       = GetKaiserWeights();
+    const auto  RowSize = size_t{Level.DstWidth} * Level.NumComponents;
+    const auto  LastRow = static_cast<int>(Level.SrcHeight) - 1;
+
+    // Horizontally filtered source rows. Every source row is used by three destination rows,
+    // so the rows are kept in a ring indexed by the unclamped source row.
+    std::vector<float> HorzRows(RowSize * KaiserNumTaps);
+    std::vector<float> DstRow(RowSize);
+
+    int CachedRows[KaiserNumTaps];
+    std::fill(std::begin(CachedRows), std::end(CachedRows), -KaiserNumTaps);
+
+    for (Uint32 y = FirstRow; y < EndRow; ++y)
+    {
+        const float* pRows[KaiserNumTaps];
+        for (Uint32 t = 0; t < KaiserNumTaps; ++t)
+        {
+            const int  Row  = static_cast<int>(y * 2 + t) - 2;
+            const auto Slot = static_cast<Uint32>(Row + KaiserNumTaps) % KaiserNumTaps;
+            float*     pRow = &HorzRows[Slot * RowSize];
+            if (CachedRows[Slot] != Row)
+            {
+                KaiserFilterRowHorz(GetSrcRow<T>(Level, static_cast<Uint32>(std::min(std::max(Row, 0), LastRow))), pRow, Level, w);
+                CachedRows[Slot] = Row;
+            }
+            pRows[t] = pRow;
+        }
+
+        KaiserFilterVert(pRows, DstRow.data(), RowSize, w);
+
+        T* pDst = GetDstRow<T>(Level, y);
+        for (size_t i = 0; i < RowSize; ++i)
+            pDst[i] = KaiserResolve<T>(DstRow[i]);
+    }
+}
+
+template <typename T>
+void FilterRows(MIP_FILTER_TYPE Filter, const LevelDesc& Level, Uint32 FirstRow, Uint32 EndRow)
+{
+    if (Filter == MIP_FILTER_KAISER)
+        KaiserFilterRows<T>(Level, FirstRow, EndRow);
+    else
+        BoxFilterRows<T>(Level, FirstRow, EndRow);
+}
+
+} // namespace
+
+void GenerateMips(const GenerateMipsAttribs& Attribs)
+{
+    if (Attribs.Width == 0 || Attribs.Height == 0 || Attribs.NumMipLevels < 2)
+        return;
+
+    VERIFY(Attribs.pLevel0Data != nullptr && Attribs.pMipLevels != nullptr, "Source and destination data must not be null");
+    VERIFY(Attribs.NumComponents > 0, "The number of components must not be zero");
+
+    decltype(&FilterRows<Uint8>) FilterFunc = nullptr;
+    switch (Attribs.ComponentType)
+    {
+        case VT_UINT8: FilterFunc = FilterRows<Uint8>; break;
+        case VT_UINT16: FilterFunc = FilterRows<Uint16>; break;
+        case VT_FLOAT32: FilterFunc = FilterRows<float>; break;
+        default:
+            UNEXPECTED("Unsupported component type. Only VT_UINT8, VT_UINT16 and VT_FLOAT32 are supported.");
+            return;
+    }
+
+    LevelDesc Level;
+    Level.pSrc          = static_cast<const Uint8*>(Attribs.pLevel0Data);
+    Level.SrcStride     = Attribs.Level0Stride;
+    Level.SrcWidth      = Attribs.Width;
+    Level.SrcHeight     = Attribs.Height;
+    Level.NumComponents = Attribs.NumComponents;
+    for (Uint32 mip = 1; mip < Attribs.NumMipLevels; ++mip)
+    {
+        const auto& DstData = Attribs.pMipLevels[mip - 1];
+
+        Level.pDst      = static_cast<Uint8*>(DstData.pData);
+        Level.DstStride = DstData.Stride;
+        Level.DstWidth  = std::max(Attribs.Width >> mip, 1u);
+        Level.DstHeight = std::max(Attribs.Height >> mip, 1u);
+
+        // Levels depend on each other, so only the rows of a single level are processed in parallel
+        if (Attribs.pScheduler != nullptr)
+        {
+            // Avoid chunks that are too small to amortize the scheduling cost
+            const auto MinRowsPerChunk = std::max(16384u / (Level.DstWidth * Level.NumComponents), 1u);
+            Attribs.pScheduler->ParallelFor(
+                Level.DstHeight,
+                [&](Uint32 /*ThreadId*/, Uint32 /*Chunk*/, Uint32 FirstRow, Uint32 EndRow) {
+                    FilterFunc(Attribs.Filter, Level, FirstRow, EndRow);
+                },
+                MinRowsPerChunk);
+        }
+        else
+        {
+            FilterFunc(Attribs.Filter, Level, 0, Level.DstHeight);
+        }
+
+        Level.pSrc      = Level.pDst;
+        Level.SrcStride = Level.DstStride;
+        Level.SrcWidth  = Level.DstWidth;
+        Level.SrcHeight = Level.DstHeight;
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,194 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+
+#include "OffscreenSwapChain.hpp"
+#include "ObjectBase.hpp"
+#include "RefCntAutoPtr.hpp"
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+class OffscreenSwapChain final : public ObjectBase<ISwapChain>
+{
+public:
+    using TBase = ObjectBase<ISwapChain>;
+
+    OffscreenSwapChain(IReferenceCounters*  pRefCounters,
+                       IRenderDevice*       pDevice,
+                       IDeviceContext*      pContext,
+                       const SwapChainDesc& SCDesc) :
+        TBase{pRefCounters},
+        m_pDevice{pDevice},
+        m_pContext{pContext},
+        m_Desc{SCDesc}
+    {
+        m_Desc.PreTransform = SURFACE_TRANSFORM_IDENTITY;
+        m_Desc.BufferCount  = std::max(m_Desc.BufferCount, 1u);
+        if (m_Desc.Width == 0 || m_Desc.Height == 0)
+        {
+            m_Desc.Width  = 1024;
+            m_Desc.Height = 768;
+        }
+
+        FenceDesc FenceCI;
+        FenceCI.Name = "Offscreen swap chain fence";
+        m_pDevice->CreateFence(FenceCI, &m_pFence);
+
+        CreateBuffers();
+    }
+
+    IMPLEMENT_QUERY_INTERFACE_IN_PLACE(IID_SwapChain, TBase)
+
+    virtual void DILIGENT_CALL_TYPE Present(Uint32 SyncInterval) override final
+    {
+        // There is nothing to present, but we still need to submit the frame and
+        // keep the CPU from running arbitrarily far ahead of the GPU.
+        m_pContext->EnqueueSignal(m_pFence, ++m_FrameIndex);
+        m_pContext->Flush();
+        if (m_FrameIndex > m_Desc.BufferCount)
+            m_pFence->Wait(m_FrameIndex - m_Desc.BufferCount);
+    }
+
+    virtual const SwapChainDesc& DILIGENT_CALL_TYPE GetDesc() const override final
+    {
+        return m_Desc;
+    }
+
+    virtual void DILIGENT_CALL_TYPE Resize(Uint32 NewWidth, Uint32 NewHeight, SURFACE_TRANSFORM NewTransform) override final
+    {
+        if (NewWidth == 0 || NewHeight == 0 || (NewWidth == m_Desc.Width && NewHeight == m_Desc.Height))
+            return;
+
+        // Make sure the GPU does not use the buffers we are about to release
+        m_pContext->WaitForIdle();
+
+        m_Desc.Width  = NewWidth;
+        m_Desc.Height = NewHeight;
+        CreateBuffers();
+    }
+
+    virtual void DILIGENT_CALL_TYPE SetFullscreenMode(const DisplayModeAttribs& DisplayMode) override final
+    {
+        UNSUPPORTED("Offscreen swap chain does not support full screen mode");
+    }
+
+    virtual void DILIGENT_CALL_TYPE SetWindowedMode() override final
+    {
+    }
+
+    virtual void DILIGENT_CALL_TYPE SetMaximumFrameLatency(Uint32 MaxLatency) override final
+    {
+        m_Desc.BufferCount = std::max(MaxLatency, 1u);
+    }
+
+    virtual ITextureView* DILIGENT_CALL_TYPE GetCurrentBackBufferRTV() override final
+    {
+        return m_pRTV;
+    }
+
+    virtual ITextureView* DILIGENT_CALL_TYPE GetDepthBufferDSV() override final
+    {
+        return m_pDSV;
+    }
+
+private:
+    void CreateBuffers()
+    {
+        m_pRTV.Release();
+        m_pDSV.Release();
+        m_pColorBuffer.Release();
+        m_pDepthBuffer.Release();
+
+        TextureDesc TexDesc;
+        TexDesc.Name      = "Offscreen swap chain color buffer";
+        TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+        TexDesc.Width     = m_Desc.Width;
+        TexDesc.Height    = m_Desc.Height;
+        TexDesc.Format    = m_Desc.ColorBufferFormat;
+        TexDesc.BindFlags = BIND_RENDER_TARGET;
+        if (m_Desc.Usage & SWAP_CHAIN_USAGE_SHADER_RESOURCE)
+            TexDesc.BindFlags |= BIND_SHADER_RESOURCE;
+
+        m_pDevice->CreateTexture(TexDesc, nullptr, &m_pColorBuffer);
+        if (!m_pColorBuffer)
+            LOG_ERROR_AND_THROW("Failed to create offscreen color buffer");
+        m_pRTV = m_pColorBuffer->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
+
+        if (m_Desc.DepthBufferFormat != TEX_FORMAT_UNKNOWN)
+        {
+            TexDesc.Name      = "Offscreen swap chain depth buffer";
+            TexDesc.Format    = m_Desc.DepthBufferFormat;
+            TexDesc.BindFlags = BIND_DEPTH_STENCIL;
+
+            m_pDevice->CreateTexture(TexDesc, nullptr, &m_pDepthBuffer);
+            if (!m_pDepthBuffer)
+                LOG_ERROR_AND_THROW("Failed to create offscreen depth buffer");
+            m_pDSV = m_pDepthBuffer->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL);
+        }
+    }
+
+    RefCntAutoPtr<IRenderDevice>  m_pDevice;
+    RefCntAutoPtr<IDeviceContext> m_pContext;
+    RefCntAutoPtr<IFence>         m_pFence;
+    RefCntAutoPtr<ITexture>       m_pColorBuffer;
+    RefCntAutoPtr<ITexture>       m_pDepthBuffer;
+    RefCntAutoPtr<ITextureView>   m_pRTV;
+    RefCntAutoPtr<ITextureView>   m_pDSV;
+
+    SwapChainDesc m_Desc;
+    Uint64        m_FrameIndex = 0;
+};
+
+} // namespace
+
+void CreateOffscreenSwapChain(IRenderDevice*       pDevice,
+                              IDeviceContext*      pContext,
+                              const SwapChainDesc& SCDesc,
+                              ISwapChain**         ppSwapChain)
+{
+    DEV_CHECK_ERR(pDevice != nullptr && pContext != nullptr, "Device and context must not be null");
+    DEV_CHECK_ERR(ppSwapChain != nullptr && *ppSwapChain == nullptr, "Swap chain pointer must not be null and must point to null");
+
+    try
+    {
+        auto* pSwapChain = MakeNewRCObj<OffscreenSwapChain>()(pDevice, pContext, SCDesc);
+        pSwapChain->QueryInterface(IID_SwapChain, reinterpret_cast<IObject**>(ppSwapChain));
+    }
+    catch (...)
+    {
+        LOG_ERROR_MESSAGE("Failed to create offscreen swap chain");
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,233 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include "PipelineStateBatch.hpp"
+#include "TaskScheduler.hpp"
+#include "ShaderCache.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+template <typename ObjectType, typename FuncType>
+void CreateObject(const FuncType& Func, std::promise<RefCntAutoPtr<ObjectType>>& Promise)
+{
+    // Exceptions are rethrown by the future's get()
+    try
+    {
+        RefCntAutoPtr<ObjectType> pObject;
+        Func(&pObject);
+        Promise.set_value(std::move(pObject));
+    }
+    catch (...)
+    {
+        Promise.set_exception(std::current_exception());
+    }
+}
+
+} // namespace
+
+struct PipelineStateBatch::ShaderRequest
+{
+    ShaderFunc                           Func;
+    std::promise<RefCntAutoPtr<IShader>> Promise;
+
+    // A copy of the create info and of all data it references
+    ShaderCreateInfo                               CI;
+    std::string                                    Name;
+    std::string                                    FilePath;
+    std::string                                    Source;
+    std::string                                    EntryPoint;
+    std::string                                    CombinedSamplerSuffix;
+    std::vector<std::string>                       MacroStrings;
+    std::vector<ShaderMacro>                       Macros;
+    std::vector<Uint8>                             ByteCode;
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> pStreamFactory;
+};
+
+struct PipelineStateBatch::PipelineStateRequest
+{
+    PipelineStateFunc                           Func;
+    std::promise<RefCntAutoPtr<IPipelineState>> Promise;
+};
+
+PipelineStateBatch::PipelineStateBatch(IRenderDevice* pDevice, ShaderCache* pShaderCache) :
+    m_pDevice{pDevice},
+    m_pShaderCache{pShaderCache}
+{
+    VERIFY_EXPR(m_pDevice);
+}
+
+PipelineStateBatch::~PipelineStateBatch()
+{
+    VERIFY(m_Shaders.empty() && m_PipelineStates.empty(), "The batch has not been executed. Its futures will never become ready.");
+}
+
+PipelineStateBatch::ShaderFuture PipelineStateBatch::AddShader(const ShaderCreateInfo& ShaderCI)
+{
+    VERIFY(ShaderCI.ppConversionStream == nullptr, "Conversion streams are not supported");
+
+    std::unique_ptr<ShaderRequest> pRequest{new ShaderRequest};
+    auto&                          Req = *pRequest;
+
+    Req.CI = ShaderCI;
+
+    auto CopyString = [](const Char* Src, std::string& Dst, const Char*& Ptr) {
+        if (Src == nullptr)
+            return;
+        Dst = Src;
+        Ptr = Dst.c_str();
+    };
+    CopyString(ShaderCI.Desc.Name, Req.Name, Req.CI.Desc.Name);
+    CopyString(ShaderCI.FilePath, Req.FilePath, Req.CI.FilePath);
+    CopyString(ShaderCI.EntryPoint, Req.EntryPoint, Req.CI.EntryPoint);
+    CopyString(ShaderCI.CombinedSamplerSuffix, Req.CombinedSamplerSuffix, Req.CI.CombinedSamplerSuffix);
+
+    if (ShaderCI.Source != nullptr)
+    {
+        Req.Source.assign(ShaderCI.Source, ShaderCI.SourceLength != 0 ? ShaderCI.SourceLength : strlen(ShaderCI.Source));
+        Req.CI.Source       = Req.Source.c_str();
+        Req.CI.SourceLength = Req.Source.length();
+    }
+    else if (ShaderCI.ByteCode != nullptr)
+    {
+        const auto* pBytes = static_cast<const Uint8*>(ShaderCI.ByteCode);
+        Req.ByteCode.assign(pBytes, pBytes + ShaderCI.ByteCodeSize);
+        Req.CI.ByteCode     = Req.ByteCode.data();
+        Req.CI.ByteCodeSize = Req.ByteCode.size();
+    }
+
+    if (ShaderCI.Macros != nullptr)
+    {
+        // Copy all strings first so that the pointers are not invalidated by reallocation
+        for (const auto* pMacro = ShaderCI.Macros; pMacro->Name != nullptr; ++pMacro)
+        {
+            Req.MacroStrings.emplace_back(pMacro->Name);
+            Req.MacroStrings.emplace_back(pMacro->Definition != nullptr ? pMacro->Definition : "");
+        }
+        for (size_t i = 0; i < Req.MacroStrings.size(); i += 2)
+            Req.Macros.push_back({Req.MacroStrings[i].c_str(), Req.MacroStrings[i + 1].c_str()});
+        Req.Macros.push_back({nullptr, nullptr});
+        Req.CI.Macros = Req.Macros.data();
+    }
+
+    Req.pStreamFactory = ShaderCI.pShaderSourceStreamFactory;
+
+    auto Future = Req.Promise.get_future().share();
+    m_Shaders.emplace_back(std::move(pRequest));
+    return Future;
+}
+
+PipelineStateBatch::ShaderFuture PipelineStateBatch::AddShader(ShaderFunc CreateShader)
+{
+    VERIFY_EXPR(CreateShader);
+
+    std::unique_ptr<ShaderRequest> pRequest{new ShaderRequest};
+    pRequest->Func = std::move(CreateShader);
+
+    auto Future = pRequest->Promise.get_future().share();
+    m_Shaders.emplace_back(std::move(pRequest));
+    return Future;
+}
+
+PipelineStateBatch::PipelineStateFuture PipelineStateBatch::AddPipelineState(PipelineStateFunc CreatePSO)
+{
+    VERIFY_EXPR(CreatePSO);
+
+    std::unique_ptr<PipelineStateRequest> pRequest{new PipelineStateRequest};
+    pRequest->Func = std::move(CreatePSO);
+
+    auto Future = pRequest->Promise.get_future().share();
+    m_PipelineStates.emplace_back(std::move(pRequest));
+    return Future;
+}
+
+void PipelineStateBatch::Execute(TaskScheduler* pScheduler)
+{
+    auto CreateShader = [this](ShaderRequest& Req) {
+        if (Req.Func)
+        {
+            CreateObject(Req.Func, Req.Promise);
+        }
+        else
+        {
+            auto Func = [&](IShader** ppShader) {
+                if (m_pShaderCache != nullptr)
+                    m_pShaderCache->CreateShader(Req.CI, ppShader);
+                else
+                    m_pDevice->CreateShader(Req.CI, ppShader);
+            };
+            CreateObject(Func, Req.Promise);
+        }
+    };
+
+    const auto NumRequests = std::max(m_Shaders.size(), m_PipelineStates.size());
+    if (m_pDevice->GetDeviceInfo().IsGLDevice() || NumRequests <= 1)
+    {
+        for (auto& pReq : m_Shaders)
+            CreateShader(*pReq);
+        for (auto& pReq : m_PipelineStates)
+            CreateObject(pReq->Func, pReq->Promise);
+    }
+    else
+    {
+        std::unique_ptr<TaskScheduler> pTempScheduler;
+        if (pScheduler == nullptr)
+        {
+            // The calling thread also executes tasks
+            const auto NumWorkers = std::min(std::max(std::thread::hardware_concurrency(), 1u) - 1u, static_cast<Uint32>(NumRequests - 1));
+            pTempScheduler.reset(new TaskScheduler{NumWorkers});
+            pScheduler = pTempScheduler.get();
+        }
+
+        // Every request is a separate chunk because compilation times vary a lot.
+        // Pipeline states may use the shaders, so they are created after all shaders are ready.
+        const auto NumShaders = static_cast<Uint32>(m_Shaders.size());
+        pScheduler->ParallelFor(NumShaders, NumShaders, [&](Uint32 ThreadId, Uint32 ChunkIndex, Uint32 Begin, Uint32 End) {
+            for (Uint32 i = Begin; i < End; ++i)
+                CreateShader(*m_Shaders[i]);
+        });
+
+        const auto NumPSOs = static_cast<Uint32>(m_PipelineStates.size());
+        pScheduler->ParallelFor(NumPSOs, NumPSOs, [&](Uint32 ThreadId, Uint32 ChunkIndex, Uint32 Begin, Uint32 End) {
+            for (Uint32 i = Begin; i < End; ++i)
+                CreateObject(m_PipelineStates[i]->Func, m_PipelineStates[i]->Promise);
+        });
+    }
+
+    m_Shaders.clear();
+    m_PipelineStates.clear();
+}
+
+} // namespace Diligent
@@ -0,0 +1,264 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+
+#include "RingUploadBuffer.hpp"
+#include "Align.hpp"
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Capacity is a multiple of the maximum alignment, so that aligned positions
+// are also aligned in the buffer.
+constexpr Uint32 MaxAlignment = 256;
+
+RESOURCE_STATE GetReadState(BIND_FLAGS BindFlags)
+{
+    RESOURCE_STATE State = RESOURCE_STATE_UNKNOWN;
+    if (BindFlags & BIND_VERTEX_BUFFER)
+        State |= RESOURCE_STATE_VERTEX_BUFFER;
+    if (BindFlags & BIND_INDEX_BUFFER)
+        State |= RESOURCE_STATE_INDEX_BUFFER;
+    if (BindFlags & BIND_UNIFORM_BUFFER)
+        State |= RESOURCE_STATE_CONSTANT_BUFFER;
+    if (BindFlags & BIND_SHADER_RESOURCE)
+        State |= RESOURCE_STATE_SHADER_RESOURCE;
+    if (BindFlags & BIND_INDIRECT_DRAW_ARGS)
+        State |= RESOURCE_STATE_INDIRECT_ARGUMENT;
+    return State;
+}
+
+} // namespace
+
+RingUploadBuffer::RingUploadBuffer(IRenderDevice* pDevice, IDeviceContext* pImmediateCtx, const CreateInfo& CI) :
+    m_Capacity{AlignUp(std::max(CI.Size, Uint64{MaxAlignment}), Uint64{MaxAlignment})},
+    m_ReadState{GetReadState(CI.BindFlags)}
+{
+    const auto& MemInfo = pDevice->GetAdapterInfo().Memory;
+
+    const bool UsePersistentMapping =
+        CI.AllowPersistentMapping &&
+        MemInfo.UnifiedMemory > 0 &&
+        (MemInfo.UnifiedMemoryCPUAccess & CPU_ACCESS_WRITE) != 0;
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name      = CI.Name != nullptr ? CI.Name : "Ring upload buffer";
+    BuffDesc.BindFlags = CI.BindFlags;
+    BuffDesc.Size      = m_Capacity;
+    if (UsePersistentMapping)
+    {
+        BuffDesc.Usage          = USAGE_UNIFIED;
+        BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    }
+    else
+    {
+        BuffDesc.Usage = USAGE_DEFAULT;
+    }
+    pDevice->CreateBuffer(BuffDesc, nullptr, &m_pBuffer);
+    if (!m_pBuffer)
+        LOG_ERROR_AND_THROW("Failed to create buffer '", BuffDesc.Name, "'");
+
+    if (UsePersistentMapping)
+    {
+        // Unified memory is accessible by both CPU and GPU, so the buffer stays mapped
+        // while the GPU reads from it. The ring guarantees that the CPU never writes
+        // memory that is in use.
+        PVoid pMappedData = nullptr;
+        pImmediateCtx->MapBuffer(m_pBuffer, MAP_WRITE, MAP_FLAG_NO_OVERWRITE, pMappedData);
+        if (pMappedData == nullptr)
+            LOG_ERROR_AND_THROW("Failed to map buffer '", BuffDesc.Name, "'");
+
+        m_pData      = static_cast<Uint8*>(pMappedData);
+        m_pMappedCtx = pImmediateCtx;
+    }
+    else
+    {
+        m_CPUData.resize(static_cast<size_t>(m_Capacity));
+        m_pData = m_CPUData.data();
+    }
+
+    StateTransitionDesc Barrier{m_pBuffer, RESOURCE_STATE_UNKNOWN, m_ReadState, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    pImmediateCtx->TransitionResourceStates(1, &Barrier);
+
+    FenceDesc FenceCI;
+    FenceCI.Name = "Ring upload buffer fence";
+    pDevice->CreateFence(FenceCI, &m_pFence);
+    if (!m_pFence)
+        LOG_ERROR_AND_THROW("Failed to create ring upload buffer fence");
+}
+
+RingUploadBuffer::~RingUploadBuffer()
+{
+    // The buffer is released only after the GPU is done with it,
+    // so there is no need to wait for the frames in flight.
+    if (m_pMappedCtx)
+        m_pMappedCtx->UnmapBuffer(m_pBuffer, MAP_WRITE);
+}
+
+RingUploadBuffer::Allocation RingUploadBuffer::Allocate(Uint64 Size, Uint32 Alignment)
+{
+    VERIFY(IsPowerOfTwo(Alignment) && Alignment <= MaxAlignment, "Alignment (", Alignment, ") must be a power of two not greater than ", MaxAlignment);
+
+    if (Size == 0 || Size > m_Capacity)
+    {
+        m_NumFailedAllocations.fetch_add(1);
+        return {};
+    }
+
+    Uint64 Head = m_Head.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        auto Start = AlignUp(Head, Uint64{Alignment});
+        // Allocations never wrap around the end of the buffer. If the allocation does
+        // not fit into the rest of the buffer, skip to the beginning of the next lap.
+        if (Start % m_Capacity + Size > m_Capacity)
+            Start = (Start / m_Capacity + 1) * m_Capacity;
+
+        const auto End = Start + Size;
+        if (End - m_Tail.load(std::memory_order_acquire) > m_Capacity)
+        {
+            if (!ReleaseMemory(End))
+            {
+                m_NumFailedAllocations.fetch_add(1);
+                return {};
+            }
+            Head = m_Head.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        if (m_Head.compare_exchange_weak(Head, End, std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            const auto Offset = Start % m_Capacity;
+            return {Offset, m_pData + Offset};
+        }
+        // Another thread advanced the head - Head now contains the new value, retry
+    }
+}
+
+void RingUploadBuffer::RetireCompletedFrames()
+{
+    const auto CompletedValue = m_pFence->GetCompletedValue();
+    while (!m_FramesInFlight.empty() && m_FramesInFlight.front().FenceValue <= CompletedValue)
+    {
+        m_Tail.store(m_FramesInFlight.front().EndPos, std::memory_order_release);
+        m_FramesInFlight.pop_front();
+    }
+}
+
+bool RingUploadBuffer::ReleaseMemory(Uint64 RequiredEnd)
+{
+    std::lock_guard<std::mutex> Lock{m_RetireMtx};
+    for (;;)
+    {
+        RetireCompletedFrames();
+        if (RequiredEnd - m_Tail.load(std::memory_order_relaxed) <= m_Capacity)
+            return true;
+
+        // The memory is used by the current frame only - waiting will not help
+        if (m_FramesInFlight.empty())
+            return false;
+
+        m_NumStalls.fetch_add(1);
+        m_pFence->Wait(m_FramesInFlight.front().FenceValue);
+    }
+}
+
+void RingUploadBuffer::Commit(IDeviceContext* pImmediateCtx)
+{
+    const auto Head = m_Head.load(std::memory_order_acquire);
+    if (Head == m_CommittedPos)
+        return;
+
+    // The range may cross the end of the buffer, in which case it is split in two.
+    // The padding skipped at the end of a lap is uploaded too, which is harmless.
+    auto Pos = m_CommittedPos;
+    while (Pos < Head)
+    {
+        const auto Offset = Pos % m_Capacity;
+        const auto Size   = std::min(Head - Pos, m_Capacity - Offset);
+        if (m_pMappedCtx)
+        {
+            // No-op for coherent memory
+            m_pBuffer->FlushMappedRange(Offset, Size);
+        }
+        else
+        {
+            pImmediateCtx->UpdateBuffer(m_pBuffer, Offset, Size, m_pData + Offset, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        }
+        Pos += Size;
+    }
+
+    if (!m_pMappedCtx)
+    {
+        // Return the buffer to the state that the commands reading the data expect
+        StateTransitionDesc Barrier{m_pBuffer, RESOURCE_STATE_UNKNOWN, m_ReadState, STATE_TRANSITION_FLAG_UPDATE_STATE};
+        pImmediateCtx->TransitionResourceStates(1, &Barrier);
+    }
+
+    m_CommittedPos = Head;
+}
+
+void RingUploadBuffer::FinishFrame(IDeviceContext* pImmediateCtx)
+{
+    const auto FrameEnd = m_Head.load(std::memory_order_acquire);
+    VERIFY(FrameEnd == m_CommittedPos, "All allocations must be committed before the frame is finished");
+
+    pImmediateCtx->EnqueueSignal(m_pFence, m_NextFenceValue);
+    {
+        std::lock_guard<std::mutex> Lock{m_RetireMtx};
+        m_FramesInFlight.push_back({m_NextFenceValue, FrameEnd});
+        RetireCompletedFrames();
+
+        const auto UsedSize = FrameEnd - m_Tail.load(std::memory_order_relaxed);
+        if (UsedSize > m_PeakUsedSize.load(std::memory_order_relaxed))
+            m_PeakUsedSize.store(UsedSize, std::memory_order_relaxed);
+    }
+    ++m_NextFenceValue;
+
+    m_LastFrameSize.store(FrameEnd - m_FrameStartPos, std::memory_order_relaxed);
+    m_FrameStartPos = FrameEnd;
+}
+
+RingUploadBuffer::Statistics RingUploadBuffer::GetStatistics() const
+{
+    Statistics Stats;
+    Stats.Capacity             = m_Capacity;
+    Stats.UsedSize             = m_Head.load() - m_Tail.load();
+    Stats.PeakUsedSize         = m_PeakUsedSize.load();
+    Stats.LastFrameSize        = m_LastFrameSize.load();
+    Stats.NumStalls            = m_NumStalls.load();
+    Stats.NumFailedAllocations = m_NumFailedAllocations.load();
+    return Stats;
+}
+
+} // namespace Diligent
@@ -29,6 +29,9 @@
 #include <iomanip>
 #include <cstdlib>
 #include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <thread>
 
 #include "PlatformDefinitions.h"
 #include "SampleApp.hpp"
@@ -37,6 +40,10 @@
 #include "MapHelper.hpp"
 #include "Image.h"
 #include "FileWrapper.hpp"
+#include "OffscreenSwapChain.hpp"
+#include "GraphicsAccessories.hpp"
+#include "ImageDiff.hpp"
+#include "ShaderCache.hpp"
 
 #if D3D11_SUPPORTED
 #    include "EngineFactoryD3D11.h"
@@ -73,9 +80,31 @@ SampleApp::SampleApp() :
 
 SampleApp::~SampleApp()
 {
+    ReleaseEngine();
+}
+
+void SampleApp::ReleaseEngine()
+{
+    // Finish writing all pending screen captures. The captures that were still
+    // in the queue may fail, so the exit code must be updated after the flush.
+    if (m_pImageWriter)
+    {
+        m_pImageWriter->WaitIdle();
+        if (m_ExitCode == 0)
+            m_ExitCode = m_pImageWriter->GetErrorCode();
+        m_pImageWriter.reset();
+    }
+
     m_pImGui.reset();
     m_TheSample.reset();
 
+    if (m_pShaderCache)
+    {
+        const auto Stats = m_pShaderCache->GetStatistics();
+        LOG_INFO_MESSAGE("Shader cache: ", Stats.NumHits, " hits, ", Stats.NumMisses, " misses, ", Stats.NumBypassed, " shaders not cached");
+        m_pShaderCache.reset();
+    }
+
     if (!m_pDeviceContexts.empty())
     {
         for (Uint32 q = 0; q < m_NumImmediateContexts; ++q)
@@ -87,6 +116,18 @@ SampleApp::~SampleApp()
     m_pDevice.Release();
 }
 
+int SampleApp::GetExitCode() const
+{
+    if (m_pImageWriter)
+    {
+        // Screen captures that are still queued may fail, so wait until they are written
+        m_pImageWriter->WaitIdle();
+        if (m_ExitCode == 0)
+            return m_pImageWriter->GetErrorCode();
+    }
+    return m_ExitCode;
+}
+
 
 void SampleApp::InitializeDiligentEngine(const NativeWindow* pWindow)
 {
@@ -310,6 +351,28 @@ void SampleApp::InitializeDiligentEngine(const NativeWindow* pWindow)
             auto* pFactoryVk = GetEngineFactoryVk();
             m_pEngineFactory = pFactoryVk;
 
+            Uint32 NumAdapters = 0;
+            pFactoryVk->EnumerateAdapters(EngineCI.GraphicsAPIVersion, NumAdapters, nullptr);
+            std::vector<GraphicsAdapterInfo> Adapters(NumAdapters);
+            if (NumAdapters > 0)
+                pFactoryVk->EnumerateAdapters(EngineCI.GraphicsAPIVersion, NumAdapters, Adapters.data());
+
+            if (m_AdapterType == ADAPTER_TYPE_SOFTWARE)
+            {
+                // Look for a software ICD such as lavapipe or SwiftShader
+                for (Uint32 i = 0; i < Adapters.size(); ++i)
+                {
+                    if (Adapters[i].Type == m_AdapterType)
+                    {
+                        EngineCI.AdapterId = i;
+                        LOG_INFO_MESSAGE("Found software adapter '", Adapters[i].Description, "'");
+                        break;
+                    }
+                }
+                if (EngineCI.AdapterId == DEFAULT_ADAPTER_ID)
+                    LOG_WARNING_MESSAGE("Failed to find a software Vulkan adapter. Using the default adapter.");
+            }
+
             m_TheSample->ModifyEngineInitInfo({pFactoryVk, m_DeviceType, EngineCI, m_SwapChainInitDesc});
 
             NumImmediateContexts = std::max(1u, EngineCI.NumImmediateContexts);
@@ -321,6 +384,9 @@ void SampleApp::InitializeDiligentEngine(const NativeWindow* pWindow)
                                     "or required features may not be supported by this GPU/driver/OS version.");
             }
 
+            // With the default adapter ID the engine picks the adapter itself, so ask the device which one it is
+            m_AdapterAttribs = EngineCI.AdapterId < Adapters.size() ? Adapters[EngineCI.AdapterId] : m_pDevice->GetAdapterInfo();
+
             if (!m_pSwapChain && pWindow != nullptr)
                 pFactoryVk->CreateSwapChainVk(m_pDevice, ppContexts[0], m_SwapChainInitDesc, *pWindow, &m_pSwapChain);
         }
@@ -381,6 +447,9 @@ void SampleApp::InitializeDiligentEngine(const NativeWindow* pWindow)
     for (size_t i = 0; i < ppContexts.size(); ++i)
         m_pDeviceContexts[i].Attach(ppContexts[i]);
 
+    if (!m_ShaderCacheDir.empty())
+        m_pShaderCache.reset(new ShaderCache{m_pDevice, m_ShaderCacheDir});
+
     if (m_ScreenCaptureInfo.AllowCapture)
     {
         if (m_GoldenImgMode != GoldenImageMode::None)
@@ -390,6 +459,10 @@ void SampleApp::InitializeDiligentEngine(const NativeWindow* pWindow)
         }
 
         m_pScreenCapture.reset(new ScreenCapture(m_pDevice));
+
+        // Encoding is CPU-heavy, but we don't want to compete with the render thread and the sample's workers
+        const auto NumWriterThreads = std::max(std::min(std::thread::hardware_concurrency() / 4u, 4u), 1u);
+        m_pImageWriter.reset(new AsyncImageWriter{NumWriterThreads, m_ScreenCaptureInfo.MaxQueueDepth});
     }
 }
 
@@ -432,6 +505,7 @@ void SampleApp::InitializeSample()
     InitInfo.NumDeferredCtx = static_cast<Uint32>(m_pDeviceContexts.size()) - m_NumImmediateContexts;
     InitInfo.pSwapChain     = m_pSwapChain;
     InitInfo.pImGui         = m_pImGui.get();
+    InitInfo.pShaderCache   = m_pShaderCache.get();
     m_TheSample->Initialize(InitInfo);
 
     m_TheSample->WindowResize(SCDesc.Width, SCDesc.Height);
@@ -569,6 +643,16 @@ std::string GetArgument(const char*& pos, const char* ArgName)
 //
 //     magick convert  -delay 6  -loop 0 -layers Optimize -compress LZW -strip -resize 240x180   frame*.png   Animation.gif
 //
+// Command line example to run the sample headless for 500 frames on a software Vulkan device
+// and write per-frame CPU timings to a JSON file (the app exits when the benchmark is complete):
+//
+//     -mode vk -adapter sw -width 1280 -height 720 -benchmark 500 -benchmark_warmup 10 -benchmark_output Tutorial01.json
+//
+// Command line example to load compiled shaders from the cache and add new ones to it
+// (the directory can be shared by all samples):
+//
+//     -mode vk -shader_cache shader_cache
+//
 void SampleApp::ProcessCommandLine(const char* CmdLine)
 {
     const auto* pos = strchr(CmdLine, '-');
@@ -660,6 +744,10 @@ void SampleApp::ProcessCommandLine(const char* CmdLine)
         {
             m_ScreenCaptureInfo.JpegQuality = atoi(Arg.c_str());
         }
+        else if (!(Arg = GetArgument(pos, "capture_queue")).empty())
+        {
+            m_ScreenCaptureInfo.MaxQueueDepth = static_cast<Uint32>(std::max(atoi(Arg.c_str()), 1));
+        }
         else if (!(Arg = GetArgument(pos, "capture_alpha")).empty())
         {
             m_ScreenCaptureInfo.KeepAlpha = (StrCmpNoCase(Arg.c_str(), "true", Arg.length()) == 0) || Arg == "1";
@@ -724,6 +812,10 @@ void SampleApp::ProcessCommandLine(const char* CmdLine)
         {
             m_GoldenImgPixelTolerance = atoi(Arg.c_str());
         }
+        else if (!(Arg = GetArgument(pos, "golden_image_diff")).empty())
+        {
+            m_bWriteGoldenImgDiff = (StrCmpNoCase(Arg.c_str(), "true", Arg.length()) == 0) || Arg == "1";
+        }
         else if (!(Arg = GetArgument(pos, "vsync")).empty())
         {
             m_bVSync = (StrCmpNoCase(Arg.c_str(), "true", Arg.length()) == 0) || (StrCmpNoCase(Arg.c_str(), "on", Arg.length()) == 0) || Arg == "1";
@@ -732,6 +824,26 @@ void SampleApp::ProcessCommandLine(const char* CmdLine)
         {
             m_bForceNonSeprblProgs = (StrCmpNoCase(Arg.c_str(), "true", Arg.length()) == 0) || (StrCmpNoCase(Arg.c_str(), "on", Arg.length()) == 0) || Arg == "1";
         }
+        else if (!(Arg = GetArgument(pos, "benchmark")).empty())
+        {
+            auto NumFrames = atoi(Arg.c_str());
+            VERIFY_EXPR(NumFrames >= 0);
+            m_BenchmarkInfo.NumFrames = static_cast<Uint32>(std::max(NumFrames, 0));
+        }
+        else if (!(Arg = GetArgument(pos, "benchmark_warmup")).empty())
+        {
+            auto NumFrames = atoi(Arg.c_str());
+            VERIFY_EXPR(NumFrames >= 0);
+            m_BenchmarkInfo.WarmupFrames = static_cast<Uint32>(std::max(NumFrames, 0));
+        }
+        else if (!(Arg = GetArgument(pos, "benchmark_output")).empty())
+        {
+            m_BenchmarkInfo.OutputPath = std::move(Arg);
+        }
+        else if (!(Arg = GetArgument(pos, "shader_cache")).empty())
+        {
+            m_ShaderCacheDir = std::move(Arg);
+        }
 
         pos = strchr(pos, '-');
     }
@@ -754,6 +866,14 @@ void SampleApp::ProcessCommandLine(const char* CmdLine)
     }
 
     m_TheSample->ProcessCommandLine(CmdLine);
+
+    if (m_BenchmarkInfo.NumFrames > 0)
+    {
+        // The benchmark runs headless, so control must not return to the platform layer, which
+        // would create a window and enter the message loop. RunBenchmark() has already released
+        // the engine and the sample.
+        std::exit(RunBenchmark());
+    }
 }
 
 void SampleApp::WindowResize(int width, int height)
@@ -842,29 +962,73 @@ void SampleApp::CompareGoldenImage(const std::string& FileName, ScreenCapture::C
         return;
     }
 
+    if (GoldenImgDesc.ComponentType != VT_UINT8 || (GoldenImgDesc.NumComponents != 3 && GoldenImgDesc.NumComponents != 4))
+    {
+        LOG_ERROR_MESSAGE("Golden image must be an 8-bit RGB or RGBA image");
+        m_ExitCode = -2;
+        return;
+    }
+
     auto* const pCtx = GetImmediateContext();
 
     MappedTextureSubresource TexData;
     pCtx->MapTextureSubresource(Capture.pTexture, 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, TexData);
-    auto CapturedPixels = Image::ConvertImageData(TexDesc.Width, TexDesc.Height,
-                                                  reinterpret_cast<const Uint8*>(TexData.pData), static_cast<Uint32>(TexData.Stride),
-                                                  TexDesc.Format, TEX_FORMAT_RGBA8_UNORM, false /*Keep alpha*/);
+
+    ImageDiffAttribs DiffAttribs;
+    DiffAttribs.Width  = TexDesc.Width;
+    DiffAttribs.Height = TexDesc.Height;
+
+    // RGBA8 captures are compared in place. Other formats (e.g. BGRA8) are converted to RGBA8 first.
+    std::vector<Uint8> CapturedPixels;
+    if (TexDesc.Format == TEX_FORMAT_RGBA8_UNORM || TexDesc.Format == TEX_FORMAT_RGBA8_UNORM_SRGB)
+    {
+        DiffAttribs.pImage1 = reinterpret_cast<const Uint8*>(TexData.pData);
+        DiffAttribs.Stride1 = static_cast<Uint32>(TexData.Stride);
+    }
+    else
+    {
+        CapturedPixels = Image::ConvertImageData(TexDesc.Width, TexDesc.Height,
+                                                 reinterpret_cast<const Uint8*>(TexData.pData), static_cast<Uint32>(TexData.Stride),
+                                                 TexDesc.Format, TEX_FORMAT_RGBA8_UNORM, true /*Keep alpha*/);
+        DiffAttribs.pImage1 = CapturedPixels.data();
+        DiffAttribs.Stride1 = TexDesc.Width * 4;
+    }
+    DiffAttribs.NumComponents1 = 4;
+    DiffAttribs.pImage2        = reinterpret_cast<const Uint8*>(pGoldenImg->GetData()->GetDataPtr());
+    DiffAttribs.Stride2        = GoldenImgDesc.RowStride;
+    DiffAttribs.NumComponents2 = GoldenImgDesc.NumComponents;
+    DiffAttribs.Tolerance      = static_cast<Uint8>(std::min(std::max(m_GoldenImgPixelTolerance, 0), 255));
+
+    std::vector<Uint8> Heatmap;
+    if (m_bWriteGoldenImgDiff)
+    {
+        Heatmap.resize(size_t{TexDesc.Width} * size_t{TexDesc.Height} * 4);
+        DiffAttribs.pDiffHeatmap = Heatmap.data();
+    }
+
+    const auto DiffInfo = ComputeImageDifference(DiffAttribs);
     pCtx->UnmapTextureSubresource(Capture.pTexture, 0, 0);
 
-    auto* pGoldenImgPixels = reinterpret_cast<const Uint8*>(pGoldenImg->GetData()->GetDataPtr());
+    m_ExitCode = static_cast<int>(DiffInfo.NumDiffPixels);
+    if (DiffInfo.NumDiffPixels > 0)
+    {
+        LOG_INFO_MESSAGE("Golden image comparison: ", DiffInfo.NumDiffPixels, " pixels differ. Max difference: ", DiffInfo.MaxDifference,
+                         ", PSNR: ", DiffInfo.PSNR, " dB");
+    }
 
-    m_ExitCode = 0;
-    for (size_t row = 0; row < TexDesc.Height; ++row)
+    if (m_bWriteGoldenImgDiff && DiffInfo.NumDiffPixels > 0)
     {
-        for (size_t col = 0; col < TexDesc.Width; ++col)
-        {
-            const auto* SrcPixel = &CapturedPixels[(col + row * size_t{TexDesc.Width}) * 3u];
-            const auto* DstPixel = pGoldenImgPixels + row * size_t{GoldenImgDesc.RowStride} + col * size_t{GoldenImgDesc.NumComponents};
-            if (std::abs(int{SrcPixel[0]} - int{DstPixel[0]}) > m_GoldenImgPixelTolerance ||
-                std::abs(int{SrcPixel[1]} - int{DstPixel[1]}) > m_GoldenImgPixelTolerance ||
-                std::abs(int{SrcPixel[2]} - int{DstPixel[2]}) > m_GoldenImgPixelTolerance)
-                ++m_ExitCode;
-        }
+        const auto ExtPos = FileName.find_last_of('.');
+
+        AsyncImageWriter::ImageInfo Info;
+        Info.FileName   = FileName.substr(0, ExtPos) + "_diff.png";
+        Info.Width      = TexDesc.Width;
+        Info.Height     = TexDesc.Height;
+        Info.Stride     = TexDesc.Width * 4;
+        Info.TexFormat  = TEX_FORMAT_RGBA8_UNORM;
+        Info.FileFormat = IMAGE_FILE_FORMAT_PNG;
+        m_pImageWriter->Enqueue(std::move(Info), std::move(Heatmap));
+        m_pImageWriter->WaitIdle();
     }
 }
 
@@ -872,39 +1036,40 @@ void SampleApp::SaveScreenCapture(const std::string& FileName, ScreenCapture::Ca
 {
     auto* const pCtx = GetImmediateContext();
 
+    const auto& TexDesc    = Capture.pTexture->GetDesc();
+    const auto& FmtAttribs = GetTextureFormatAttribs(TexDesc.Format);
+    const auto  RowSize    = size_t{TexDesc.Width} * FmtAttribs.GetElementSize();
+
+    // Only copy the pixels while the staging texture is mapped. Encoding and writing
+    // the file happen on the writer threads, so the render thread is not stalled.
+    auto Pixels = m_pImageWriter->AcquireBuffer(RowSize * TexDesc.Height);
+
     MappedTextureSubresource TexData;
     pCtx->MapTextureSubresource(Capture.pTexture, 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, TexData);
-    const auto& TexDesc = Capture.pTexture->GetDesc();
+    for (Uint32 row = 0; row < TexDesc.Height; ++row)
+    {
+        memcpy(&Pixels[row * RowSize],
+               reinterpret_cast<const Uint8*>(TexData.pData) + row * size_t{TexData.Stride},
+               RowSize);
+    }
+    pCtx->UnmapTextureSubresource(Capture.pTexture, 0, 0);
 
-    Image::EncodeInfo Info;
+    AsyncImageWriter::ImageInfo Info;
+    Info.FileName    = FileName;
     Info.Width       = TexDesc.Width;
     Info.Height      = TexDesc.Height;
+    Info.Stride      = static_cast<Uint32>(RowSize);
     Info.TexFormat   = TexDesc.Format;
     Info.KeepAlpha   = m_ScreenCaptureInfo.KeepAlpha;
-    Info.pData       = TexData.pData;
-    Info.Stride      = static_cast<Uint32>(TexData.Stride);
     Info.FileFormat  = m_ScreenCaptureInfo.FileFormat;
     Info.JpegQuality = m_ScreenCaptureInfo.JpegQuality;
+    m_pImageWriter->Enqueue(std::move(Info), std::move(Pixels));
 
-    RefCntAutoPtr<IDataBlob> pEncodedImage;
-    Image::Encode(Info, &pEncodedImage);
-    pCtx->UnmapTextureSubresource(Capture.pTexture, 0, 0);
-
-    FileWrapper pFile(FileName.c_str(), EFileAccessMode::Overwrite);
-    if (pFile)
+    if (m_GoldenImgMode != GoldenImageMode::None)
     {
-        auto res = pFile->Write(pEncodedImage->GetDataPtr(), pEncodedImage->GetSize());
-        if (!res)
-        {
-            LOG_ERROR_MESSAGE("Failed to write screen capture file '", FileName, "'.");
-            m_ExitCode = -5;
-        }
-        pFile.Close();
-    }
-    else
-    {
-        LOG_ERROR_MESSAGE("Failed to create screen capture file '", FileName, "'. Verify that the directory exists and the app has sufficient rights to write to this directory.");
-        m_ExitCode = -6;
+        // The app exits right after the golden image frame, so the file must be on disk
+        // and the error code must be known before we return.
+        m_pImageWriter->WaitIdle();
     }
 }
 
@@ -979,7 +1144,234 @@ void SampleApp::Present()
 
             m_pScreenCapture->RecycleStagingTexture(std::move(Capture.pTexture));
         }
+
+        if (m_pImageWriter && m_ExitCode == 0)
+            m_ExitCode = m_pImageWriter->GetErrorCode();
+    }
+}
+
+namespace
+{
+
+struct TimingStats
+{
+    double Mean = 0;
+    double P50  = 0;
+    double P95  = 0;
+    double P99  = 0;
+    double Max  = 0;
+};
+
+// Computes statistics using the nearest-rank percentile method
+TimingStats ComputeTimingStats(std::vector<double> Values)
+{
+    TimingStats Stats;
+    if (Values.empty())
+        return Stats;
+
+    std::sort(Values.begin(), Values.end());
+
+    const auto Percentile = [&Values](double P) {
+        auto Rank = static_cast<size_t>(std::ceil(P / 100.0 * static_cast<double>(Values.size())));
+        return Values[std::min(std::max(Rank, size_t{1}), Values.size()) - 1];
+    };
+
+    double Sum = 0;
+    for (auto Val : Values)
+        Sum += Val;
+
+    Stats.Mean = Sum / static_cast<double>(Values.size());
+    Stats.P50  = Percentile(50);
+    Stats.P95  = Percentile(95);
+    Stats.P99  = Percentile(99);
+    Stats.Max  = Values.back();
+    return Stats;
+}
+
+void WriteJsonTimingStats(std::stringstream& ss, const char* Name, const TimingStats& Stats)
+{
+    ss << "    \"" << Name << "\": {"
+       << "\"mean_ms\": " << Stats.Mean * 1000.0 << ", "
+       << "\"p50_ms\": " << Stats.P50 * 1000.0 << ", "
+       << "\"p95_ms\": " << Stats.P95 * 1000.0 << ", "
+       << "\"p99_ms\": " << Stats.P99 * 1000.0 << ", "
+       << "\"max_ms\": " << Stats.Max * 1000.0 << "}";
+}
+
+std::string EscapeJsonString(const char* Str)
+{
+    std::string Escaped;
+    for (; Str != nullptr && *Str != 0; ++Str)
+    {
+        if (*Str == '"' || *Str == '\\')
+            Escaped.push_back('\\');
+        if (static_cast<unsigned char>(*Str) >= 0x20)
+            Escaped.push_back(*Str);
     }
+    return Escaped;
+}
+
+} // namespace
+
+int SampleApp::RunBenchmark()
+{
+#if PLATFORM_WIN32 || PLATFORM_LINUX || PLATFORM_MACOS
+    if (m_DeviceType == RENDER_DEVICE_TYPE_GL || m_DeviceType == RENDER_DEVICE_TYPE_GLES)
+    {
+        // OpenGL context can't be created without a window
+#    if VULKAN_SUPPORTED
+        LOG_WARNING_MESSAGE("OpenGL backend can't run headless. Switching to Vulkan for the benchmark.");
+        m_DeviceType = RENDER_DEVICE_TYPE_VULKAN;
+#    else
+        LOG_ERROR_MESSAGE("OpenGL backend can't run headless. Please select another device type for the benchmark.");
+        m_ExitCode = -7;
+        return m_ExitCode;
+#    endif
+    }
+
+    auto& Frames = m_BenchmarkInfo.Frames;
+    try
+    {
+        InitializeDiligentEngine(nullptr);
+
+        SwapChainDesc SCDesc = m_SwapChainInitDesc;
+        SCDesc.Width         = m_InitialWindowWidth > 0 ? static_cast<Uint32>(m_InitialWindowWidth) : 1024;
+        SCDesc.Height        = m_InitialWindowHeight > 0 ? static_cast<Uint32>(m_InitialWindowHeight) : 768;
+        CreateOffscreenSwapChain(m_pDevice, GetImmediateContext(), SCDesc, &m_pSwapChain);
+        if (!m_pSwapChain)
+            LOG_ERROR_AND_THROW("Failed to create offscreen swap chain");
+
+        m_pImGui.reset(new ImGuiImplDiligent(m_pDevice, SCDesc.ColorBufferFormat, SCDesc.DepthBufferFormat));
+        InitializeSample();
+
+        using Clock    = std::chrono::high_resolution_clock;
+        using SecondsD = std::chrono::duration<double>;
+
+        const auto TotalFrames = m_BenchmarkInfo.WarmupFrames + m_BenchmarkInfo.NumFrames;
+        Frames.clear();
+        Frames.reserve(m_BenchmarkInfo.NumFrames);
+
+        // SampleApp drives the frames itself: there is no window and no platform message loop
+        const auto StartTime     = Clock::now();
+        auto       PrevFrameTime = StartTime;
+        auto       MeasureStart  = StartTime;
+        for (Uint32 frame = 0; frame < TotalFrames; ++frame)
+        {
+            if (frame == m_BenchmarkInfo.WarmupFrames)
+                MeasureStart = Clock::now();
+
+            const auto UpdateStart = Clock::now();
+            const auto CurrTime    = std::chrono::duration_cast<SecondsD>(UpdateStart - StartTime).count();
+            const auto ElapsedTime = std::chrono::duration_cast<SecondsD>(UpdateStart - PrevFrameTime).count();
+            PrevFrameTime          = UpdateStart;
+
+            Update(CurrTime, ElapsedTime);
+            const auto RenderStart = Clock::now();
+            Render();
+            const auto PresentStart = Clock::now();
+            Present();
+            const auto FrameEnd = Clock::now();
+
+            if (frame >= m_BenchmarkInfo.WarmupFrames)
+            {
+                BenchmarkInfo::FrameTimings Timings;
+                Timings.Update  = std::chrono::duration_cast<SecondsD>(RenderStart - UpdateStart).count();
+                Timings.Render  = std::chrono::duration_cast<SecondsD>(PresentStart - RenderStart).count();
+                Timings.Present = std::chrono::duration_cast<SecondsD>(FrameEnd - PresentStart).count();
+                Frames.push_back(Timings);
+            }
+        }
+
+        // Include the GPU work of the last frames into the total time
+        GetImmediateContext()->WaitForIdle();
+        m_BenchmarkInfo.TotalTime = std::chrono::duration_cast<SecondsD>(Clock::now() - MeasureStart).count();
+
+        WriteBenchmarkReport();
+    }
+    catch (...)
+    {
+        LOG_ERROR_MESSAGE("Failed to run the benchmark");
+        m_ExitCode = -8;
+    }
+
+    ReleaseEngine();
+#else
+    LOG_ERROR_MESSAGE("Benchmark mode is not supported on this platform");
+    m_ExitCode = -7;
+#endif
+
+    return GetExitCode();
+}
+
+void SampleApp::WriteBenchmarkReport()
+{
+    const auto& Frames = m_BenchmarkInfo.Frames;
+
+    std::vector<double> UpdateTimes(Frames.size());
+    std::vector<double> RenderTimes(Frames.size());
+    std::vector<double> PresentTimes(Frames.size());
+    std::vector<double> FrameTimes(Frames.size());
+    for (size_t i = 0; i < Frames.size(); ++i)
+    {
+        UpdateTimes[i]  = Frames[i].Update;
+        RenderTimes[i]  = Frames[i].Render;
+        PresentTimes[i] = Frames[i].Present;
+        FrameTimes[i]   = Frames[i].Update + Frames[i].Render + Frames[i].Present;
+    }
+
+    const auto& SCDesc = m_pSwapChain->GetDesc();
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(4);
+    ss << "{\n"
+       << "  \"sample\": \"" << EscapeJsonString(m_TheSample->GetSampleName()) << "\",\n"
+       << "  \"device\": \"" << GetRenderDeviceTypeString(m_DeviceType) << "\",\n"
+       << "  \"adapter\": \"" << EscapeJsonString(m_AdapterAttribs.Description) << "\",\n"
+       << "  \"width\": " << SCDesc.Width << ",\n"
+       << "  \"height\": " << SCDesc.Height << ",\n"
+       << "  \"warmup_frames\": " << m_BenchmarkInfo.WarmupFrames << ",\n"
+       << "  \"num_frames\": " << Frames.size() << ",\n"
+       << "  \"total_time_s\": " << m_BenchmarkInfo.TotalTime << ",\n"
+       << "  \"avg_fps\": " << (m_BenchmarkInfo.TotalTime > 0 ? static_cast<double>(Frames.size()) / m_BenchmarkInfo.TotalTime : 0.0) << ",\n"
+       << "  \"summary\": {\n";
+    WriteJsonTimingStats(ss, "update", ComputeTimingStats(std::move(UpdateTimes)));
+    ss << ",\n";
+    WriteJsonTimingStats(ss, "render", ComputeTimingStats(std::move(RenderTimes)));
+    ss << ",\n";
+    WriteJsonTimingStats(ss, "present", ComputeTimingStats(std::move(PresentTimes)));
+    ss << ",\n";
+    WriteJsonTimingStats(ss, "frame", ComputeTimingStats(std::move(FrameTimes)));
+    ss << "\n  },\n"
+       << "  \"frames\": [\n";
+    for (size_t i = 0; i < Frames.size(); ++i)
+    {
+        ss << "    {\"update_ms\": " << Frames[i].Update * 1000.0
+           << ", \"render_ms\": " << Frames[i].Render * 1000.0
+           << ", \"present_ms\": " << Frames[i].Present * 1000.0 << "}"
+           << (i + 1 < Frames.size() ? ",\n" : "\n");
+    }
+    ss << "  ]\n"
+       << "}\n";
+
+    const auto Report = ss.str();
+
+    FileWrapper pFile(m_BenchmarkInfo.OutputPath.c_str(), EFileAccessMode::Overwrite);
+    if (pFile)
+    {
+        if (!pFile->Write(Report.data(), Report.size()))
+        {
+            LOG_ERROR_MESSAGE("Failed to write benchmark report '", m_BenchmarkInfo.OutputPath, "'.");
+            m_ExitCode = -5;
+        }
+        pFile.Close();
+    }
+    else
+    {
+        LOG_ERROR_MESSAGE("Failed to create benchmark report file '", m_BenchmarkInfo.OutputPath, "'.");
+        m_ExitCode = -6;
+    }
+
+    LOG_INFO_MESSAGE("Benchmark complete: ", Frames.size(), " frames in ", m_BenchmarkInfo.TotalTime, " s. Report: ", m_BenchmarkInfo.OutputPath);
 }
 
 } // namespace Diligent
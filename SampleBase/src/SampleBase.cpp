@@ -27,6 +27,7 @@
 
 #include "PlatformDefinitions.h"
 #include "SampleBase.hpp"
+#include "ShaderCache.hpp"
 #include "Errors.hpp"
 
 namespace Diligent
@@ -128,6 +129,14 @@ float4x4 SampleBase::GetAdjustedProjectionMatrix(float FOV, float NearPlane, flo
     return Proj;
 }
 
+void SampleBase::CreateShader(const ShaderCreateInfo& ShaderCI, IShader** ppShader)
+{
+    if (m_pShaderCache != nullptr)
+        m_pShaderCache->CreateShader(ShaderCI, ppShader);
+    else
+        m_pDevice->CreateShader(ShaderCI, ppShader);
+}
+
 float4x4 SampleBase::GetSurfacePretransformMatrix(const float3& f3CameraViewAxis) const
 {
     const auto& SCDesc = m_pSwapChain->GetDesc();
@@ -0,0 +1,411 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <cstring>
+#include <unordered_set>
+
+#include "ShaderCache.hpp"
+#include "APIInfo.h"
+#include "FileWrapper.hpp"
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Increment when the hash input or the file layout changes
+constexpr Uint32 ShaderCacheVersion = 1;
+constexpr Uint32 ShaderCacheMagic   = 0x48535344; // 'DSSH'
+
+struct CacheFileHeader
+{
+    Uint32 Magic    = ShaderCacheMagic;
+    Uint32 Version  = ShaderCacheVersion;
+    Uint64 Hash     = 0;
+    Uint64 Size     = 0;
+    Uint64 Checksum = 0;
+};
+
+// 64-bit FNV-1a. Unlike std::hash, the result is the same in every build,
+// so the cache can be shared by all samples and configurations.
+class Hasher
+{
+public:
+    void Update(const void* pData, size_t Size)
+    {
+        const auto* pBytes = static_cast<const Uint8*>(pData);
+        for (size_t i = 0; i < Size; ++i)
+        {
+            m_Hash ^= pBytes[i];
+            m_Hash *= 0x100000001b3ull;
+        }
+    }
+
+    template <typename T>
+    void Update(const T& Value)
+    {
+        Update(&Value, sizeof(Value));
+    }
+
+    void Update(const Char* Str)
+    {
+        // Hash the terminating zero too, so that {"ab", "c"} and {"a", "bc"} differ
+        if (Str != nullptr)
+            Update(Str, strlen(Str) + 1);
+        else
+            Update(Uint8{0xFF});
+    }
+
+    Uint64 Get() const { return m_Hash; }
+
+private:
+    Uint64 m_Hash = 0xcbf29ce484222325ull;
+};
+
+Uint64 ComputeChecksum(const void* pData, size_t Size)
+{
+    Hasher H;
+    H.Update(pData, Size);
+    return H.Get();
+}
+
+bool ReadSourceFile(IShaderSourceInputStreamFactory* pFactory, const Char* Name, std::string& Source)
+{
+    RefCntAutoPtr<IFileStream> pStream;
+    pFactory->CreateInputStream(Name, &pStream);
+    if (!pStream)
+        return false;
+
+    Source.resize(pStream->GetSize());
+    return Source.empty() || pStream->Read(&Source[0], Source.size());
+}
+
+// Hashes the source and, recursively, all files it includes.
+void HashSource(Hasher&                          H,
+                const Char*                      Source,
+                size_t                           Length,
+                IShaderSourceInputStreamFactory* pFactory,
+                std::unordered_set<std::string>& VisitedIncludes)
+{
+    H.Update(Source, Length);
+    H.Update(Length);
+    if (pFactory == nullptr)
+        return;
+
+    const auto* const pEnd = Source + Length;
+    for (const auto* pos = Source; pos < pEnd;)
+    {
+        const auto* pLineEnd = static_cast<const Char*>(memchr(pos, '\n', static_cast<size_t>(pEnd - pos)));
+        if (pLineEnd == nullptr)
+            pLineEnd = pEnd;
+
+        // Look for '#include "File"' or '#include <File>'
+        while (pos < pLineEnd && (*pos == ' ' || *pos == '\t'))
+            ++pos;
+        if (pos < pLineEnd && *pos == '#')
+        {
+            ++pos;
+            while (pos < pLineEnd && (*pos == ' ' || *pos == '\t'))
+                ++pos;
+
+            static constexpr Char   Include[]  = "include";
+            static constexpr size_t IncludeLen = sizeof(Include) - 1;
+            if (static_cast<size_t>(pLineEnd - pos) > IncludeLen && strncmp(pos, Include, IncludeLen) == 0)
+            {
+                pos += IncludeLen;
+                while (pos < pLineEnd && (*pos == ' ' || *pos == '\t'))
+                    ++pos;
+
+                if (pos < pLineEnd && (*pos == '"' || *pos == '<'))
+                {
+                    const Char  Closing  = *pos == '"' ? '"' : '>';
+                    const auto* pNameEnd = static_cast<const Char*>(memchr(pos + 1, Closing, static_cast<size_t>(pLineEnd - pos - 1)));
+                    if (pNameEnd != nullptr)
+                    {
+                        std::string IncludeName{pos + 1, pNameEnd};
+                        if (VisitedIncludes.insert(IncludeName).second)
+                        {
+                            H.Update(IncludeName.c_str());
+
+                            // If the file can't be found, the compiler will report the error
+                            std::string IncludeSource;
+                            if (ReadSourceFile(pFactory, IncludeName.c_str(), IncludeSource))
+                                HashSource(H, IncludeSource.data(), IncludeSource.size(), pFactory, VisitedIncludes);
+                        }
+                    }
+                }
+            }
+        }
+
+        pos = pLineEnd + 1;
+    }
+}
+
+} // namespace
+
+ShaderCache::ShaderCache(IRenderDevice* pDevice, const std::string& Directory) :
+    m_pDevice{pDevice},
+    m_Directory{Directory}
+{
+    VERIFY_EXPR(m_pDevice);
+    if (m_pDevice->GetDeviceInfo().IsGLDevice())
+    {
+        LOG_WARNING_MESSAGE("OpenGL shaders have no bytecode. Shader cache is disabled.");
+        return;
+    }
+
+    if (!FileSystem::PathExists(m_Directory.c_str()) && !FileSystem::CreateDirectory(m_Directory.c_str()))
+    {
+        LOG_ERROR_MESSAGE("Failed to create shader cache directory '", m_Directory, "'. Shader cache is disabled.");
+        return;
+    }
+
+    m_IsEnabled = true;
+    LOG_INFO_MESSAGE("Shader cache directory: ", m_Directory);
+}
+
+bool ShaderCache::ComputeHash(const ShaderCreateInfo& ShaderCI, Uint64& Hash) const
+{
+    // Shaders created from bytecode or with conversion streams are not cached
+    if (ShaderCI.ByteCode != nullptr || ShaderCI.ppConversionStream != nullptr)
+        return false;
+
+    Hasher H;
+    H.Update(ShaderCacheVersion);
+    H.Update(Uint32{DILIGENT_API_VERSION});
+
+    const auto& DeviceInfo = m_pDevice->GetDeviceInfo();
+    H.Update(static_cast<Uint32>(DeviceInfo.Type));
+    H.Update(DeviceInfo.APIVersion.Major);
+    H.Update(DeviceInfo.APIVersion.Minor);
+
+    H.Update(static_cast<Uint32>(ShaderCI.Desc.ShaderType));
+    H.Update(static_cast<Uint32>(ShaderCI.SourceLanguage));
+    H.Update(static_cast<Uint32>(ShaderCI.ShaderCompiler));
+    H.Update(static_cast<Uint32>(ShaderCI.CompileFlags));
+    H.Update(ShaderCI.HLSLVersion.Major);
+    H.Update(ShaderCI.HLSLVersion.Minor);
+    H.Update(ShaderCI.UseCombinedTextureSamplers);
+    H.Update(ShaderCI.UseCombinedTextureSamplers ? ShaderCI.CombinedSamplerSuffix : nullptr);
+    H.Update(ShaderCI.EntryPoint);
+
+    for (const auto* pMacro = ShaderCI.Macros; pMacro != nullptr && pMacro->Name != nullptr; ++pMacro)
+    {
+        H.Update(pMacro->Name);
+        H.Update(pMacro->Definition);
+    }
+    H.Update(Uint8{0xFF});
+
+    std::unordered_set<std::string> VisitedIncludes;
+    if (ShaderCI.Source != nullptr)
+    {
+        const auto Length = ShaderCI.SourceLength != 0 ? ShaderCI.SourceLength : strlen(ShaderCI.Source);
+        HashSource(H, ShaderCI.Source, Length, ShaderCI.pShaderSourceStreamFactory, VisitedIncludes);
+    }
+    else if (ShaderCI.FilePath != nullptr && ShaderCI.pShaderSourceStreamFactory != nullptr)
+    {
+        std::string Source;
+        if (!ReadSourceFile(ShaderCI.pShaderSourceStreamFactory, ShaderCI.FilePath, Source))
+            return false;
+
+        VisitedIncludes.insert(ShaderCI.FilePath);
+        HashSource(H, Source.data(), Source.size(), ShaderCI.pShaderSourceStreamFactory, VisitedIncludes);
+    }
+    else
+    {
+        return false;
+    }
+
+    Hash = H.Get();
+    return true;
+}
+
+std::string ShaderCache::GetFilePath(Uint64 Hash) const
+{
+    static constexpr Char HexDigits[] = "0123456789abcdef";
+
+    std::string Path{m_Directory};
+    if (!Path.empty() && !FileSystem::IsSlash(Path.back()))
+        Path.push_back(FileSystem::SlashSymbol);
+    for (int i = 15; i >= 0; --i)
+        Path.push_back(HexDigits[(Hash >> (i * 4)) & 0xF]);
+    Path.append(".bin");
+    return Path;
+}
+
+const ShaderCache::Bytecode* ShaderCache::FindBytecode(Uint64 Hash)
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_BytecodesMtx};
+
+        auto it = m_Bytecodes.find(Hash);
+        if (it != m_Bytecodes.end())
+            return &it->second;
+    }
+
+    const auto Path = GetFilePath(Hash);
+    if (!FileSystem::FileExists(Path.c_str()))
+        return nullptr;
+
+    FileWrapper pFile{Path.c_str(), EFileAccessMode::Read};
+    if (!pFile)
+        return nullptr;
+
+    CacheFileHeader Header;
+    if (pFile->GetSize() < sizeof(Header) || !pFile->Read(&Header, sizeof(Header)))
+        return nullptr;
+
+    // Files may be left partially written if the application was terminated
+    if (Header.Magic != ShaderCacheMagic ||
+        Header.Version != ShaderCacheVersion ||
+        Header.Hash != Hash ||
+        Header.Size == 0 ||
+        pFile->GetSize() != sizeof(Header) + Header.Size)
+    {
+        LOG_WARNING_MESSAGE("Ignoring invalid shader cache file '", Path, "'.");
+        return nullptr;
+    }
+
+    Bytecode Data(static_cast<size_t>(Header.Size));
+    if (!pFile->Read(Data.data(), Data.size()) || ComputeChecksum(Data.data(), Data.size()) != Header.Checksum)
+    {
+        LOG_WARNING_MESSAGE("Ignoring corrupted shader cache file '", Path, "'.");
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> Lock{m_BytecodesMtx};
+    // Another thread may have loaded the same shader in the meantime, in which case the existing entry is kept
+    return &m_Bytecodes.emplace(Hash, std::move(Data)).first->second;
+}
+
+const ShaderCache::Bytecode* ShaderCache::AddBytecode(Uint64 Hash, IShader* pShader)
+{
+    const void* pData = nullptr;
+    Uint64      Size  = 0;
+    pShader->GetBytecode(&pData, Size);
+    if (pData == nullptr || Size == 0)
+        return nullptr;
+
+    CacheFileHeader Header;
+    Header.Hash     = Hash;
+    Header.Size     = Size;
+    Header.Checksum = ComputeChecksum(pData, static_cast<size_t>(Size));
+
+    const auto  Path = GetFilePath(Hash);
+    FileWrapper pFile{Path.c_str(), EFileAccessMode::Overwrite};
+    if (!pFile || !pFile->Write(&Header, sizeof(Header)) || !pFile->Write(pData, static_cast<size_t>(Size)))
+        LOG_ERROR_MESSAGE("Failed to write shader cache file '", Path, "'.");
+
+    const auto* pBytes = static_cast<const Uint8*>(pData);
+
+    std::lock_guard<std::mutex> Lock{m_BytecodesMtx};
+    return &m_Bytecodes.emplace(Hash, Bytecode{pBytes, pBytes + Size}).first->second;
+}
+
+void ShaderCache::CreateShader(const ShaderCreateInfo& ShaderCI, IShader** ppShader)
+{
+    Uint64 Hash = 0;
+    if (!m_IsEnabled || !ComputeHash(ShaderCI, Hash))
+    {
+        m_NumBypassed.fetch_add(1);
+        m_pDevice->CreateShader(ShaderCI, ppShader);
+        return;
+    }
+
+    if (const auto* pBytecode = FindBytecode(Hash))
+    {
+        auto BytecodeCI{ShaderCI};
+        BytecodeCI.Source       = nullptr;
+        BytecodeCI.FilePath     = nullptr;
+        BytecodeCI.Macros       = nullptr;
+        BytecodeCI.ByteCode     = pBytecode->data();
+        BytecodeCI.ByteCodeSize = pBytecode->size();
+        m_pDevice->CreateShader(BytecodeCI, ppShader);
+        if (*ppShader != nullptr)
+        {
+            m_NumHits.fetch_add(1);
+            return;
+        }
+        LOG_WARNING_MESSAGE("Failed to create shader '", (ShaderCI.Desc.Name != nullptr ? ShaderCI.Desc.Name : ""),
+                            "' from the cached bytecode. Compiling the shader from source.");
+    }
+
+    m_NumMisses.fetch_add(1);
+    m_pDevice->CreateShader(ShaderCI, ppShader);
+    if (*ppShader != nullptr)
+        AddBytecode(Hash, *ppShader);
+}
+
+bool ShaderCache::ResolveBytecode(ShaderCreateInfo& ShaderCI)
+{
+    Uint64 Hash = 0;
+    if (!m_IsEnabled || !ComputeHash(ShaderCI, Hash))
+    {
+        m_NumBypassed.fetch_add(1);
+        return false;
+    }
+
+    const auto* pBytecode = FindBytecode(Hash);
+    if (pBytecode != nullptr)
+    {
+        m_NumHits.fetch_add(1);
+    }
+    else
+    {
+        m_NumMisses.fetch_add(1);
+
+        RefCntAutoPtr<IShader> pShader;
+        m_pDevice->CreateShader(ShaderCI, &pShader);
+        if (!pShader)
+            return false;
+
+        pBytecode = AddBytecode(Hash, pShader);
+        if (pBytecode == nullptr)
+            return false;
+    }
+
+    ShaderCI.Source       = nullptr;
+    ShaderCI.FilePath     = nullptr;
+    ShaderCI.Macros       = nullptr;
+    ShaderCI.ByteCode     = pBytecode->data();
+    ShaderCI.ByteCodeSize = pBytecode->size();
+    return true;
+}
+
+ShaderCache::Statistics ShaderCache::GetStatistics() const
+{
+    Statistics Stats;
+    Stats.NumHits     = m_NumHits.load();
+    Stats.NumMisses   = m_NumMisses.load();
+    Stats.NumBypassed = m_NumBypassed.load();
+    return Stats;
+}
+
+} // namespace Diligent
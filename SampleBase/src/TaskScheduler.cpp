@@ -0,0 +1,261 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+
+#include "TaskScheduler.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+TaskScheduler::TaskScheduler(Uint32 NumWorkers)
+{
+    m_Queues.reserve(size_t{NumWorkers} + 1);
+    for (Uint32 i = 0; i < NumWorkers + 1; ++i)
+        m_Queues.emplace_back(new ThreadQueue);
+
+    m_Workers.reserve(NumWorkers);
+    for (Uint32 i = 0; i < NumWorkers; ++i)
+        m_Workers.emplace_back(&TaskScheduler::WorkerThreadFunc, this, i);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_WakeMtx};
+        m_Stop = true;
+    }
+    m_WakeCV.notify_all();
+
+    for (auto& Worker : m_Workers)
+        Worker.join();
+
+    VERIFY(m_NumStealableTasks.load() == 0 && m_NumPinnedTasks.load() == 0, "All tasks must be complete when the scheduler is destroyed");
+}
+
+Uint32 TaskScheduler::GetRecommendedChunkCount(Uint32 Count, Uint32 MinChunkSize) const
+{
+    // A few chunks per thread let idle threads steal work from the threads
+    // that got more expensive items.
+    static constexpr Uint32 ChunksPerThread = 4;
+
+    MinChunkSize = std::max(MinChunkSize, 1u);
+
+    const auto MaxChunks = (Count + MinChunkSize - 1) / MinChunkSize;
+    return std::max(std::min(GetNumThreads() * ChunksPerThread, MaxChunks), Count > 0 ? 1u : 0u);
+}
+
+void TaskScheduler::WakeWorkers()
+{
+    // Lock the mutex to make sure that a worker that has just checked the wait
+    // predicate does not miss the notification.
+    {
+        std::lock_guard<std::mutex> Lock{m_WakeMtx};
+    }
+    m_WakeCV.notify_all();
+}
+
+void TaskScheduler::ParallelFor(Uint32 Count, Uint32 NumChunks, const RangeFunc& Func)
+{
+    NumChunks = std::min(NumChunks, Count);
+    if (NumChunks == 0)
+        return;
+
+    const auto CallerId = GetNumWorkers();
+    if (NumChunks == 1 || m_Workers.empty())
+    {
+        for (Uint32 chunk = 0; chunk < NumChunks; ++chunk)
+            Func(CallerId, chunk, static_cast<Uint32>(Uint64{Count} * chunk / NumChunks), static_cast<Uint32>(Uint64{Count} * (chunk + 1) / NumChunks));
+        return;
+    }
+
+    TaskGroup Group;
+    Group.NumRemaining.store(NumChunks);
+    // Increment the counter before the tasks become visible so that it never underflows
+    m_NumStealableTasks.fetch_add(NumChunks);
+
+    // Distribute contiguous runs of chunks between the threads so that every thread
+    // starts with neighboring items. The caller's queue gets the first run.
+    const auto NumQueues = static_cast<Uint32>(m_Queues.size());
+    for (Uint32 q = 0; q < NumQueues; ++q)
+    {
+        const Uint32 FirstChunk = NumChunks * q / NumQueues;
+        const Uint32 EndChunk   = NumChunks * (q + 1) / NumQueues;
+        if (FirstChunk == EndChunk)
+            continue;
+
+        // Queue 0 is served by the caller
+        auto& Queue = *m_Queues[q == 0 ? CallerId : q - 1];
+
+        std::lock_guard<std::mutex> Lock{Queue.Mtx};
+        for (Uint32 chunk = FirstChunk; chunk < EndChunk; ++chunk)
+        {
+            const auto Begin = static_cast<Uint32>(Uint64{Count} * chunk / NumChunks);
+            const auto End   = static_cast<Uint32>(Uint64{Count} * (chunk + 1) / NumChunks);
+
+            Task T;
+            T.pGroup = &Group;
+            T.Func   = [&Func, chunk, Begin, End](Uint32 ThreadId) {
+                Func(ThreadId, chunk, Begin, End);
+            };
+            Queue.Tasks.emplace_back(std::move(T));
+        }
+    }
+    WakeWorkers();
+
+    // Help the workers while waiting
+    Task T;
+    while (Group.NumRemaining.load() > 0 && PopTask(CallerId, T))
+        ExecuteTask(CallerId, T);
+
+    WaitForGroup(Group);
+}
+
+void TaskScheduler::RunOnEachWorker(const std::function<void(Uint32 WorkerId)>& Func)
+{
+    if (m_Workers.empty())
+        return;
+
+    TaskGroup Group;
+    Group.NumRemaining.store(GetNumWorkers());
+    m_NumPinnedTasks.fetch_add(GetNumWorkers());
+    for (Uint32 w = 0; w < GetNumWorkers(); ++w)
+    {
+        auto& Queue = *m_Queues[w];
+
+        Task T;
+        T.pGroup = &Group;
+        T.Func   = Func;
+
+        std::lock_guard<std::mutex> Lock{Queue.Mtx};
+        Queue.PinnedTasks.emplace_back(std::move(T));
+    }
+    WakeWorkers();
+
+    WaitForGroup(Group);
+}
+
+void TaskScheduler::WaitForGroup(TaskGroup& Group)
+{
+    if (Group.NumRemaining.load() == 0)
+        return;
+
+    std::unique_lock<std::mutex> Lock{m_WakeMtx};
+    m_GroupDoneCV.wait(Lock, [&Group] { return Group.NumRemaining.load() == 0; });
+}
+
+bool TaskScheduler::PopTask(Uint32 ThreadId, Task& T)
+{
+    {
+        auto& OwnQueue = *m_Queues[ThreadId];
+
+        std::lock_guard<std::mutex> Lock{OwnQueue.Mtx};
+        if (!OwnQueue.PinnedTasks.empty())
+        {
+            T = std::move(OwnQueue.PinnedTasks.front());
+            OwnQueue.PinnedTasks.pop_front();
+            m_NumPinnedTasks.fetch_sub(1);
+            return true;
+        }
+        if (!OwnQueue.Tasks.empty())
+        {
+            T = std::move(OwnQueue.Tasks.front());
+            OwnQueue.Tasks.pop_front();
+            m_NumStealableTasks.fetch_sub(1);
+            return true;
+        }
+    }
+
+    if (m_NumStealableTasks.load() == 0)
+        return false;
+
+    // Steal from the back of the other queues, i.e. take the work the owner would get to last
+    const auto NumQueues = static_cast<Uint32>(m_Queues.size());
+    for (Uint32 i = 1; i < NumQueues; ++i)
+    {
+        auto& Victim = *m_Queues[(ThreadId + i) % NumQueues];
+
+        std::lock_guard<std::mutex> Lock{Victim.Mtx};
+        if (!Victim.Tasks.empty())
+        {
+            T = std::move(Victim.Tasks.back());
+            Victim.Tasks.pop_back();
+            m_NumStealableTasks.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TaskScheduler::ExecuteTask(Uint32 ThreadId, Task& T)
+{
+    T.Func(ThreadId);
+
+    auto* pGroup = T.pGroup;
+    T        = {};
+    if (pGroup->NumRemaining.fetch_sub(1) == 1)
+    {
+        // The group may be destroyed as soon as the waiting thread sees zero,
+        // so pGroup must not be accessed after this point.
+        {
+            std::lock_guard<std::mutex> Lock{m_WakeMtx};
+        }
+        m_GroupDoneCV.notify_all();
+    }
+}
+
+void TaskScheduler::WorkerThreadFunc(Uint32 WorkerId)
+{
+    auto& OwnQueue = *m_Queues[WorkerId];
+    for (;;)
+    {
+        Task T;
+        if (PopTask(WorkerId, T))
+        {
+            ExecuteTask(WorkerId, T);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> Lock{m_WakeMtx};
+        m_WakeCV.wait(Lock, [&] {
+            if (m_Stop || m_NumStealableTasks.load() > 0)
+                return true;
+            if (m_NumPinnedTasks.load() > 0)
+            {
+                std::lock_guard<std::mutex> QueueLock{OwnQueue.Mtx};
+                return !OwnQueue.PinnedTasks.empty();
+            }
+            return false;
+        });
+        if (m_Stop)
+            return;
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,335 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#include "TraceRecorder.hpp"
+#include "FileWrapper.hpp"
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+Uint64 GetSteadyClockNs()
+{
+    return static_cast<Uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+Uint64 TimestampToNs(const QueryDataTimestamp& Data)
+{
+    return Data.Frequency != 0 ?
+        static_cast<Uint64>(static_cast<double>(Data.Counter) * 1.0e+9 / static_cast<double>(Data.Frequency)) :
+        0;
+}
+
+void WriteJsonString(std::ostream& Stream, const Char* Str)
+{
+    Stream << '"';
+    for (const Char* c = Str != nullptr ? Str : ""; *c != '\0'; ++c)
+    {
+        switch (*c)
+        {
+            case '"': Stream << "\\\""; break;
+            case '\\': Stream << "\\\\"; break;
+            case '\n': Stream << "\\n"; break;
+            case '\t': Stream << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(*c) < 0x20)
+                    Stream << ' ';
+                else
+                    Stream << *c;
+        }
+    }
+    Stream << '"';
+}
+
+} // namespace
+
+TraceRecorder::TraceRecorder() :
+    m_StartTime{GetSteadyClockNs()}
+{
+}
+
+TraceRecorder::~TraceRecorder()
+{
+}
+
+void TraceRecorder::Initialize(IRenderDevice* pDevice, const CreateInfo& CI)
+{
+    VERIFY(m_Tracks.empty(), "The recorder must be initialized before any tracks are added");
+    VERIFY(CI.MaxEvents > 0 && (CI.MaxEvents & (CI.MaxEvents - 1)) == 0, "Event ring capacity must be a power of two");
+    VERIFY(CI.NumFramesInFlight > 0, "The number of frames in flight must not be zero");
+
+    m_pDevice = pDevice;
+    m_CI      = CI;
+
+    if (m_pDevice)
+    {
+        const auto& Features              = m_pDevice->GetDeviceInfo().Features;
+        m_SupportsTimestamps              = Features.TimestampQueries != DEVICE_FEATURE_STATE_DISABLED;
+        m_SupportsTransferQueueTimestamps = Features.TransferQueueTimestampQueries != DEVICE_FEATURE_STATE_DISABLED;
+    }
+
+    m_Events.reset(new Event[m_CI.MaxEvents]);
+    m_WritePos.store(0);
+}
+
+Uint32 TraceRecorder::AddTrack(const Char* Name)
+{
+    VERIFY(IsInitialized(), "The recorder is not initialized");
+
+    std::unique_ptr<Track> pTrack{new Track{}};
+    pTrack->Name = Name != nullptr ? Name : "";
+    pTrack->Stack.reserve(32);
+    pTrack->GpuFrames.reset(new GpuFrame[m_CI.NumFramesInFlight]);
+    if (m_SupportsTimestamps)
+    {
+        QueryDesc Desc;
+        Desc.Name = "Trace timestamp query";
+        Desc.Type = QUERY_TYPE_TIMESTAMP;
+        for (Uint32 f = 0; f < m_CI.NumFramesInFlight; ++f)
+        {
+            auto& Frame = pTrack->GpuFrames[f];
+            Frame.Queries.resize(size_t{m_CI.MaxGpuScopesPerFrame} * 2);
+            for (auto& pQuery : Frame.Queries)
+                m_pDevice->CreateQuery(Desc, &pQuery);
+            Frame.Scopes.resize(m_CI.MaxGpuScopesPerFrame);
+        }
+    }
+
+    m_Tracks.emplace_back(std::move(pTrack));
+    return static_cast<Uint32>(m_Tracks.size() - 1);
+}
+
+Uint64 TraceRecorder::GetCpuTime() const
+{
+    return GetSteadyClockNs() - m_StartTime;
+}
+
+bool TraceRecorder::SupportsTimestamps(IDeviceContext* pContext) const
+{
+    if (!m_SupportsTimestamps)
+        return false;
+
+    const auto QueueType = pContext->GetDesc().QueueType & COMMAND_QUEUE_TYPE_PRIMARY_MASK;
+    return QueueType > COMMAND_QUEUE_TYPE_TRANSFER || m_SupportsTransferQueueTimestamps;
+}
+
+void TraceRecorder::AddEvent(const Char* Name, Uint32 Track, Uint64 Begin, Uint64 End, bool IsGpu)
+{
+    const auto Pos = m_WritePos.fetch_add(1, std::memory_order_relaxed);
+    auto&      E   = m_Events[Pos & (m_CI.MaxEvents - 1)];
+
+    // Invalidate the slot while it is being written
+    E.Seq.store(0, std::memory_order_relaxed);
+    E.Name  = Name;
+    E.Begin = Begin;
+    E.End   = std::max(Begin, End);
+    E.Track = Track;
+    E.IsGpu = IsGpu;
+    E.Seq.store(Pos + 1, std::memory_order_release);
+}
+
+void TraceRecorder::BeginScope(Uint32 TrackIdx, const Char* Name, IDeviceContext* pContext)
+{
+    if (!IsInitialized())
+        return;
+
+    VERIFY(TrackIdx < m_Tracks.size(), "Track index is out of range");
+    auto& T = *m_Tracks[TrackIdx];
+
+    OpenScope Scope;
+    Scope.Name     = Name;
+    Scope.CpuBegin = GetCpuTime();
+    if (pContext != nullptr && SupportsTimestamps(pContext))
+    {
+        auto&      Frame = T.GpuFrames[m_FrameIdx.load(std::memory_order_relaxed)];
+        const auto Idx   = Frame.NumScopes.load(std::memory_order_relaxed);
+        if (Idx < m_CI.MaxGpuScopesPerFrame)
+        {
+            auto& GpuScope    = Frame.Scopes[Idx];
+            GpuScope.Name     = Name;
+            GpuScope.CpuBegin = Scope.CpuBegin;
+            GpuScope.Ended    = false;
+            pContext->EndQuery(Frame.Queries[size_t{Idx} * 2 + 0]);
+
+            Frame.NumScopes.store(Idx + 1, std::memory_order_release);
+            Scope.GpuScopeIdx = Idx;
+        }
+    }
+
+    T.Stack.push_back(Scope);
+}
+
+void TraceRecorder::EndScope(Uint32 TrackIdx, IDeviceContext* pContext)
+{
+    if (!IsInitialized())
+        return;
+
+    VERIFY(TrackIdx < m_Tracks.size(), "Track index is out of range");
+    auto& T = *m_Tracks[TrackIdx];
+    if (T.Stack.empty())
+    {
+        UNEXPECTED("EndScope() is called without matching BeginScope()");
+        return;
+    }
+
+    const auto Scope = T.Stack.back();
+    T.Stack.pop_back();
+
+    if (Scope.GpuScopeIdx != ~0u)
+    {
+        VERIFY(pContext != nullptr, "The scope was opened with a device context, so it must be closed with the same context");
+        if (pContext != nullptr)
+        {
+            auto& Frame = T.GpuFrames[m_FrameIdx.load(std::memory_order_relaxed)];
+            pContext->EndQuery(Frame.Queries[size_t{Scope.GpuScopeIdx} * 2 + 1]);
+            Frame.Scopes[Scope.GpuScopeIdx].Ended = true;
+        }
+    }
+
+    AddEvent(Scope.Name, TrackIdx, Scope.CpuBegin, GetCpuTime(), false);
+}
+
+void TraceRecorder::NextFrame()
+{
+    if (!IsInitialized())
+        return;
+
+    // The oldest frame in flight becomes the current frame
+    const auto FrameIdx = (m_FrameIdx.load(std::memory_order_relaxed) + 1) % m_CI.NumFramesInFlight;
+    for (Uint32 t = 0; t < m_Tracks.size(); ++t)
+    {
+        auto&      Frame     = m_Tracks[t]->GpuFrames[FrameIdx];
+        const auto NumScopes = Frame.NumScopes.load(std::memory_order_acquire);
+        for (Uint32 i = 0; i < NumScopes; ++i)
+        {
+            const auto& Scope = Frame.Scopes[i];
+
+            QueryDataTimestamp BeginData;
+            QueryDataTimestamp EndData;
+            if (Scope.Ended &&
+                Frame.Queries[size_t{i} * 2 + 0]->GetData(&BeginData, sizeof(BeginData), true) &&
+                Frame.Queries[size_t{i} * 2 + 1]->GetData(&EndData, sizeof(EndData), true))
+            {
+                const auto GpuBegin = TimestampToNs(BeginData);
+                const auto GpuEnd   = TimestampToNs(EndData);
+                if (!m_GpuToCpuOffsetSet)
+                {
+                    m_GpuToCpuOffset    = static_cast<Int64>(Scope.CpuBegin) - static_cast<Int64>(GpuBegin);
+                    m_GpuToCpuOffsetSet = true;
+                }
+
+                const auto ToCpuTime = [this](Uint64 GpuTime) {
+                    return static_cast<Uint64>(std::max(static_cast<Int64>(GpuTime) + m_GpuToCpuOffset, Int64{0}));
+                };
+                AddEvent(Scope.Name, t, ToCpuTime(GpuBegin), ToCpuTime(GpuEnd), true);
+            }
+            else
+            {
+                ++m_NumLostGpuScopes;
+            }
+        }
+        Frame.NumScopes.store(0, std::memory_order_relaxed);
+    }
+
+    m_FrameIdx.store(FrameIdx, std::memory_order_release);
+}
+
+TraceRecorder::Statistics TraceRecorder::GetStatistics() const
+{
+    Statistics Stats;
+    Stats.NumEvents        = m_WritePos.load(std::memory_order_relaxed);
+    Stats.NumLostGpuScopes = m_NumLostGpuScopes;
+    return Stats;
+}
+
+bool TraceRecorder::ExportChromeTrace(const Char* FilePath) const
+{
+    if (!IsInitialized())
+        return false;
+
+    // CPU and GPU events are exported as two processes with one thread per track
+    static constexpr int CpuPid = 1;
+    static constexpr int GpuPid = 2;
+
+    std::stringstream Json;
+    Json.precision(3);
+    Json.flags(std::ios_base::fixed);
+    Json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    Json << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << CpuPid << ",\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+    Json << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << GpuPid << ",\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+    for (Uint32 t = 0; t < m_Tracks.size(); ++t)
+    {
+        for (int Pid : {CpuPid, GpuPid})
+        {
+            Json << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << Pid << ",\"tid\":" << t << ",\"args\":{\"name\":";
+            WriteJsonString(Json, m_Tracks[t]->Name.c_str());
+            Json << "}}";
+        }
+    }
+
+    const auto WritePos = m_WritePos.load(std::memory_order_acquire);
+    const auto FirstPos = WritePos > m_CI.MaxEvents ? WritePos - m_CI.MaxEvents : 0;
+    for (auto Pos = FirstPos; Pos < WritePos; ++Pos)
+    {
+        const auto& E = m_Events[Pos & (m_CI.MaxEvents - 1)];
+        if (E.Seq.load(std::memory_order_acquire) != Pos + 1)
+            continue; // The slot is being written or has been overwritten
+
+        // Chrome trace timestamps are in microseconds
+        Json << ",\n{\"name\":";
+        WriteJsonString(Json, E.Name);
+        Json << ",\"ph\":\"X\",\"pid\":" << (E.IsGpu ? GpuPid : CpuPid) << ",\"tid\":" << E.Track
+             << ",\"ts\":" << static_cast<double>(E.Begin) * 1.0e-3
+             << ",\"dur\":" << static_cast<double>(E.End - E.Begin) * 1.0e-3 << "}";
+    }
+    Json << "\n]}\n";
+
+    const auto JsonStr = Json.str();
+
+    FileWrapper pFile{FilePath, EFileAccessMode::Overwrite};
+    if (!pFile)
+    {
+        LOG_ERROR_MESSAGE("Failed to create trace file '", FilePath, "'");
+        return false;
+    }
+    if (!pFile->Write(JsonStr.data(), JsonStr.size()))
+    {
+        LOG_ERROR_MESSAGE("Failed to write trace file '", FilePath, "'");
+        return false;
+    }
+    return true;
+}
+
+} // namespace Diligent
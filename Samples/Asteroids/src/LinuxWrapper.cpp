@@ -0,0 +1,439 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.  
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+// Linux counterpart of WinWrapper.cpp. Only the Diligent Vulkan mode is available.
+
+#include <xcb/xcb.h>
+#include <xcb/xcb_keysyms.h>
+#include <X11/keysym.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "asteroids_DE.h"
+#include "camera.h"
+#include "gui.h"
+#include "TaskScheduler.hpp"
+
+namespace {
+
+// Global demo state
+Settings gSettings;
+OrbitCamera gCamera;
+
+AsteroidsDE::Asteroids* gWorkloadDE = nullptr;
+bool gUpdateWorkload = false;
+
+GUI gGUI;
+GUIText* gFPSControl;
+
+struct XCBWindow
+{
+    xcb_connection_t* connection = nullptr;
+    xcb_window_t window = 0;
+    xcb_key_symbols_t* keySymbols = nullptr;
+    xcb_intern_atom_reply_t* atomWMDeleteWindow = nullptr;
+};
+
+// Mouse drag state for camera manipulation
+bool gDragging = false;
+int gLastMouseX = 0;
+int gLastMouseY = 0;
+
+void ResetCameraView()
+{
+    auto center    = Diligent::float3(0.0f, -0.4f*SIM_DISC_RADIUS, 0.0f);
+    auto radius    = SIM_ORBIT_RADIUS + SIM_DISC_RADIUS + 10.f;
+    auto minRadius = SIM_ORBIT_RADIUS - 3.0f * SIM_DISC_RADIUS;
+    auto maxRadius = SIM_ORBIT_RADIUS + 3.0f * SIM_DISC_RADIUS;
+    auto longAngle = 4.50f;
+    auto latAngle  = 1.45f;
+    gCamera.View(center, radius, minRadius, maxRadius, longAngle, latAngle);
+}
+
+void Resize(int width, int height)
+{
+    gSettings.windowWidth = width;
+    gSettings.windowHeight = height;
+    gSettings.renderWidth = gSettings.windowWidth;
+    gSettings.renderHeight = gSettings.windowHeight;
+
+    if (gSettings.renderWidth != 0 && gSettings.renderHeight != 0) {
+        float aspect = (float)gSettings.renderWidth / (float)gSettings.renderHeight;
+        gCamera.Projection(Diligent::PI_F * 0.5f * 0.8f * 3 / 2, aspect);
+
+        if (gWorkloadDE) {
+            gWorkloadDE->ResizeSwapChain(gSettings.renderWidth, gSettings.renderHeight);
+        }
+    }
+}
+
+void SetWindowTitle(const XCBWindow& wnd, const char* title)
+{
+    xcb_change_property(wnd.connection, XCB_PROP_MODE_REPLACE, wnd.window, XCB_ATOM_WM_NAME, XCB_ATOM_STRING,
+                        8, (uint32_t)strlen(title), title);
+}
+
+bool CreateDemoWindow(XCBWindow& wnd)
+{
+    int screenIndex = 0;
+    wnd.connection = xcb_connect(nullptr, &screenIndex);
+    if (wnd.connection == nullptr || xcb_connection_has_error(wnd.connection)) {
+        fprintf(stderr, "error: unable to make an XCB connection\n");
+        return false;
+    }
+
+    auto iter = xcb_setup_roots_iterator(xcb_get_setup(wnd.connection));
+    while (screenIndex-- > 0) {
+        xcb_screen_next(&iter);
+    }
+    auto screen = iter.data;
+
+    wnd.window = xcb_generate_id(wnd.connection);
+    uint32_t valueMask = XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK;
+    uint32_t valueList[] = {
+        screen->black_pixel,
+        XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE |
+        XCB_EVENT_MASK_POINTER_MOTION | XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_STRUCTURE_NOTIFY
+    };
+    xcb_create_window(wnd.connection, XCB_COPY_FROM_PARENT, wnd.window, screen->root,
+                      100, 100, (uint16_t)gSettings.windowWidth, (uint16_t)gSettings.windowHeight, 0,
+                      XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual, valueMask, valueList);
+
+    // Ask the window manager to send a message instead of destroying the window
+    auto protocolsCookie = xcb_intern_atom(wnd.connection, 1, 12, "WM_PROTOCOLS");
+    auto protocolsReply = xcb_intern_atom_reply(wnd.connection, protocolsCookie, nullptr);
+    auto deleteCookie = xcb_intern_atom(wnd.connection, 0, 16, "WM_DELETE_WINDOW");
+    wnd.atomWMDeleteWindow = xcb_intern_atom_reply(wnd.connection, deleteCookie, nullptr);
+    if (protocolsReply == nullptr || wnd.atomWMDeleteWindow == nullptr) {
+        fprintf(stderr, "error: unable to intern the WM_PROTOCOLS and WM_DELETE_WINDOW atoms\n");
+        free(protocolsReply);
+        return false;
+    }
+    xcb_change_property(wnd.connection, XCB_PROP_MODE_REPLACE, wnd.window, protocolsReply->atom, XCB_ATOM_ATOM, 32, 1,
+                        &wnd.atomWMDeleteWindow->atom);
+    free(protocolsReply);
+
+    SetWindowTitle(wnd, "Asteroids");
+    xcb_map_window(wnd.connection, wnd.window);
+    xcb_flush(wnd.connection);
+
+    // Wait until the window is visible
+    while (auto event = xcb_wait_for_event(wnd.connection)) {
+        bool exposed = (event->response_type & 0x7f) == XCB_EXPOSE;
+        free(event);
+        if (exposed) break;
+    }
+
+    wnd.keySymbols = xcb_key_symbols_alloc(wnd.connection);
+    return true;
+}
+
+void DestroyDemoWindow(XCBWindow& wnd)
+{
+    if (wnd.keySymbols) xcb_key_symbols_free(wnd.keySymbols);
+    free(wnd.atomWMDeleteWindow);
+    if (wnd.connection) {
+        xcb_destroy_window(wnd.connection, wnd.window);
+        xcb_disconnect(wnd.connection);
+    }
+}
+
+// Returns false when the application should quit
+bool HandleKeyPress(const XCBWindow& wnd, const xcb_key_press_event_t* event)
+{
+    auto keySym = xcb_key_symbols_get_keysym(wnd.keySymbols, event->detail, 0);
+    switch (keySym) {
+    case XK_space:
+        gSettings.animate = !gSettings.animate;
+        std::cout << "Animate: " << gSettings.animate << std::endl;
+        break;
+    case XK_v:
+        gSettings.vsync = !gSettings.vsync;
+        std::cout << "Vsync: " << gSettings.vsync << std::endl;
+        break;
+    case XK_m:
+        gSettings.multithreadedRendering = !gSettings.multithreadedRendering;
+        std::cout << "Multithreaded Rendering: " << gSettings.multithreadedRendering << std::endl;
+        break;
+    case XK_c:
+        gSettings.frustumCulling = !gSettings.frustumCulling;
+        std::cout << "Frustum Culling: " << gSettings.frustumCulling << std::endl;
+        break;
+    case XK_g:
+        gSettings.gpuCulling = !gSettings.gpuCulling;
+        std::cout << "GPU Culling: " << gSettings.gpuCulling << std::endl;
+        break;
+    case XK_b:
+        gSettings.resourceBindingMode = (gSettings.resourceBindingMode + 1) % 4;
+        gUpdateWorkload = true;
+        break;
+
+    case XK_plus:
+    case XK_equal:
+    case XK_KP_Add:
+        gSettings.numThreads = std::min(gSettings.numThreads+1, 16);
+        gUpdateWorkload = true;
+        break;
+    case XK_minus:
+    case XK_KP_Subtract:
+        gSettings.numThreads = std::max(gSettings.numThreads-1, 2);
+        gUpdateWorkload = true;
+        break;
+
+    case XK_Escape:
+        return false;
+    }
+    return true;
+}
+
+void HandleButtonPress(const xcb_button_press_event_t* event)
+{
+    switch (event->detail) {
+    case XCB_BUTTON_INDEX_1: {
+        // Compute pointer position in render units
+        auto x = event->event_x * gSettings.renderWidth / std::max(gSettings.windowWidth, 1);
+        auto y = event->event_y * gSettings.renderHeight / std::max(gSettings.windowHeight, 1);
+        if (gGUI.HitTest(x, y) == gFPSControl) {
+            gSettings.lockFrameRate = !gSettings.lockFrameRate;
+        } else { // Camera manipulation
+            gDragging = true;
+            gLastMouseX = event->event_x;
+            gLastMouseY = event->event_y;
+        }
+        break;
+    }
+
+    // Mouse wheel, same step as one WHEEL_DELTA on Windows
+    case XCB_BUTTON_INDEX_4: gCamera.ZoomRadius(-0.07f * 120); break;
+    case XCB_BUTTON_INDEX_5: gCamera.ZoomRadius( 0.07f * 120); break;
+    }
+}
+
+void HandleMotion(const xcb_motion_notify_event_t* event)
+{
+    if (!gDragging) return;
+
+    // Same scale as the manipulation deltas on Windows
+    gCamera.OrbitX((event->event_x - gLastMouseX) * 0.0007f);
+    gCamera.OrbitY(-(event->event_y - gLastMouseY) * 0.0007f);
+    gLastMouseX = event->event_x;
+    gLastMouseY = event->event_y;
+}
+
+// Returns false when the application should quit
+bool ProcessEvents(const XCBWindow& wnd)
+{
+    bool run = true;
+    while (auto event = xcb_poll_for_event(wnd.connection)) {
+        switch (event->response_type & 0x7f) {
+        case XCB_CLIENT_MESSAGE:
+            if (reinterpret_cast<xcb_client_message_event_t*>(event)->data.data32[0] == wnd.atomWMDeleteWindow->atom) {
+                run = false;
+            }
+            break;
+
+        case XCB_DESTROY_NOTIFY:
+            run = false;
+            break;
+
+        case XCB_CONFIGURE_NOTIFY: {
+            auto cfgEvent = reinterpret_cast<xcb_configure_notify_event_t*>(event);
+            if (cfgEvent->width != gSettings.windowWidth || cfgEvent->height != gSettings.windowHeight) {
+                Resize(cfgEvent->width, cfgEvent->height);
+            }
+            break;
+        }
+
+        case XCB_KEY_PRESS:
+            run = HandleKeyPress(wnd, reinterpret_cast<xcb_key_press_event_t*>(event)) && run;
+            break;
+
+        case XCB_BUTTON_PRESS:
+            HandleButtonPress(reinterpret_cast<xcb_button_press_event_t*>(event));
+            break;
+
+        case XCB_BUTTON_RELEASE:
+            if (reinterpret_cast<xcb_button_release_event_t*>(event)->detail == XCB_BUTTON_INDEX_1) {
+                gDragging = false;
+            }
+            break;
+
+        case XCB_MOTION_NOTIFY:
+            HandleMotion(reinterpret_cast<xcb_motion_notify_event_t*>(event));
+            break;
+        }
+        free(event);
+    }
+    return run;
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    const char* meshCachePath = nullptr;
+    for (int a = 1; a < argc; ++a) {
+        if (strcmp(argv[a], "-close_after") == 0 && a + 1 < argc) {
+            gSettings.closeAfterSeconds = atof(argv[++a]);
+        } else if (strcmp(argv[a], "-singlethreaded") == 0) {
+            gSettings.multithreadedRendering = false;
+        } else if (strcmp(argv[a], "-warp") == 0) {
+            gSettings.warp = true;
+        } else if (strcmp(argv[a], "-window") == 0 && a + 2 < argc) {
+            gSettings.windowWidth = atoi(argv[++a]);
+            gSettings.windowHeight = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-locked_fps") == 0 && a + 1 < argc) {
+            gSettings.lockedFrameRate = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-threads") == 0 && a + 1 < argc) {
+            gSettings.numThreads = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-mesh_cache") == 0 && a + 1 < argc) {
+            meshCachePath = argv[++a];
+        } else if (strcmp(argv[a], "-no_culling") == 0) {
+            gSettings.frustumCulling = false;
+        } else if (strcmp(argv[a], "-gpu_culling") == 0) {
+            gSettings.gpuCulling = true;
+        } else if (strcmp(argv[a], "-vk") == 0) {
+            // The only mode on this platform
+        } else {
+            fprintf(stderr, "error: unrecognized argument '%s'\n", argv[a]);
+            fprintf(stderr, "usage: Asteroids [options]\n");
+            fprintf(stderr, "options:\n");
+            fprintf(stderr, "  -close_after [seconds]\n");
+            fprintf(stderr, "  -window [width] [height]\n");
+            fprintf(stderr, "  -locked_fps [fps]\n");
+            fprintf(stderr, "  -threads [count]\n");
+            fprintf(stderr, "  -singlethreaded\n");
+            fprintf(stderr, "  -warp (use a software Vulkan device)\n");
+            fprintf(stderr, "  -mesh_cache [file]\n");
+            fprintf(stderr, "  -no_culling\n");
+            fprintf(stderr, "  -gpu_culling\n");
+            return -1;
+        }
+    }
+
+    if (gSettings.numThreads == 0)
+    {
+        gSettings.numThreads = std::max(std::thread::hardware_concurrency(), 3u) - 1;
+    }
+    gSettings.mode = Settings::RenderMode::DiligentVulkan;
+
+    // Setup GUI
+    gFPSControl = gGUI.AddText(150, 10);
+
+    ResetCameraView();
+
+    // The main thread also executes tasks, so numThreads - 1 workers are enough
+    Diligent::TaskScheduler scheduler{static_cast<Diligent::Uint32>(gSettings.numThreads - 1)};
+
+    AsteroidsSimulation asteroids(1337, NUM_ASTEROIDS, NUM_UNIQUE_MESHES, MESH_MAX_SUBDIV_LEVELS, NUM_UNIQUE_TEXTURES, &scheduler, meshCachePath);
+
+    XCBWindow wnd;
+    if (!CreateDemoWindow(wnd)) {
+        DestroyDemoWindow(wnd);
+        return -1;
+    }
+    Resize(gSettings.windowWidth, gSettings.windowHeight);
+
+    Diligent::LinuxNativeWindow nativeWindow;
+    nativeWindow.WindowId = wnd.window;
+    nativeWindow.pXCBConnection = wnd.connection;
+
+    using Clock = std::chrono::high_resolution_clock;
+    auto lastCount = Clock::now();
+
+    // main loop
+    double elapsedTime = 0.0;
+    double frameTime = 0.0;
+
+    float filteredUpdateTime = 0.0f;
+    float filteredRenderTime = 0.0f;
+    float filteredFrameTime = 0.0f;
+    while (ProcessEvents(wnd))
+    {
+        if (gWorkloadDE == nullptr || gUpdateWorkload) {
+            delete gWorkloadDE;
+            gWorkloadDE = new AsteroidsDE::Asteroids(gSettings, &asteroids, &gGUI, nativeWindow, Diligent::RENDER_DEVICE_TYPE_VULKAN);
+            gWorkloadDE->ResizeSwapChain(gSettings.renderWidth, gSettings.renderHeight);
+            gUpdateWorkload = false;
+        }
+
+        // Get time delta
+        auto count = Clock::now();
+        auto rawFrameTime = std::chrono::duration<double>(count - lastCount).count();
+        elapsedTime += rawFrameTime;
+        lastCount = count;
+
+        // Maintaining absolute time sync is not important in this demo so we can err on the "smoother" side
+        double alpha = 0.2f;
+        frameTime = alpha * rawFrameTime + (1.0f - alpha) * frameTime;
+
+        // Update GUI
+        {
+            const char *resBindModeStr = "";
+            switch (gSettings.resourceBindingMode)
+            {
+                case 0: resBindModeStr = "-dyn";break;
+                case 1: resBindModeStr = "-mut";break;
+                case 2: resBindModeStr = "-tex_mut";break;
+                case 3: resBindModeStr = "-bindless";break;
+            }
+
+            float updateTime = 0;
+            float renderTime = 0;
+            gWorkloadDE->GetPerfCounters(updateTime, renderTime);
+
+            float filterScale = 0.02f;
+            filteredUpdateTime = filteredUpdateTime * (1.f - filterScale) + filterScale * updateTime;
+            filteredRenderTime = filteredRenderTime * (1.f - filterScale) + filterScale * renderTime;
+            filteredFrameTime = filteredFrameTime * (1.f - filterScale) + filterScale * (float)frameTime;
+
+            char buffer[256];
+            snprintf(buffer, sizeof(buffer), "Asteroids Diligent Vk%s (%dt) - %4.1f ms (%4.1f ms / %4.1f ms)", resBindModeStr, (gSettings.multithreadedRendering ? gSettings.numThreads : 1),
+                     1000.f * filteredFrameTime, 1000.f * filteredUpdateTime, 1000.f * filteredRenderTime);
+
+            SetWindowTitle(wnd, buffer);
+
+            if (gSettings.lockFrameRate) {
+                snprintf(buffer, sizeof(buffer), "(Locked)");
+            } else {
+                snprintf(buffer, sizeof(buffer), "%.0f fps", 1.0f / filteredFrameTime);
+            }
+            gFPSControl->Text(buffer);
+        }
+
+        gWorkloadDE->Render((float)frameTime, gCamera, gSettings);
+
+        if (gSettings.lockFrameRate) {
+            double renderTime = std::chrono::duration<double>(Clock::now() - count).count();
+            double targetRenderTime = 1.0 / double(gSettings.lockedFrameRate);
+            if (targetRenderTime > renderTime) {
+                std::this_thread::sleep_for(std::chrono::duration<double>(targetRenderTime - renderTime));
+            }
+        }
+
+        // All done?
+        if (gSettings.closeAfterSeconds > 0.0 && elapsedTime > gSettings.closeAfterSeconds) {
+            break;
+        }
+    }
+
+    delete gWorkloadDE;
+    gWorkloadDE = nullptr;
+    DestroyDemoWindow(wnd);
+    return 0;
+}
@@ -27,6 +27,7 @@
 #include "asteroids_DE.h"
 #include "camera.h"
 #include "gui.h"
+#include "TaskScheduler.hpp"
 
 using namespace DirectX;
 
@@ -69,7 +70,7 @@ bool CheckDll(char const* dllName)
 
 void ResetCameraView()
 {
-    auto center    = XMVectorSet(0.0f, -0.4f*SIM_DISC_RADIUS, 0.0f, 0.0f);
+    auto center    = Diligent::float3(0.0f, -0.4f*SIM_DISC_RADIUS, 0.0f);
     auto radius    = SIM_ORBIT_RADIUS + SIM_DISC_RADIUS + 10.f;
     auto minRadius = SIM_ORBIT_RADIUS - 3.0f * SIM_DISC_RADIUS;
     auto maxRadius = SIM_ORBIT_RADIUS + 3.0f * SIM_DISC_RADIUS;
@@ -156,7 +157,7 @@ LRESULT CALLBACK WindowProc(
                 case Settings::RenderMode::DiligentD3D12:
                 case Settings::RenderMode::DiligentVulkan:
                     if(gWorkloadDE)
-                        gWorkloadDE->ResizeSwapChain(hWnd, gSettings.renderWidth, gSettings.renderHeight);
+                        gWorkloadDE->ResizeSwapChain(gSettings.renderWidth, gSettings.renderHeight);
                 break;
             }
 
@@ -187,6 +188,14 @@ LRESULT CALLBACK WindowProc(
                 gSettings.executeIndirect = !gSettings.executeIndirect;
                 std::cout << "ExecuteIndirect Rendering: " << gSettings.executeIndirect << std::endl;
                 return 0;
+            case 'C':
+                gSettings.frustumCulling = !gSettings.frustumCulling;
+                std::cout << "Frustum Culling: " << gSettings.frustumCulling << std::endl;
+                return 0;
+            case 'G':
+                gSettings.gpuCulling = !gSettings.gpuCulling;
+                std::cout << "GPU Culling: " << gSettings.gpuCulling << std::endl;
+                return 0;
             case 'S':
                 gSettings.submitRendering = !gSettings.submitRendering;
                 std::cout << "Submit Rendering: " << gSettings.submitRendering << std::endl;
@@ -324,15 +333,15 @@ int InitWorkload(HWND hWnd, AsteroidsSimulation &asteroids)
         break;
 
         case Settings::RenderMode::DiligentD3D11:
-            gWorkloadDE = new AsteroidsDE::Asteroids(gSettings, &asteroids, &gGUI, hWnd, Diligent::RENDER_DEVICE_TYPE_D3D11);
+            gWorkloadDE = new AsteroidsDE::Asteroids(gSettings, &asteroids, &gGUI, Diligent::Win32NativeWindow{hWnd}, Diligent::RENDER_DEVICE_TYPE_D3D11);
         break;
 
         case Settings::RenderMode::DiligentD3D12:
-            gWorkloadDE = new AsteroidsDE::Asteroids(gSettings, &asteroids, &gGUI, hWnd, Diligent::RENDER_DEVICE_TYPE_D3D12);
+            gWorkloadDE = new AsteroidsDE::Asteroids(gSettings, &asteroids, &gGUI, Diligent::Win32NativeWindow{hWnd}, Diligent::RENDER_DEVICE_TYPE_D3D12);
         break;
 
         case Settings::RenderMode::DiligentVulkan:
-            gWorkloadDE = new AsteroidsDE::Asteroids(gSettings, &asteroids, &gGUI, hWnd, Diligent::RENDER_DEVICE_TYPE_VULKAN);
+            gWorkloadDE = new AsteroidsDE::Asteroids(gSettings, &asteroids, &gGUI, Diligent::Win32NativeWindow{hWnd}, Diligent::RENDER_DEVICE_TYPE_VULKAN);
         break;
     }
 
@@ -387,6 +396,7 @@ int main(int argc, char** argv)
 #endif
 
     gSettings.mode = Settings::RenderMode::Undefined;
+    const char* meshCachePath = nullptr;
     for (int a = 1; a < argc; ++a) {
         if (_stricmp(argv[a], "-close_after") == 0 && a + 1 < argc) {
             gSettings.closeAfterSeconds = atof(argv[++a]);
@@ -409,6 +419,12 @@ int main(int argc, char** argv)
             gSettings.lockedFrameRate = atoi(argv[++a]);
         } else if (_stricmp(argv[a], "-threads") == 0 && a + 1 < argc) {
             gSettings.numThreads = atoi(argv[++a]);
+        } else if (_stricmp(argv[a], "-mesh_cache") == 0 && a + 1 < argc) {
+            meshCachePath = argv[++a];
+        } else if (_stricmp(argv[a], "-no_culling") == 0) {
+            gSettings.frustumCulling = false;
+        } else if (_stricmp(argv[a], "-gpu_culling") == 0) {
+            gSettings.gpuCulling = true;
         } else if (_stricmp(argv[a], "-d3d11") == 0) {
             gSettings.mode = Settings::RenderMode::DiligentD3D11;
         } else if (_stricmp(argv[a], "-d3d12") == 0) {
@@ -427,13 +443,16 @@ int main(int argc, char** argv)
             fprintf(stderr, "  -render_scale [scale]\n");
             fprintf(stderr, "  -locked_fps [fps]\n");
             fprintf(stderr, "  -warp\n");
+            fprintf(stderr, "  -mesh_cache [file]\n");
+            fprintf(stderr, "  -no_culling\n");
+            fprintf(stderr, "  -gpu_culling\n");
             return -1;
         }
     }
     
     if (gSettings.numThreads == 0)
     {
-        gSettings.numThreads = std::max(std::thread::hardware_concurrency()-1, 2u);
+        gSettings.numThreads = std::max(std::thread::hardware_concurrency(), 3u) - 1;
     }
 
     //if (!d3d11Available && !d3d12Available) {
@@ -450,7 +469,10 @@ int main(int argc, char** argv)
     ResetCameraView();
     // Camera projection set up in WM_SIZE
 
-    AsteroidsSimulation asteroids(1337, NUM_ASTEROIDS, NUM_UNIQUE_MESHES, MESH_MAX_SUBDIV_LEVELS, NUM_UNIQUE_TEXTURES);
+    // The main thread also executes tasks, so numThreads - 1 workers are enough
+    Diligent::TaskScheduler scheduler{static_cast<Diligent::Uint32>(gSettings.numThreads - 1)};
+
+    AsteroidsSimulation asteroids(1337, NUM_ASTEROIDS, NUM_UNIQUE_MESHES, MESH_MAX_SUBDIV_LEVELS, NUM_UNIQUE_TEXTURES, &scheduler, meshCachePath);
 
     if (gSettings.mode == Settings::RenderMode::Undefined)
     {
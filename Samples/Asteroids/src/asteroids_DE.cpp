@@ -8,7 +8,6 @@
 // Intel does not assume any responsibility for any errors which may appear in this software
 // nor any responsibility to update it.
 
-#include <directxmath.h>
 #include <math.h>
 
 #include <iostream>
@@ -18,6 +17,7 @@
 #include <limits>
 #include <random>
 #include <locale>
+#include <chrono>
 
 #include "asteroids_DE.h"
 
@@ -39,11 +39,10 @@
 #endif
 
 #include "MapHelper.hpp"
+#include "ShaderMacroHelper.hpp"
 
-#include "util.h"
 #include "mesh.h"
 #include "noise.h"
-#include "texture.h"
 #include "StringTools.hpp"
 #include "TextureUtilities.h"
 
@@ -75,32 +74,64 @@ namespace AsteroidsDE
 
 struct DrawConstantBuffer
 {
-    DirectX::XMFLOAT4X4 mViewProjection;
-    DirectX::XMFLOAT4X4 mWorld;
-    DirectX::XMFLOAT3   mSurfaceColor;
+    float4x4            mViewProjection;
+    float4x4            mWorld;
+    float3              mSurfaceColor;
     float               unused0;
 
-    DirectX::XMFLOAT3 mDeepColor;
-    float             unused1;
+    float3 mDeepColor;
+    float  unused1;
 };
 
 struct AsteroidData
 {
-    DirectX::XMFLOAT4X4 mWorld;
-    DirectX::XMFLOAT3   mSurfaceColor;
-    float               unused0;
-    DirectX::XMFLOAT3   mDeepColor;
-    Uint32              mTextureIndex;
+    float4x4 mWorld;
+    float3   mSurfaceColor;
+    float    unused0;
+    float3   mDeepColor;
+    Uint32   mTextureIndex;
 };
 
+// Arguments of one indexed indirect draw command
+struct DrawIndexedIndirectArgs
+{
+    Uint32 IndexCount;
+    Uint32 InstanceCount;
+    Uint32 FirstIndex;
+    Int32  BaseVertex;
+    Uint32 FirstInstance;
+};
+static_assert(sizeof(DrawIndexedIndirectArgs) == 20, "This must match DRAW_ARGS_STRIDE in asteroid_cull_diligent.csh");
+
+// Per-asteroid draw parameters read by the culling shader
+struct AsteroidDrawInfo
+{
+    Uint32 IndexCount;
+    Uint32 FirstIndex;
+    Uint32 BaseVertex;
+    Uint32 Lod;
+};
+
+struct CullConstants
+{
+    float4 FrustumPlanes[6];
+    Uint32 NumAsteroids;
+    Uint32 MaxDrawsPerLod;
+    float  MeshRadius;
+    float  Padding;
+};
+
+static constexpr Uint32 NumLods             = MESH_MAX_SUBDIV_LEVELS + 1;
+static constexpr Uint32 CullThreadGroupSize = 64;
+
 struct SkyboxConstantBuffer
 {
-    DirectX::XMFLOAT4X4 mViewProjection;
+    float4x4 mViewProjection;
 };
 
 
 // Create Direct3D device and swap chain
-void Asteroids::InitDevice(HWND hWnd, RENDER_DEVICE_TYPE DevType)
+void Asteroids::InitDevice(const NativeWindow& window, RENDER_DEVICE_TYPE DevType, bool softwareAdapter)
 {
     SwapChainDesc SwapChainDesc;
     SwapChainDesc.BufferCount       = NUM_SWAP_CHAIN_BUFFERS;
@@ -124,7 +155,7 @@ void Asteroids::InitDevice(HWND hWnd, RENDER_DEVICE_TYPE DevType)
 #    endif
             auto* pFactoryD3D11 = GetEngineFactoryD3D11();
             pFactoryD3D11->CreateDeviceAndContextsD3D11(EngineCI, &mDevice, ppContexts.data());
-            pFactoryD3D11->CreateSwapChainD3D11(mDevice, ppContexts[0], SwapChainDesc, FullScreenModeDesc{}, Win32NativeWindow{hWnd}, &mSwapChain);
+            pFactoryD3D11->CreateSwapChainD3D11(mDevice, ppContexts[0], SwapChainDesc, FullScreenModeDesc{}, window, &mSwapChain);
         }
         break;
 #endif
@@ -146,7 +177,7 @@ void Asteroids::InitDevice(HWND hWnd, RENDER_DEVICE_TYPE DevType)
 #    endif
             auto* pFactoryD3D12 = GetEngineFactoryD3D12();
             pFactoryD3D12->CreateDeviceAndContextsD3D12(EngineCI, &mDevice, ppContexts.data());
-            pFactoryD3D12->CreateSwapChainD3D12(mDevice, ppContexts[0], SwapChainDesc, FullScreenModeDesc{}, Win32NativeWindow{hWnd}, &mSwapChain);
+            pFactoryD3D12->CreateSwapChainD3D12(mDevice, ppContexts[0], SwapChainDesc, FullScreenModeDesc{}, window, &mSwapChain);
         }
         break;
 #endif
@@ -163,8 +194,28 @@ void Asteroids::InitDevice(HWND hWnd, RENDER_DEVICE_TYPE DevType)
                 GetEngineFactoryVulkan = LoadGraphicsEngineVk();
 #    endif
             auto* pFactoryVk = GetEngineFactoryVulkan();
+            if (softwareAdapter)
+            {
+                // Look for a software ICD such as lavapipe or SwiftShader
+                Uint32 NumAdapters = 0;
+                pFactoryVk->EnumerateAdapters(EngineCI.GraphicsAPIVersion, NumAdapters, nullptr);
+                std::vector<GraphicsAdapterInfo> Adapters(NumAdapters);
+                if (NumAdapters > 0)
+                    pFactoryVk->EnumerateAdapters(EngineCI.GraphicsAPIVersion, NumAdapters, Adapters.data());
+                for (Uint32 i = 0; i < Adapters.size(); ++i)
+                {
+                    if (Adapters[i].Type == ADAPTER_TYPE_SOFTWARE)
+                    {
+                        EngineCI.AdapterId = i;
+                        LOG_INFO_MESSAGE("Found software adapter '", Adapters[i].Description, "'");
+                        break;
+                    }
+                }
+                if (EngineCI.AdapterId == DEFAULT_ADAPTER_ID)
+                    LOG_WARNING_MESSAGE("Failed to find a software Vulkan adapter. Using the default adapter.");
+            }
             pFactoryVk->CreateDeviceAndContextsVk(EngineCI, &mDevice, ppContexts.data());
-            pFactoryVk->CreateSwapChainVk(mDevice, ppContexts[0], SwapChainDesc, Win32NativeWindow{hWnd}, &mSwapChain);
+            pFactoryVk->CreateSwapChainVk(mDevice, ppContexts[0], SwapChainDesc, window, &mSwapChain);
         }
         break;
 #endif
@@ -178,7 +229,7 @@ void Asteroids::InitDevice(HWND hWnd, RENDER_DEVICE_TYPE DevType)
                 GetEngineFactoryOpenGL = LoadGraphicsEngineOpenGL();
 #    endif
             EngineGLCreateInfo CreationAttribs;
-            CreationAttribs.Window.hWnd = hWnd;
+            CreationAttribs.Window = window;
             GetEngineFactoryOpenGL()->CreateDeviceAndSwapChainGL(
                 CreationAttribs, &mDevice, &mDeviceCtxt, SwapChainDesc, &mSwapChain);
         }
@@ -200,15 +251,13 @@ void Asteroids::InitDevice(HWND hWnd, RENDER_DEVICE_TYPE DevType)
     }
 }
 
-Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, GUI* gui, HWND hWnd, RENDER_DEVICE_TYPE DevType) :
+Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, GUI* gui, const NativeWindow& window, RENDER_DEVICE_TYPE DevType) :
     mAsteroids(asteroids), mGUI(gui)
 {
-    QueryPerformanceFrequency((LARGE_INTEGER*)&mPerfCounterFreq);
-
     mNumSubsets = std::max(settings.numThreads, 1);
     mNumSubsets = std::min(settings.numThreads, 32);
 
-    InitDevice(hWnd, DevType);
+    InitDevice(window, DevType, settings.warp);
 
     m_BindingMode = static_cast<BindingMode>(settings.resourceBindingMode);
     if (m_BindingMode == BindingMode::Bindless && !mDevice->GetDeviceInfo().Features.BindlessResources)
@@ -239,6 +288,7 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
     mBackBufferWidth                = mSwapChain->GetDesc().Width;
     mBackBufferHeight               = mSwapChain->GetDesc().Height;
     const auto MaxAsteroidsInSubset = (NUM_ASTEROIDS + mNumSubsets - 1) / mNumSubsets;
+    mMaxAsteroidsInSubset           = MaxAsteroidsInSubset;
 
     {
         BufferDesc desc;
@@ -248,7 +298,7 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
         desc.CPUAccessFlags = desc.Usage == USAGE_DYNAMIC ? CPU_ACCESS_WRITE : CPU_ACCESS_NONE;
         desc.BindFlags      = BIND_UNIFORM_BUFFER;
         // In bindless mode, we will only write view-projection matrix
-        desc.Size = static_cast<Uint32>((m_BindingMode == BindingMode::Bindless) ? sizeof(DirectX::XMFLOAT4X4) : sizeof(DrawConstantBuffer));
+        desc.Size = static_cast<Uint32>((m_BindingMode == BindingMode::Bindless) ? sizeof(float4x4) : sizeof(DrawConstantBuffer));
         mDevice->CreateBuffer(desc, nullptr, &mDrawConstantBuffer);
         if (m_BindingMode != BindingMode::Bindless)
             Barriers.emplace_back(mDrawConstantBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
@@ -290,6 +340,8 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
                 mDevice->CreateBuffer(desc, nullptr, &mAsteroidsDataBuffers[i]);
             }
         }
+
+        CreateCullingResources(pShaderSourceFactory, Barriers);
     }
 
     // create pipeline state
@@ -356,8 +408,8 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
         samDesc.Desc.AddressU        = TEXTURE_ADDRESS_WRAP;
         samDesc.Desc.AddressV        = TEXTURE_ADDRESS_WRAP;
         samDesc.Desc.AddressW        = TEXTURE_ADDRESS_WRAP;
-        samDesc.Desc.MinLOD          = -D3D11_FLOAT32_MAX;
-        samDesc.Desc.MaxLOD          = D3D11_FLOAT32_MAX;
+        samDesc.Desc.MinLOD          = -std::numeric_limits<float>::max();
+        samDesc.Desc.MaxLOD          = std::numeric_limits<float>::max();
         samDesc.Desc.MipLODBias      = 0.0f;
         samDesc.Desc.MaxAnisotropy   = TEXTURE_ANISO;
         samDesc.Desc.ComparisonFunc  = COMPARISON_FUNC_NEVER;
@@ -514,8 +566,8 @@ Asteroids::Asteroids(const Settings& settings, AsteroidsSimulation* asteroids, G
         desc.AddressU       = TEXTURE_ADDRESS_WRAP;
         desc.AddressV       = TEXTURE_ADDRESS_WRAP;
         desc.AddressW       = TEXTURE_ADDRESS_WRAP;
-        desc.MinLOD         = -D3D11_FLOAT32_MAX;
-        desc.MaxLOD         = D3D11_FLOAT32_MAX;
+        desc.MinLOD         = -std::numeric_limits<float>::max();
+        desc.MaxLOD         = std::numeric_limits<float>::max();
         desc.MipLODBias     = 0.0f;
         desc.MaxAnisotropy  = TEXTURE_ANISO;
         desc.ComparisonFunc = COMPARISON_FUNC_NEVER;
@@ -658,7 +710,7 @@ Asteroids::~Asteroids()
 }
 
 
-void Asteroids::ResizeSwapChain(HWND outputWindow, unsigned int width, unsigned int height)
+void Asteroids::ResizeSwapChain(unsigned int width, unsigned int height)
 {
     mSwapChain->Resize(width, height);
     mBackBufferWidth  = width;
@@ -752,7 +804,7 @@ void Asteroids::InitializeTextureData()
     textureDesc.BindFlags   = BIND_SHADER_RESOURCE;
 
     std::vector<StateTransitionDesc> Barriers;
-    for (UINT t = 0; t < NUM_UNIQUE_TEXTURES; ++t)
+    for (Uint32 t = 0; t < NUM_UNIQUE_TEXTURES; ++t)
     {
         std::vector<TextureSubResData> subResData(size_t{textureDesc.ArraySize} * size_t{mAsteroids->GetTextureMipLevels()});
         auto*                          texData = mAsteroids->TextureData(t);
@@ -832,7 +884,7 @@ void Asteroids::WorkerThreadFunc(Asteroids* pThis, Uint32 ThreadNum)
         auto  SubsetStart  = SubsetSize * (ThreadNum + 1);
         auto& FrameAttribs = pThis->mFrameAttribs;
 
-        pThis->mAsteroids->Update(FrameAttribs.frameTime, FrameAttribs.camera->Eye(), *FrameAttribs.settings, SubsetStart, SubsetSize);
+        pThis->mAsteroids->Update(FrameAttribs.frameTime, FrameAttribs.camera->EyePosition(), *FrameAttribs.settings, SubsetStart, SubsetSize);
 
         // Increment number of completed threads
         ++pThis->m_NumThreadsCompleted;
@@ -852,6 +904,325 @@ void Asteroids::WorkerThreadFunc(Asteroids* pThis, Uint32 ThreadNum)
     }
 }
 
+void Asteroids::CreateCullingResources(IShaderSourceInputStreamFactory* pShaderSourceFactory, std::vector<StateTransitionDesc>& Barriers)
+{
+    VERIFY_EXPR(mAsteroids->SubdivCount() + 1 == NumLods);
+
+    // The asteroid index is passed to the vertex shader through the first instance location
+    const auto DrawCapFlags     = mDevice->GetAdapterInfo().DrawCommand.CapFlags;
+    mIndirectDrawSupported      = (DrawCapFlags & DRAW_COMMAND_CAP_FLAG_DRAW_INDIRECT_FIRST_INSTANCE) != 0;
+    mIndirectDrawCountSupported = (DrawCapFlags & DRAW_COMMAND_CAP_FLAG_DRAW_INDIRECT_COUNTER_BUFFER) != 0;
+    if (!mIndirectDrawSupported)
+    {
+        LOG_WARNING_MESSAGE("The device does not support indirect draws with the first instance. Frustum culling is disabled.");
+        return;
+    }
+
+    mVisibleAsteroids.resize(mNumSubsets);
+    mLodFirstDraw.resize(mNumSubsets);
+    for (Uint32 i = 0; i < mNumSubsets; ++i)
+    {
+        mVisibleAsteroids[i].resize(mMaxAsteroidsInSubset);
+        mLodFirstDraw[i].resize(NumLods + 1);
+    }
+
+    {
+        // Draw arguments of the visible asteroids written by the CPU every frame
+        BufferDesc desc;
+        desc.Name           = "Draw arguments buffer";
+        desc.Usage          = USAGE_DYNAMIC;
+        desc.BindFlags      = BIND_INDIRECT_DRAW_ARGS;
+        desc.CPUAccessFlags = CPU_ACCESS_WRITE;
+        desc.Size           = static_cast<Uint64>(sizeof(DrawIndexedIndirectArgs)) * mMaxAsteroidsInSubset;
+        mDrawArgsBuffers.resize(mNumSubsets);
+        for (Uint32 i = 0; i < mNumSubsets; ++i)
+            mDevice->CreateBuffer(desc, nullptr, &mDrawArgsBuffers[i]);
+    }
+
+    if (!mDevice->GetDeviceInfo().Features.ComputeShaders)
+        return;
+
+    {
+        BufferDesc desc;
+        desc.Name      = "Cull constant buffer";
+        desc.Usage     = USAGE_DEFAULT;
+        desc.BindFlags = BIND_UNIFORM_BUFFER;
+        desc.Size      = sizeof(CullConstants);
+        mDevice->CreateBuffer(desc, nullptr, &mCullConstantBuffer);
+    }
+
+    {
+        BufferDesc desc;
+        desc.Name              = "Asteroid draw info buffer";
+        desc.Usage             = USAGE_DYNAMIC;
+        desc.BindFlags         = BIND_SHADER_RESOURCE;
+        desc.Mode              = BUFFER_MODE_STRUCTURED;
+        desc.CPUAccessFlags    = CPU_ACCESS_WRITE;
+        desc.ElementByteStride = static_cast<Uint32>(sizeof(AsteroidDrawInfo));
+        desc.Size              = desc.ElementByteStride * mMaxAsteroidsInSubset;
+        mDrawInfoBuffers.resize(mNumSubsets);
+        for (Uint32 i = 0; i < mNumSubsets; ++i)
+            mDevice->CreateBuffer(desc, nullptr, &mDrawInfoBuffers[i]);
+    }
+
+    {
+        // Draw arguments written by the culling shader, mMaxAsteroidsInSubset per LOD
+        BufferDesc desc;
+        desc.Name      = "GPU draw arguments buffer";
+        desc.Usage     = USAGE_DEFAULT;
+        desc.BindFlags = BIND_UNORDERED_ACCESS | BIND_INDIRECT_DRAW_ARGS;
+        desc.Mode      = BUFFER_MODE_RAW;
+        desc.Size      = static_cast<Uint64>(sizeof(DrawIndexedIndirectArgs)) * mMaxAsteroidsInSubset * NumLods;
+        mGPUDrawArgsBuffers.resize(mNumSubsets);
+        for (Uint32 i = 0; i < mNumSubsets; ++i)
+        {
+            mDevice->CreateBuffer(desc, nullptr, &mGPUDrawArgsBuffers[i]);
+            Barriers.emplace_back(mGPUDrawArgsBuffers[i], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDIRECT_ARGUMENT, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        }
+    }
+
+    if (mIndirectDrawCountSupported)
+    {
+        // The number of visible asteroids of every LOD
+        BufferDesc desc;
+        desc.Name      = "Draw count buffer";
+        desc.Usage     = USAGE_DEFAULT;
+        desc.BindFlags = BIND_UNORDERED_ACCESS | BIND_INDIRECT_DRAW_ARGS;
+        desc.Mode      = BUFFER_MODE_RAW;
+        desc.Size      = sizeof(Uint32) * NumLods;
+        mDrawCountBuffers.resize(mNumSubsets);
+        for (Uint32 i = 0; i < mNumSubsets; ++i)
+        {
+            mDevice->CreateBuffer(desc, nullptr, &mDrawCountBuffers[i]);
+            Barriers.emplace_back(mDrawCountBuffers[i], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDIRECT_ARGUMENT, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        }
+    }
+
+    ShaderMacroHelper Macros;
+    Macros.AddShaderMacro("THREAD_GROUP_SIZE", CullThreadGroupSize);
+    Macros.AddShaderMacro("COMPACT_DRAW_ARGS", mIndirectDrawCountSupported);
+    Macros.Finalize();
+
+    RefCntAutoPtr<IShader> cs;
+    {
+        ShaderCreateInfo attribs;
+        attribs.Desc.ShaderType            = SHADER_TYPE_COMPUTE;
+        attribs.Desc.Name                  = "Asteroids cull CS";
+        attribs.EntryPoint                 = "asteroid_cull_diligent";
+        attribs.FilePath                   = "asteroid_cull_diligent.csh";
+        attribs.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
+        attribs.pShaderSourceStreamFactory = pShaderSourceFactory;
+        attribs.UseCombinedTextureSamplers = true;
+        attribs.Macros                     = Macros;
+        mDevice->CreateShader(attribs, &cs);
+    }
+
+    ComputePipelineStateCreateInfo PSOCreateInfo;
+    PipelineStateDesc&             PSODesc = PSOCreateInfo.PSODesc;
+
+    PSODesc.Name         = "Asteroids cull PSO";
+    PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+
+    PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
+    // clang-format off
+    ShaderResourceVariableDesc Vars[] =
+    {
+        {SHADER_TYPE_COMPUTE, "CullConstants", SHADER_RESOURCE_VARIABLE_TYPE_STATIC}
+    };
+    // clang-format on
+    PSODesc.ResourceLayout.Variables    = Vars;
+    PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+    PSOCreateInfo.pCS = cs;
+    mDevice->CreateComputePipelineState(PSOCreateInfo, &mCullPSO);
+    mCullPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "CullConstants")->Set(mCullConstantBuffer);
+
+    // Create one SRB per subset
+    mCullSRBs.resize(mNumSubsets);
+    for (Uint32 i = 0; i < mNumSubsets; ++i)
+    {
+        mCullPSO->CreateShaderResourceBinding(&mCullSRBs[i], true);
+        mCullSRBs[i]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Data")->Set(mAsteroidsDataBuffers[i]->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        mCullSRBs[i]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_DrawInfo")->Set(mDrawInfoBuffers[i]->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        mCullSRBs[i]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_DrawArgs")->Set(mGPUDrawArgsBuffers[i]->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+        if (mIndirectDrawCountSupported)
+            mCullSRBs[i]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_DrawCounts")->Set(mDrawCountBuffers[i]->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+    }
+}
+
+// Writes the data of the visible asteroids sorted by LOD and the arguments of their draws
+void Asteroids::CullSubsetOnCPU(Uint32             SubsetNum,
+                                IDeviceContext*    pCtx,
+                                const OrbitCamera& camera,
+                                Uint32             startIdx,
+                                Uint32             numAsteroids)
+{
+    auto staticAsteroidData  = mAsteroids->StaticData();
+    auto dynamicAsteroidData = mAsteroids->DynamicData();
+
+    auto&      visible    = mVisibleAsteroids[SubsetNum];
+    const auto numVisible = static_cast<Uint32>(mAsteroids->Cull(camera.ViewProjection(), startIdx, numAsteroids, visible.data()));
+
+    // Counting sort by LOD
+    auto& lodFirstDraw = mLodFirstDraw[SubsetNum];
+    std::fill(lodFirstDraw.begin(), lodFirstDraw.end(), 0u);
+    for (Uint32 v = 0; v < numVisible; ++v)
+        ++lodFirstDraw[dynamicAsteroidData[visible[v]].subdiv + 1];
+    for (Uint32 lod = 0; lod < NumLods; ++lod)
+        lodFirstDraw[lod + 1] += lodFirstDraw[lod];
+
+    Uint32 lodNextDraw[NumLods];
+    std::copy(lodFirstDraw.begin(), lodFirstDraw.begin() + NumLods, lodNextDraw);
+    {
+        MapHelper<AsteroidData>            asteroidData(pCtx, mAsteroidsDataBuffers[SubsetNum], MAP_WRITE, MAP_FLAG_DISCARD);
+        MapHelper<DrawIndexedIndirectArgs> drawArgs(pCtx, mDrawArgsBuffers[SubsetNum], MAP_WRITE, MAP_FLAG_DISCARD);
+        for (Uint32 v = 0; v < numVisible; ++v)
+        {
+            const auto  drawIdx     = visible[v];
+            const auto& staticData  = staticAsteroidData[drawIdx];
+            const auto& dynamicData = dynamicAsteroidData[drawIdx];
+            const auto  slot        = lodNextDraw[dynamicData.subdiv]++;
+
+            asteroidData[slot].mWorld        = dynamicData.world;
+            asteroidData[slot].mSurfaceColor = staticData.surfaceColor;
+            asteroidData[slot].mDeepColor    = staticData.deepColor;
+            asteroidData[slot].mTextureIndex = staticData.textureIndex;
+
+            auto& args         = drawArgs[slot];
+            args.IndexCount    = dynamicData.indexCount;
+            args.InstanceCount = 1;
+            args.FirstIndex    = dynamicData.indexStart;
+            args.BaseVertex    = static_cast<Int32>(staticData.vertexStart);
+            args.FirstInstance = slot;
+        }
+    }
+
+    // clang-format off
+    StateTransitionDesc Barriers[] =
+    {
+        {mAsteroidsDataBuffers[SubsetNum], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE,   STATE_TRANSITION_FLAG_UPDATE_STATE},
+        {mDrawArgsBuffers[SubsetNum],      RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDIRECT_ARGUMENT, STATE_TRANSITION_FLAG_UPDATE_STATE}
+    };
+    // clang-format on
+    pCtx->TransitionResourceStates(_countof(Barriers), Barriers);
+}
+
+// Writes the data of all asteroids of the subset and runs the culling shader that
+// produces the draw arguments. Must be called outside of the render pass.
+void Asteroids::CullSubsetOnGPU(Uint32          SubsetNum,
+                                IDeviceContext* pCtx,
+                                Uint32          startIdx,
+                                Uint32          numAsteroids)
+{
+    auto staticAsteroidData  = mAsteroids->StaticData();
+    auto dynamicAsteroidData = mAsteroids->DynamicData();
+
+    {
+        MapHelper<AsteroidData>     asteroidData(pCtx, mAsteroidsDataBuffers[SubsetNum], MAP_WRITE, MAP_FLAG_DISCARD);
+        MapHelper<AsteroidDrawInfo> drawInfo(pCtx, mDrawInfoBuffers[SubsetNum], MAP_WRITE, MAP_FLAG_DISCARD);
+        for (Uint32 i = 0; i < numAsteroids; ++i)
+        {
+            const auto& staticData  = staticAsteroidData[startIdx + i];
+            const auto& dynamicData = dynamicAsteroidData[startIdx + i];
+
+            asteroidData[i].mWorld        = dynamicData.world;
+            asteroidData[i].mSurfaceColor = staticData.surfaceColor;
+            asteroidData[i].mDeepColor    = staticData.deepColor;
+            asteroidData[i].mTextureIndex = staticData.textureIndex;
+
+            drawInfo[i].IndexCount = dynamicData.indexCount;
+            drawInfo[i].FirstIndex = dynamicData.indexStart;
+            drawInfo[i].BaseVertex = staticData.vertexStart;
+            drawInfo[i].Lod        = dynamicData.subdiv;
+        }
+    }
+
+    // clang-format off
+    StateTransitionDesc Barriers[] =
+    {
+        {mAsteroidsDataBuffers[SubsetNum], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE,   STATE_TRANSITION_FLAG_UPDATE_STATE},
+        {mDrawInfoBuffers[SubsetNum],      RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE,   STATE_TRANSITION_FLAG_UPDATE_STATE},
+        {mGPUDrawArgsBuffers[SubsetNum],   RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_UNORDERED_ACCESS, STATE_TRANSITION_FLAG_UPDATE_STATE}
+    };
+    // clang-format on
+    pCtx->TransitionResourceStates(_countof(Barriers), Barriers);
+
+    if (mIndirectDrawCountSupported)
+    {
+        // Reset the per-LOD draw counts
+        const Uint32 zeroCounts[NumLods] = {};
+
+        StateTransitionDesc CopyBarrier{mDrawCountBuffers[SubsetNum], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_COPY_DEST, STATE_TRANSITION_FLAG_UPDATE_STATE};
+        pCtx->TransitionResourceStates(1, &CopyBarrier);
+        pCtx->UpdateBuffer(mDrawCountBuffers[SubsetNum], 0, sizeof(zeroCounts), zeroCounts, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+
+        StateTransitionDesc UAVBarrier{mDrawCountBuffers[SubsetNum], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_UNORDERED_ACCESS, STATE_TRANSITION_FLAG_UPDATE_STATE};
+        pCtx->TransitionResourceStates(1, &UAVBarrier);
+    }
+
+    pCtx->SetPipelineState(mCullPSO);
+    pCtx->CommitShaderResources(mCullSRBs[SubsetNum], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+
+    DispatchComputeAttribs DispatchAttribs;
+    DispatchAttribs.ThreadGroupCountX = (numAsteroids + CullThreadGroupSize - 1) / CullThreadGroupSize;
+    pCtx->DispatchCompute(DispatchAttribs);
+
+    StateTransitionDesc IndirectArgsBarriers[2];
+    Uint32              NumIndirectArgsBarriers = 0;
+
+    IndirectArgsBarriers[NumIndirectArgsBarriers++] = {mGPUDrawArgsBuffers[SubsetNum], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDIRECT_ARGUMENT, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    if (mIndirectDrawCountSupported)
+        IndirectArgsBarriers[NumIndirectArgsBarriers++] = {mDrawCountBuffers[SubsetNum], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDIRECT_ARGUMENT, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    pCtx->TransitionResourceStates(NumIndirectArgsBarriers, IndirectArgsBarriers);
+}
+
+void Asteroids::DrawSubsetIndirect(Uint32 SubsetNum, IDeviceContext* pCtx, bool gpuCulling, Uint32 numAsteroids)
+{
+    DrawIndexedIndirectAttribs attribs;
+    attribs.IndexType = VT_UINT16;
+    // It is very important to specify DRAW_FLAG_DYNAMIC_RESOURCE_BUFFERS_INTACT flag to make sure
+    // the engine does not do extra work processing buffers that stay intact.
+    attribs.Flags                            = DRAW_FLAG_VERIFY_ALL | DRAW_FLAG_DYNAMIC_RESOURCE_BUFFERS_INTACT;
+    attribs.AttribsBufferStateTransitionMode = RESOURCE_STATE_TRANSITION_MODE_VERIFY;
+    attribs.DrawArgsStride                   = sizeof(DrawIndexedIndirectArgs);
+
+    if (!gpuCulling)
+    {
+        // The CPU knows how many asteroids of every LOD are visible
+        const auto& lodFirstDraw = mLodFirstDraw[SubsetNum];
+
+        attribs.pAttribsBuffer = mDrawArgsBuffers[SubsetNum];
+        for (Uint32 lod = 0; lod < NumLods; ++lod)
+        {
+            attribs.DrawArgsOffset = Uint64{lodFirstDraw[lod]} * sizeof(DrawIndexedIndirectArgs);
+            attribs.DrawCount      = lodFirstDraw[lod + 1] - lodFirstDraw[lod];
+            if (attribs.DrawCount > 0)
+                pCtx->DrawIndexedIndirect(attribs);
+        }
+    }
+    else if (mIndirectDrawCountSupported)
+    {
+        // The culling shader wrote the number of draws of every LOD to the count buffer
+        attribs.pAttribsBuffer                   = mGPUDrawArgsBuffers[SubsetNum];
+        attribs.pCounterBuffer                   = mDrawCountBuffers[SubsetNum];
+        attribs.CounterBufferStateTransitionMode = RESOURCE_STATE_TRANSITION_MODE_VERIFY;
+        attribs.DrawCount                        = numAsteroids;
+        for (Uint32 lod = 0; lod < NumLods; ++lod)
+        {
+            attribs.DrawArgsOffset = Uint64{lod} * mMaxAsteroidsInSubset * sizeof(DrawIndexedIndirectArgs);
+            attribs.CounterOffset  = lod * sizeof(Uint32);
+            pCtx->DrawIndexedIndirect(attribs);
+        }
+    }
+    else
+    {
+        // Culled asteroids have zero instances
+        attribs.pAttribsBuffer = mGPUDrawArgsBuffers[SubsetNum];
+        attribs.DrawCount      = numAsteroids;
+        pCtx->DrawIndexedIndirect(attribs);
+    }
+}
+
 void Asteroids::RenderSubset(Uint32             SubsetNum,
                              IDeviceContext*    pCtx,
                              const OrbitCamera& camera,
@@ -861,6 +1232,12 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
     if (pCtx->GetDesc().IsDeferred)
         pCtx->Begin(0);
 
+    const auto& settings      = *mFrameAttribs.settings;
+    const bool  cullAsteroids = m_BindingMode == BindingMode::Bindless && mIndirectDrawSupported && settings.frustumCulling;
+    const bool  gpuCulling    = cullAsteroids && settings.gpuCulling && mCullPSO != nullptr;
+    if (gpuCulling)
+        CullSubsetOnGPU(SubsetNum, pCtx, startIdx, numAsteroids);
+
     auto* pRTV = mSwapChain->GetCurrentBackBufferRTV();
     auto* pDSV = mSwapChain->GetDepthBufferDSV();
     pCtx->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
@@ -878,18 +1255,28 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
         pCtx->SetIndexBuffer(mIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
     }
 
+    if (cullAsteroids)
+    {
+        if (!gpuCulling)
+            CullSubsetOnCPU(SubsetNum, pCtx, camera, startIdx, numAsteroids);
+
+        pCtx->CommitShaderResources(mAsteroidsSRBs[SubsetNum], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+        DrawSubsetIndirect(SubsetNum, pCtx, gpuCulling, numAsteroids);
+        return;
+    }
+
     if (m_BindingMode == BindingMode::Bindless)
     {
         {
             // Update asteroid data buffer
             MapHelper<AsteroidData> asteroidData(pCtx, mAsteroidsDataBuffers[SubsetNum], MAP_WRITE, MAP_FLAG_DISCARD);
-            UINT                    i = 0;
-            for (UINT drawIdx = startIdx; drawIdx < startIdx + numAsteroids; ++drawIdx, ++i)
+            Uint32                  i = 0;
+            for (Uint32 drawIdx = startIdx; drawIdx < startIdx + numAsteroids; ++drawIdx, ++i)
             {
                 const auto staticData  = &staticAsteroidData[drawIdx];
                 const auto dynamicData = &dynamicAsteroidData[drawIdx];
 
-                XMStoreFloat4x4(&asteroidData[i].mWorld, dynamicData->world);
+                asteroidData[i].mWorld = dynamicData->world;
                 asteroidData[i].mSurfaceColor = staticData->surfaceColor;
                 asteroidData[i].mDeepColor    = staticData->deepColor;
                 asteroidData[i].mTextureIndex = staticData->textureIndex;
@@ -905,7 +1292,7 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
 
     const auto& viewProjection = camera.ViewProjection();
     auto        pVar           = m_BindingMode == BindingMode::Dynamic ? mAsteroidsSRBs[SubsetNum]->GetVariableByName(SHADER_TYPE_PIXEL, "Tex") : nullptr;
-    for (UINT drawIdx = startIdx; drawIdx < startIdx + numAsteroids; ++drawIdx)
+    for (Uint32 drawIdx = startIdx; drawIdx < startIdx + numAsteroids; ++drawIdx)
     {
         const auto staticData  = &staticAsteroidData[drawIdx];
         const auto dynamicData = &dynamicAsteroidData[drawIdx];
@@ -913,8 +1300,8 @@ void Asteroids::RenderSubset(Uint32             SubsetNum,
         if (m_BindingMode != BindingMode::Bindless)
         {
             MapHelper<DrawConstantBuffer> drawConstants(pCtx, mDrawConstantBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
-            XMStoreFloat4x4(&drawConstants->mWorld, dynamicData->world);
-            XMStoreFloat4x4(&drawConstants->mViewProjection, viewProjection);
+            drawConstants->mWorld = dynamicData->world;
+            drawConstants->mViewProjection = viewProjection;
             drawConstants->mSurfaceColor = staticData->surfaceColor;
             drawConstants->mDeepColor    = staticData->deepColor;
         }
@@ -964,9 +1351,9 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     mDeviceCtxt->ClearRenderTarget(pRTV, clearcol, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
     mDeviceCtxt->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 0.0f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-    LONG64 currCounter;
-    QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
-    mUpdateTicks = currCounter;
+    using Clock      = std::chrono::high_resolution_clock;
+    using Seconds    = std::chrono::duration<float>;
+    auto updateStart = Clock::now();
 
     auto SubsetSize = NUM_ASTEROIDS / mNumSubsets;
 
@@ -974,10 +1361,24 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     {
         // Write view-projection matrix into the buffer
         const auto& viewProjection = camera.ViewProjection();
-        mDeviceCtxt->UpdateBuffer(mDrawConstantBuffer, 0, sizeof(DirectX::XMFLOAT4X4), (void*)&viewProjection, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        mDeviceCtxt->UpdateBuffer(mDrawConstantBuffer, 0, sizeof(float4x4), (void*)&viewProjection, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
         // Explicitly transition the buffer to CONSTANT_BUFFER state
         StateTransitionDesc Barrier{mDrawConstantBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE};
         mDeviceCtxt->TransitionResourceStates(1, &Barrier);
+
+        if (mCullPSO && settings.frustumCulling && settings.gpuCulling)
+        {
+            CullConstants cullConstants;
+            ExtractFrustumPlanes(viewProjection, cullConstants.FrustumPlanes);
+            cullConstants.NumAsteroids   = SubsetSize;
+            cullConstants.MaxDrawsPerLod = mMaxAsteroidsInSubset;
+            cullConstants.MeshRadius     = mAsteroids->MeshBoundingRadius();
+            cullConstants.Padding        = 0;
+            mDeviceCtxt->UpdateBuffer(mCullConstantBuffer, 0, sizeof(cullConstants), &cullConstants, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+            StateTransitionDesc CullBarrier{mCullConstantBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE};
+            mDeviceCtxt->TransitionResourceStates(1, &CullBarrier);
+        }
     }
 
     if (settings.multithreadedRendering)
@@ -988,7 +1389,7 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
 
     // Update all subsets in this thread when multithreadedRendering is false
     for (Uint32 i = 0; i < (!settings.multithreadedRendering ? mNumSubsets : 1); ++i)
-        mAsteroids->Update(frameTime, camera.Eye(), settings, SubsetSize * i, SubsetSize);
+        mAsteroids->Update(frameTime, camera.EyePosition(), settings, SubsetSize * i, SubsetSize);
 
     if (settings.multithreadedRendering)
     {
@@ -999,10 +1400,8 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
         mUpdateSubsetsSignal.Reset();
     }
 
-    QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
-    mUpdateTicks = currCounter - mUpdateTicks;
-
-    mRenderTicks = currCounter;
+    auto renderStart = Clock::now();
+    mUpdateTime      = std::chrono::duration_cast<Seconds>(renderStart - updateStart).count();
 
     if (settings.multithreadedRendering)
     {
@@ -1043,8 +1442,7 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     for (auto& ctx : mDeferredCtxt)
         ctx->FinishFrame();
 
-    QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
-    mRenderTicks = currCounter - mRenderTicks;
+    mRenderTime = std::chrono::duration_cast<Seconds>(Clock::now() - renderStart).count();
 
     mDeviceCtxt->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
@@ -1052,7 +1450,7 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     {
         {
             MapHelper<SkyboxConstantBuffer> skyboxConstants(mDeviceCtxt, mSkyboxConstantBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
-            XMStoreFloat4x4(&skyboxConstants->mViewProjection, camera.ViewProjection());
+            skyboxConstants->mViewProjection = camera.ViewProjection();
         }
 
         IBuffer* ia_buffers[] = {mSkyboxVertexBuffer};
@@ -1068,7 +1466,7 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     // Draw sprites and fonts
     {
         // Fill in vertices (TODO: could move this vector to be a member - not a big deal)
-        std::vector<UINT> controlVertices;
+        std::vector<Uint32> controlVertices;
         controlVertices.reserve(mGUI->size());
 
         {
@@ -1078,7 +1476,7 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
             for (int i = -1; i < (int)mGUI->size(); ++i)
             {
                 auto control = i >= 0 ? (*mGUI)[i] : mSprite.get();
-                controlVertices.push_back((UINT)(control->Draw((float)mBackBufferWidth, (float)mBackBufferHeight, vertexEnd) - vertexEnd));
+                controlVertices.push_back((Uint32)(control->Draw((float)mBackBufferWidth, (float)mBackBufferHeight, vertexEnd) - vertexEnd));
                 vertexEnd += controlVertices.back();
             }
         }
@@ -1087,7 +1485,7 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
         mDeviceCtxt->SetVertexBuffers(0, 1, ia_buffers, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_NONE);
 
         // Draw
-        UINT vertexStart = 0;
+        Uint32 vertexStart = 0;
         for (int i = -1; i < (int)mGUI->size(); ++i)
         {
             auto control = i >= 0 ? (*mGUI)[i] : mSprite.get();
@@ -1118,8 +1516,8 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
 
 void Asteroids::GetPerfCounters(float& UpdateTime, float& RenderTime)
 {
-    UpdateTime = (float)mUpdateTicks / (float)mPerfCounterFreq;
-    RenderTime = (float)mRenderTicks / (float)mPerfCounterFreq;
+    UpdateTime = mUpdateTime;
+    RenderTime = mRenderTime;
 }
 
 } // namespace AsteroidsDE
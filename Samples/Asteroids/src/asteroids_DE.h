@@ -14,15 +14,17 @@
 #include "SwapChain.h"
 #include "DeviceContext.h"
 #include "RefCntAutoPtr.hpp"
+#include "NativeWindow.h"
 #include "ThreadSignal.hpp"
 #include <map>
 #include <mutex>
 #include <atomic>
+#include <thread>
+#include <condition_variable>
 
 #include "camera.h"
 #include "settings.h"
 #include "simulation.h"
-#include "util.h"
 #include "gui.h"
 
 
@@ -30,12 +32,12 @@ namespace AsteroidsDE {
 
 class Asteroids {
 public:
-    Asteroids(const Settings &settings, AsteroidsSimulation* asteroids, GUI* gui, HWND hWnd, Diligent::RENDER_DEVICE_TYPE DevType);
+    Asteroids(const Settings &settings, AsteroidsSimulation* asteroids, GUI* gui, const Diligent::NativeWindow& window, Diligent::RENDER_DEVICE_TYPE DevType);
     ~Asteroids();
 
     void Render(float frameTime, const OrbitCamera& camera, const Settings& settings);
 
-    void ResizeSwapChain(HWND outputWindow, unsigned int width, unsigned int height);
+    void ResizeSwapChain(unsigned int width, unsigned int height);
 
     void GetPerfCounters(float &UpdateTime, float &RenderTime);
 
@@ -44,7 +46,11 @@ private:
     void InitializeTextureData();
     void CreateGUIResources();
     void RenderSubset(Diligent::Uint32 SubsetNum, Diligent::IDeviceContext *pCtx, const OrbitCamera& camera, Diligent::Uint32 startIdx, Diligent::Uint32 numAsteroids);
-    void InitDevice(HWND hWnd, Diligent::RENDER_DEVICE_TYPE DevType);
+    void CreateCullingResources(Diligent::IShaderSourceInputStreamFactory* pShaderSourceFactory, std::vector<Diligent::StateTransitionDesc>& Barriers);
+    void CullSubsetOnCPU(Diligent::Uint32 SubsetNum, Diligent::IDeviceContext* pCtx, const OrbitCamera& camera, Diligent::Uint32 startIdx, Diligent::Uint32 numAsteroids);
+    void CullSubsetOnGPU(Diligent::Uint32 SubsetNum, Diligent::IDeviceContext* pCtx, Diligent::Uint32 startIdx, Diligent::Uint32 numAsteroids);
+    void DrawSubsetIndirect(Diligent::Uint32 SubsetNum, Diligent::IDeviceContext* pCtx, bool gpuCulling, Diligent::Uint32 numAsteroids);
+    void InitDevice(const Diligent::NativeWindow& window, Diligent::RENDER_DEVICE_TYPE DevType, bool softwareAdapter);
 
     enum class BindingMode
     {
@@ -93,6 +99,22 @@ private:
 
     Diligent::RefCntAutoPtr<Diligent::IPipelineState>  mAsteroidsPSO;
     std::vector< Diligent::RefCntAutoPtr<Diligent::IShaderResourceBinding> > mAsteroidsSRBs;
+
+    // Frustum culling and indirect draws in bindless mode. Every subset has its own buffers.
+    // Draw arguments are grouped by LOD: the arguments of LOD l start at l * mMaxAsteroidsInSubset
+    // in the GPU-written buffers and at mLodFirstDraw[SubsetNum][l] in the CPU-written ones.
+    bool mIndirectDrawSupported = false;
+    bool mIndirectDrawCountSupported = false;
+    Diligent::Uint32 mMaxAsteroidsInSubset = 0;
+    std::vector< std::vector<Diligent::Uint32> > mVisibleAsteroids;
+    std::vector< std::vector<Diligent::Uint32> > mLodFirstDraw;
+    std::vector< Diligent::RefCntAutoPtr<Diligent::IBuffer> > mDrawArgsBuffers;
+    std::vector< Diligent::RefCntAutoPtr<Diligent::IBuffer> > mDrawInfoBuffers;
+    std::vector< Diligent::RefCntAutoPtr<Diligent::IBuffer> > mGPUDrawArgsBuffers;
+    std::vector< Diligent::RefCntAutoPtr<Diligent::IBuffer> > mDrawCountBuffers;
+    Diligent::RefCntAutoPtr<Diligent::IBuffer>  mCullConstantBuffer;
+    Diligent::RefCntAutoPtr<Diligent::IPipelineState>  mCullPSO;
+    std::vector< Diligent::RefCntAutoPtr<Diligent::IShaderResourceBinding> > mCullSRBs;
     
     Diligent::RefCntAutoPtr<Diligent::IPipelineState>  mFontPSO;
     Diligent::RefCntAutoPtr<Diligent::IPipelineState>  mSpritePSO;
@@ -111,8 +133,8 @@ private:
     Diligent::RefCntAutoPtr<Diligent::ISampler> mSamplerState;
 
     std::unique_ptr<GUISprite> mSprite;
-    UINT64 mPerfCounterFreq = 0;
-    volatile LONG64 mUpdateTicks = 0, mRenderTicks = 0;
+    // Seconds
+    float mUpdateTime = 0, mRenderTime = 0;
 };
 
 } // namespace AsteroidsD3D11
@@ -403,7 +403,7 @@ void Asteroids::InitializeTextureData()
     textureDesc.BindFlags        = D3D11_BIND_SHADER_RESOURCE;
 
     for (UINT t = 0; t < NUM_UNIQUE_TEXTURES; ++t) {
-        ThrowIfFailed(mDevice->CreateTexture2D(&textureDesc, mAsteroids->TextureData(t), &mTextures[t]));
+        ThrowIfFailed(mDevice->CreateTexture2D(&textureDesc, AsD3D11SubresourceData(mAsteroids->TextureData(t)), &mTextures[t]));
         ThrowIfFailed(mDevice->CreateShaderResourceView(mTextures[t], nullptr, &mTextureSRVs[t]));
     }
 }
@@ -442,7 +442,10 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
 
     // Frame data
-    mAsteroids->Update(frameTime, camera.Eye(), settings);
+    if (settings.multithreadedRendering)
+        mAsteroids->UpdateAll(frameTime, camera.EyePosition(), settings);
+    else
+        mAsteroids->Update(frameTime, camera.EyePosition(), settings);
     
     mTotalUpdateTicks = currCounter;
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
@@ -490,8 +493,8 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
         ThrowIfFailed(mDeviceCtxt->Map(mDrawConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
 
         auto drawConstants = (DrawConstantBuffer*) mapped.pData;
-        XMStoreFloat4x4(&drawConstants->mWorld,          dynamicData->world);
-        XMStoreFloat4x4(&drawConstants->mViewProjection, viewProjection);
+        drawConstants->mWorld = dynamicData->world;
+        drawConstants->mViewProjection = viewProjection;
         drawConstants->mSurfaceColor = staticData->surfaceColor;
         drawConstants->mDeepColor    = staticData->deepColor;
 
@@ -511,7 +514,7 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
         D3D11_MAPPED_SUBRESOURCE mapped = {};
         ThrowIfFailed(mDeviceCtxt->Map(mSkyboxConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
         auto skyboxConstants = (SkyboxConstantBuffer*) mapped.pData;
-        XMStoreFloat4x4(&skyboxConstants->mViewProjection, camera.ViewProjection());
+        skyboxConstants->mViewProjection = camera.ViewProjection();
         mDeviceCtxt->Unmap(mSkyboxConstantBuffer, 0);
 
         ID3D11Buffer* ia_buffers[] = { mSkyboxVertexBuffer };
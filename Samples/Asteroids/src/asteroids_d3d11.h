@@ -25,17 +25,17 @@
 namespace AsteroidsD3D11 {
 
 struct DrawConstantBuffer {
-    DirectX::XMFLOAT4X4 mWorld;
-    DirectX::XMFLOAT4X4 mViewProjection;
-    DirectX::XMFLOAT3 mSurfaceColor;
+    Diligent::float4x4 mWorld;
+    Diligent::float4x4 mViewProjection;
+    Diligent::float3 mSurfaceColor;
     float unused0;
-    DirectX::XMFLOAT3 mDeepColor;
+    Diligent::float3 mDeepColor;
     float unused1;
     UINT unused2[4];
 };
 
 struct SkyboxConstantBuffer {
-    DirectX::XMFLOAT4X4 mViewProjection;
+    Diligent::float4x4 mViewProjection;
 };
 
 class Asteroids {
@@ -121,7 +121,7 @@ Asteroids::Asteroids(AsteroidsSimulation* asteroids, GUI *gui, UINT minCmdLsts,
             ));
             textureDesc = mAsteroidTextures[i]->GetDesc();
 
-            InitializeTexture2D(mDevice, mCommandQueue, mAsteroidTextures[i], &textureDesc, 1, 1, 4, mAsteroids->TextureData(i));
+            InitializeTexture2D(mDevice, mCommandQueue, mAsteroidTextures[i], &textureDesc, 1, 1, 4, AsD3D11SubresourceData(mAsteroids->TextureData(i)));
 
             // Append a descriptor to the heap
             mSRVDescs->AppendSRV(mAsteroidTextures[i]);
@@ -677,7 +677,7 @@ void Asteroids::RenderSubset(
     D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView,
     size_t frameIndex, float frameTime,
     SubsetD3D12* subset, UINT subsetIdx,
-    XMVECTOR cameraEye, XMMATRIX viewProjection,
+    const Diligent::float3& cameraEye, const Diligent::float4x4& viewProjection,
     const Settings& settings)
 {
     UINT drawStart = mDrawsPerSubset * subsetIdx;
@@ -718,8 +718,8 @@ void Asteroids::RenderSubset(
             auto staticData = &staticAsteroidData[drawIdx];
             auto dynamicData = &dynamicAsteroidData[drawIdx];
 
-            XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mWorld, dynamicData->world);
-            XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mViewProjection, viewProjection);
+            drawConstantBuffers[drawIdx].mWorld = dynamicData->world;
+            drawConstantBuffers[drawIdx].mViewProjection = viewProjection;
 
             // Set root cbuffer
             //cmdLst->SetGraphicsRootDescriptorTable(RP_TEX_SRV, mSRVDescs->GPU(0));
@@ -736,8 +736,8 @@ void Asteroids::RenderSubset(
         {
             auto dynamicData = &dynamicAsteroidData[drawIdx];
 
-            XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mWorld, dynamicData->world);
-            XMStoreFloat4x4(&drawConstantBuffers[drawIdx].mViewProjection, viewProjection);
+            drawConstantBuffers[drawIdx].mWorld = dynamicData->world;
+            drawConstantBuffers[drawIdx].mViewProjection = viewProjection;
 
             auto drawIndexed = &indirectArgs[drawIdx].mDrawIndexed;
             drawIndexed->IndexCountPerInstance = dynamicData->indexCount;
@@ -768,15 +768,11 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     // Update asteroid simulation
     if (settings.multithreadedRendering)
     {
-        concurrency::parallel_for<UINT>(0, mSubsetCount, [&](UINT subsetIdx) {
-            UINT drawStart = mDrawsPerSubset * subsetIdx;
-            UINT drawEnd = std::min(drawStart + mDrawsPerSubset, (UINT)NUM_ASTEROIDS);
-            mAsteroids->Update(frameTime, camera.Eye(), settings, drawStart, drawEnd - drawStart);
-        });
+        mAsteroids->UpdateAll(frameTime, camera.EyePosition(), settings);
     }
     else
     {
-        mAsteroids->Update(frameTime, camera.Eye(), settings, 0, (UINT)NUM_ASTEROIDS);
+        mAsteroids->Update(frameTime, camera.EyePosition(), settings, 0, (UINT)NUM_ASTEROIDS);
     }
     LONG64 currCounter;
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
@@ -788,14 +784,14 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
     {
         concurrency::parallel_for<UINT>(0, mSubsetCount, [&](UINT subsetIdx) {
             RenderSubset(swapChainBuffer->mRenderTargetView, mCurrentFrameIndex, frameTime,
-                frame->mSubsets[subsetIdx], subsetIdx, camera.Eye(), camera.ViewProjection(), settings);
+                frame->mSubsets[subsetIdx], subsetIdx, camera.EyePosition(), camera.ViewProjection(), settings);
         });
     }
     else
     {
         for (unsigned int subsetIdx = 0; subsetIdx < mSubsetCount; ++subsetIdx) {
             RenderSubset(swapChainBuffer->mRenderTargetView, mCurrentFrameIndex, frameTime,
-                frame->mSubsets[subsetIdx], subsetIdx, camera.Eye(), camera.ViewProjection(), settings);
+                frame->mSubsets[subsetIdx], subsetIdx, camera.EyePosition(), camera.ViewProjection(), settings);
         }
     }
     QueryPerformanceCounter((LARGE_INTEGER*)&currCounter);
@@ -849,7 +845,7 @@ void Asteroids::Render(float frameTime, const OrbitCamera& camera, const Setting
             // Draw skybox
             {
                 auto constants = &frame->mDynamicUpload->DataWO()->mSkyboxConstants;
-                XMStoreFloat4x4(&constants->mViewProjection, camera.ViewProjection());
+                constants->mViewProjection = camera.ViewProjection();
 
                 mPostCmdLst->IASetVertexBuffers(0, 1, &mSkyboxVertexBufferView);
 
@@ -30,18 +30,18 @@
 namespace AsteroidsD3D12 {
 
 CBUFFER_ALIGN struct DrawConstantBuffer {
-    DirectX::XMFLOAT4X4 mWorld;
-    DirectX::XMFLOAT4X4 mViewProjection;
-    DirectX::XMFLOAT3 mSurfaceColor;
+    Diligent::float4x4 mWorld;
+    Diligent::float4x4 mViewProjection;
+    Diligent::float3 mSurfaceColor;
     float unused0;
-    DirectX::XMFLOAT3 mDeepColor;
+    Diligent::float3 mDeepColor;
     float unused1;
     UINT mTextureIndex;
     UINT unused2[3];
 };
 
 CBUFFER_ALIGN struct SkyboxConstantBuffer {
-    DirectX::XMFLOAT4X4 mViewProjection;
+    Diligent::float4x4 mViewProjection;
 };
 
 struct ExecuteIndirectArgs {
@@ -76,7 +76,7 @@ private:
         D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView,
         size_t frameIndex, float frameTime,
         SubsetD3D12* subset, UINT subsetIdx,
-        DirectX::XMVECTOR cameraEye, DirectX::XMMATRIX viewProjection,
+        const Diligent::float3& cameraEye, const Diligent::float4x4& viewProjection,
         const Settings& settings);
 
     void CreatePSOs();
@@ -12,22 +12,55 @@
 #include <cmath>
 
 #include "camera.h"
-#include "util.h"
+#if PLATFORM_WIN32
+#    include "util.h"
+#endif
 
-using namespace DirectX;
+using namespace Diligent;
+
+namespace {
+
+// Same as XMMatrixLookAtRH
+float4x4 LookAtRH(const float3& eye, const float3& focus, const float3& up)
+{
+    auto zaxis = normalize(eye - focus);
+    auto xaxis = normalize(cross(up, zaxis));
+    auto yaxis = cross(zaxis, xaxis);
+    return float4x4(
+        xaxis.x, yaxis.x, zaxis.x, 0.0f,
+        xaxis.y, yaxis.y, zaxis.y, 0.0f,
+        xaxis.z, yaxis.z, zaxis.z, 0.0f,
+        -dot(xaxis, eye), -dot(yaxis, eye), -dot(zaxis, eye), 1.0f);
+}
+
+// Same as XMMatrixPerspectiveFovRH; passing nearZ > farZ gives reversed depth
+float4x4 PerspectiveFovRH(float fovY, float aspect, float nearZ, float farZ)
+{
+    float h = 1.0f / std::tan(0.5f * fovY);
+    float w = h / aspect;
+    float range = farZ / (nearZ - farZ);
+    return float4x4(
+        w,    0.0f, 0.0f,           0.0f,
+        0.0f, h,    0.0f,           0.0f,
+        0.0f, 0.0f, range,         -1.0f,
+        0.0f, 0.0f, range * nearZ,  0.0f);
+}
+
+} // namespace
 
 
 OrbitCamera::OrbitCamera()
 {
     // Defaults
-    mCenter = XMVectorSet(0, 0, 0, 0);
-    mUp = XMVectorSet(0, 1, 0, 0);
+    mCenter = float3(0, 0, 0);
+    mUp = float3(0, 1, 0);
     mRadius = 1.0f;
     mMinRadius = 1.0f;
     mMaxRadius = 1.0f;
     mLongAngle = 0.0f;
     mLatAngle = 0.0f;
 
+#if PLATFORM_WIN32
     // Set up interaction context (i.e. touch input processing, etc)
     ThrowIfFailed(CreateInteractionContext(&mInteractionContext));
     ThrowIfFailed(SetPropertyInteractionContext(mInteractionContext, INTERACTION_CONTEXT_PROPERTY_FILTER_POINTERS, TRUE));
@@ -50,17 +83,20 @@ OrbitCamera::OrbitCamera()
     }
 
     ThrowIfFailed(RegisterOutputCallbackInteractionContext(mInteractionContext, OrbitCamera::StaticInteractionOutputCallback, this));
+#endif
 }
 
 
 OrbitCamera::~OrbitCamera()
 {
+#if PLATFORM_WIN32
     DestroyInteractionContext(mInteractionContext);
+#endif
 }
 
 
 void OrbitCamera::View(
-    DirectX::XMVECTOR center, float radius, float minRadius, float maxRadius,
+    const float3& center, float radius, float minRadius, float maxRadius,
     float longAngle, float latAngle)
 {
     mCenter = center;
@@ -76,21 +112,20 @@ void OrbitCamera::View(
 void OrbitCamera::Projection(float fov, float aspect)
 {
     float fovY = (aspect <= 1.0 ? fov : fov / aspect);
-    mProjection = XMMatrixPerspectiveFovRH(fovY, aspect, 10000.0f, 0.1f);
+    mProjection = PerspectiveFovRH(fovY, aspect, 10000.0f, 0.1f);
     UpdateData();
 }
 
 
 void OrbitCamera::UpdateData()
 {
-    mEye = XMVectorSet(
+    mEye = float3(
         mRadius * std::sin(mLatAngle) * std::cos(mLongAngle),
         mRadius * std::cos(mLatAngle),
-        mRadius * std::sin(mLatAngle) * std::sin(mLongAngle),
-        0.0f);
+        mRadius * std::sin(mLatAngle) * std::sin(mLongAngle));
 
-    mView = XMMatrixLookAtRH(mEye, mCenter, mUp);
-    mViewProjection = XMMatrixMultiply(mView, mProjection);
+    mView = LookAtRH(mEye, mCenter, mUp);
+    mViewProjection = mView * mProjection;
 }
 
 
@@ -103,8 +138,8 @@ void OrbitCamera::OrbitX(float angle)
 
 void OrbitCamera::OrbitY(float angle)
 {
-    float limit = XM_PI * 0.01f;
-    mLatAngle = std::max(limit, std::min(XM_PI-limit, mLatAngle + angle));
+    float limit = PI_F * 0.01f;
+    mLatAngle = std::max(limit, std::min(PI_F-limit, mLatAngle + angle));
     UpdateData();
 }
 
@@ -122,6 +157,7 @@ void OrbitCamera::ZoomRadiusScale(float delta)
 }
 
 
+#if PLATFORM_WIN32
 void OrbitCamera::AddPointer(UINT pointerId)
 {
     AddPointerInteractionContext(mInteractionContext, pointerId);
@@ -170,3 +206,4 @@ void OrbitCamera::InteractionOutputCallback(const INTERACTION_CONTEXT_OUTPUT *ou
         break;
     }
 }
+#endif
@@ -10,8 +10,11 @@
 
 #pragma once
 
-#include <DirectXMath.h>
-#include <interactioncontext.h>
+#if PLATFORM_WIN32
+#    include <interactioncontext.h>
+#endif
+
+#include "BasicMath.hpp"
 
 class OrbitCamera
 {
@@ -19,20 +22,23 @@ public:
     OrbitCamera();
     ~OrbitCamera();
 
-    void View(DirectX::XMVECTOR center,
+    void View(const Diligent::float3& center,
               float radius, float minRadius, float maxRadius,
               float longAngle, float latAngle);
 
     // Uses the provided fov for the larger dimension
     void Projection(float fov, float aspect);
 
-    DirectX::XMVECTOR const& Eye() const { return mEye; }
-    DirectX::XMMATRIX const& ViewProjection() const { return mViewProjection; }
+    Diligent::float3 const& EyePosition() const { return mEye; }
+    // Row-major matrix for row vectors, same layout as DirectX::XMFLOAT4X4
+    Diligent::float4x4 const& ViewProjection() const { return mViewProjection; }
 
+#if PLATFORM_WIN32
     void AddPointer(UINT pointerId);
     void ProcessPointerFrames(UINT pointerId, const POINTER_INFO* pointerInfo);
     void ProcessInertia();
     void RemovePointer(UINT pointerId);
+#endif
 
     void OrbitX(float angle);
     void OrbitY(float angle);
@@ -41,11 +47,13 @@ public:
     
 private:
     void UpdateData();
+#if PLATFORM_WIN32
     static VOID CALLBACK StaticInteractionOutputCallback(VOID *clientData, const INTERACTION_CONTEXT_OUTPUT *output);
     void InteractionOutputCallback(const INTERACTION_CONTEXT_OUTPUT *output);
+#endif
 
-    DirectX::XMVECTOR mCenter;
-    DirectX::XMVECTOR mUp;
+    Diligent::float3 mCenter;
+    Diligent::float3 mUp;
     float mMinRadius;
     float mMaxRadius;
     
@@ -53,10 +61,12 @@ private:
     float mLongAngle;
     float mRadius;
 
-    DirectX::XMVECTOR mEye;
-    DirectX::XMMATRIX mView;
-    DirectX::XMMATRIX mProjection;
-    DirectX::XMMATRIX mViewProjection;
+    Diligent::float3 mEye;
+    Diligent::float4x4 mView;
+    Diligent::float4x4 mProjection;
+    Diligent::float4x4 mViewProjection;
 
+#if PLATFORM_WIN32
     HINTERACTIONCONTEXT mInteractionContext;
+#endif
 };
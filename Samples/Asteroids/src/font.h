@@ -48,7 +48,7 @@ public:
 
     void GetDimensions(const char* str, int* width, int* height) const
     {
-        UINT w = 0;
+        int w = 0;
         for (; *str; ++str) {
             int codePoint = *str - STB_SOMEFONT_FIRST_CHAR;
             assert(codePoint >= 0 && codePoint < static_cast<int>(mFontData.size()));
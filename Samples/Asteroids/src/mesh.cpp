@@ -10,11 +10,17 @@
 
 #include "mesh.h"
 #include "noise.h"
-#include <map>
+#include "TaskScheduler.hpp"
+
+#include <stdint.h>
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
 #include <random>
 
-using namespace DirectX;
-
 void CreateIcosahedron(Mesh *outMesh)
 {
     static const float a = std::sqrt(2.0f / (5.0f - std::sqrt(5.0f)));
@@ -68,7 +74,7 @@ void CreateIcosahedron(Mesh *outMesh)
 }
 
 
-// Maps edge (lower index first!) to
+// Lower index first!
 struct Edge
 {
     Edge(IndexType i0, IndexType i1)
@@ -80,18 +86,58 @@ struct Edge
     IndexType v0;
     IndexType v1;
 
-    bool operator<(const Edge &c) const
+    uint32_t Key() const { return (uint32_t(v0) << 16) | v1; }
+};
+
+// v0 < v1, so a valid edge never packs to all ones
+static const uint32_t EmptyKey = 0xFFFFFFFFu;
+
+// Maps edge to its midpoint vertex. Open addressing with linear probing in a table
+// that is sized once for the known edge count, so there are no allocations per edge.
+class MidpointMap
+{
+public:
+    explicit MidpointMap(size_t edgeCount)
     {
-        return v0 < c.v0 || (v0 == c.v0 && v1 < c.v1);
+        // Keep the load factor at or below 1/2
+        size_t capacity = 64;
+        while (capacity < edgeCount * 2)
+            capacity *= 2;
+        mKeys.assign(capacity, EmptyKey);
+        mValues.resize(capacity);
+        mMask = static_cast<uint32_t>(capacity - 1);
+    }
+
+    // Returns the value slot for the edge. found is false if the edge has just been added
+    // and the caller must fill in the value.
+    IndexType* FindOrInsert(const Edge& e, bool* found)
+    {
+        const auto key = e.Key();
+        auto hash = key * 0x9E3779B1u; // Fibonacci hashing
+        for (auto slot = (hash ^ (hash >> 15)) & mMask;; slot = (slot + 1) & mMask) {
+            if (mKeys[slot] == key) {
+                *found = true;
+                return &mValues[slot];
+            }
+            if (mKeys[slot] == EmptyKey) {
+                mKeys[slot] = key;
+                *found = false;
+                return &mValues[slot];
+            }
+        }
     }
-};
 
-typedef std::map<Edge, IndexType> MidpointMap;
+private:
+    std::vector<uint32_t> mKeys;
+    std::vector<IndexType> mValues;
+    uint32_t mMask = 0;
+};
 
 inline IndexType EdgeMidpoint(Mesh *mesh, MidpointMap *midpoints, Edge e)
 {
-    auto index = midpoints->find(e);
-    if (index == midpoints->end())
+    bool found;
+    auto index = midpoints->FindOrInsert(e, &found);
+    if (!found)
     {
         auto a = mesh->vertices[e.v0];
         auto b = mesh->vertices[e.v1];
@@ -101,16 +147,17 @@ inline IndexType EdgeMidpoint(Mesh *mesh, MidpointMap *midpoints, Edge e)
         m.y = (a.y + b.y) * 0.5f;
         m.z = (a.z + b.z) * 0.5f;
 
-        index = midpoints->insert(std::make_pair(e, static_cast<IndexType>(mesh->vertices.size()))).first;
+        *index = static_cast<IndexType>(mesh->vertices.size());
         mesh->vertices.push_back(m);
     }
-    return index->second;
+    return *index;
 }
 
 
 void SubdivideInPlace(Mesh *outMesh)
 {
-    MidpointMap midpoints;
+    // A closed triangle mesh has 3/2 edges per triangle, i.e. one per two indices
+    MidpointMap midpoints(outMesh->indices.size() / 2);
 
     std::vector<IndexType> newIndices;
     newIndices.reserve(outMesh->indices.size() * 4);
@@ -152,21 +199,23 @@ void SpherifyInPlace(Mesh *outMesh, float radius)
 }
 
 
-void ComputeAvgNormalsInPlace(Mesh *outMesh)
+namespace {
+
+void ComputeAvgNormals(Vertex* vertices, size_t vertexCount, const IndexType* indices, size_t indexCount)
 {
-    for (auto &v : outMesh->vertices) {
-        v.nx = 0.0f;
-        v.ny = 0.0f;
-        v.nz = 0.0f;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        vertices[i].nx = 0.0f;
+        vertices[i].ny = 0.0f;
+        vertices[i].nz = 0.0f;
     }
 
-    assert(outMesh->indices.size() % 3 == 0); // trilist
-    size_t triangles = outMesh->indices.size() / 3;
+    assert(indexCount % 3 == 0); // trilist
+    size_t triangles = indexCount / 3;
     for (size_t t = 0; t < triangles; ++t)
     {
-        auto v1 = &outMesh->vertices[outMesh->indices[t*3+0]];
-        auto v2 = &outMesh->vertices[outMesh->indices[t*3+1]];
-        auto v3 = &outMesh->vertices[outMesh->indices[t*3+2]];
+        auto v1 = &vertices[indices[t*3+0]];
+        auto v2 = &vertices[indices[t*3+1]];
+        auto v3 = &vertices[indices[t*3+2]];
 
         // Two edge vectors u,v
         auto ux = v2->x - v1->x;
@@ -188,7 +237,8 @@ void ComputeAvgNormalsInPlace(Mesh *outMesh)
     }
 
     // Normalize
-    for (auto &v : outMesh->vertices) {
+    for (size_t i = 0; i < vertexCount; ++i) {
+        auto& v = vertices[i];
         float n = 1.0f / std::sqrt(v.nx*v.nx + v.ny*v.ny + v.nz*v.nz);
         v.nx *= n;
         v.ny *= n;
@@ -196,6 +246,15 @@ void ComputeAvgNormalsInPlace(Mesh *outMesh)
     }
 }
 
+} // namespace
+
+
+void ComputeAvgNormalsInPlace(Mesh *outMesh)
+{
+    ComputeAvgNormals(outMesh->vertices.data(), outMesh->vertices.size(),
+                      outMesh->indices.data(), outMesh->indices.size());
+}
+
 
 void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int* outSubdivIndexOffsets)
 {
@@ -228,51 +287,173 @@ void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int
 }
 
 
+namespace {
+
+// Randomizes the base geosphere into the vertices of one unique asteroid mesh
+void CreateAsteroidFromGeosphere(const Mesh& baseMesh, unsigned int rngSeed, unsigned int meshInstance, Vertex* outVertices)
+{
+    // Every mesh has its own sequence, so meshes can be created in any order
+    std::seed_seq seed{rngSeed, meshInstance};
+    std::mt19937 rng(seed);
+
+    auto randomNoise = std::uniform_real_distribution<float>(0.0f, 10000.0f);
+    auto randomPersistence = std::normal_distribution<float>(0.95f, 0.04f);
+    float noiseScale = 0.5f;
+    float radiusScale = 0.9f;
+    float radiusBias = 0.3f;
+
+    NoiseOctaves<4> textureNoise(randomPersistence(rng));
+    float noise = randomNoise(rng);
+
+    const auto vertexCount = baseMesh.vertices.size();
+    for (size_t i = 0; i < vertexCount; ++i) {
+        auto v = baseMesh.vertices[i];
+        float radius = textureNoise(v.x*noiseScale, v.y*noiseScale, v.z*noiseScale, noise);
+        radius = radius * radiusScale + radiusBias;
+        v.x *= radius;
+        v.y *= radius;
+        v.z *= radius;
+        outVertices[i] = v;
+    }
+    ComputeAvgNormals(outVertices, vertexCount, baseMesh.indices.data(), baseMesh.indices.size());
+}
+
+
+// Bump when the generated data changes for the same parameters
+static const uint32_t MESH_CACHE_VERSION = 1;
+
+struct MeshCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t indexSize;
+    uint32_t rngSeed;
+    uint32_t subdivLevelCount;
+    uint32_t meshInstanceCount;
+    uint32_t vertexCountPerMesh;
+    uint32_t indexCount;
+};
+
+MeshCacheHeader MakeMeshCacheHeader(unsigned int rngSeed, unsigned int subdivLevelCount, unsigned int meshInstanceCount)
+{
+    MeshCacheHeader header = {};
+    std::memcpy(header.magic, "AMSH", sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.indexSize = sizeof(IndexType);
+    header.rngSeed = rngSeed;
+    header.subdivLevelCount = subdivLevelCount;
+    header.meshInstanceCount = meshInstanceCount;
+    return header;
+}
+
+// File layout: header, subdiv index offsets, vertices, indices
+bool LoadMeshCache(const char* path, const MeshCacheHeader& expected,
+                   Mesh* outMesh, unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    MeshCacheHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+        header.version != expected.version ||
+        header.vertexSize != expected.vertexSize ||
+        header.indexSize != expected.indexSize ||
+        header.rngSeed != expected.rngSeed ||
+        header.subdivLevelCount != expected.subdivLevelCount ||
+        header.meshInstanceCount != expected.meshInstanceCount) {
+        std::cout << "Mesh cache '" << path << "' is out of date" << std::endl;
+        return false;
+    }
+
+    std::vector<uint32_t> offsets(header.subdivLevelCount + 2);
+    std::vector<Vertex> vertices(size_t{header.vertexCountPerMesh} * header.meshInstanceCount);
+    std::vector<IndexType> indices(header.indexCount);
+    file.read(reinterpret_cast<char*>(offsets.data()), offsets.size() * sizeof(offsets[0]));
+    file.read(reinterpret_cast<char*>(vertices.data()), vertices.size() * sizeof(vertices[0]));
+    file.read(reinterpret_cast<char*>(indices.data()), indices.size() * sizeof(indices[0]));
+    if (!file || offsets.back() != header.indexCount) {
+        std::cout << "Mesh cache '" << path << "' is truncated" << std::endl;
+        return false;
+    }
+
+    std::copy(offsets.begin(), offsets.end(), outSubdivIndexOffsets);
+    *vertexCountPerMesh = header.vertexCountPerMesh;
+    std::swap(outMesh->vertices, vertices);
+    std::swap(outMesh->indices, indices);
+    return true;
+}
+
+void SaveMeshCache(const char* path, MeshCacheHeader header,
+                   const Mesh& mesh, const unsigned int* subdivIndexOffsets, unsigned int vertexCountPerMesh)
+{
+    header.vertexCountPerMesh = vertexCountPerMesh;
+    header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+    std::vector<uint32_t> offsets(subdivIndexOffsets, subdivIndexOffsets + header.subdivLevelCount + 2);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(offsets[0]));
+    file.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(mesh.vertices[0]));
+    file.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(mesh.indices[0]));
+    if (!file) {
+        std::cout << "Failed to write mesh cache '" << path << "'" << std::endl;
+    }
+}
+
+} // namespace
+
+
 void CreateAsteroidsFromGeospheres(Mesh *outMesh,
                                    unsigned int subdivLevelCount, unsigned int meshInstanceCount,
                                    unsigned int rngSeed,
-                                   unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh)
+                                   unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh,
+                                   Diligent::TaskScheduler* scheduler,
+                                   const char* cachePath)
 {
     assert(subdivLevelCount <= meshInstanceCount);
 
-    std::mt19937 rng(rngSeed);
+    const auto cacheHeader = MakeMeshCacheHeader(rngSeed, subdivLevelCount, meshInstanceCount);
+    if (cachePath != nullptr &&
+        LoadMeshCache(cachePath, cacheHeader, outMesh, outSubdivIndexOffsets, vertexCountPerMesh)) {
+        std::cout << "Loaded meshes from '" << cachePath << "'" << std::endl;
+        return;
+    }
 
     Mesh baseMesh;
     CreateGeospheres(&baseMesh, subdivLevelCount, outSubdivIndexOffsets);
 
     // Per unique mesh
     *vertexCountPerMesh = (unsigned int)baseMesh.vertices.size();
-    std::vector<Vertex> vertices;
-    vertices.reserve(meshInstanceCount * baseMesh.vertices.size());
     // Reuse indices for the different unique meshes
-
-    auto randomNoise = std::uniform_real_distribution<float>(0.0f, 10000.0f);
-    auto randomPersistence = std::normal_distribution<float>(0.95f, 0.04f);
-    float noiseScale = 0.5f;
-    float radiusScale = 0.9f;
-    float radiusBias = 0.3f;
+    std::vector<Vertex> vertices(size_t{meshInstanceCount} * baseMesh.vertices.size());
 
     // Create and randomize unique vertices for each mesh instance
-    for (unsigned int m = 0; m < meshInstanceCount; ++m) {
-        Mesh newMesh(baseMesh);
-        NoiseOctaves<4> textureNoise(randomPersistence(rng));
-        float noise = randomNoise(rng);
-
-        for (auto &v : newMesh.vertices) {
-            float radius = textureNoise(v.x*noiseScale, v.y*noiseScale, v.z*noiseScale, noise);
-            radius = radius * radiusScale + radiusBias;
-            v.x *= radius;
-            v.y *= radius;
-            v.z *= radius;
+    auto createMeshes = [&](unsigned int begin, unsigned int end) {
+        for (auto m = begin; m < end; ++m) {
+            CreateAsteroidFromGeosphere(baseMesh, rngSeed, m, vertices.data() + size_t{m} * baseMesh.vertices.size());
         }
-        ComputeAvgNormalsInPlace(&newMesh);
-
-        vertices.insert(vertices.end(), newMesh.vertices.begin(), newMesh.vertices.end());
+    };
+    if (scheduler) {
+        scheduler->ParallelFor(meshInstanceCount, [&](Diligent::Uint32, Diligent::Uint32, Diligent::Uint32 begin, Diligent::Uint32 end) {
+            createMeshes(begin, end);
+        });
+    } else {
+        createMeshes(0, meshInstanceCount);
     }
 
     // Copy to output
     std::swap(outMesh->indices, baseMesh.indices);
     std::swap(outMesh->vertices, vertices);
+
+    if (cachePath != nullptr) {
+        SaveMeshCache(cachePath, cacheHeader, *outMesh, outSubdivIndexOffsets, *vertexCountPerMesh);
+    }
 }
 
 
@@ -282,7 +463,7 @@ void CreateSkyboxMesh(std::vector<SkyboxVertex>* outVertices)
     
     // Cube mesh centered at zero
     static const float c = 0.5f;
-    static const DirectX::XMFLOAT3 vertexPos[] = { // x, y, z
+    static const struct { float x, y, z; } vertexPos[] = {
         {-c,  c, -c}, // 0
         { c,  c, -c}, // 1
         { c,  c,  c}, // 2
@@ -11,7 +11,11 @@
 #pragma once
 
 #include <vector>
-#include <directxmath.h>
+
+namespace Diligent
+{
+class TaskScheduler;
+}
 
 typedef unsigned short IndexType;
 
@@ -54,10 +58,16 @@ void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount, unsigned int
 // - A set of indices for each subdiv level (outSubdivIndexOffsets for offsets/counts)
 // - A set of vertices for each mesh instance (base vertices per mesh computed from vertexCountPerMesh)
 // - Indices already have the vertex offsets for the correct subdiv level "baked-in", so only need the mesh offset
+// Every mesh instance has its own RNG seeded from rngSeed and the instance index, so the result
+// does not depend on the number of threads. If a scheduler is provided, instances are generated in parallel.
+// If cachePath is not null, the result is loaded from that file when it was generated with the same
+// parameters, and is written to it otherwise.
 void CreateAsteroidsFromGeospheres(Mesh *outMesh,
                                    unsigned int subdivLevelCount, unsigned int meshInstanceCount,
                                    unsigned int rngSeed,
-                                   unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh);
+                                   unsigned int* outSubdivIndexOffsets, unsigned int* vertexCountPerMesh,
+                                   Diligent::TaskScheduler* scheduler = nullptr,
+                                   const char* cachePath = nullptr);
 
 
 struct SkyboxVertex
@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #include "simplexnoise1234.h"
 
 // Very simple multi-octave simplex noise helper
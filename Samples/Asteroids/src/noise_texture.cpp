@@ -0,0 +1,69 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.  
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#include "noise_texture.h"
+#include "noise.h"
+#include "MipGenerator.hpp"
+
+#include <stdint.h>
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+void GenerateMips2D_XXXX8(SubresourceData* subresources, size_t widthLevel0, size_t heightLevel0, size_t mipLevels)
+{
+    // Textures are already generated in parallel by the caller, so the mips of
+    // a single texture are only vectorized.
+    std::vector<Diligent::MipLevelData> levels(mipLevels > 1 ? mipLevels - 1 : 0);
+    for (size_t m = 1; m < mipLevels; ++m) {
+        levels[m - 1].pData = const_cast<void*>(subresources[m].pSysMem);
+        levels[m - 1].Stride = subresources[m].SysMemPitch;
+    }
+
+    Diligent::GenerateMipsAttribs attribs;
+    attribs.Width = static_cast<Diligent::Uint32>(widthLevel0);
+    attribs.Height = static_cast<Diligent::Uint32>(heightLevel0);
+    attribs.ComponentType = Diligent::VT_UINT8;
+    attribs.NumComponents = 4;
+    attribs.pLevel0Data = subresources[0].pSysMem;
+    attribs.Level0Stride = subresources[0].SysMemPitch;
+    attribs.NumMipLevels = static_cast<Diligent::Uint32>(mipLevels);
+    attribs.pMipLevels = levels.data();
+    Diligent::GenerateMips(attribs);
+}
+
+
+void FillNoise2D_RGBA8(SubresourceData* subresources, size_t width, size_t height, size_t mipLevels,
+                       float seed, float persistence, float noiseScale, float noiseStrength,
+					   float redScale, float greenScale, float blueScale)
+{
+    NoiseOctaves<4> textureNoise(persistence);
+    
+    // Level 0
+    for (size_t y = 0; y < height; ++y) {
+        uint32_t* row = (uint32_t*)((uint8_t*)subresources[0].pSysMem + y*subresources[0].SysMemPitch);
+        for (size_t x = 0; x < width; ++x) {
+            auto c = textureNoise((float)x*noiseScale, (float)y*noiseScale, seed);
+            c = std::max(0.0f, std::min(1.0f, (c - 0.5f) * noiseStrength + 0.5f));
+
+            int32_t cr = (int32_t)(c * redScale);
+			int32_t cg = (int32_t)(c * greenScale);
+			int32_t cb = (int32_t)(c * blueScale);
+			assert(cr >= 0 && cr < 256);
+			assert(cg >= 0 && cg < 256);
+            assert(cb >= 0 && cb < 256);
+
+            row[x] = (cr) << 16 | (cg) <<  8 | (cb) << 0;
+        }
+    }
+
+    if (mipLevels > 1)
+        GenerateMips2D_XXXX8(subresources, width, height, mipLevels);
+}
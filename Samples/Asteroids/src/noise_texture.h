@@ -0,0 +1,28 @@
+// Copyright 2014 Intel Corporation All Rights Reserved
+//
+// Intel makes no representations about the suitability of this software for any purpose.  
+// THIS SOFTWARE IS PROVIDED ""AS IS."" INTEL SPECIFICALLY DISCLAIMS ALL WARRANTIES,
+// EXPRESS OR IMPLIED, AND ALL LIABILITY, INCLUDING CONSEQUENTIAL AND OTHER INDIRECT DAMAGES,
+// FOR THE USE OF THIS SOFTWARE, INCLUDING LIABILITY FOR INFRINGEMENT OF ANY PROPRIETARY
+// RIGHTS, AND INCLUDING THE WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+// Intel does not assume any responsibility for any errors which may appear in this software
+// nor any responsibility to update it.
+
+#pragma once
+
+#include <stddef.h>
+
+// Same layout as D3D11_SUBRESOURCE_DATA, so that the generated textures
+// can be passed to the native backends without copying
+struct SubresourceData
+{
+    const void* pSysMem;
+    unsigned int SysMemPitch;
+    unsigned int SysMemSlicePitch;
+};
+
+void GenerateMips2D_XXXX8(SubresourceData* subresources, size_t widthLevel0, size_t heightLevel0, size_t mipLevels);
+
+void FillNoise2D_RGBA8(SubresourceData* subresources, size_t width, size_t height, size_t mipLevels,
+                       float seed, float persistence, float noiseScale, float noiseStrength,
+                       float redScale = 255.0f, float greenScale = 255.0f, float blueScale = 255.0f);
@@ -10,7 +10,6 @@
 
 #pragma once
 
-#include "camera.h"
 #include "common_defines.h"
 
 // Profiling
@@ -90,4 +89,10 @@ struct Settings
     bool submitRendering = true;
     bool executeIndirect = false;
     bool warp = false;
+
+    // Only for the bindless binding mode of DiligentD3D12 and DiligentVk modes:
+    // skip asteroids outside of the view frustum and draw the rest with indirect draws
+    // whose arguments are written by the CPU or, with gpuCulling, by a compute shader
+    bool frustumCulling = true;
+    bool gpuCulling = false;
 };
@@ -10,16 +10,26 @@
 
 #include "simulation.h"
 #include "settings.h"
-#include "texture.h"
-#include "util.h"
+#include "noise_texture.h"
+#include "TaskScheduler.hpp"
 
 #include <random>
 #include <limits>
 #include <algorithm>
 #include <iostream>
-#include <ppl.h>
+#include <cmath>
+#include <assert.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define ASTEROIDS_SIMULATION_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define ASTEROIDS_SIMULATION_NEON 1
+#endif
 
-using namespace DirectX;
+using Diligent::float3;
+using Diligent::PI_F;
 
 static int const COLOR_SCHEMES[] = {
     156, 139, 113,  55,  49,  40,
@@ -32,16 +42,18 @@ static int const COLOR_SCHEMES[] = {
 
 static int const NUM_COLOR_SCHEMES = (int) (sizeof(COLOR_SCHEMES) / (6 * sizeof(int)));
 
-static XMVECTOR RandomPointOnSphere(std::mt19937& rng)
+static float3 RandomPointOnSphere(std::mt19937& rng)
 {
     std::normal_distribution<float> dist;
 
-    XMVECTOR r;
     for (;;) {
-        r = XMVectorSet(dist(rng), dist(rng), dist(rng), 0.0f);
-        auto d2 = XMVectorGetX(XMVector3LengthSq(r));
+        float3 r;
+        r.x = dist(rng);
+        r.y = dist(rng);
+        r.z = dist(rng);
+        auto d2 = Diligent::dot(r, r);
         if (d2 > std::numeric_limits<float>::min()) {
-            return XMVector3Normalize(r);
+            return r / std::sqrt(d2);
         }
     }
     // Unreachable
@@ -56,13 +68,332 @@ static inline float VeryApproxLog2f(float x)
 }
 
 
+
+namespace
+{
+
+// The per-asteroid math below is written once and instantiated for plain floats,
+// which handle the range tails, and for SIMD vectors of four asteroids.
+
+inline float Splat(float, float v) { return v; }
+inline float Load(float, const float* p) { return *p; }
+inline void Store(float* p, float v) { *p = v; }
+inline float Abs(float v) { return std::abs(v); }
+inline float Round(float v) { return std::nearbyint(v); }
+inline float Max(float a, float b) { return std::max(a, b); }
+inline float RSqrt(float v) { return 1.0f / std::sqrt(v); }
+inline float ApproxLog2(float v) { return VeryApproxLog2f(v); }
+inline float CopySign(float mag, float sign) { return std::copysign(mag, sign); }
+inline bool Greater(float a, float b) { return a > b; }
+inline float Select(bool mask, float a, float b) { return mask ? a : b; }
+inline bool And(bool a, bool b) { return a && b; }
+inline int MoveMask(bool mask) { return mask ? 1 : 0; }
+
+#if ASTEROIDS_SIMULATION_SSE2
+
+struct SimdFloat
+{
+    __m128 v;
+};
+using SimdMask = __m128;
+
+inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return {_mm_add_ps(a.v, b.v)}; }
+inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return {_mm_mul_ps(a.v, b.v)}; }
+
+inline SimdFloat Splat(SimdFloat, float v) { return {_mm_set1_ps(v)}; }
+inline SimdFloat Load(SimdFloat, const float* p) { return {_mm_loadu_ps(p)}; }
+inline void Store(float* p, SimdFloat v) { _mm_storeu_ps(p, v.v); }
+inline SimdFloat Abs(SimdFloat v) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), v.v)}; }
+inline SimdFloat Round(SimdFloat v) { return {_mm_cvtepi32_ps(_mm_cvtps_epi32(v.v))}; }
+inline SimdFloat Max(SimdFloat a, SimdFloat b) { return {_mm_max_ps(a.v, b.v)}; }
+// sqrt and div are correctly rounded, so every lane matches the scalar 1 / std::sqrt()
+// that handles the range tails, unlike the estimate of _mm_rsqrt_ps.
+inline SimdFloat RSqrt(SimdFloat v) { return {_mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(v.v))}; }
+inline SimdFloat ApproxLog2(SimdFloat v)
+{
+    const __m128 bits = _mm_cvtepi32_ps(_mm_castps_si128(v.v));
+    return {_mm_sub_ps(_mm_mul_ps(bits, _mm_set1_ps(1.1920928955078125e-7f)), _mm_set1_ps(126.94269504f))};
+}
+inline SimdFloat CopySign(SimdFloat mag, SimdFloat sign)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    return {_mm_or_ps(_mm_andnot_ps(signMask, mag.v), _mm_and_ps(signMask, sign.v))};
+}
+inline SimdMask Greater(SimdFloat a, SimdFloat b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline SimdFloat Select(SimdMask mask, SimdFloat a, SimdFloat b) { return {_mm_or_ps(_mm_and_ps(mask, a.v), _mm_andnot_ps(mask, b.v))}; }
+inline SimdMask And(SimdMask a, SimdMask b) { return _mm_and_ps(a, b); }
+inline int MoveMask(SimdMask mask) { return _mm_movemask_ps(mask); }
+
+// Transposes four rows of four asteroids into the rows of four world matrices
+inline void StoreWorld(AsteroidDynamic* dst, SimdFloat (&m)[4][4])
+{
+    for (int r = 0; r < 4; ++r) {
+        __m128 x = m[r][0].v, y = m[r][1].v, z = m[r][2].v, w = m[r][3].v;
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        _mm_storeu_ps(&dst[0].world.m[r][0], x);
+        _mm_storeu_ps(&dst[1].world.m[r][0], y);
+        _mm_storeu_ps(&dst[2].world.m[r][0], z);
+        _mm_storeu_ps(&dst[3].world.m[r][0], w);
+    }
+}
+
+#elif ASTEROIDS_SIMULATION_NEON
+
+struct SimdFloat
+{
+    float32x4_t v;
+};
+using SimdMask = uint32x4_t;
+
+inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return {vaddq_f32(a.v, b.v)}; }
+inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return {vsubq_f32(a.v, b.v)}; }
+inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return {vmulq_f32(a.v, b.v)}; }
+
+inline SimdFloat Splat(SimdFloat, float v) { return {vdupq_n_f32(v)}; }
+inline SimdFloat Load(SimdFloat, const float* p) { return {vld1q_f32(p)}; }
+inline void Store(float* p, SimdFloat v) { vst1q_f32(p, v.v); }
+inline SimdFloat Abs(SimdFloat v) { return {vabsq_f32(v.v)}; }
+inline SimdFloat Round(SimdFloat v) { return {vrndnq_f32(v.v)}; }
+inline SimdFloat Max(SimdFloat a, SimdFloat b) { return {vmaxq_f32(a.v, b.v)}; }
+// Matches the scalar path exactly, unlike the estimate of vrsqrteq_f32
+inline SimdFloat RSqrt(SimdFloat v) { return {vdivq_f32(vdupq_n_f32(1.0f), vsqrtq_f32(v.v))}; }
+inline SimdFloat ApproxLog2(SimdFloat v)
+{
+    const float32x4_t bits = vcvtq_f32_s32(vreinterpretq_s32_f32(v.v));
+    return {vsubq_f32(vmulq_n_f32(bits, 1.1920928955078125e-7f), vdupq_n_f32(126.94269504f))};
+}
+inline SimdFloat CopySign(SimdFloat mag, SimdFloat sign) { return {vbslq_f32(vdupq_n_u32(0x80000000u), sign.v, mag.v)}; }
+inline SimdMask Greater(SimdFloat a, SimdFloat b) { return vcgtq_f32(a.v, b.v); }
+inline SimdFloat Select(SimdMask mask, SimdFloat a, SimdFloat b) { return {vbslq_f32(mask, a.v, b.v)}; }
+inline SimdMask And(SimdMask a, SimdMask b) { return vandq_u32(a, b); }
+inline int MoveMask(SimdMask mask)
+{
+    const uint32_t laneBits[4] = {1, 2, 4, 8};
+    return (int)vaddvq_u32(vandq_u32(mask, vld1q_u32(laneBits)));
+}
+
+inline void StoreWorld(AsteroidDynamic* dst, SimdFloat (&m)[4][4])
+{
+    for (int r = 0; r < 4; ++r) {
+        const float32x4x2_t xy = vtrnq_f32(m[r][0].v, m[r][1].v);
+        const float32x4x2_t zw = vtrnq_f32(m[r][2].v, m[r][3].v);
+        vst1q_f32(&dst[0].world.m[r][0], vcombine_f32(vget_low_f32(xy.val[0]), vget_low_f32(zw.val[0])));
+        vst1q_f32(&dst[1].world.m[r][0], vcombine_f32(vget_low_f32(xy.val[1]), vget_low_f32(zw.val[1])));
+        vst1q_f32(&dst[2].world.m[r][0], vcombine_f32(vget_high_f32(xy.val[0]), vget_high_f32(zw.val[0])));
+        vst1q_f32(&dst[3].world.m[r][0], vcombine_f32(vget_high_f32(xy.val[1]), vget_high_f32(zw.val[1])));
+    }
+}
+
+#endif
+
+inline void StoreWorld(AsteroidDynamic* dst, float (&m)[4][4])
+{
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            dst->world.m[r][c] = m[r][c];
+        }
+    }
+}
+
+template <typename V> struct LaneCount { static constexpr size_t value = 4; };
+template <> struct LaneCount<float> { static constexpr size_t value = 1; };
+
+// Angles stay in [-pi, pi] so that they do not lose precision over time
+// and fit the polynomial range of SinCos()
+template <typename V>
+inline V WrapAngle(V a)
+{
+    const V twoPi = Splat(V{}, 2.0f * PI_F);
+    return a - twoPi * Round(a * Splat(V{}, 0.5f / PI_F));
+}
+
+// a must be in [-pi, pi]
+template <typename V>
+inline void SinCos(V a, V& s, V& c)
+{
+    const auto k = [](float v) { return Splat(V{}, v); };
+
+    // Reflect into [-pi/2, pi/2]: sin(a) = sin(pi - a), cos(a) = -cos(pi - a)
+    const auto reflect = Greater(Abs(a), k(0.5f * PI_F));
+    const V    x       = Select(reflect, CopySign(k(PI_F), a) - a, a);
+    const V    x2      = x * x;
+
+    // Taylor series, the error is below 4e-6 in the reduced range
+    s = x * (k(1.0f) + x2 * (k(-1.0f / 6.0f) + x2 * (k(1.0f / 120.0f) + x2 * (k(-1.0f / 5040.0f) + x2 * k(1.0f / 362880.0f)))));
+
+    const V cr = k(1.0f) + x2 * (k(-0.5f) + x2 * (k(1.0f / 24.0f) + x2 * (k(-1.0f / 720.0f) + x2 * (k(1.0f / 40320.0f) + x2 * k(-1.0f / 3628800.0f)))));
+    c = Select(reflect, k(0.0f) - cr, cr);
+}
+
+struct UpdateParams
+{
+    float frameTime;
+    bool animate;
+    float3 eye;
+    float minSubdivSizeLog2;
+    unsigned int subdivCount;
+    const unsigned int* indexOffsets;
+};
+
+// Updates LaneCount<V> asteroids starting at i
+template <typename V>
+inline void UpdateAsteroids(AsteroidMotion& motion, AsteroidBounds& bounds, AsteroidDynamic* dynamic, size_t i, const UpdateParams& params)
+{
+    const auto k = [](float v) { return Splat(V{}, v); };
+
+    V spinAngle  = Load(V{}, motion.spinAngle.data() + i);
+    V orbitAngle = Load(V{}, motion.orbitAngle.data() + i);
+    if (params.animate) {
+        const V dt = k(params.frameTime);
+        spinAngle  = WrapAngle(spinAngle + Load(V{}, motion.spinVelocity.data() + i) * dt);
+        orbitAngle = WrapAngle(orbitAngle + Load(V{}, motion.orbitVelocity.data() + i) * dt);
+        Store(motion.spinAngle.data() + i, spinAngle);
+        Store(motion.orbitAngle.data() + i, orbitAngle);
+    }
+
+    const V ax     = Load(V{}, motion.spinAxisX.data() + i);
+    const V ay     = Load(V{}, motion.spinAxisY.data() + i);
+    const V az     = Load(V{}, motion.spinAxisZ.data() + i);
+    const V scale  = Load(V{}, motion.scale.data() + i);
+    const V radius = Load(V{}, motion.orbitRadius.data() + i);
+    const V height = Load(V{}, motion.discPosY.data() + i);
+
+    V sinSpin, cosSpin, sinOrbit, cosOrbit;
+    SinCos(spinAngle, sinSpin, cosSpin);
+    SinCos(orbitAngle, sinOrbit, cosOrbit);
+
+    // world = Scale * RotationNormal(spinAxis, spinAngle) * Translation(radius, height, 0) * RotationY(orbitAngle),
+    // which is what the incremental spin * world * orbit update converges to.
+    const V oneMinusCos = k(1.0f) - cosSpin;
+    const V sx = ax * sinSpin;
+    const V sy = ay * sinSpin;
+    const V sz = az * sinSpin;
+    const V xy = ax * ay * oneMinusCos;
+    const V xz = ax * az * oneMinusCos;
+    const V yz = ay * az * oneMinusCos;
+
+    const V spin[3][3] = {
+        {(cosSpin + ax * ax * oneMinusCos) * scale, (xy + sz) * scale, (xz - sy) * scale},
+        {(xy - sz) * scale, (cosSpin + ay * ay * oneMinusCos) * scale, (yz + sx) * scale},
+        {(xz + sy) * scale, (yz - sx) * scale, (cosSpin + az * az * oneMinusCos) * scale},
+    };
+
+    // Rotation around Y maps (x, y, z) to (x * cos + z * sin, y, z * cos - x * sin)
+    V world[4][4];
+    for (int r = 0; r < 3; ++r) {
+        world[r][0] = spin[r][0] * cosOrbit + spin[r][2] * sinOrbit;
+        world[r][1] = spin[r][1];
+        world[r][2] = spin[r][2] * cosOrbit - spin[r][0] * sinOrbit;
+        world[r][3] = k(0.0f);
+    }
+    world[3][0] = radius * cosOrbit;
+    world[3][1] = height;
+    world[3][2] = k(0.0f) - radius * sinOrbit;
+    world[3][3] = k(1.0f);
+    StoreWorld(dynamic + i, world);
+    Store(bounds.centerX.data() + i, world[3][0]);
+    Store(bounds.centerY.data() + i, world[3][1]);
+    Store(bounds.centerZ.data() + i, world[3][2]);
+
+    // Pick LOD based on approx screen area - can be very approximate
+    const V dx = k(params.eye.x) - world[3][0];
+    const V dy = k(params.eye.y) - world[3][1];
+    const V dz = k(params.eye.z) - world[3][2];
+    const V distanceToEyeRcp = RSqrt(dx * dx + dy * dy + dz * dz);
+    // Add one subdiv for each factor of 2 past min
+    const V relativeScreenSizeLog2 = ApproxLog2(scale * distanceToEyeRcp);
+    const V subdivFloat = Max(k(0.0f), relativeScreenSizeLog2 - k(params.minSubdivSizeLog2));
+
+    float subdivs[LaneCount<V>::value];
+    Store(subdivs, subdivFloat);
+    for (size_t lane = 0; lane < LaneCount<V>::value; ++lane) {
+        auto subdiv = std::min(params.subdivCount, (unsigned int)subdivs[lane]);
+
+        // Offscreen asteroids are rejected by Cull(), which the renderer runs after the update
+
+        auto& dynamicData = dynamic[i + lane];
+        dynamicData.subdiv = subdiv;
+        dynamicData.indexStart = params.indexOffsets[subdiv];
+        dynamicData.indexCount = params.indexOffsets[subdiv + 1] - dynamicData.indexStart;
+    }
+}
+
+// Returns a bit mask of the asteroids among LaneCount<V> asteroids starting at i
+// whose bounding spheres are not entirely outside one of the planes
+template <typename V>
+inline int TestBounds(const AsteroidBounds& bounds, size_t i, const Diligent::float4 (&planes)[6])
+{
+    const auto k = [](float v) { return Splat(V{}, v); };
+
+    const V cx = Load(V{}, bounds.centerX.data() + i);
+    const V cy = Load(V{}, bounds.centerY.data() + i);
+    const V cz = Load(V{}, bounds.centerZ.data() + i);
+    const V negRadius = k(0.0f) - Load(V{}, bounds.radius.data() + i);
+
+    auto inside = Greater(cx * k(planes[0].x) + cy * k(planes[0].y) + cz * k(planes[0].z) + k(planes[0].w), negRadius);
+    for (int p = 1; p < 6; ++p) {
+        const V distance = cx * k(planes[p].x) + cy * k(planes[p].y) + cz * k(planes[p].z) + k(planes[p].w);
+        inside = And(inside, Greater(distance, negRadius));
+    }
+    return MoveMask(inside);
+}
+
+} // namespace
+
+
+void ExtractFrustumPlanes(const Diligent::float4x4& viewProjection, Diligent::float4 planes[6])
+{
+    // Clip coordinates are v * viewProjection, so every clip component is a dot product
+    // with a column of the matrix
+    const auto column = [&](int c) {
+        return Diligent::float4(viewProjection.m[0][c], viewProjection.m[1][c], viewProjection.m[2][c], viewProjection.m[3][c]);
+    };
+    const auto x = column(0);
+    const auto y = column(1);
+    const auto z = column(2);
+    const auto w = column(3);
+
+    planes[0] = w + x; // -w <= x
+    planes[1] = w - x; //  x <= w
+    planes[2] = w + y; // -w <= y
+    planes[3] = w - y; //  y <= w
+    planes[4] = z;     //  0 <= z
+    planes[5] = w - z; //  z <= w
+
+    for (int p = 0; p < 6; ++p) {
+        const auto length = std::sqrt(planes[p].x * planes[p].x + planes[p].y * planes[p].y + planes[p].z * planes[p].z);
+        planes[p] = planes[p] * (1.0f / length);
+    }
+}
+
+
+void AsteroidMotion::Resize(size_t count)
+{
+    for (auto* v : {&spinAxisX, &spinAxisY, &spinAxisZ, &spinAngle, &spinVelocity,
+                    &orbitAngle, &orbitVelocity, &orbitRadius, &discPosY, &scale}) {
+        v->resize(count);
+    }
+}
+
+
+void AsteroidBounds::Resize(size_t count)
+{
+    for (auto* v : {&centerX, &centerY, &centerZ, &radius}) {
+        v->resize(count);
+    }
+}
+
+
 AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int asteroidCount,
                                          unsigned int meshInstanceCount, unsigned int subdivCount,
-                                         unsigned int textureCount)
+                                         unsigned int textureCount, Diligent::TaskScheduler* scheduler,
+                                         const char* meshCachePath)
     : mAsteroidStatic(asteroidCount)
     , mAsteroidDynamic(asteroidCount)
     , mIndexOffsets(size_t{subdivCount} + 2) // Mesh subdivs are inclusive on both ends and need forward differencing for count
     , mSubdivCount(subdivCount)
+    , mScheduler(scheduler)
 {
     std::mt19937 rng(rngSeed);
 
@@ -72,14 +403,20 @@ AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int aste
         << subdivCount << " subdivision levels..." << std::endl;
 
     CreateAsteroidsFromGeospheres(&mMeshes, mSubdivCount, meshInstanceCount,
-                                  rng(), mIndexOffsets.data(), &mVertexCountPerMesh);
+                                  rng(), mIndexOffsets.data(), &mVertexCountPerMesh,
+                                  mScheduler, meshCachePath);
+
+    for (const auto& v : mMeshes.vertices) {
+        mMeshBoundingRadius = std::max(mMeshBoundingRadius, v.x * v.x + v.y * v.y + v.z * v.z);
+    }
+    mMeshBoundingRadius = std::sqrt(mMeshBoundingRadius);
 
     CreateTextures(textureCount, rng());
 
     // Constants
     std::normal_distribution<float> orbitRadiusDist(SIM_ORBIT_RADIUS, 0.6f * SIM_DISC_RADIUS);
     std::normal_distribution<float> heightDist(0.0f, 0.4f);
-    std::uniform_real_distribution<float> angleDist(-XM_PI, XM_PI);
+    std::uniform_real_distribution<float> angleDist(-PI_F, PI_F);
     std::uniform_real_distribution<float> radialVelocityDist(5.0f, 15.0f);
     std::uniform_real_distribution<float> spinVelocityDist(-2.0f, 2.0f);
     std::normal_distribution<float> scaleDist(1.3f, 0.7f);
@@ -90,10 +427,14 @@ AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int aste
 
     // Approximate SRGB->Linear for colors
     float linearColorSchemes[NUM_COLOR_SCHEMES * 6];
-    for (int i = 0; i < ARRAYSIZE(linearColorSchemes); ++i) {
-        linearColorSchemes[i] = std::powf((float)COLOR_SCHEMES[i] / 255.0f, 2.2f);
+    for (int i = 0; i < NUM_COLOR_SCHEMES * 6; ++i) {
+        linearColorSchemes[i] = std::pow((float)COLOR_SCHEMES[i] / 255.0f, 2.2f);
     }
 
+    mAsteroidMotion.Resize(asteroidCount);
+    mAsteroidBounds.Resize(asteroidCount);
+    auto& motion = mAsteroidMotion;
+
     // Create a torus of asteroids that spin around the ring
     for (unsigned int i = 0; i < asteroidCount; ++i) {
         auto scale = scaleDist(rng);
@@ -101,72 +442,117 @@ AsteroidsSimulation::AsteroidsSimulation(unsigned int rngSeed, unsigned int aste
         scale = scale * 0.3f;
 #endif
         scale = std::max(scale, SIM_MIN_SCALE);
-        auto scaleMatrix = XMMatrixScaling(scale, scale, scale);
 
         auto orbitRadius = orbitRadiusDist(rng);
         auto discPosY = float(SIM_DISC_RADIUS) * heightDist(rng);
-
-        auto disc = XMMatrixTranslation(orbitRadius, discPosY, 0.0f);
-
         auto positionAngle = angleDist(rng);
-        auto orbit = XMMatrixRotationY(positionAngle);
 
         auto meshInstance = (unsigned int)(i / instancesPerMesh); // Vcache friendly ordering
 
+        // Motion data
+        motion.scale[i] = scale;
+        mAsteroidBounds.radius[i] = scale * mMeshBoundingRadius;
+        motion.orbitRadius[i] = orbitRadius;
+        motion.discPosY[i] = discPosY;
+        motion.orbitAngle[i] = positionAngle;
+        motion.spinAngle[i] = 0.0f;
+        motion.spinVelocity[i] = spinVelocityDist(rng) / scale; // Smaller asteroids spin faster
+        motion.orbitVelocity[i] = radialVelocityDist(rng) / (scale * orbitRadius); // Smaller asteroids go faster, and use arc length
+
         // Static data
-        mAsteroidStatic[i].spinVelocity = spinVelocityDist(rng) / scale; // Smaller asteroids spin faster
-        mAsteroidStatic[i].orbitVelocity = radialVelocityDist(rng) / (scale * orbitRadius); // Smaller asteroids go faster, and use arc length
         mAsteroidStatic[i].vertexStart = mVertexCountPerMesh * meshInstance;
-        mAsteroidStatic[i].spinAxis = XMVector3Normalize(RandomPointOnSphere(rng));
-        mAsteroidStatic[i].scale = scale;
+        auto spinAxis = RandomPointOnSphere(rng);
+        motion.spinAxisX[i] = spinAxis.x;
+        motion.spinAxisY[i] = spinAxis.y;
+        motion.spinAxisZ[i] = spinAxis.z;
         mAsteroidStatic[i].textureIndex = textureIndexDist(rng);
 
-        auto colorScheme = ((int)abs(colorSchemeDist(rng))) % NUM_COLOR_SCHEMES;
+        auto colorScheme = ((int)std::abs(colorSchemeDist(rng))) % NUM_COLOR_SCHEMES;
         auto c = linearColorSchemes + 6 * colorScheme;
-        mAsteroidStatic[i].surfaceColor = XMFLOAT3(c[0], c[1], c[2]);
-        mAsteroidStatic[i].deepColor    = XMFLOAT3(c[3], c[4], c[5]);
+        mAsteroidStatic[i].surfaceColor = float3(c[0], c[1], c[2]);
+        mAsteroidStatic[i].deepColor    = float3(c[3], c[4], c[5]);
 
-        // Initialize dynamic data
-        mAsteroidDynamic[i].world = scaleMatrix * disc * orbit;
-
-        assert(mAsteroidStatic[i].scale > 0.0f);
-        assert(mAsteroidStatic[i].orbitVelocity > 0.0f);
+        assert(motion.scale[i] > 0.0f);
+        assert(motion.orbitVelocity[i] > 0.0f);
     }
+
+    // Initialize world matrices and LODs
+    Settings staticSettings;
+    staticSettings.animate = false;
+    Update(0.0f, float3(0.0f, 0.0f, 0.0f), staticSettings);
 }
 
 
-void AsteroidsSimulation::Update(float frameTime, DirectX::XMVECTOR cameraEye, const Settings& settings,
+void AsteroidsSimulation::Update(float frameTime, const Diligent::float3& cameraEye, const Settings& settings,
                                  size_t startIndex, size_t count)
 {
-    bool animate = settings.animate;
-
     // TODO: This constant should really depend on resolution and/or be configurable...
-    static const float minSubdivSizeLog2 = std::log2f(0.0019f);
+    static const float minSubdivSizeLog2 = std::log2(0.0019f);
+
+    UpdateParams params;
+    params.frameTime = frameTime;
+    params.animate = settings.animate;
+    params.eye = cameraEye;
+    params.minSubdivSizeLog2 = minSubdivSizeLog2;
+    params.subdivCount = mSubdivCount;
+    params.indexOffsets = mIndexOffsets.data();
 
     size_t last = count ? startIndex + count : mAsteroidDynamic.size();
-    for (size_t i = startIndex; i < last; ++i) {
-        const AsteroidStatic& staticData = mAsteroidStatic[i];
-        AsteroidDynamic& dynamicData = mAsteroidDynamic[i];
-
-        if (animate) {
-            auto orbit = XMMatrixRotationY(staticData.orbitVelocity * frameTime);
-            auto spin = XMMatrixRotationNormal(staticData.spinAxis, staticData.spinVelocity * frameTime);
-            dynamicData.world = spin * dynamicData.world * orbit;
-        }
+    size_t i = startIndex;
+#if ASTEROIDS_SIMULATION_SSE2 || ASTEROIDS_SIMULATION_NEON
+    for (; i + 4 <= last; i += 4) {
+        UpdateAsteroids<SimdFloat>(mAsteroidMotion, mAsteroidBounds, mAsteroidDynamic.data(), i, params);
+    }
+#endif
+    for (; i < last; ++i) {
+        UpdateAsteroids<float>(mAsteroidMotion, mAsteroidBounds, mAsteroidDynamic.data(), i, params);
+    }
+}
+
+
+void AsteroidsSimulation::UpdateAll(float frameTime, const Diligent::float3& cameraEye, const Settings& settings)
+{
+    if (mScheduler == nullptr) {
+        Update(frameTime, cameraEye, settings);
+        return;
+    }
+
+    // Split the asteroids into blocks that are multiples of the SIMD width
+    const Diligent::Uint32 blockSize = 256;
+    const auto asteroidCount = static_cast<Diligent::Uint32>(mAsteroidDynamic.size());
+    const auto blockCount = (asteroidCount + blockSize - 1) / blockSize;
+    mScheduler->ParallelFor(blockCount, [&](Diligent::Uint32, Diligent::Uint32, Diligent::Uint32 firstBlock, Diligent::Uint32 endBlock) {
+        const auto start = firstBlock * blockSize;
+        const auto end = std::min(endBlock * blockSize, asteroidCount);
+        Update(frameTime, cameraEye, settings, start, end - start);
+    });
+}
 
-        // Pick LOD based on approx screen area - can be very approximate
-        auto position = dynamicData.world.r[3];
-        auto distanceToEyeRcp = XMVectorGetX(XMVector3ReciprocalLengthEst(XMVectorSubtract(cameraEye, position)));
-        // Add one subdiv for each factor of 2 past min
-        auto relativeScreenSizeLog2 = VeryApproxLog2f(staticData.scale * distanceToEyeRcp);
-        float subdivFloat = std::max(0.0f, relativeScreenSizeLog2 - minSubdivSizeLog2);
-        auto subdiv = std::min(mSubdivCount, (unsigned int)subdivFloat);
 
-        // TODO: Ignore/cull/force lowest subdiv if offscreen?
-        
-        dynamicData.indexStart = mIndexOffsets[subdiv];
-        dynamicData.indexCount = mIndexOffsets[subdiv+1] - dynamicData.indexStart;
+size_t AsteroidsSimulation::Cull(const Diligent::float4x4& viewProjection, size_t startIndex, size_t count,
+                                 unsigned int* visibleIndices) const
+{
+    Diligent::float4 planes[6];
+    ExtractFrustumPlanes(viewProjection, planes);
+
+    // Every index is written, but the output position only advances past the visible ones
+    size_t visibleCount = 0;
+    size_t last = startIndex + count;
+    size_t i = startIndex;
+#if ASTEROIDS_SIMULATION_SSE2 || ASTEROIDS_SIMULATION_NEON
+    for (; i + 4 <= last; i += 4) {
+        const int mask = TestBounds<SimdFloat>(mAsteroidBounds, i, planes);
+        for (int lane = 0; lane < 4; ++lane) {
+            visibleIndices[visibleCount] = static_cast<unsigned int>(i + lane);
+            visibleCount += (mask >> lane) & 1;
+        }
     }
+#endif
+    for (; i < last; ++i) {
+        visibleIndices[visibleCount] = static_cast<unsigned int>(i);
+        visibleCount += TestBounds<float>(mAsteroidBounds, i, planes);
+    }
+    return visibleCount;
 }
 
 
@@ -175,11 +561,10 @@ void AsteroidsSimulation::CreateTextures(unsigned int textureCount, unsigned int
     mTextureDim = TEXTURE_DIM;
     mTextureCount = textureCount;
     mTextureArraySize = 3;
-    {
-        DWORD msbIndex = 0;
-        auto result = _BitScanReverse(&msbIndex, mTextureDim);
-        assert(result); // Should only fail if mTextureDim = 0
-        mTextureMipLevels = msbIndex + 1;
+    assert(mTextureDim > 0);
+    mTextureMipLevels = 0;
+    for (auto dim = mTextureDim; dim != 0; dim >>= 1) {
+        ++mTextureMipLevels;
     }
 
     assert((mTextureDim & (mTextureDim-1)) == 0); // Must be pow2 currently; we don't handle wacky mip chains
@@ -189,10 +574,10 @@ void AsteroidsSimulation::CreateTextures(unsigned int textureCount, unsigned int
         << mTextureDim << "x" << mTextureDim << " textures..." << std::endl;
     
     // Allocate space
-    UINT texelSizeInBytes = 4; // RGBA8
-    UINT extraSpaceForMips = 2;
-    UINT totalTextureSizeInBytes = texelSizeInBytes * mTextureDim * mTextureDim * mTextureArraySize * extraSpaceForMips;
-    totalTextureSizeInBytes = AlignUp(totalTextureSizeInBytes, 64U); // Avoid false sharing
+    unsigned int texelSizeInBytes = 4; // RGBA8
+    unsigned int extraSpaceForMips = 2;
+    unsigned int totalTextureSizeInBytes = texelSizeInBytes * mTextureDim * mTextureDim * mTextureArraySize * extraSpaceForMips;
+    totalTextureSizeInBytes = (totalTextureSizeInBytes + 63U) & ~63U; // Avoid false sharing
 
     mTextureDataBuffer.resize(size_t{totalTextureSizeInBytes} * size_t{textureCount});
     mTextureSubresources.resize(size_t{mTextureArraySize} * size_t{mTextureMipLevels} * size_t{textureCount});
@@ -204,19 +589,19 @@ void AsteroidsSimulation::CreateTextures(unsigned int textureCount, unsigned int
         for (auto &i : rngSeeds) i = seeds();
     }
 
-    concurrency::parallel_for(UINT(0), textureCount, [&](UINT t) {
+    auto createTexture = [&](unsigned int t) {
         std::mt19937 rng(rngSeeds[t]);
         auto randomNoise = std::uniform_real_distribution<float>(0.0f, 10000.0f);
         auto randomNoiseScale = std::uniform_real_distribution<float>(100, 150);
         auto randomPersistence = std::normal_distribution<float>(0.9f, 0.2f);
 
-        BYTE* data = mTextureDataBuffer.data() + t * size_t{totalTextureSizeInBytes};
-        for (UINT a = 0; a < mTextureArraySize; ++a) {
-            for (UINT m = 0; m < mTextureMipLevels; ++m) {
+        uint8_t* data = mTextureDataBuffer.data() + t * size_t{totalTextureSizeInBytes};
+        for (unsigned int a = 0; a < mTextureArraySize; ++a) {
+            for (unsigned int m = 0; m < mTextureMipLevels; ++m) {
                 auto width  = mTextureDim >> m;
                 auto height = mTextureDim >> m;
 
-                D3D11_SUBRESOURCE_DATA initialData = {};
+                SubresourceData initialData = {};
                 initialData.pSysMem = data;
                 initialData.SysMemPitch = width * texelSizeInBytes;
                 mTextureSubresources[SubresourceIndex(t, a, m)] = initialData;
@@ -230,7 +615,7 @@ void AsteroidsSimulation::CreateTextures(unsigned int textureCount, unsigned int
         float persistence = randomPersistence(rng);
         float strength = 1.5f;
 
-        for (UINT a = 0; a < mTextureArraySize; ++a) {
+        for (unsigned int a = 0; a < mTextureArraySize; ++a) {
             float redScale   = 255.0f;
             float greenScale = 255.0f;
             float blueScale  = 255.0f;
@@ -246,5 +631,17 @@ void AsteroidsSimulation::CreateTextures(unsigned int textureCount, unsigned int
                               randomNoise(rng), persistence, noiseScale, strength,
                               redScale, greenScale, blueScale);
         }
-    }); // parallel_for
+    };
+
+    if (mScheduler != nullptr) {
+        mScheduler->ParallelFor(textureCount, [&](Diligent::Uint32, Diligent::Uint32, Diligent::Uint32 begin, Diligent::Uint32 end) {
+            for (auto t = begin; t < end; ++t) {
+                createTexture(t);
+            }
+        });
+    } else {
+        for (unsigned int t = 0; t < textureCount; ++t) {
+            createTexture(t);
+        }
+    }
 }
@@ -10,45 +10,83 @@
 
 #pragma once
 
-#include <d3d11.h> // For D3D11_SUBRESOURCE_DATA
-#include <DirectXMath.h>
 #include <vector>
-#include <algorithm>
 #include <random>
 
+#include "BasicMath.hpp"
 #include "mesh.h"
 #include "settings.h"
+#include "noise_texture.h"
+
+namespace Diligent
+{
+class TaskScheduler;
+}
 
-// We may want to ISPC-ify this down the road and just let it own the data structure in AoSoA format or similar
-// For now we'll just do the dumb thing and see if it's fast enough
 struct AsteroidDynamic
 {
-    DirectX::XMMATRIX world;
+    // Row-major matrix for row vectors, same layout as DirectX::XMFLOAT4X4
+    Diligent::float4x4 world;
     // These depend on chosen subdiv level, hence are not constant
+    unsigned int subdiv;
     unsigned int indexStart;
     unsigned int indexCount;
 };
 
 struct AsteroidStatic
 {
-    DirectX::XMFLOAT3 surfaceColor;
-    DirectX::XMFLOAT3 deepColor;
-    DirectX::XMVECTOR spinAxis;
-    float scale;
-    float spinVelocity;
-    float orbitVelocity;
+    Diligent::float3 surfaceColor;
+    Diligent::float3 deepColor;
     unsigned int vertexStart;
     unsigned int textureIndex;
 };
 
+// Animation state in structure-of-arrays layout, so that the update can process
+// several asteroids with one SIMD instruction. The world matrix is rebuilt every
+// frame from the accumulated angles instead of being multiplied incrementally.
+struct AsteroidMotion
+{
+    std::vector<float> spinAxisX;
+    std::vector<float> spinAxisY;
+    std::vector<float> spinAxisZ;
+    std::vector<float> spinAngle;
+    std::vector<float> spinVelocity;
+    std::vector<float> orbitAngle;
+    std::vector<float> orbitVelocity;
+    std::vector<float> orbitRadius;
+    std::vector<float> discPosY;
+    std::vector<float> scale;
+
+    void Resize(size_t count);
+};
+
+// Bounding spheres in structure-of-arrays layout for frustum culling.
+// Centers are updated together with the world matrices.
+struct AsteroidBounds
+{
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radius;
+
+    void Resize(size_t count);
+};
+
+// Extracts normalized left, right, bottom, top, near and far planes from a row-vector
+// view-projection matrix with [0, 1] depth range. A point p is inside the plane when
+// dot(plane.xyz, p) + plane.w >= 0.
+void ExtractFrustumPlanes(const Diligent::float4x4& viewProjection, Diligent::float4 planes[6]);
+
 class AsteroidsSimulation
 {
 private:
-    // NOTE: Memory could be optimized further for efficient cache traversal, etc.
     std::vector<AsteroidStatic> mAsteroidStatic;
     std::vector<AsteroidDynamic> mAsteroidDynamic;
+    AsteroidMotion mAsteroidMotion;
+    AsteroidBounds mAsteroidBounds;
 
     Mesh mMeshes;
+    float mMeshBoundingRadius = 0.0f;
     std::vector<unsigned int> mIndexOffsets;
     unsigned int mSubdivCount;
     unsigned int mVertexCountPerMesh;
@@ -57,8 +95,10 @@ private:
     unsigned int mTextureCount;
     unsigned int mTextureArraySize;
     unsigned int mTextureMipLevels;
-    std::vector<BYTE> mTextureDataBuffer;
-    std::vector<D3D11_SUBRESOURCE_DATA> mTextureSubresources;
+    std::vector<uint8_t> mTextureDataBuffer;
+    std::vector<SubresourceData> mTextureSubresources;
+
+    Diligent::TaskScheduler* mScheduler = nullptr;
 
     unsigned int SubresourceIndex(unsigned int texture, unsigned int arrayElement = 0, unsigned int mip = 0)
     {
@@ -68,23 +108,44 @@ private:
     void CreateTextures(unsigned int textureCount, unsigned int rngSeed);
     
 public:
+    // The scheduler is optional and is used for mesh and texture generation and UpdateAll()
+    // If meshCachePath is not null, generated meshes are cached in that file between runs
     AsteroidsSimulation(unsigned int rngSeed, unsigned int asteroidCount,
                         unsigned int meshInstanceCount, unsigned int subdivCount,
-                        unsigned int textureCount);
+                        unsigned int textureCount, Diligent::TaskScheduler* scheduler = nullptr,
+                        const char* meshCachePath = nullptr);
 
     const Mesh* Meshes() { return &mMeshes; }
-    const D3D11_SUBRESOURCE_DATA* TextureData(unsigned int textureIndex)
+    const SubresourceData* TextureData(unsigned int textureIndex)
     {
         return mTextureSubresources.data() + SubresourceIndex(textureIndex);
     }
 
     unsigned int GetTextureMipLevels()const{return mTextureMipLevels;}
 
+    // LODs are in [0, SubdivCount()]
+    unsigned int SubdivCount() const { return mSubdivCount; }
+    // Radius of the sphere centered at the origin that bounds every mesh
+    float MeshBoundingRadius() const { return mMeshBoundingRadius; }
+
+    size_t AsteroidCount() const { return mAsteroidDynamic.size(); }
+
     const AsteroidStatic* StaticData() const { return mAsteroidStatic.data(); }
     const AsteroidDynamic* DynamicData() const { return mAsteroidDynamic.data(); }
 
     // Can optionally provide a range of asteroids to update; count = 0 => to the end
-    // This is useful for multithreading
-    void Update(float frameTime, DirectX::XMVECTOR cameraEye, const Settings& settings,
+    // Disjoint ranges may be updated from different threads
+    void Update(float frameTime, const Diligent::float3& cameraEye, const Settings& settings,
                 size_t startIndex = 0, size_t count = 0);
+
+    // Updates all asteroids, splitting them between the scheduler threads.
+    // Falls back to Update() when the simulation has no scheduler.
+    void UpdateAll(float frameTime, const Diligent::float3& cameraEye, const Settings& settings);
+
+    // Tests the bounding spheres of the asteroids in [startIndex, startIndex + count) against
+    // the view frustum and writes the indices of the visible ones to visibleIndices, which must
+    // have room for count elements. Returns the number of visible asteroids.
+    // Disjoint ranges may be culled from different threads.
+    size_t Cull(const Diligent::float4x4& viewProjection, size_t startIndex, size_t count,
+                unsigned int* visibleIndices) const;
 };
@@ -14,12 +14,19 @@
 #include <d3dx12.h>
 #include <d3d11.h>
 
-void GenerateMips2D_XXXX8(D3D11_SUBRESOURCE_DATA* subresources, size_t widthLevel0, size_t heightLevel0, size_t mipLevels);
+#include <stddef.h>
 
-// Will generate mips (into subresources array) is mipLevels > 0
-void FillNoise2D_RGBA8(D3D11_SUBRESOURCE_DATA* subresources, size_t width, size_t height, size_t mipLevels,
-                       float seed, float persistence, float noiseScale, float noiseStrength,
-					   float redScale = 255.0f, float greenScale = 255.0f, float blueScale = 255.0f);
+#include "noise_texture.h"
+
+static_assert(sizeof(SubresourceData) == sizeof(D3D11_SUBRESOURCE_DATA) &&
+              offsetof(SubresourceData, SysMemPitch) == offsetof(D3D11_SUBRESOURCE_DATA, SysMemPitch) &&
+              offsetof(SubresourceData, SysMemSlicePitch) == offsetof(D3D11_SUBRESOURCE_DATA, SysMemSlicePitch),
+              "SubresourceData must have the same layout as D3D11_SUBRESOURCE_DATA");
+
+inline const D3D11_SUBRESOURCE_DATA* AsD3D11SubresourceData(const SubresourceData* data)
+{
+    return reinterpret_cast<const D3D11_SUBRESOURCE_DATA*>(data);
+}
 
 
 // Helper for uploading initial texture data in D3D12; as with D3D11, one initialData structure per subresource
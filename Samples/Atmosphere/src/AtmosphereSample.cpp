@@ -28,6 +28,7 @@
 #include <cmath>
 #include <algorithm>
 #include <array>
+#include <thread>
 
 #include "AtmosphereSample.hpp"
 #include "MapHelper.hpp"
@@ -109,10 +110,13 @@ void AtmosphereSample::Initialize(const SampleInitInfo& InitInfo)
     m_strNormalMapTexPaths[3] = "Terrain\\Tiles\\Snow_NM.jpg";
     m_strNormalMapTexPaths[4] = "Terrain\\Tiles\\grass_NM.dds";
 
+    // The calling thread also executes tasks, so one thread is left for it
+    m_pScheduler.reset(new TaskScheduler{std::max(std::thread::hardware_concurrency(), 2u) - 1});
+
     // Create data source
     try
     {
-        m_pElevDataSource.reset(new ElevationDataSource(m_strRawDEMDataFile.c_str()));
+        m_pElevDataSource.reset(new ElevationDataSource(m_strRawDEMDataFile.c_str(), m_pScheduler.get()));
         m_pElevDataSource->SetOffsets(m_TerrainRenderParams.m_iColOffset, m_TerrainRenderParams.m_iRowOffset);
         m_fMinElevation = m_pElevDataSource->GetGlobalMinElevation() * m_TerrainRenderParams.m_TerrainAttribs.m_fElevationScale;
         m_fMaxElevation = m_pElevDataSource->GetGlobalMaxElevation() * m_TerrainRenderParams.m_TerrainAttribs.m_fElevationScale;
@@ -146,7 +150,9 @@ void AtmosphereSample::Initialize(const SampleInitInfo& InitInfo)
                              strNormalMapPaths,
                              m_pcbCameraAttribs,
                              m_pcbLightAttribs,
-                             pcMediaScatteringParams);
+                             pcMediaScatteringParams,
+                             m_pScheduler.get(),
+                             m_pShaderCache);
 
     CreateShadowMap();
 }
@@ -31,6 +31,7 @@
 #include "BasicMath.hpp"
 #include "EarthHemisphere.hpp"
 #include "ElevationDataSource.hpp"
+#include "TaskScheduler.hpp"
 #include "EpipolarLightScattering.hpp"
 #include "ShadowMapManager.hpp"
 
@@ -91,6 +92,9 @@ private:
 
     float m_fMinElevation = 0, m_fMaxElevation = 0;
 
+    // Used to process terrain data on all cores. Must outlive the elevation data source.
+    std::unique_ptr<TaskScheduler> m_pScheduler;
+
     std::unique_ptr<ElevationDataSource> m_pElevDataSource;
     EarthHemsiphere                      m_EarthHemisphere;
     bool                                 m_bIsGLDevice = false;
@@ -66,6 +66,8 @@ namespace Diligent
 #include "TextureUtilities.h"
 #include "CommonlyUsedStates.h"
 #include "CallbackWrapper.hpp"
+#include "MipGenerator.hpp"
+#include "ShaderCache.hpp"
 
 namespace Diligent
 {
@@ -495,7 +497,8 @@ void EarthHemsiphere::RenderNormalMap(IRenderDevice*  pDevice,
                                       const Uint16*   pHeightMap,
                                       size_t          HeightMapStride,
                                       int             iHeightMapDim,
-                                      ITexture*       ptex2DNormalMap)
+                                      ITexture*       ptex2DNormalMap,
+                                      TaskScheduler*  pScheduler)
 {
     TextureDesc HeightMapDesc;
     HeightMapDesc.Name      = "Height map texture";
@@ -520,39 +523,36 @@ void EarthHemsiphere::RenderNormalMap(IRenderDevice*  pDevice,
     CoarseMipLevels.resize(static_cast<size_t>(iHeightMapDim) / 2 * iHeightMapDim);
 
     std::vector<TextureSubResData> InitData(HeightMapDesc.MipLevels);
-    InitData[0].pData            = pHeightMap;
-    InitData[0].Stride           = (Uint32)HeightMapStride * sizeof(pHeightMap[0]);
-    const Uint16* pFinerMipLevel = pHeightMap;
-    Uint16*       pCurrMipLevel  = &CoarseMipLevels[0];
-    size_t        FinerMipStride = HeightMapStride;
-    size_t        CurrMipStride  = iHeightMapDim / 2;
+    InitData[0].pData  = pHeightMap;
+    InitData[0].Stride = (Uint32)HeightMapStride * sizeof(pHeightMap[0]);
+
+    const size_t              CoarseMipStride = iHeightMapDim / 2; // Same stride for all mips
+    std::vector<MipLevelData> CoarseMips(HeightMapDesc.MipLevels - 1);
+    Uint16*                   pCurrMipLevel = &CoarseMipLevels[0];
     for (Uint32 uiMipLevel = 1; uiMipLevel < HeightMapDesc.MipLevels; ++uiMipLevel)
     {
         const auto MipProps = GetMipLevelProperties(HeightMapDesc, uiMipLevel);
-        for (size_t Row = 0; Row < MipProps.LogicalHeight; ++Row)
-        {
-            for (size_t Col = 0; Col < MipProps.LogicalWidth; ++Col)
-            {
-                int iAverageHeight = 0;
-                for (size_t i = 0; i < 2; ++i)
-                {
-                    for (size_t j = 0; j < 2; ++j)
-                    {
-                        iAverageHeight += pFinerMipLevel[(Col * 2 + i) + (Row * 2 + j) * size_t{FinerMipStride}];
-                    }
-                }
-                pCurrMipLevel[Col + Row * CurrMipStride] = (Uint16)(iAverageHeight >> 2);
-            }
-        }
 
-        InitData[uiMipLevel].pData  = pCurrMipLevel;
-        InitData[uiMipLevel].Stride = (Uint32)CurrMipStride * sizeof(*pCurrMipLevel);
-        pFinerMipLevel              = pCurrMipLevel;
-        FinerMipStride              = CurrMipStride;
-        pCurrMipLevel += MipProps.LogicalHeight * CurrMipStride;
-        CurrMipStride = iHeightMapDim / 2; // Same stride for all mips
+        CoarseMips[uiMipLevel - 1].pData  = pCurrMipLevel;
+        CoarseMips[uiMipLevel - 1].Stride = CoarseMipStride * sizeof(*pCurrMipLevel);
+        InitData[uiMipLevel].pData        = pCurrMipLevel;
+        InitData[uiMipLevel].Stride       = (Uint32)CoarseMipStride * sizeof(*pCurrMipLevel);
+        pCurrMipLevel += MipProps.LogicalHeight * CoarseMipStride;
     }
 
+    GenerateMipsAttribs MipsAttribs;
+    MipsAttribs.Width         = HeightMapDesc.Width;
+    MipsAttribs.Height        = HeightMapDesc.Height;
+    MipsAttribs.ComponentType = VT_UINT16;
+    MipsAttribs.NumComponents = 1;
+    MipsAttribs.Filter        = MIP_FILTER_BOX;
+    MipsAttribs.pLevel0Data   = pHeightMap;
+    MipsAttribs.Level0Stride  = HeightMapStride * sizeof(pHeightMap[0]);
+    MipsAttribs.NumMipLevels  = HeightMapDesc.MipLevels;
+    MipsAttribs.pMipLevels    = CoarseMips.data();
+    MipsAttribs.pScheduler    = pScheduler;
+    GenerateMips(MipsAttribs);
+
     RefCntAutoPtr<ITexture> ptex2DHeightMap;
     TextureData             HeigtMapInitData;
     HeigtMapInitData.pSubResources   = InitData.data();
@@ -567,8 +567,13 @@ void EarthHemsiphere::RenderNormalMap(IRenderDevice*  pDevice,
 
     m_pResMapping->AddResource("cbNMGenerationAttribs", pcbNMGenerationAttribs, true);
 
+    auto ShaderCallback = MakeCallback([&](ShaderCreateInfo& ShaderCI, SHADER_TYPE ShaderType, bool& IsAddToCache) {
+        if (m_pShaderCache != nullptr)
+            m_pShaderCache->ResolveBytecode(ShaderCI);
+    });
+
     RefCntAutoPtr<IPipelineState> pRenderNormalMapPSO;
-    m_pRSNLoader->LoadPipelineState({"Render Normal Map", PIPELINE_TYPE_GRAPHICS, false}, &pRenderNormalMapPSO);
+    m_pRSNLoader->LoadPipelineState({"Render Normal Map", PIPELINE_TYPE_GRAPHICS, false, nullptr, nullptr, ShaderCallback, ShaderCallback}, &pRenderNormalMapPSO);
 
     pRenderNormalMapPSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
 
@@ -615,10 +620,13 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
                              const Char*                TileNormalMapPath[],
                              IBuffer*                   pcbCameraAttribs,
                              IBuffer*                   pcbLightAttribs,
-                             IBuffer*                   pcMediaScatteringParams)
+                             IBuffer*                   pcMediaScatteringParams,
+                             TaskScheduler*             pScheduler,
+                             ShaderCache*               pShaderCache)
 {
-    m_Params  = Params;
-    m_pDevice = pDevice;
+    m_Params       = Params;
+    m_pDevice      = pDevice;
+    m_pShaderCache = pShaderCache;
 
     RefCntAutoPtr<IRenderStateNotationParser> pRSNParser;
     {
@@ -635,12 +643,14 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
         CreateRenderStateNotationLoader({m_pDevice, pRSNParser, pStreamFactory}, &m_pRSNLoader);
     }
 
-    const Uint16* pHeightMap;
-    size_t        HeightMapPitch;
-    pDataSource->GetDataPtr(pHeightMap, HeightMapPitch);
     Uint32 iHeightMapDim = pDataSource->GetNumCols();
     VERIFY_EXPR(iHeightMapDim == pDataSource->GetNumRows());
 
+    // The data source stores samples in tiles, while the height map texture
+    // needs them in linear layout
+    std::vector<Uint16> HeightMap(size_t{iHeightMapDim} * size_t{iHeightMapDim});
+    pDataSource->ReadSamples(0, 0, iHeightMapDim, iHeightMapDim, HeightMap.data(), iHeightMapDim);
+
     TextureDesc NormalMapDesc;
     NormalMapDesc.Name      = "Normal map texture";
     NormalMapDesc.Type      = RESOURCE_DIM_TEX_2D;
@@ -702,14 +712,21 @@ void EarthHemsiphere::Create(class ElevationDataSource* pDataSource,
 
     m_pDevice->CreateSampler(Sam_ComparisonLinearClamp, &m_pComparisonSampler);
 
-    RenderNormalMap(pDevice, pContext, pHeightMap, HeightMapPitch, iHeightMapDim, ptex2DNormalMap);
+    RenderNormalMap(pDevice, pContext, HeightMap.data(), iHeightMapDim, iHeightMapDim, ptex2DNormalMap, pScheduler);
+    // The copy is not needed after the height map texture is created
+    HeightMap.clear();
+    HeightMap.shrink_to_fit();
 
     {
         auto Callback = MakeCallback([&](PipelineStateCreateInfo& pPipelineCI) {
             auto& GraphicsPipelineCI{static_cast<GraphicsPipelineStateCreateInfo&>(pPipelineCI)};
             GraphicsPipelineCI.GraphicsPipeline.DSVFormat = m_Params.ShadowMapFormat;
         });
-        m_pRSNLoader->LoadPipelineState({"Render Hemisphere Z Only", PIPELINE_TYPE_GRAPHICS, false, Callback, Callback}, &m_pHemisphereZOnlyPSO);
+        auto ShaderCallback = MakeCallback([&](ShaderCreateInfo& ShaderCI, SHADER_TYPE ShaderType, bool& IsAddToCache) {
+            if (m_pShaderCache != nullptr)
+                m_pShaderCache->ResolveBytecode(ShaderCI);
+        });
+        m_pRSNLoader->LoadPipelineState({"Render Hemisphere Z Only", PIPELINE_TYPE_GRAPHICS, false, Callback, Callback, ShaderCallback, ShaderCallback}, &m_pHemisphereZOnlyPSO);
         m_pHemisphereZOnlyPSO->BindStaticResources(SHADER_TYPE_VERTEX | SHADER_TYPE_PIXEL, m_pResMapping, BIND_SHADER_RESOURCES_VERIFY_ALL_RESOLVED);
         m_pHemisphereZOnlyPSO->CreateShaderResourceBinding(&m_pHemisphereZOnlySRB, true);
     }
@@ -771,6 +788,8 @@ void EarthHemsiphere::Render(IDeviceContext*        pContext,
         auto ShaderCallback = MakeCallback([&](ShaderCreateInfo& pShaderCI, SHADER_TYPE ShaderType, bool& IsAddToCache) {
             if (ShaderType == SHADER_TYPE_PIXEL)
                 pShaderCI.Macros = Macros;
+            if (m_pShaderCache != nullptr)
+                m_pShaderCache->ResolveBytecode(pShaderCI);
         });
 
         auto PipelineCallback = MakeCallback([&](PipelineStateCreateInfo& pPipelineCI) {
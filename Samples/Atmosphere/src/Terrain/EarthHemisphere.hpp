@@ -135,7 +135,9 @@ public:
                 const char*                TileNormalMapPath[],
                 IBuffer*                   pcbCameraAttribs,
                 IBuffer*                   pcbLightAttribs,
-                IBuffer*                   pcMediaScatteringParams);
+                IBuffer*                   pcMediaScatteringParams,
+                class TaskScheduler*       pScheduler   = nullptr,
+                class ShaderCache*         pShaderCache = nullptr);
 
     enum
     {
@@ -148,7 +150,8 @@ private:
                          const Uint16*   pHeightMap,
                          size_t          HeightMapPitch,
                          int             HeightMapDim,
-                         ITexture*       ptex2DNormalMap);
+                         ITexture*       ptex2DNormalMap,
+                         TaskScheduler*  pScheduler);
 
     RenderingParams m_Params;
 
@@ -156,6 +159,9 @@ private:
 
     RefCntAutoPtr<IRenderStateNotationLoader> m_pRSNLoader;
 
+    // Null if the shader cache is disabled
+    ShaderCache* m_pShaderCache = nullptr;
+
     RefCntAutoPtr<IBuffer>      m_pcbTerrainAttribs;
     RefCntAutoPtr<IBuffer>      m_pVertBuff;
     RefCntAutoPtr<ITextureView> m_ptex2DNormalMapSRV, m_ptex2DMtrlMaskSRV;
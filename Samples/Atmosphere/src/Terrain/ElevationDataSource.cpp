@@ -45,6 +45,8 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <string>
 
 #include "ElevationDataSource.hpp"
 #include "FileWrapper.hpp"
@@ -53,51 +55,319 @@
 #include "BasicFileStream.hpp"
 #include "TextureUtilities.h"
 #include "GraphicsAccessories.hpp"
+#include "Align.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    if defined(__SSE4_1__)
+#        include <smmintrin.h>
+#    else
+#        include <emmintrin.h>
+#    endif
+#    define ELEVATION_MIN_MAX_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define ELEVATION_MIN_MAX_NEON 1
+#endif
 
 namespace Diligent
 {
 
-// Creates data source from the specified raw data file
-ElevationDataSource::ElevationDataSource(const Char* strSrcDemFile) :
+namespace
+{
+
+// Tiled elevation file layout:
+//   - Header
+//   - NumTilesX x NumTilesY tiles, each containing TileSize x TileSize 16-bit samples
+//   - Min/max elevation hierarchy, all levels starting from the coarsest one
+// All values are little-endian.
+struct TiledElevationFileHeader
+{
+    static constexpr Uint32 MagicValue  = 0x48455444; // 'DTEH'
+    static constexpr Uint32 CurrVersion = 2;
+
+    Uint32 Magic     = MagicValue;
+    Uint32 Version   = CurrVersion;
+    Uint32 NumCols   = 0;
+    Uint32 NumRows   = 0;
+    Uint32 TileSize  = 0;
+    Uint32 NumTilesX = 0;
+    Uint32 NumTilesY = 0;
+    Uint32 NumLevels = 0;
+    Uint32 PatchSize = 0;
+    Uint32 Reserved  = 0;
+
+    Uint64 TilesOffset  = 0;
+    Uint64 MinMaxOffset = 0;
+    Uint64 FileSize     = 0;
+
+    // Size and hash of the image the file was converted from, zero if unknown
+    Uint64 SourceSize = 0;
+    Uint64 SourceHash = 0;
+
+    // Computes the number of tiles and the offsets from the dimensions
+    void InitLayout()
+    {
+        NumTilesX    = (NumCols + TileSize - 1) / TileSize;
+        NumTilesY    = (NumRows + TileSize - 1) / TileSize;
+        TilesOffset  = sizeof(TiledElevationFileHeader);
+        MinMaxOffset = AlignUp(TilesOffset + Uint64{NumTilesX} * NumTilesY * TileSize * TileSize * sizeof(Uint16), Uint64{16});
+        FileSize     = MinMaxOffset + HierarchyArray<std::pair<Uint16, Uint16>>::GetNumElements(NumLevels) * sizeof(std::pair<Uint16, Uint16>);
+    }
+};
+static_assert(sizeof(TiledElevationFileHeader) == 80, "Tiled elevation file header size must only change together with the version");
+static_assert(sizeof(std::pair<Uint16, Uint16>) == 4, "Min/max elevation pairs are stored in the file as two 16-bit values");
+
+constexpr char TiledFileExtension[] = ".dteh";
+
+// 64-bit FNV-1a
+Uint64 HashBytes(const void* pData, size_t Size)
+{
+    Uint64      Hash   = 0xCBF29CE484222325ull;
+    const auto* pBytes = static_cast<const Uint8*>(pData);
+    for (size_t i = 0; i < Size; ++i)
+    {
+        Hash ^= pBytes[i];
+        Hash *= 0x100000001B3ull;
+    }
+    return Hash;
+}
+
+bool HasTiledFileExtension(const std::string& Path)
+{
+    const size_t ExtLen = sizeof(TiledFileExtension) - 1;
+    return Path.length() >= ExtLen && Path.compare(Path.length() - ExtLen, ExtLen, TiledFileExtension) == 0;
+}
+
+// Updates MinElev and MaxElev with the minimum and maximum of Count samples
+void ReduceMinMaxElevation(const Uint16* pSamples, size_t Count, Uint16& MinElev, Uint16& MaxElev)
+{
+    size_t i = 0;
+#if ELEVATION_MIN_MAX_SSE2
+    if (Count >= 8)
+    {
+#    if defined(__SSE4_1__)
+        __m128i MinVec = _mm_set1_epi16(static_cast<short>(MinElev));
+        __m128i MaxVec = _mm_set1_epi16(static_cast<short>(MaxElev));
+        for (; i + 8 <= Count; i += 8)
+        {
+            const __m128i Samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSamples + i));
+            MinVec                = _mm_min_epu16(MinVec, Samples);
+            MaxVec                = _mm_max_epu16(MaxVec, Samples);
+        }
+        const __m128i SignFlip = _mm_setzero_si128();
+#    else
+        // SSE2 only has signed 16-bit min/max. Flipping the sign bit maps unsigned
+        // values to signed values with the same order.
+        const __m128i SignFlip = _mm_set1_epi16(static_cast<short>(0x8000));
+        __m128i       MinVec   = _mm_xor_si128(_mm_set1_epi16(static_cast<short>(MinElev)), SignFlip);
+        __m128i       MaxVec   = _mm_xor_si128(_mm_set1_epi16(static_cast<short>(MaxElev)), SignFlip);
+        for (; i + 8 <= Count; i += 8)
+        {
+            const __m128i Samples = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSamples + i)), SignFlip);
+            MinVec                = _mm_min_epi16(MinVec, Samples);
+            MaxVec                = _mm_max_epi16(MaxVec, Samples);
+        }
+#    endif
+        alignas(16) Uint16 MinLanes[8];
+        alignas(16) Uint16 MaxLanes[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(MinLanes), _mm_xor_si128(MinVec, SignFlip));
+        _mm_store_si128(reinterpret_cast<__m128i*>(MaxLanes), _mm_xor_si128(MaxVec, SignFlip));
+        for (int Lane = 0; Lane < 8; ++Lane)
+        {
+            MinElev = std::min(MinElev, MinLanes[Lane]);
+            MaxElev = std::max(MaxElev, MaxLanes[Lane]);
+        }
+    }
+#elif ELEVATION_MIN_MAX_NEON
+    if (Count >= 8)
+    {
+        uint16x8_t MinVec = vdupq_n_u16(MinElev);
+        uint16x8_t MaxVec = vdupq_n_u16(MaxElev);
+        for (; i + 8 <= Count; i += 8)
+        {
+            const uint16x8_t Samples = vld1q_u16(pSamples + i);
+            MinVec                   = vminq_u16(MinVec, Samples);
+            MaxVec                   = vmaxq_u16(MaxVec, Samples);
+        }
+        MinElev = vminvq_u16(MinVec);
+        MaxElev = vmaxvq_u16(MaxVec);
+    }
+#endif
+
+    for (; i < Count; ++i)
+    {
+        MinElev = std::min(MinElev, pSamples[i]);
+        MaxElev = std::max(MaxElev, pSamples[i]);
+    }
+}
+
+} // namespace
+
+// Creates data source from the specified file
+ElevationDataSource::ElevationDataSource(const Char* strSrcDemFile, TaskScheduler* pScheduler) :
     m_iNumLevels(0),
     m_iPatchSize(128),
     m_iColOffset(0),
-    m_iRowOffset(0)
+    m_iRowOffset(0),
+    m_pScheduler(pScheduler)
+{
+    const std::string SrcPath{strSrcDemFile};
+    if (HasTiledFileExtension(SrcPath))
+    {
+        if (!OpenTiledFile(strSrcDemFile))
+            LOG_ERROR_AND_THROW("Failed to open tiled elevation file '", strSrcDemFile, "'");
+    }
+    else
+    {
+        // If the image can't be read, the tiled file is used as is and the import below reports the error
+        SourceFileInfo Source;
+        const bool     HasSource = GetSourceFileInfo(strSrcDemFile, Source);
+
+        const std::string TiledPath = SrcPath + TiledFileExtension;
+        if (!OpenTiledFile(TiledPath.c_str(), HasSource ? &Source : nullptr))
+        {
+            ImportImage(strSrcDemFile);
+            SaveTiledFile(TiledPath.c_str(), Source);
+        }
+    }
+
+#ifdef DILIGENT_DEBUG
+    VerifyDirtyPatchUpdate();
+#endif
+}
+
+bool ElevationDataSource::GetSourceFileInfo(const Char* Path, SourceFileInfo& Info)
+{
+    MappedFile SrcFile;
+    if (!SrcFile.Open(Path))
+        return false;
+
+    Info.Size = SrcFile.GetSize();
+    Info.Hash = HashBytes(SrcFile.GetData(), SrcFile.GetSize());
+    return true;
+}
+
+bool ElevationDataSource::OpenTiledFile(const Char* Path, const SourceFileInfo* pSource)
 {
+    // Open the file as copy-on-write: UpdateSamples() edits the samples and the min/max elevations
+    // in place, and the changes must never be written back to the file.
+    if (!m_TiledFile.Open(Path, true))
+        return false;
+
+    const auto FileSize = m_TiledFile.GetSize();
+    if (FileSize < sizeof(TiledElevationFileHeader))
+    {
+        LOG_WARNING_MESSAGE("Tiled elevation file '", Path, "' is truncated");
+        m_TiledFile.Close();
+        return false;
+    }
+
+    auto* pData = static_cast<Uint8*>(m_TiledFile.GetWritableData());
+
+    TiledElevationFileHeader Header;
+    memcpy(&Header, pData, sizeof(Header));
+
+    TiledElevationFileHeader ExpectedLayout;
+    ExpectedLayout.NumCols   = Header.NumCols;
+    ExpectedLayout.NumRows   = Header.NumRows;
+    ExpectedLayout.TileSize  = Header.TileSize;
+    ExpectedLayout.NumLevels = Header.NumLevels;
+    ExpectedLayout.InitLayout();
+
+    const bool IsValid =
+        Header.Magic == TiledElevationFileHeader::MagicValue &&
+        Header.Version == TiledElevationFileHeader::CurrVersion &&
+        Header.NumCols > 1 && Header.NumRows > 1 &&
+        Header.TileSize > 0 && IsPowerOfTwo(Header.TileSize) &&
+        Header.PatchSize > 0 && Header.NumLevels > 0 && Header.NumLevels < 16 &&
+        (Uint64{Header.PatchSize} << (Header.NumLevels - 1)) + 1 >= std::max(Header.NumCols, Header.NumRows) &&
+        Header.NumTilesX == ExpectedLayout.NumTilesX &&
+        Header.NumTilesY == ExpectedLayout.NumTilesY &&
+        Header.TilesOffset == ExpectedLayout.TilesOffset &&
+        Header.MinMaxOffset == ExpectedLayout.MinMaxOffset &&
+        Header.FileSize == ExpectedLayout.FileSize &&
+        Header.FileSize == FileSize;
+    if (!IsValid)
+    {
+        LOG_WARNING_MESSAGE("Tiled elevation file '", Path, "' is invalid or was created by an incompatible version");
+        m_TiledFile.Close();
+        return false;
+    }
+
+    if (pSource != nullptr && (Header.SourceSize != pSource->Size || Header.SourceHash != pSource->Hash))
+    {
+        LOG_INFO_MESSAGE("Tiled elevation file '", Path, "' is out of date and will be converted again");
+        m_TiledFile.Close();
+        return false;
+    }
+
+    AttachTiledData(pData);
+    return true;
+}
+
+void ElevationDataSource::AttachTiledData(Uint8* pData)
+{
+    TiledElevationFileHeader Header;
+    memcpy(&Header, pData, sizeof(Header));
+
+    m_iNumCols   = Header.NumCols;
+    m_iNumRows   = Header.NumRows;
+    m_iNumLevels = static_cast<int>(Header.NumLevels);
+    m_iPatchSize = static_cast<int>(Header.PatchSize);
+    m_NumTilesX  = Header.NumTilesX;
+
+    m_TileSizeLog2 = 0;
+    while ((1u << m_TileSizeLog2) < Header.TileSize)
+        ++m_TileSizeLog2;
 
-#if 1
+    m_pTiles = reinterpret_cast<Uint16*>(pData + Header.TilesOffset);
+    m_MinMaxElevation.Attach(reinterpret_cast<std::pair<Uint16, Uint16>*>(pData + Header.MinMaxOffset), m_iNumLevels);
+}
+
+void ElevationDataSource::ImportImage(const Char* Path)
+{
     RefCntAutoPtr<Image> pHeightMap;
-    CreateImageFromFile(strSrcDemFile, &pHeightMap);
+    CreateImageFromFile(Path, &pHeightMap);
+    if (!pHeightMap)
+        LOG_ERROR_AND_THROW("Failed to load elevation data from '", Path, "'");
 
     const auto& ImgInfo    = pHeightMap->GetDesc();
     auto*       pImageData = pHeightMap->GetData();
     // Calculate minimal number of columns and rows
     // in the form 2^n+1 that encompass the data
-    m_iNumCols = 1;
-    m_iNumRows = 1;
-    while (m_iNumCols + 1 < ImgInfo.Width || m_iNumRows + 1 < ImgInfo.Height)
+    Uint32 NumCols = 1;
+    Uint32 NumRows = 1;
+    while (NumCols + 1 < ImgInfo.Width || NumRows + 1 < ImgInfo.Height)
     {
-        m_iNumCols *= 2;
-        m_iNumRows *= 2;
+        NumCols *= 2;
+        NumRows *= 2;
     }
 
-    m_iNumLevels = 1;
-    while ((m_iPatchSize << (m_iNumLevels - 1)) < (int)m_iNumCols ||
-           (m_iPatchSize << (m_iNumLevels - 1)) < (int)m_iNumRows)
-        m_iNumLevels++;
+    int NumLevels = 1;
+    while ((m_iPatchSize << (NumLevels - 1)) < (int)NumCols ||
+           (m_iPatchSize << (NumLevels - 1)) < (int)NumRows)
+        NumLevels++;
 
-    m_iNumCols++;
-    m_iNumRows++;
-    m_iStride = (m_iNumCols + 1) & (-2);
+    TiledElevationFileHeader Header;
+    Header.NumCols   = NumCols + 1;
+    Header.NumRows   = NumRows + 1;
+    Header.TileSize  = static_cast<Uint32>(m_iPatchSize);
+    Header.NumLevels = static_cast<Uint32>(NumLevels);
+    Header.PatchSize = static_cast<Uint32>(m_iPatchSize);
+    Header.InitLayout();
 
-    // Load the data
-    m_TheHeightMap.resize(size_t{m_iStride} * size_t{m_iNumRows});
+    m_ImportedData.resize(static_cast<size_t>(Header.FileSize));
+    memcpy(m_ImportedData.data(), &Header, sizeof(Header));
+    AttachTiledData(m_ImportedData.data());
 
+    // Load the data
     VERIFY(ImgInfo.ComponentType == VT_UINT16 && ImgInfo.NumComponents == 1, "Unexpected scanline size: 16-bit single-channel image is expected");
-    auto* pSrcImgData = reinterpret_cast<Uint8*>(pImageData->GetDataPtr());
-    for (size_t row = 0; row < ImgInfo.Height; row++, pSrcImgData += ImgInfo.RowStride)
+    const auto* pSrcImgData = reinterpret_cast<const Uint8*>(pImageData->GetDataPtr());
+    for (Uint32 iRow = 0; iRow < ImgInfo.Height; iRow++, pSrcImgData += ImgInfo.RowStride)
     {
-        memcpy(&m_TheHeightMap[row * m_iStride], pSrcImgData, size_t{ImgInfo.Width} * size_t{GetValueSize(ImgInfo.ComponentType)});
+        const auto* pSrcRow = reinterpret_cast<const Uint16*>(pSrcImgData);
+        for (Uint32 iCol = 0; iCol < ImgInfo.Width; iCol++)
+            GetElevSample(iCol, iRow) = pSrcRow[iCol];
     }
 
     // Duplicate the last row and column
@@ -109,36 +379,31 @@ ElevationDataSource::ElevationDataSource(const Char* strSrcDemFile) :
         for (Uint32 iRow = ImgInfo.Height; iRow < m_iNumRows; iRow++)
             GetElevSample(iCol, iRow) = GetElevSample(iCol, ImgInfo.Height - 1);
 
-#else
-    m_iStride  = 2048;
-    m_iNumRows = m_iNumCols = 2048;
-    m_iNumLevels            = 5;
-    m_TheHeightMap.resize(m_iStride * m_iNumRows);
-    for (Uint32 j = 0; j < m_iNumRows; ++j)
-    {
-        for (Uint32 i = 0; i < m_iNumCols; ++i)
-        {
-            float x = (float)i / (float)m_iNumRows;
-            float y = (float)j / (float)m_iNumCols;
-            float A = 1;
-            float F = 1;
-            float h = 0;
-            for (int Octave = 0; Octave < 8; ++Octave, A *= 0.7f, F *= 1.8f)
-            {
-                h += A * (sin(x * F) * sin(y * 1.5f * F) + 0.5f * (sin((x + y) * 1.3f * F) + cos((x * y) * 1.7f * F)));
-                h = fabs(h - 0.5f);
-            }
-            h = fabs(h) * 32000.f;
-            h = std::min(h, (float)std::numeric_limits<Uint16>::max());
+    // Calculate min/max elevations
+    CalculateMinMaxElevations();
+}
 
-            GetElevSample(i, j) = (Uint16)h;
-        }
+void ElevationDataSource::SaveTiledFile(const Char* Path, const SourceFileInfo& Source)
+{
+    VERIFY_EXPR(!m_ImportedData.empty());
+
+    TiledElevationFileHeader Header;
+    memcpy(&Header, m_ImportedData.data(), sizeof(Header));
+    Header.SourceSize = Source.Size;
+    Header.SourceHash = Source.Hash;
+    memcpy(m_ImportedData.data(), &Header, sizeof(Header));
+
+    FileWrapper pFile{Path, EFileAccessMode::Overwrite};
+    if (!pFile)
+    {
+        // Not an error: the data source works from memory, the image will be converted again next time
+        LOG_INFO_MESSAGE("Unable to create tiled elevation file '", Path, "'");
+        return;
     }
-#endif
-    m_MinMaxElevation.Resize(m_iNumLevels);
 
-    // Calculate min/max elevations
-    CalculateMinMaxElevations();
+    if (!pFile->Write(m_ImportedData.data(), m_ImportedData.size()))
+        LOG_WARNING_MESSAGE("Failed to write tiled elevation file '", Path, "'");
+    pFile.Close();
 }
 
 ElevationDataSource::~ElevationDataSource(void)
@@ -167,14 +432,21 @@ int MirrorCoord(int iCoord, int iDim)
     return iCoord;
 }
 
+inline size_t ElevationDataSource::GetSampleIndex(Int32 i, Int32 j) const
+{
+    const Uint32 TileMask  = (1u << m_TileSizeLog2) - 1u;
+    const size_t TileIndex = (static_cast<size_t>(j) >> m_TileSizeLog2) * m_NumTilesX + (static_cast<size_t>(i) >> m_TileSizeLog2);
+    return (TileIndex << (2 * m_TileSizeLog2)) + ((static_cast<size_t>(j) & TileMask) << m_TileSizeLog2) + (static_cast<size_t>(i) & TileMask);
+}
+
 inline Uint16& ElevationDataSource::GetElevSample(Int32 i, Int32 j)
 {
-    return m_TheHeightMap[i + j * m_iStride];
+    return m_pTiles[GetSampleIndex(i, j)];
 }
 
 inline Uint16 ElevationDataSource::GetElevSample(Int32 i, Int32 j) const
 {
-    return m_TheHeightMap[i + j * m_iStride];
+    return m_pTiles[GetSampleIndex(i, j)];
 }
 
 float ElevationDataSource::GetInterpolatedHeight(float fCol, float fRow, int iStep) const
@@ -235,17 +507,27 @@ void ElevationDataSource::RecomputePatchMinMaxElevations(const QuadTreeNodeLocat
     {
         std::pair<Uint16, Uint16>& CurrPatchMinMaxElev = m_MinMaxElevation[QuadTreeNodeLocation(pos.horzOrder, pos.vertOrder, pos.level)];
 
-        int iStartCol = pos.horzOrder * m_iPatchSize;
-        int iStartRow = pos.vertOrder * m_iPatchSize;
+        // The patch includes the first row and column of the neighboring patches
+        const Uint32 StartCol = static_cast<Uint32>(pos.horzOrder * m_iPatchSize);
+        const Uint32 StartRow = static_cast<Uint32>(pos.vertOrder * m_iPatchSize);
+        const Uint32 EndCol   = std::min(StartCol + static_cast<Uint32>(m_iPatchSize), m_iNumCols - 1);
+        const Uint32 EndRow   = std::min(StartRow + static_cast<Uint32>(m_iPatchSize), m_iNumRows - 1);
+        const Uint32 TileSize = 1u << m_TileSizeLog2;
 
-        CurrPatchMinMaxElev.first = CurrPatchMinMaxElev.second = GetElevSample(iStartCol, iStartRow);
-        for (int iRow = iStartRow; iRow <= iStartRow + m_iPatchSize; iRow++)
-            for (int iCol = iStartCol; iCol <= iStartCol + m_iPatchSize; iCol++)
+        Uint16 MinElev = 0xFFFF;
+        Uint16 MaxElev = 0;
+        for (Uint32 Row = StartRow; Row <= EndRow; ++Row)
+        {
+            // Samples of a row are contiguous within a tile
+            for (Uint32 Col = StartCol; Col <= EndCol;)
             {
-                Uint16 CurrElev            = GetElevSample(std::min(iCol, (Int32)m_iNumCols - 1), std::min(iRow, (Int32)m_iNumRows - 1));
-                CurrPatchMinMaxElev.first  = std::min(CurrPatchMinMaxElev.first, CurrElev);
-                CurrPatchMinMaxElev.second = std::max(CurrPatchMinMaxElev.second, CurrElev);
+                const Uint32 NumInTile = std::min(TileSize - (Col & (TileSize - 1)), EndCol + 1 - Col);
+                ReduceMinMaxElevation(&m_pTiles[GetSampleIndex(Col, Row)], NumInTile, MinElev, MaxElev);
+                Col += NumInTile;
             }
+        }
+        CurrPatchMinMaxElev.first  = MinElev;
+        CurrPatchMinMaxElev.second = MaxElev;
     }
     else
     {
@@ -268,17 +550,148 @@ void ElevationDataSource::RecomputePatchMinMaxElevations(const QuadTreeNodeLocat
 // Calculates min/max elevations for the hierarchy
 void ElevationDataSource::CalculateMinMaxElevations()
 {
-    // Calculate min/max elevations starting from the finest level
-    for (HierarchyReverseIterator it(m_iNumLevels); it.IsValid(); it.Next())
+    NodeRange FinestLevel;
+    FinestLevel.MaxX = FinestLevel.MaxY = (1 << (m_iNumLevels - 1)) - 1;
+    RecomputeMinMaxElevations(FinestLevel);
+}
+
+void ElevationDataSource::RecomputeMinMaxElevations(NodeRange Range)
+{
+    // Levels are processed from the finest to the coarsest one. Nodes of one level
+    // only depend on the finer level and are processed in parallel.
+    for (int Level = m_iNumLevels - 1; Level >= 0; --Level)
     {
-        RecomputePatchMinMaxElevations(it);
+        const Uint32 RangeWidth = static_cast<Uint32>(Range.MaxX - Range.MinX + 1);
+        const Uint32 NumNodes   = RangeWidth * static_cast<Uint32>(Range.MaxY - Range.MinY + 1);
+
+        auto ProcessNodes = [&](Uint32 /*ThreadId*/, Uint32 /*Chunk*/, Uint32 FirstNode, Uint32 EndNode) {
+            for (Uint32 Node = FirstNode; Node < EndNode; ++Node)
+            {
+                const int NodeX = Range.MinX + static_cast<int>(Node % RangeWidth);
+                const int NodeY = Range.MinY + static_cast<int>(Node / RangeWidth);
+                RecomputePatchMinMaxElevations(QuadTreeNodeLocation{NodeX, NodeY, Level});
+            }
+        };
+
+        // A leaf patch reduces 129x129 samples, while a node of a coarser level only
+        // combines four values, so coarse levels need many more nodes per chunk.
+        const Uint32 MinNodesPerChunk = Level == m_iNumLevels - 1 ? 4 : 4096;
+        if (m_pScheduler != nullptr && NumNodes > MinNodesPerChunk)
+            m_pScheduler->ParallelFor(NumNodes, ProcessNodes, MinNodesPerChunk);
+        else
+            ProcessNodes(0, 0, 0, NumNodes);
+
+        // Parent nodes of the range
+        Range.MinX >>= 1;
+        Range.MinY >>= 1;
+        Range.MaxX >>= 1;
+        Range.MaxY >>= 1;
     }
 }
 
-void ElevationDataSource::GetDataPtr(const Uint16*& pDataPtr, size_t& Pitch)
+void ElevationDataSource::UpdateSamples(Uint32 StartCol, Uint32 StartRow, Uint32 NumCols, Uint32 NumRows, const Uint16* pSrc, size_t SrcStride)
 {
-    pDataPtr = &m_TheHeightMap[0];
-    Pitch    = m_iStride;
+    VERIFY_EXPR(StartCol + NumCols <= m_iNumCols && StartRow + NumRows <= m_iNumRows);
+    if (NumCols == 0 || NumRows == 0)
+        return;
+
+    const Uint32 TileSize = 1u << m_TileSizeLog2;
+    for (Uint32 iRow = 0; iRow < NumRows; ++iRow, pSrc += SrcStride)
+    {
+        for (Uint32 iCol = 0; iCol < NumCols;)
+        {
+            const Uint32 Col       = StartCol + iCol;
+            const Uint32 NumInTile = std::min(TileSize - (Col & (TileSize - 1)), NumCols - iCol);
+            memcpy(&m_pTiles[GetSampleIndex(Col, StartRow + iRow)], pSrc + iCol, NumInTile * sizeof(Uint16));
+            iCol += NumInTile;
+        }
+    }
+
+    // Patch p covers samples [p * PatchSize, (p + 1) * PatchSize], so a sample on the
+    // boundary belongs to two patches.
+    const int MaxPatch = (1 << (m_iNumLevels - 1)) - 1;
+
+    NodeRange Patches;
+    Patches.MinX = std::max((static_cast<int>(StartCol) + m_iPatchSize - 1) / m_iPatchSize - 1, 0);
+    Patches.MinY = std::max((static_cast<int>(StartRow) + m_iPatchSize - 1) / m_iPatchSize - 1, 0);
+    Patches.MaxX = std::min(static_cast<int>(StartCol + NumCols - 1) / m_iPatchSize, MaxPatch);
+    Patches.MaxY = std::min(static_cast<int>(StartRow + NumRows - 1) / m_iPatchSize, MaxPatch);
+
+    if (m_DirtyPatches.IsValid())
+    {
+        m_DirtyPatches.MinX = std::min(m_DirtyPatches.MinX, Patches.MinX);
+        m_DirtyPatches.MinY = std::min(m_DirtyPatches.MinY, Patches.MinY);
+        m_DirtyPatches.MaxX = std::max(m_DirtyPatches.MaxX, Patches.MaxX);
+        m_DirtyPatches.MaxY = std::max(m_DirtyPatches.MaxY, Patches.MaxY);
+    }
+    else
+    {
+        m_DirtyPatches = Patches;
+    }
+}
+
+void ElevationDataSource::RecomputeDirtyPatches()
+{
+    if (!m_DirtyPatches.IsValid())
+        return;
+
+    RecomputeMinMaxElevations(m_DirtyPatches);
+    m_DirtyPatches = {};
+}
+
+#ifdef DILIGENT_DEBUG
+// Edits a block of samples that straddles four patches, checks that recomputing the dirty
+// patches gives the same min/max hierarchy as a full rebuild and restores the samples.
+void ElevationDataSource::VerifyDirtyPatchUpdate()
+{
+    const Uint32 PatchSize = static_cast<Uint32>(m_iPatchSize);
+    if (m_iNumCols <= PatchSize * 2 || m_iNumRows <= PatchSize * 2)
+        return;
+
+    const Uint32 StartCol = m_iNumCols / PatchSize / 2 * PatchSize - PatchSize / 2;
+    const Uint32 StartRow = m_iNumRows / PatchSize / 2 * PatchSize - PatchSize / 2;
+
+    std::vector<Uint16> Original(size_t{PatchSize} * PatchSize);
+    ReadSamples(StartCol, StartRow, PatchSize, PatchSize, Original.data(), PatchSize);
+
+    // The new extremes of the block are also the global ones, so every level must be updated
+    std::vector<Uint16> Edited{Original};
+    Edited.front() = 0;
+    Edited.back()  = 0xFFFF;
+    UpdateSamples(StartCol, StartRow, PatchSize, PatchSize, Edited.data(), PatchSize);
+    VERIFY_EXPR(HasDirtyPatches());
+    RecomputeDirtyPatches();
+
+    const auto* pMinMax     = &m_MinMaxElevation[QuadTreeNodeLocation{}];
+    const auto  NumElements = HierarchyArray<std::pair<Uint16, Uint16>>::GetNumElements(m_iNumLevels);
+
+    const std::vector<std::pair<Uint16, Uint16>> IncrementalMinMax(pMinMax, pMinMax + NumElements);
+    CalculateMinMaxElevations();
+    VERIFY(std::equal(IncrementalMinMax.begin(), IncrementalMinMax.end(), pMinMax),
+           "Recomputing the dirty patches gives a different min/max elevation hierarchy than a full rebuild");
+
+    UpdateSamples(StartCol, StartRow, PatchSize, PatchSize, Original.data(), PatchSize);
+    RecomputeDirtyPatches();
+}
+#endif
+
+void ElevationDataSource::ReadSamples(Uint32 StartCol, Uint32 StartRow, Uint32 NumCols, Uint32 NumRows, Uint16* pDst, size_t DstStride) const
+{
+    VERIFY_EXPR(StartCol + NumCols <= m_iNumCols && StartRow + NumRows <= m_iNumRows);
+
+    const Uint32 TileSize = 1u << m_TileSizeLog2;
+    for (Uint32 iRow = 0; iRow < NumRows; ++iRow, pDst += DstStride)
+    {
+        // Copy the row one tile at a time
+        for (Uint32 iCol = 0; iCol < NumCols;)
+        {
+            const Uint32 Col       = StartCol + iCol;
+            const Uint32 NumInTile = std::min(TileSize - (Col & (TileSize - 1)), NumCols - iCol);
+            const auto*  pTileSpan = &m_pTiles[GetSampleIndex(Col, StartRow + iRow)];
+            memcpy(pDst + iCol, pTileSpan, NumInTile * sizeof(Uint16));
+            iCol += NumInTile;
+        }
+    }
 }
 
 } // namespace Diligent
@@ -50,19 +50,33 @@
 #include "BasicMath.hpp"
 #include "HierarchyArray.hpp"
 #include "DynamicQuadTreeNode.hpp"
+#include "MappedFile.hpp"
+#include "TaskScheduler.hpp"
 
 namespace Diligent
 {
 
-// Class implementing elevation data source
+// Class implementing elevation data source.
+//
+// Elevation samples are stored in square tiles, and the data source is normally backed by
+// a memory-mapped tiled elevation file (.dteh), so that even very large height maps open
+// instantly and only the tiles that are accessed become resident. The file also contains
+// the min/max elevation hierarchy, so it does not need to be computed at startup.
 class ElevationDataSource
 {
 public:
-    // Creates data source from the specified raw data file
-    ElevationDataSource(const Char* strSrcDemFile);
+    // Creates data source from the specified file, which is either a tiled elevation file
+    // or a 16-bit single-channel image. An image is converted to the tiled format once,
+    // and the result is saved next to the image (e.g. HeightMap.tif.dteh) to be mapped
+    // next time. The tiled file records the size and a hash of the image contents, and the
+    // image is converted again if it has changed since.
+    // If the scheduler is not null, min/max elevations are computed in parallel.
+    ElevationDataSource(const Char* strSrcDemFile, TaskScheduler* pScheduler = nullptr);
     virtual ~ElevationDataSource(void);
 
-    void GetDataPtr(const Uint16*& pDataPtr, size_t& Pitch);
+    // Copies NumCols x NumRows samples starting at (StartCol, StartRow) to pDst, which has
+    // DstStride samples per row.
+    void ReadSamples(Uint32 StartCol, Uint32 StartRow, Uint32 NumCols, Uint32 NumRows, Uint16* pDst, size_t DstStride) const;
 
     // Returns minimal height of the whole terrain
     Uint16 GetGlobalMinElevation() const;
@@ -72,6 +86,16 @@ public:
 
     void RecomputePatchMinMaxElevations(const QuadTreeNodeLocation& pos);
 
+    // Overwrites NumCols x NumRows samples starting at (StartCol, StartRow) with the data
+    // from pSrc, which has SrcStride samples per row, and marks the affected patches dirty.
+    // The changes are never written back to the tiled elevation file.
+    void UpdateSamples(Uint32 StartCol, Uint32 StartRow, Uint32 NumCols, Uint32 NumRows, const Uint16* pSrc, size_t SrcStride);
+
+    // Recomputes min/max elevations of the dirty patches and their ancestors only
+    void RecomputeDirtyPatches();
+
+    bool HasDirtyPatches() const { return m_DirtyPatches.IsValid(); }
+
     void SetOffsets(int iColOffset, int iRowOffset)
     {
         m_iColOffset = iColOffset;
@@ -90,13 +114,55 @@ public:
     unsigned int GetNumCols() const { return m_iNumCols; }
     unsigned int GetNumRows() const { return m_iNumRows; }
 
+    // Returns true if the data is memory-mapped from a tiled elevation file
+    bool IsMapped() const { return m_TiledFile.IsMapped(); }
+
 private:
     inline Uint16  GetElevSample(Int32 i, Int32 j) const;
     inline Uint16& GetElevSample(Int32 i, Int32 j);
 
+    inline size_t GetSampleIndex(Int32 i, Int32 j) const;
+
+    // Size and hash of the contents of the image a tiled file is converted from
+    struct SourceFileInfo
+    {
+        Uint64 Size = 0;
+        Uint64 Hash = 0;
+    };
+    static bool GetSourceFileInfo(const Char* Path, SourceFileInfo& Info);
+
+    // Opens tiled elevation file. Returns false if the file does not exist or is invalid.
+    // If pSource is not null, also returns false if the file was converted from a different image.
+    bool OpenTiledFile(const Char* Path, const SourceFileInfo* pSource = nullptr);
+
+    // Loads the image and converts it to the tiled format in memory
+    void ImportImage(const Char* Path);
+
+    void SaveTiledFile(const Char* Path, const SourceFileInfo& Source);
+
+    // Initializes the data source from the contents of a tiled elevation file
+    void AttachTiledData(Uint8* pData);
+
     // Calculates min/max elevations for all patches in the tree
     void CalculateMinMaxElevations();
 
+    // Inclusive range of quad tree nodes of one level
+    struct NodeRange
+    {
+        int MinX = 0, MinY = 0;
+        int MaxX = -1, MaxY = -1;
+
+        bool IsValid() const { return MinX <= MaxX && MinY <= MaxY; }
+    };
+
+    // Recomputes min/max elevations of the nodes in the range and all their ancestors
+    void RecomputeMinMaxElevations(NodeRange Range);
+
+#ifdef DILIGENT_DEBUG
+    // Checks that an incremental update of the min/max elevations matches a full rebuild
+    void VerifyDirtyPatchUpdate();
+#endif
+
     // Hierarchy array storing minimal and maximal heights for quad tree nodes
     HierarchyArray<std::pair<Uint16, Uint16>> m_MinMaxElevation;
 
@@ -104,9 +170,22 @@ private:
     int m_iPatchSize;
     int m_iColOffset, m_iRowOffset;
 
-    // The whole terrain height map
-    std::vector<Uint16> m_TheHeightMap;
-    Uint32              m_iNumCols, m_iNumRows, m_iStride;
+    // Memory-mapped tiled elevation file
+    MappedFile m_TiledFile;
+    // Tiled elevation data converted from an image
+    std::vector<Uint8> m_ImportedData;
+
+    // Square tiles of (1 << m_TileSizeLog2) samples per side. Tiles and samples in a tile are stored in row-major order.
+    Uint16* m_pTiles       = nullptr;
+    Uint32  m_TileSizeLog2 = 0;
+    Uint32  m_NumTilesX    = 0;
+
+    Uint32 m_iNumCols, m_iNumRows;
+
+    TaskScheduler* m_pScheduler = nullptr;
+
+    // Leaf patches whose samples were updated since the last RecomputeDirtyPatches()
+    NodeRange m_DirtyPatches;
 };
 
 } // namespace Diligent
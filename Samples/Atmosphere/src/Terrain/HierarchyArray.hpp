@@ -52,40 +52,59 @@ namespace Diligent
 {
 
 // Template class implementing hierarchy array, which is a quad tree indexed by
-// quad tree node location
+// quad tree node location. All levels are stored in a single array, starting
+// from the coarsest one, so that the hierarchy can be saved to and used directly
+// from a file.
 template <class T>
 class HierarchyArray
 {
 public:
     T& operator[](const QuadTreeNodeLocation& at)
     {
-        return m_data[at.level][at.horzOrder + (at.vertOrder << at.level)];
+        return m_pData[GetLevelOffset(at.level) + at.horzOrder + (static_cast<size_t>(at.vertOrder) << at.level)];
     }
     const T& operator[](const QuadTreeNodeLocation& at) const
     {
-        return m_data[at.level][at.horzOrder + (at.vertOrder << at.level)];
+        return m_pData[GetLevelOffset(at.level) + at.horzOrder + (static_cast<size_t>(at.vertOrder) << at.level)];
     }
 
     void Resize(size_t numLevelsInHierarchy)
     {
-        m_data.resize(numLevelsInHierarchy);
-        if (numLevelsInHierarchy)
-        {
-            for (size_t level = numLevelsInHierarchy; level--;)
-            {
-                size_t numElementsInLevel = (size_t)1 << level;
-                m_data[level].resize(numElementsInLevel * numElementsInLevel);
-            }
-        }
+        m_data.resize(GetNumElements(numLevelsInHierarchy));
+        m_pData     = m_data.data();
+        m_numLevels = numLevelsInHierarchy;
+    }
+
+    // Uses external storage of GetNumElements(numLevelsInHierarchy) elements,
+    // e.g. a memory-mapped file. The storage must outlive the array.
+    void Attach(T* pData, size_t numLevelsInHierarchy)
+    {
+        m_data.clear();
+        m_data.shrink_to_fit();
+        m_pData     = pData;
+        m_numLevels = numLevelsInHierarchy;
     }
 
     bool Empty() const
     {
-        return m_data.empty();
+        return m_numLevels == 0;
+    }
+
+    // Index of the first element of the level: 1 + 4 + ... + 4^(level-1)
+    static size_t GetLevelOffset(size_t level)
+    {
+        return ((size_t{1} << (2 * level)) - 1) / 3;
+    }
+
+    static size_t GetNumElements(size_t numLevelsInHierarchy)
+    {
+        return GetLevelOffset(numLevelsInHierarchy);
     }
 
 private:
-    std::vector<std::vector<T>> m_data;
+    std::vector<T> m_data;
+    T*             m_pData     = nullptr;
+    size_t         m_numLevels = 0;
 };
 
 } // namespace Diligent
@@ -0,0 +1,248 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#include "AsyncModelLoader.hpp"
+
+#include <exception>
+#include <vector>
+#include <algorithm>
+
+#include "DebugUtilities.hpp"
+#include "GLTFBaker.hpp"
+#include "MappedFile.hpp"
+
+namespace Diligent
+{
+
+AsyncModelLoader::AsyncModelLoader(IRenderDevice*              pDevice,
+                                   const char*                 FileName,
+                                   GLTF::ResourceCacheUseInfo* pCacheInfo,
+                                   const char*                 BakedCacheDir) :
+    // clang-format off
+    m_pDevice      {pDevice},
+    m_FileName     {FileName},
+    m_pCacheInfo   {pCacheInfo},
+    m_BakedCacheDir{BakedCacheDir != nullptr ? BakedCacheDir : ""},
+    m_StartTime    {std::chrono::high_resolution_clock::now()}
+// clang-format on
+{
+    // Relative weights of the stages. Decoding the textures dominates the load unless the model is
+    // baked, which in turn takes most of the time on the first load.
+    float Weights[static_cast<size_t>(Stage::Count)] = {};
+    Weights[static_cast<size_t>(Stage::Baking)]      = m_BakedCacheDir.empty() ? 0.f : 4.f;
+    Weights[static_cast<size_t>(Stage::Reading)]     = 1.f;
+    Weights[static_cast<size_t>(Stage::Decoding)]    = m_BakedCacheDir.empty() ? 7.f : 3.f;
+    Weights[static_cast<size_t>(Stage::Uploading)]   = 1.f;
+
+    float TotalWeight = 0;
+    for (auto Weight : Weights)
+        TotalWeight += Weight;
+    for (size_t i = 0; i < static_cast<size_t>(Stage::Count); ++i)
+        m_StageStart[i + 1] = m_StageStart[i] + Weights[i] / TotalWeight;
+
+    m_Stage.store(m_BakedCacheDir.empty() ? Stage::Reading : Stage::Baking);
+
+    m_Thread = std::thread{&AsyncModelLoader::ThreadProc, this};
+}
+
+AsyncModelLoader::~AsyncModelLoader()
+{
+    Cancel();
+    if (m_Thread.joinable())
+        m_Thread.join();
+}
+
+void AsyncModelLoader::ThreadProc()
+{
+    std::unique_ptr<GLTF::Model> pModel;
+
+    std::string FilePath = m_FileName;
+    if (!m_BakedCacheDir.empty() && !m_CancelRequested.load())
+    {
+        FilePath = GetBakedGLTFModel(m_FileName.c_str(), m_BakedCacheDir.c_str(),
+                                     [this](float Fraction) { SetStageProgress(Fraction); });
+    }
+
+    if (!m_CancelRequested.load())
+    {
+        BeginStage(Stage::Reading);
+        ReadFiles(FilePath);
+    }
+
+    if (!m_CancelRequested.load())
+    {
+        BeginStage(Stage::Decoding);
+
+        GLTF::Model::CreateInfo ModelCI;
+        ModelCI.FileName   = FilePath.c_str();
+        ModelCI.pCacheInfo = m_pCacheInfo;
+        try
+        {
+            // Without a device context the loader only creates the GPU objects, which is
+            // thread-safe, and keeps the initial data until PrepareGPUResources() is called.
+            pModel.reset(new GLTF::Model{m_pDevice, nullptr, ModelCI});
+        }
+        catch (const std::exception& e)
+        {
+            m_ErrorMessage = e.what();
+        }
+        catch (...)
+        {
+            m_ErrorMessage = "unknown error";
+        }
+    }
+
+    Status NewStatus = Status::Cancelled;
+    if (m_CancelRequested.load())
+    {
+        // Release the model on this thread rather than the UI thread
+        pModel.reset();
+    }
+    else if (pModel)
+    {
+        m_Model   = std::move(pModel);
+        NewStatus = Status::Loaded;
+        BeginStage(Stage::Uploading);
+    }
+    else
+    {
+        NewStatus = Status::Failed;
+    }
+
+    // Cancel() may have changed the status in the meantime, so only move forward from Loading
+    auto Expected = Status::Loading;
+    m_Status.compare_exchange_strong(Expected, NewStatus);
+    m_ThreadFinished.store(true);
+}
+
+void AsyncModelLoader::Cancel()
+{
+    m_CancelRequested.store(true);
+
+    auto Expected = Status::Loading;
+    if (!m_Status.compare_exchange_strong(Expected, Status::Cancelled))
+    {
+        Expected = Status::Loaded;
+        m_Status.compare_exchange_strong(Expected, Status::Cancelled);
+    }
+}
+
+void AsyncModelLoader::ReadFiles(const std::string& FilePath)
+{
+    // The files are read into the OS file cache, so that the time spent on I/O is reported as
+    // a stage of its own and the loader then reads them from memory.
+    std::vector<std::string> Paths{FilePath};
+    GetGLTFReferencedFiles(FilePath.c_str(), Paths);
+
+    std::vector<MappedFile> Files(Paths.size());
+    size_t                  TotalSize = 0;
+    for (size_t i = 0; i < Paths.size(); ++i)
+    {
+        if (Files[i].Open(Paths[i].c_str()))
+            TotalSize += Files[i].GetSize();
+    }
+
+    // Mapped files are only read when their pages are touched
+    static constexpr size_t PageSize  = 4096;
+    static constexpr size_t BlockSize = size_t{1} << 20;
+
+    size_t BytesRead = 0;
+    Uint8  Sum       = 0;
+    for (auto& File : Files)
+    {
+        if (!File.IsMapped())
+        {
+            BytesRead += File.GetSize();
+            continue;
+        }
+
+        const auto* pData = static_cast<const volatile Uint8*>(File.GetData());
+        for (size_t BlockStart = 0; BlockStart < File.GetSize() && !m_CancelRequested.load(); BlockStart += BlockSize)
+        {
+            const auto BlockEnd = std::min(BlockStart + BlockSize, File.GetSize());
+            for (size_t Offset = BlockStart; Offset < BlockEnd; Offset += PageSize)
+                Sum += pData[Offset];
+
+            BytesRead += BlockEnd - BlockStart;
+            SetStageProgress(static_cast<float>(BytesRead) / static_cast<float>(TotalSize));
+        }
+        File.Close();
+    }
+    (void)Sum;
+}
+
+void AsyncModelLoader::BeginStage(Stage NewStage)
+{
+    m_Stage.store(NewStage);
+    SetStageProgress(0);
+}
+
+void AsyncModelLoader::SetStageProgress(float Fraction)
+{
+    const auto StageIdx = static_cast<size_t>(m_Stage.load());
+    const auto Progress = m_StageStart[StageIdx] + (m_StageStart[StageIdx + 1] - m_StageStart[StageIdx]) * std::min(std::max(Fraction, 0.f), 1.f);
+
+    auto CurrProgress = m_Progress.load();
+    while (CurrProgress < Progress && !m_Progress.compare_exchange_weak(CurrProgress, Progress))
+    {
+    }
+}
+
+const char* AsyncModelLoader::GetStageName(Stage LoadStage)
+{
+    switch (LoadStage)
+    {
+        case Stage::Baking: return "Baking";
+        case Stage::Reading: return "Reading";
+        case Stage::Decoding: return "Decoding";
+        case Stage::Uploading: return "Uploading";
+        default: return "";
+    }
+}
+
+double AsyncModelLoader::GetElapsedTime() const
+{
+    const auto CurrTime = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::duration<double>>(CurrTime - m_StartTime).count();
+}
+
+std::unique_ptr<GLTF::Model> AsyncModelLoader::Finalize(IDeviceContext* pContext)
+{
+    if (m_Status.load() != Status::Loaded)
+    {
+        UNEXPECTED("The model is not loaded");
+        return nullptr;
+    }
+
+    VERIFY_EXPR(m_Model);
+    m_Model->PrepareGPUResources(m_pDevice, pContext);
+    SetStageProgress(1);
+    m_Status.store(Status::Ready);
+    return std::move(m_Model);
+}
+
+} // namespace Diligent
@@ -0,0 +1,164 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "RefCntAutoPtr.hpp"
+#include "GLTFLoader.hpp"
+
+namespace Diligent
+{
+
+/// Loads a GLTF model on a background thread.
+
+/// The loader thread parses the file, decodes the textures and processes vertex and index data
+/// without a device context, so the UI thread keeps rendering while it runs. Once the CPU side
+/// is done, the owner calls Finalize() on the thread that owns the immediate context to upload
+/// the data to the GPU. The load may be cancelled at any time; a cancelled loader discards
+/// the model as soon as the loader thread finishes.
+class AsyncModelLoader
+{
+public:
+    enum class Status : Uint32
+    {
+        /// The loader thread is reading and processing the model.
+        Loading,
+
+        /// CPU data is ready and the model waits for Finalize().
+        Loaded,
+
+        /// Finalize() has uploaded the data and returned the model.
+        Ready,
+
+        Cancelled,
+        Failed
+    };
+
+    /// Stages of the load, in the order they run.
+    enum class Stage : Uint32
+    {
+        /// Hashing and baking the referenced files. Only runs when a baked cache directory is used.
+        Baking,
+
+        /// Reading the glTF file and the files it references.
+        Reading,
+
+        /// Decoding the textures, processing the vertex data and creating the GPU objects.
+        Decoding,
+
+        /// Uploading the data to the GPU. Starts when Finalize() is called.
+        Uploading,
+
+        Count
+    };
+
+    /// pCacheInfo must stay valid until the loader finishes or is destroyed.
+    /// If BakedCacheDir is not null, the model is loaded from a baked copy in this directory,
+    /// see GetBakedGLTFModel().
+    AsyncModelLoader(IRenderDevice*              pDevice,
+                     const char*                 FileName,
+                     GLTF::ResourceCacheUseInfo* pCacheInfo,
+                     const char*                 BakedCacheDir = nullptr);
+
+    /// Waits for the loader thread to finish.
+    ~AsyncModelLoader();
+
+    // clang-format off
+    AsyncModelLoader           (const AsyncModelLoader&)  = delete;
+    AsyncModelLoader           (      AsyncModelLoader&&) = delete;
+    AsyncModelLoader& operator=(const AsyncModelLoader&)  = delete;
+    AsyncModelLoader& operator=(      AsyncModelLoader&&) = delete;
+    // clang-format on
+
+    /// Requests cancellation. The loader thread can't interrupt the loader in the middle
+    /// of a file, so it may keep running for a while, but the model will never be returned.
+    void Cancel();
+
+    Status GetStatus() const { return m_Status.load(); }
+
+    /// Returns true when the loader thread has exited and the object can be destroyed without blocking.
+    bool IsThreadFinished() const { return m_ThreadFinished.load(); }
+
+    Stage GetStage() const { return m_Stage.load(); }
+
+    static const char* GetStageName(Stage LoadStage);
+
+    /// Progress in [0, 1]. Every stage covers a fixed part of the range. Baking and reading
+    /// advance with every file, decoding only advances when it is complete.
+    float GetProgress() const { return m_Progress.load(); }
+
+    /// Time since the load was started, in seconds.
+    double GetElapsedTime() const;
+
+    const std::string& GetFileName() const { return m_FileName; }
+    const std::string& GetErrorMessage() const { return m_ErrorMessage; }
+
+    /// Uploads the model data through pContext and returns the model.
+    /// Must only be called when the status is Status::Loaded.
+    std::unique_ptr<GLTF::Model> Finalize(IDeviceContext* pContext);
+
+private:
+    void ThreadProc();
+    void ReadFiles(const std::string& FilePath);
+
+    /// Sets the progress to the given fraction of the current stage. The progress never goes back,
+    /// so the fraction may be reported from several threads.
+    void SetStageProgress(float Fraction);
+    void BeginStage(Stage NewStage);
+
+    RefCntAutoPtr<IRenderDevice>      m_pDevice;
+    const std::string                 m_FileName;
+    GLTF::ResourceCacheUseInfo* const m_pCacheInfo;
+    const std::string                 m_BakedCacheDir;
+
+    const std::chrono::high_resolution_clock::time_point m_StartTime;
+
+    std::atomic<Status> m_Status{Status::Loading};
+    std::atomic<Stage>  m_Stage{Stage::Reading};
+    std::atomic<float>  m_Progress{0};
+
+    // Start of every stage in the progress range, the last element is the end of the range
+    float m_StageStart[static_cast<size_t>(Stage::Count) + 1] = {};
+    std::atomic<bool>   m_CancelRequested{false};
+    std::atomic<bool>   m_ThreadFinished{false};
+
+    // Written by the loader thread before the status changes to Loaded or Failed
+    std::unique_ptr<GLTF::Model> m_Model;
+    std::string                  m_ErrorMessage;
+
+    std::thread m_Thread;
+};
+
+} // namespace Diligent
@@ -0,0 +1,539 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#include "GLTFBaker.hpp"
+
+#include <cctype>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+#include "DebugUtilities.hpp"
+#include "Errors.hpp"
+#include "FileSystem.hpp"
+#include "FileWrapper.hpp"
+#include "RefCntAutoPtr.hpp"
+#include "Image.h"
+#include "MappedFile.hpp"
+#include "MipGenerator.hpp"
+#include "TaskScheduler.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Increment when the baked layout changes to invalidate existing copies
+constexpr Uint64 BakedFormatVersion = 1;
+
+constexpr Uint64 FNVOffsetBasis = 0xCBF29CE484222325ull;
+
+struct DDSPixelFormat
+{
+    Uint32 Size        = sizeof(DDSPixelFormat);
+    Uint32 Flags       = 0x41; // DDPF_RGB | DDPF_ALPHAPIXELS
+    Uint32 FourCC      = 0;
+    Uint32 RGBBitCount = 32;
+    Uint32 RBitMask    = 0x000000FF;
+    Uint32 GBitMask    = 0x0000FF00;
+    Uint32 BBitMask    = 0x00FF0000;
+    Uint32 ABitMask    = 0xFF000000;
+};
+static_assert(sizeof(DDSPixelFormat) == 32, "DDS pixel format size must be 32 bytes");
+
+// Legacy DDS header describing an RGBA8 texture with a mip chain. DDS loaders map these masks to R8G8B8A8_UNORM.
+struct DDSHeader
+{
+    Uint32         Size              = sizeof(DDSHeader);
+    Uint32         Flags             = 0x2100F; // CAPS | HEIGHT | WIDTH | PITCH | PIXELFORMAT | MIPMAPCOUNT
+    Uint32         Height            = 0;
+    Uint32         Width             = 0;
+    Uint32         PitchOrLinearSize = 0;
+    Uint32         Depth             = 0;
+    Uint32         MipMapCount       = 0;
+    Uint32         Reserved1[11]     = {};
+    DDSPixelFormat PixelFormat;
+    Uint32         Caps      = 0x401008; // TEXTURE | MIPMAP | COMPLEX
+    Uint32         Caps2     = 0;
+    Uint32         Caps3     = 0;
+    Uint32         Caps4     = 0;
+    Uint32         Reserved2 = 0;
+};
+static_assert(sizeof(DDSHeader) == 124, "DDS header size must be 124 bytes");
+
+constexpr Uint32 DDSMagic = 0x20534444; // 'DDS '
+
+Uint64 HashBytes(const void* pData, size_t Size, Uint64 Hash)
+{
+    // 64-bit FNV-1a
+    const auto* pBytes = static_cast<const Uint8*>(pData);
+    for (size_t i = 0; i < Size; ++i)
+    {
+        Hash ^= pBytes[i];
+        Hash *= 0x100000001B3ull;
+    }
+    return Hash;
+}
+
+// A "uri" string value in the glTF JSON
+struct UriRef
+{
+    // Range of the string contents, without quotes
+    size_t Begin = 0;
+    size_t End   = 0;
+
+    std::string Uri;
+};
+
+// Finds all "uri" properties. Returns false if a value uses escape sequences
+// that this simple scanner does not handle.
+bool FindUris(const std::string& Json, std::vector<UriRef>& Uris)
+{
+    static constexpr char UriKey[] = "\"uri\"";
+
+    size_t Pos = 0;
+    while ((Pos = Json.find(UriKey, Pos)) != std::string::npos)
+    {
+        Pos += sizeof(UriKey) - 1;
+        while (Pos < Json.size() && isspace(static_cast<unsigned char>(Json[Pos])))
+            ++Pos;
+        if (Pos >= Json.size() || Json[Pos] != ':')
+            continue;
+        ++Pos;
+        while (Pos < Json.size() && isspace(static_cast<unsigned char>(Json[Pos])))
+            ++Pos;
+        if (Pos >= Json.size() || Json[Pos] != '"')
+            continue;
+
+        UriRef Ref;
+        Ref.Begin = ++Pos;
+        while (Pos < Json.size() && Json[Pos] != '"')
+        {
+            if (Json[Pos] == '\\')
+            {
+                if (Pos + 1 >= Json.size())
+                    return false;
+                const auto c = Json[Pos + 1];
+                if (c != '/' && c != '\\' && c != '"')
+                    return false;
+                Ref.Uri.push_back(c);
+                Pos += 2;
+            }
+            else
+            {
+                Ref.Uri.push_back(Json[Pos++]);
+            }
+        }
+        if (Pos >= Json.size())
+            return false;
+        Ref.End = Pos++;
+
+        Uris.emplace_back(std::move(Ref));
+    }
+    return true;
+}
+
+int HexDigitValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// glTF URIs are percent-encoded, e.g. spaces are written as %20
+std::string DecodeUri(const std::string& Uri)
+{
+    std::string Decoded;
+    Decoded.reserve(Uri.size());
+    for (size_t i = 0; i < Uri.size(); ++i)
+    {
+        if (Uri[i] == '%' && i + 2 < Uri.size())
+        {
+            const auto Hi = HexDigitValue(Uri[i + 1]);
+            const auto Lo = HexDigitValue(Uri[i + 2]);
+            if (Hi >= 0 && Lo >= 0)
+            {
+                Decoded.push_back(static_cast<char>(Hi * 16 + Lo));
+                i += 2;
+                continue;
+            }
+        }
+        Decoded.push_back(Uri[i]);
+    }
+    return Decoded;
+}
+
+// Referenced files are relative to the directory of the glTF file
+std::string GetReferencedFilePath(const std::string& SrcDir, const std::string& Uri)
+{
+    return SrcDir.empty() ? DecodeUri(Uri) : SrcDir + '/' + DecodeUri(Uri);
+}
+
+std::string GetLowerCaseExtension(const std::string& Path)
+{
+    const auto DotPos = Path.find_last_of('.');
+    if (DotPos == std::string::npos || Path.find_first_of("/\\", DotPos) != std::string::npos)
+        return "";
+
+    auto Ext = Path.substr(DotPos);
+    std::transform(Ext.begin(), Ext.end(), Ext.begin(), [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+    return Ext;
+}
+
+bool WriteFile(const std::string& Path, const void* pData, size_t Size)
+{
+    FileWrapper pFile{Path.c_str(), EFileAccessMode::Overwrite};
+    if (!pFile)
+    {
+        LOG_ERROR_MESSAGE("Failed to create file '", Path, "'");
+        return false;
+    }
+    if (!pFile->Write(pData, Size))
+    {
+        LOG_ERROR_MESSAGE("Failed to write file '", Path, "'");
+        return false;
+    }
+    return true;
+}
+
+bool CopyFileContents(const std::string& SrcPath, const std::string& DstPath)
+{
+    MappedFile SrcFile;
+    if (!SrcFile.Open(SrcPath.c_str()))
+    {
+        LOG_ERROR_MESSAGE("Failed to open file '", SrcPath, "'");
+        return false;
+    }
+    return WriteFile(DstPath, SrcFile.GetData(), SrcFile.GetSize());
+}
+
+// Decodes the image and writes it as an RGBA8 DDS file with a full mip chain
+bool BakeImage(const std::string& SrcPath, const std::string& DstPath)
+{
+    RefCntAutoPtr<Image> pImage;
+    CreateImageFromFile(SrcPath.c_str(), &pImage);
+    if (!pImage)
+        return false;
+
+    const auto& ImgDesc = pImage->GetDesc();
+    if ((ImgDesc.ComponentType != VT_UINT8 && ImgDesc.ComponentType != VT_UINT16) ||
+        ImgDesc.NumComponents < 1 || ImgDesc.NumComponents > 4 ||
+        ImgDesc.Width == 0 || ImgDesc.Height == 0)
+        return false;
+
+    Uint32 NumMipLevels = 1;
+    while ((std::max(ImgDesc.Width, ImgDesc.Height) >> NumMipLevels) != 0)
+        ++NumMipLevels;
+
+    size_t DataSize = sizeof(DDSMagic) + sizeof(DDSHeader);
+    for (Uint32 mip = 0; mip < NumMipLevels; ++mip)
+        DataSize += size_t{std::max(ImgDesc.Width >> mip, 1u)} * std::max(ImgDesc.Height >> mip, 1u) * 4;
+
+    std::vector<Uint8> Data(DataSize);
+
+    DDSHeader Header;
+    Header.Width             = ImgDesc.Width;
+    Header.Height            = ImgDesc.Height;
+    Header.PitchOrLinearSize = ImgDesc.Width * 4;
+    Header.MipMapCount       = NumMipLevels;
+    memcpy(Data.data(), &DDSMagic, sizeof(DDSMagic));
+    memcpy(Data.data() + sizeof(DDSMagic), &Header, sizeof(Header));
+
+    // Expand the image to RGBA8. 16-bit images keep the most significant byte.
+    auto* const       pLevel0     = Data.data() + sizeof(DDSMagic) + sizeof(DDSHeader);
+    const auto* const pSrcData    = static_cast<const Uint8*>(pImage->GetData()->GetDataPtr());
+    const Uint32      SrcCompSize = ImgDesc.ComponentType == VT_UINT16 ? 2 : 1;
+    const Uint32      SrcByteOff  = SrcCompSize - 1;
+    for (Uint32 y = 0; y < ImgDesc.Height; ++y)
+    {
+        const auto* pSrcRow = pSrcData + size_t{y} * ImgDesc.RowStride;
+        auto*       pDstRow = pLevel0 + size_t{y} * ImgDesc.Width * 4;
+        for (Uint32 x = 0; x < ImgDesc.Width; ++x)
+        {
+            const auto* pSrc = pSrcRow + size_t{x} * ImgDesc.NumComponents * SrcCompSize + SrcByteOff;
+            auto*       pDst = pDstRow + size_t{x} * 4;
+            switch (ImgDesc.NumComponents)
+            {
+                case 1:
+                    pDst[0] = pDst[1] = pDst[2] = pSrc[0];
+                    pDst[3]                     = 255;
+                    break;
+
+                case 2:
+                    pDst[0] = pDst[1] = pDst[2] = pSrc[0];
+                    pDst[3]                     = pSrc[SrcCompSize];
+                    break;
+
+                case 3:
+                    pDst[0] = pSrc[0];
+                    pDst[1] = pSrc[SrcCompSize];
+                    pDst[2] = pSrc[SrcCompSize * 2];
+                    pDst[3] = 255;
+                    break;
+
+                case 4:
+                    pDst[0] = pSrc[0];
+                    pDst[1] = pSrc[SrcCompSize];
+                    pDst[2] = pSrc[SrcCompSize * 2];
+                    pDst[3] = pSrc[SrcCompSize * 3];
+                    break;
+            }
+        }
+    }
+
+    std::vector<MipLevelData> MipLevels(NumMipLevels - 1);
+    auto*                     pMipData = pLevel0 + size_t{ImgDesc.Width} * ImgDesc.Height * 4;
+    for (Uint32 mip = 1; mip < NumMipLevels; ++mip)
+    {
+        const auto MipWidth  = std::max(ImgDesc.Width >> mip, 1u);
+        const auto MipHeight = std::max(ImgDesc.Height >> mip, 1u);
+
+        MipLevels[mip - 1].pData  = pMipData;
+        MipLevels[mip - 1].Stride = size_t{MipWidth} * 4;
+        pMipData += size_t{MipWidth} * MipHeight * 4;
+    }
+    VERIFY_EXPR(pMipData == Data.data() + Data.size());
+
+    GenerateMipsAttribs MipsAttribs;
+    MipsAttribs.Width         = ImgDesc.Width;
+    MipsAttribs.Height        = ImgDesc.Height;
+    MipsAttribs.ComponentType = VT_UINT8;
+    MipsAttribs.NumComponents = 4;
+    MipsAttribs.pLevel0Data   = pLevel0;
+    MipsAttribs.Level0Stride  = size_t{ImgDesc.Width} * 4;
+    MipsAttribs.NumMipLevels  = NumMipLevels;
+    MipsAttribs.pMipLevels    = MipLevels.data();
+    GenerateMips(MipsAttribs);
+
+    return WriteFile(DstPath, Data.data(), Data.size());
+}
+
+struct BakedFile
+{
+    std::string SrcPath;
+    std::string BakedName;
+    bool        IsImage     = false;
+    Uint64      ContentHash = 0;
+};
+
+} // namespace
+
+std::string GetBakedGLTFModel(const Char*                        FilePath,
+                              const Char*                        CacheDir,
+                              const std::function<void(float)>& ProgressCallback)
+{
+    VERIFY_EXPR(FilePath != nullptr && CacheDir != nullptr);
+
+    std::string Json;
+    {
+        MappedFile SrcFile;
+        if (!SrcFile.Open(FilePath))
+        {
+            // Let the loader report the error
+            return FilePath;
+        }
+        Json.assign(static_cast<const char*>(SrcFile.GetData()), SrcFile.GetSize());
+    }
+
+    if (Json.compare(0, 4, "glTF") == 0)
+    {
+        LOG_INFO_MESSAGE("Binary glTF file '", FilePath, "' is loaded without baking");
+        return FilePath;
+    }
+
+    std::vector<UriRef> Uris;
+    if (!FindUris(Json, Uris))
+    {
+        LOG_WARNING_MESSAGE("Unable to parse URIs in '", FilePath, "'. The model will be loaded without baking.");
+        return FilePath;
+    }
+
+    std::string SrcDir, SrcFileName;
+    FileSystem::GetPathComponents(FilePath, &SrcDir, &SrcFileName);
+    const auto ModelName = SrcFileName.substr(0, SrcFileName.find_last_of('.'));
+
+    Uint64 Hash = HashBytes(&BakedFormatVersion, sizeof(BakedFormatVersion), FNVOffsetBasis);
+    Hash        = HashBytes(Json.data(), Json.size(), Hash);
+
+    // Every referenced file is baked once, even if several objects use it
+    std::vector<BakedFile>                  Files;
+    std::unordered_map<std::string, size_t> UriToFile;
+    for (const auto& Ref : Uris)
+    {
+        // Embedded data is left in the JSON
+        if (Ref.Uri.compare(0, 5, "data:") == 0 || UriToFile.find(Ref.Uri) != UriToFile.end())
+            continue;
+
+        BakedFile File;
+        File.SrcPath = GetReferencedFilePath(SrcDir, Ref.Uri);
+
+        const auto Ext = GetLowerCaseExtension(File.SrcPath);
+        File.IsImage   = Ext == ".png" || Ext == ".jpg" || Ext == ".jpeg";
+        File.BakedName = (File.IsImage ? "image" : "file") + std::to_string(Files.size()) + (File.IsImage ? ".dds" : Ext);
+
+        UriToFile.emplace(Ref.Uri, Files.size());
+        Files.emplace_back(std::move(File));
+    }
+    const auto NumFiles = static_cast<Uint32>(Files.size());
+
+    // The calling thread also executes tasks, so the pool never has more threads than cores
+    TaskScheduler Scheduler{std::max(std::min(std::thread::hardware_concurrency(), NumFiles), 1u) - 1};
+
+    // Every file is hashed and then baked, which is two steps of work per file
+    std::atomic<Uint32> NumStepsDone{0};
+    const auto          CompleteSteps = [&](Uint32 NumSteps) {
+        const auto StepsDone = NumStepsDone.fetch_add(NumSteps) + NumSteps;
+        if (ProgressCallback)
+            ProgressCallback(NumFiles > 0 ? static_cast<float>(StepsDone) / static_cast<float>(NumFiles * 2) : 1.f);
+    };
+
+    // Referenced files are hashed by their contents, so any edit produces a new copy.
+    // A file that can't be opened keeps a zero hash and fails to bake below.
+    Scheduler.ParallelFor(NumFiles, [&](Uint32 /*ThreadId*/, Uint32 /*Chunk*/, Uint32 Begin, Uint32 End) {
+        for (auto i = Begin; i < End; ++i)
+        {
+            MappedFile SrcFile;
+            if (SrcFile.Open(Files[i].SrcPath.c_str()))
+                Files[i].ContentHash = HashBytes(SrcFile.GetData(), SrcFile.GetSize(), FNVOffsetBasis);
+            CompleteSteps(1);
+        }
+    });
+    for (const auto& File : Files)
+        Hash = HashBytes(&File.ContentHash, sizeof(File.ContentHash), Hash);
+
+    char HashStr[32];
+    snprintf(HashStr, sizeof(HashStr), "%016llx", static_cast<unsigned long long>(Hash));
+    const auto BakedDir  = std::string{CacheDir} + '/' + ModelName + '_' + HashStr;
+    const auto BakedPath = BakedDir + '/' + ModelName + ".gltf";
+
+    // Cancelled and new loads of the same model may run at the same time
+    static std::mutex           BakeMtx;
+    std::lock_guard<std::mutex> Lock{BakeMtx};
+
+    // The glTF file is written last, so its presence means that the copy is complete
+    if (FileSystem::FileExists(BakedPath.c_str()))
+    {
+        CompleteSteps(NumFiles);
+        return BakedPath;
+    }
+
+    // A directory without the glTF file is left by an interrupted bake and is simply overwritten
+    if (!FileSystem::PathExists(BakedDir.c_str()) && !FileSystem::CreateDirectory(BakedDir.c_str()))
+    {
+        LOG_ERROR_MESSAGE("Failed to create directory '", BakedDir, "'. The model will be loaded without baking.");
+        return FilePath;
+    }
+
+    LOG_INFO_MESSAGE("Baking '", FilePath, "' to '", BakedDir, "'");
+
+    // Decode the images in parallel
+    std::atomic<bool> AllBaked{true};
+    Scheduler.ParallelFor(NumFiles, [&](Uint32 /*ThreadId*/, Uint32 /*Chunk*/, Uint32 Begin, Uint32 End) {
+        for (auto i = Begin; i < End; ++i)
+        {
+            auto& File = Files[i];
+            if (File.IsImage)
+            {
+                if (BakeImage(File.SrcPath, BakedDir + '/' + File.BakedName))
+                {
+                    CompleteSteps(1);
+                    continue;
+                }
+
+                // Keep the original image if it has a format the baker does not handle
+                LOG_WARNING_MESSAGE("Unable to bake image '", File.SrcPath, "'. The original file will be used.");
+                File.BakedName = "file" + std::to_string(i) + GetLowerCaseExtension(File.SrcPath);
+            }
+            if (!CopyFileContents(File.SrcPath, BakedDir + '/' + File.BakedName))
+                AllBaked.store(false);
+            CompleteSteps(1);
+        }
+    });
+    if (!AllBaked.load())
+    {
+        LOG_ERROR_MESSAGE("Failed to bake '", FilePath, "'. The model will be loaded without baking.");
+        return FilePath;
+    }
+
+    // Baked names only contain alphanumeric characters and dots, so they need no escaping
+    std::string BakedJson;
+    BakedJson.reserve(Json.size());
+    size_t Pos = 0;
+    for (const auto& Ref : Uris)
+    {
+        auto it = UriToFile.find(Ref.Uri);
+        if (it == UriToFile.end())
+            continue;
+        BakedJson.append(Json, Pos, Ref.Begin - Pos);
+        BakedJson.append(Files[it->second].BakedName);
+        Pos = Ref.End;
+    }
+    BakedJson.append(Json, Pos, std::string::npos);
+
+    if (!WriteFile(BakedPath, BakedJson.data(), BakedJson.size()))
+        return FilePath;
+
+    return BakedPath;
+}
+
+bool GetGLTFReferencedFiles(const Char* FilePath, std::vector<std::string>& Paths)
+{
+    VERIFY_EXPR(FilePath != nullptr);
+
+    std::string Json;
+    {
+        MappedFile SrcFile;
+        if (!SrcFile.Open(FilePath))
+            return false;
+        Json.assign(static_cast<const char*>(SrcFile.GetData()), SrcFile.GetSize());
+    }
+
+    if (Json.compare(0, 4, "glTF") == 0)
+        return true;
+
+    std::vector<UriRef> Uris;
+    if (!FindUris(Json, Uris))
+        return false;
+
+    std::string SrcDir;
+    FileSystem::GetPathComponents(FilePath, &SrcDir, nullptr);
+    for (const auto& Ref : Uris)
+    {
+        if (Ref.Uri.compare(0, 5, "data:") != 0)
+            Paths.emplace_back(GetReferencedFilePath(SrcDir, Ref.Uri));
+    }
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,66 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Returns the path of a baked copy of the glTF model in CacheDir, creating the copy if
+/// it does not exist or is out of date.
+
+/// The baked copy has every external PNG/JPEG texture decoded into an uncompressed RGBA8 DDS
+/// file with a full mip chain, so loading it only maps the files and copies the pixels: no
+/// image decoding, format conversion or mip generation is required. Buffers are copied as is
+/// and the glTF file is rewritten to reference the baked files.
+///
+/// The copy is placed into a subdirectory whose name contains a hash of the glTF file and
+/// the contents of the files it references, so editing the model produces a new copy.
+/// If the model can't be baked (e.g. it is a binary .glb file or a file can't be written),
+/// the original path is returned.
+///
+/// If ProgressCallback is not empty, it receives the fraction of the work done, in [0, 1].
+/// Hashing the referenced files is the first half of the work and baking them is the second.
+/// The callback is called from the worker threads, possibly at the same time.
+///
+/// This function may be called from any thread.
+std::string GetBakedGLTFModel(const Char*                        FilePath,
+                              const Char*                        CacheDir,
+                              const std::function<void(float)>& ProgressCallback = nullptr);
+
+/// Appends the paths of the external buffers and images referenced by the glTF file to Paths.
+/// Embedded data and binary .glb files reference no external files.
+/// Returns false if the file can't be read or its URIs can't be parsed.
+bool GetGLTFReferencedFiles(const Char* FilePath, std::vector<std::string>& Paths);
+
+} // namespace Diligent
@@ -26,7 +26,14 @@
  */
 
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <array>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
 
 #include "GLTFViewer.hpp"
 #include "MapHelper.hpp"
@@ -40,6 +47,7 @@
 #include "imGuIZMO.h"
 #include "ImGuiUtils.hpp"
 #include "CallbackWrapper.hpp"
+#include "ShaderCache.hpp"
 #include "QxGLTFViewer.h"
 
 namespace Diligent
@@ -83,20 +91,66 @@ const std::pair<const char*, const char*> GLTFViewer::GLTFModels[] =
 
 void GLTFViewer::LoadModel(const char* Path)
 {
-    if (m_Model)
+    if (m_ModelLoader)
     {
-        m_PlayAnimation  = false;
-        m_AnimationIndex = 0;
-        m_AnimationTimers.clear();
+        // Let the previous load finish in the background; its model will be discarded
+        m_ModelLoader->Cancel();
+        m_CancelledLoaders.emplace_back(std::move(m_ModelLoader));
     }
 
-    GLTF::Model::CreateInfo ModelCI;
-    ModelCI.FileName   = Path;
-    ModelCI.pCacheInfo = m_bUseResourceCache ? &m_CacheUseInfo : nullptr;
-    m_Model.reset(new GLTF::Model{m_pDevice, m_pImmediateContext, ModelCI});
+    m_ModelLoader.reset(new AsyncModelLoader{m_pDevice, Path, m_bUseResourceCache ? &m_CacheUseInfo : nullptr,
+                                             !m_BakedCacheDir.empty() ? m_BakedCacheDir.c_str() : nullptr});
+}
 
-    m_ModelResourceBindings = m_GLTFRenderer->CreateResourceBindings(*m_Model,
-        m_CameraAttribsCB, m_LightAttribsCB);
+void GLTFViewer::UpdateModelLoader()
+{
+    // Destroying a loader joins its thread, so only release the ones that have finished
+    m_CancelledLoaders.erase(
+        std::remove_if(m_CancelledLoaders.begin(), m_CancelledLoaders.end(),
+                       [](const std::unique_ptr<AsyncModelLoader>& pLoader) { return pLoader->IsThreadFinished(); }),
+        m_CancelledLoaders.end());
+
+    if (!m_ModelLoader)
+        return;
+
+    switch (m_ModelLoader->GetStatus())
+    {
+        case AsyncModelLoader::Status::Loading:
+            break;
+
+        case AsyncModelLoader::Status::Loaded:
+            SetModel(m_ModelLoader->Finalize(m_pImmediateContext));
+            m_ModelLoader.reset();
+            break;
+
+        case AsyncModelLoader::Status::Failed:
+            LOG_ERROR_MESSAGE("Failed to load model '", m_ModelLoader->GetFileName(), "': ", m_ModelLoader->GetErrorMessage());
+            m_ModelLoader.reset();
+            break;
+
+        case AsyncModelLoader::Status::Cancelled:
+            m_CancelledLoaders.emplace_back(std::move(m_ModelLoader));
+            break;
+
+        default:
+            UNEXPECTED("Unexpected loader status");
+            m_ModelLoader.reset();
+    }
+}
+
+void GLTFViewer::SetModel(std::unique_ptr<GLTF::Model> pModel)
+{
+    m_PlayAnimation  = false;
+    m_AnimationIndex = 0;
+    m_AnimationTimers.clear();
+
+    m_Model = std::move(pModel);
+
+    if (!m_bUseResourceCache)
+    {
+        m_ModelResourceBindings = m_GLTFRenderer->CreateResourceBindings(*m_Model,
+            m_CameraAttribsCB, m_LightAttribsCB);
+    }
 
     // Center and scale model
     float3 ModelDim{m_Model->AABBTransform[0][0], m_Model->AABBTransform[1][1], m_Model->AABBTransform[2][2]};
@@ -124,6 +178,128 @@ void GLTFViewer::LoadModel(const char* Path)
         if (node->pCamera && node->pCamera->Type == GLTF::Camera::Projection::Perspective)
             m_Cameras.push_back(node->pCamera.get());
     }
+
+    // Order the nodes so that every parent precedes its children and the global matrices
+    // can be computed in a single pass
+    std::vector<std::pair<Uint32, const GLTF::Node*>> NodesByDepth;
+    NodesByDepth.reserve(m_Model->LinearNodes.size());
+    for (const auto* node : m_Model->LinearNodes)
+    {
+        Uint32 Depth = 0;
+        for (const auto* parent = node->Parent; parent != nullptr; parent = parent->Parent)
+            ++Depth;
+        NodesByDepth.emplace_back(Depth, node);
+    }
+    std::stable_sort(NodesByDepth.begin(), NodesByDepth.end(),
+                     [](const std::pair<Uint32, const GLTF::Node*>& lhs, const std::pair<Uint32, const GLTF::Node*>& rhs) {
+                         return lhs.first < rhs.first;
+                     });
+
+    std::unordered_map<const GLTF::Node*, int> NodeIndices;
+
+    const auto FindNode = [&NodeIndices](const GLTF::Node* node) {
+        auto it = node != nullptr ? NodeIndices.find(node) : NodeIndices.end();
+        return it != NodeIndices.end() ? it->second : -1;
+    };
+
+    m_AnimatedNodes.clear();
+    for (const auto& it : NodesByDepth)
+    {
+        NodeIndices.emplace(it.second, static_cast<int>(m_AnimatedNodes.size()));
+        m_AnimatedNodes.push_back({it.second, FindNode(it.second->Parent)});
+    }
+
+    m_ChannelNodes.clear();
+    for (const auto& Anim : m_Model->Animations)
+    {
+        m_ChannelNodes.emplace_back();
+        for (const auto& Channel : Anim.Channels)
+            m_ChannelNodes.back().push_back(FindNode(Channel.node));
+    }
+
+    m_Meshes.clear();
+    m_NumJointsPerInstance = 0;
+    for (Uint32 i = 0; i < m_AnimatedNodes.size(); ++i)
+    {
+        const auto* node = m_AnimatedNodes[i].pNode;
+        if (!node->pMesh)
+            continue;
+
+        AnimatedMesh Mesh;
+        Mesh.pMesh      = node->pMesh.get();
+        Mesh.NodeIdx    = i;
+        Mesh.FirstJoint = m_NumJointsPerInstance;
+        if (node->pSkin != nullptr)
+        {
+            const auto NumJoints = std::min({static_cast<size_t>(std::max(Mesh.pMesh->Transforms.jointcount, 0)),
+                                             node->pSkin->Joints.size(),
+                                             node->pSkin->InverseBindMatrices.size()});
+            for (size_t j = 0; j < NumJoints; ++j)
+            {
+                const auto JointIdx = FindNode(node->pSkin->Joints[j]);
+                Mesh.JointNodes.push_back(static_cast<Uint32>(JointIdx >= 0 ? JointIdx : i));
+            }
+        }
+        m_NumJointsPerInstance += static_cast<Uint32>(Mesh.JointNodes.size());
+        m_Meshes.emplace_back(std::move(Mesh));
+    }
+
+    for (auto& Nodes : m_ThreadNodeTransforms)
+    {
+        Nodes.Translations.resize(m_AnimatedNodes.size());
+        Nodes.Rotations.resize(m_AnimatedNodes.size());
+        Nodes.Scales.resize(m_AnimatedNodes.size());
+        Nodes.GlobalMatrices.resize(m_AnimatedNodes.size());
+    }
+
+    m_Instances.clear();
+    ResizeInstances();
+}
+
+void GLTFViewer::ResizeInstances()
+{
+    const auto OldNumInstances = static_cast<Uint32>(m_Instances.size());
+    const auto NumInstances    = static_cast<Uint32>(m_NumInstances);
+    m_Instances.resize(NumInstances);
+
+    // Arrange the instances in a square grid in the XZ plane
+    const auto  GridSize    = static_cast<Uint32>(std::ceil(std::sqrt(static_cast<float>(NumInstances))));
+    const float GridSpacing = 0.75f;
+    for (Uint32 i = 0; i < NumInstances; ++i)
+    {
+        auto& Inst  = m_Instances[i];
+        Inst.Offset = float3{
+            (static_cast<float>(i % GridSize) - static_cast<float>(GridSize - 1) * 0.5f) * GridSpacing,
+            0,
+            (static_cast<float>(i / GridSize) - static_cast<float>(GridSize - 1) * 0.5f) * GridSpacing};
+
+        // Spread the phases with the golden ratio so that neighbors are never in sync
+        Inst.AnimationPhase = std::fmod(static_cast<float>(i) * 0.618034f, 1.f);
+    }
+
+    m_MeshMatrices.resize(size_t{NumInstances} * m_Meshes.size());
+    m_JointMatrices.resize(size_t{NumInstances} * m_NumJointsPerInstance);
+
+    if (OldNumInstances == 0 && NumInstances > 0)
+    {
+        // The model has just been loaded and its meshes still hold the rest pose
+        for (size_t m = 0; m < m_Meshes.size(); ++m)
+        {
+            const auto& Mesh = m_Meshes[m];
+
+            m_MeshMatrices[m] = Mesh.pMesh->Transforms.matrix;
+            for (size_t j = 0; j < Mesh.JointNodes.size(); ++j)
+                m_JointMatrices[Mesh.FirstJoint + j] = Mesh.pMesh->Transforms.jointMatrices[j];
+        }
+    }
+
+    // Other new instances start from the pose of the first one until UpdateAnimations()
+    // computes their own one
+    for (Uint32 i = std::max(OldNumInstances, 1u); i < NumInstances; ++i)
+    {
+        std::copy_n(m_MeshMatrices.begin(), m_Meshes.size(), m_MeshMatrices.begin() + i * m_Meshes.size());
+        std::copy_n(m_JointMatrices.begin(), m_NumJointsPerInstance, m_JointMatrices.begin() + size_t{i} * m_NumJointsPerInstance);
+    }
 }
 
 void GLTFViewer::ResetView()
@@ -149,6 +325,14 @@ void GLTFViewer::ProcessCommandLine(const char* CmdLine)
         {
             m_bUseResourceCache = Arg == "1" || Arg == "true";
         }
+        else if (!(Arg = GetArgument(pos, "baked_cache")).empty())
+        {
+            m_BakedCacheDir = Arg;
+        }
+        else if (!(Arg = GetArgument(pos, "instances")).empty())
+        {
+            m_NumInstances = clamp(atoi(Arg.c_str()), 1, MaxInstances);
+        }
         pos = strchr(pos, '-');
     }
 }
@@ -293,6 +477,9 @@ void GLTFViewer::Initialize(const SampleInitInfo& InitInfo)
     if (m_bUseResourceCache)
         CreateGLTFResourceCache();
 
+    m_pScheduler.reset(new TaskScheduler{std::max(std::thread::hardware_concurrency(), 2u) - 1});
+    m_ThreadNodeTransforms.resize(m_pScheduler->GetNumThreads());
+
     LoadModel(GLTFModels[m_SelectedModel].second);
 }
 
@@ -312,6 +499,8 @@ void GLTFViewer::UpdateUI()
                 LoadModel(GLTFModels[m_SelectedModel].second);
             }
         }
+        if (ImGui::SliderInt("Instances", &m_NumInstances, 1, MaxInstances) && m_Model)
+            ResizeInstances();
 #ifdef PLATFORM_WIN32
         if (ImGui::Button("Load model"))
         {
@@ -325,6 +514,19 @@ void GLTFViewer::UpdateUI()
             }
         }
 #endif
+        if (m_ModelLoader)
+        {
+            ImGui::TextDisabled("Loading %s", m_ModelLoader->GetFileName().c_str());
+            char Overlay[64];
+            snprintf(Overlay, sizeof(Overlay), "%s: %.1f s",
+                     AsyncModelLoader::GetStageName(m_ModelLoader->GetStage()), m_ModelLoader->GetElapsedTime());
+            ImGui::ProgressBar(m_ModelLoader->GetProgress(), ImVec2{-1, 0}, Overlay);
+            if (ImGui::Button("Cancel loading"))
+            {
+                m_ModelLoader->Cancel();
+                m_CancelledLoaders.emplace_back(std::move(m_ModelLoader));
+            }
+        }
         if (!m_Cameras.empty())
         {
             std::vector<std::pair<Uint32, std::string>> CamList;
@@ -375,7 +577,7 @@ void GLTFViewer::UpdateUI()
             ImGui::TreePop();
         }
 
-        if (!m_Model->Animations.empty())
+        if (m_Model && !m_Model->Animations.empty())
         {
             ImGui::SetNextTreeNodeOpen(true, ImGuiCond_FirstUseEver);
             if (ImGui::TreeNode("Animation"))
@@ -385,6 +587,8 @@ void GLTFViewer::UpdateUI()
                 for (size_t i = 0; i < m_Model->Animations.size(); ++i)
                     Animations[i] = m_Model->Animations[i].Name.c_str();
                 ImGui::Combo("Active Animation", reinterpret_cast<int*>(&m_AnimationIndex), Animations.data(), static_cast<int>(Animations.size()));
+                ImGui::Text("Updated %u of %u instances in %.2f ms", m_NumUpdatedInstances,
+                            static_cast<Uint32>(m_Instances.size()), m_AnimationUpdateTime * 1000.0);
                 ImGui::TreePop();
             }
         }
@@ -457,11 +661,16 @@ void GLTFViewer::CreateEnvMapPSO(IRenderStateNotationLoader* pRSNLoader)
         GraphicsPipelineCI.GraphicsPipeline.DSVFormat        = m_pSwapChain->GetDesc().DepthBufferFormat;
         GraphicsPipelineCI.GraphicsPipeline.NumRenderTargets = 1;
     });
+    auto ModifyShaderCI = MakeCallback([this](ShaderCreateInfo& ShaderCI, SHADER_TYPE ShaderType, bool& IsAddToCache) {
+        if (m_pShaderCache != nullptr)
+            m_pShaderCache->ResolveBytecode(ShaderCI);
+    });
 
     pRSNLoader->LoadPipelineState(
         {"EnvMap PSO", PIPELINE_TYPE_GRAPHICS,
             true, ModifyCI,
-            ModifyCI}, &m_EnvMapPSO);
+            ModifyCI, ModifyShaderCI,
+            ModifyShaderCI}, &m_EnvMapPSO);
 
     m_EnvMapPSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "cbCameraAttribs")->Set(m_CameraAttribsCB);
     m_EnvMapPSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "cbEnvMapRenderAttribs")->Set(m_EnvMapRenderAttribsCB);
@@ -505,10 +714,15 @@ void GLTFViewer::CreateBoundBoxPSO(IRenderStateNotationLoader* pRSNLoader)
         GraphicsPipelineCI.GraphicsPipeline.DSVFormat        = m_pSwapChain->GetDesc().DepthBufferFormat;
         GraphicsPipelineCI.GraphicsPipeline.NumRenderTargets = 1;
     });
+    auto ModifyShaderCI = MakeCallback([this](ShaderCreateInfo& ShaderCI, SHADER_TYPE ShaderType, bool& IsAddToCache) {
+        if (m_pShaderCache != nullptr)
+            m_pShaderCache->ResolveBytecode(ShaderCI);
+    });
     pRSNLoader->LoadPipelineState(
         {"BoundBox PSO", PIPELINE_TYPE_GRAPHICS,
             true, ModifyCI,
-            ModifyCI},
+            ModifyCI, ModifyShaderCI,
+            ModifyShaderCI},
             &m_BoundBoxPSO);
 
     m_BoundBoxPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "cbCameraAttribs")->Set(
@@ -518,6 +732,13 @@ void GLTFViewer::CreateBoundBoxPSO(IRenderStateNotationLoader* pRSNLoader)
 
 GLTFViewer::~GLTFViewer()
 {
+    // Loaders reference the resource cache, so stop them before it is released
+    if (m_ModelLoader)
+        m_ModelLoader->Cancel();
+    for (auto& pLoader : m_CancelledLoaders)
+        pLoader->Cancel();
+    m_ModelLoader.reset();
+    m_CancelledLoaders.clear();
 }
 
 // Render a frame
@@ -583,19 +804,22 @@ void GLTFViewer::Render()
         CamAttribs->mViewProjInvT = CameraViewProj.Inverse().Transpose();
         CamAttribs->f4Position    = float4(CameraWorldPos, 1);
 
-        if (m_BoundBoxMode != BoundBoxMode::None)
+        if (m_Model && m_BoundBoxMode != BoundBoxMode::None)
         {
+            // Bound box of the first instance
+            const auto ModelTransform = float4x4::Translation(m_Instances[0].Offset) * m_RenderParams.ModelTransform;
+
             float4x4 BBTransform;
             if (m_BoundBoxMode == BoundBoxMode::Local)
             {
                 BBTransform =
-                    m_Model->AABBTransform * m_RenderParams.ModelTransform;
+                    m_Model->AABBTransform * ModelTransform;
             }
             else if (m_BoundBoxMode == BoundBoxMode::Global)
             {
                 auto TransformedBB = BoundBox{m_Model->dimensions.min,
                     m_Model->dimensions.max}.Transform(
-                        m_RenderParams.ModelTransform);
+                        ModelTransform);
                 BBTransform        = float4x4::Scale(TransformedBB.Max -
                     TransformedBB.Min) *
                         float4x4::Translation(TransformedBB.Min);
@@ -617,22 +841,51 @@ void GLTFViewer::Render()
         lightAttribs->f4Intensity = m_LightColor * m_LightIntensity;
     }
 
-    if (m_bUseResourceCache)
-    {
-        m_GLTFRenderer->Begin(m_pDevice, m_pImmediateContext,
-            m_CacheUseInfo, m_CacheBindings,
-            m_CameraAttribsCB, m_LightAttribsCB);
-        m_GLTFRenderer->Render(m_pImmediateContext, *m_Model,
-            m_RenderParams, nullptr, &m_CacheBindings);
-    }
-    else
+    if (!m_Instances.empty())
     {
-        m_GLTFRenderer->Begin(m_pImmediateContext);
-        m_GLTFRenderer->Render(m_pImmediateContext, *m_Model,
-            m_RenderParams, &m_ModelResourceBindings);
+        if (m_bUseResourceCache)
+        {
+            m_GLTFRenderer->Begin(m_pDevice, m_pImmediateContext,
+                m_CacheUseInfo, m_CacheBindings,
+                m_CameraAttribsCB, m_LightAttribsCB);
+        }
+        else
+        {
+            m_GLTFRenderer->Begin(m_pImmediateContext);
+        }
+
+        auto InstanceRenderParams = m_RenderParams;
+        for (size_t i = 0; i < m_Instances.size(); ++i)
+        {
+            const auto& Inst = m_Instances[i];
+
+            // The renderer reads the transforms of the instance from the meshes of the model
+            const auto* pMeshMatrices  = m_MeshMatrices.data() + i * m_Meshes.size();
+            const auto* pJointMatrices = m_JointMatrices.data() + i * m_NumJointsPerInstance;
+            for (size_t m = 0; m < m_Meshes.size(); ++m)
+            {
+                const auto& Mesh = m_Meshes[m];
+
+                Mesh.pMesh->Transforms.matrix = pMeshMatrices[m];
+                if (!Mesh.JointNodes.empty())
+                    std::copy_n(pJointMatrices + Mesh.FirstJoint, Mesh.JointNodes.size(), &Mesh.pMesh->Transforms.jointMatrices[0]);
+            }
+
+            InstanceRenderParams.ModelTransform = float4x4::Translation(Inst.Offset) * m_RenderParams.ModelTransform;
+            if (m_bUseResourceCache)
+            {
+                m_GLTFRenderer->Render(m_pImmediateContext, *m_Model,
+                    InstanceRenderParams, nullptr, &m_CacheBindings);
+            }
+            else
+            {
+                m_GLTFRenderer->Render(m_pImmediateContext, *m_Model,
+                    InstanceRenderParams, &m_ModelResourceBindings);
+            }
+        }
     }
 
-    if (m_BoundBoxMode != BoundBoxMode::None)
+    if (m_Model && m_BoundBoxMode != BoundBoxMode::None)
     {
         m_pImmediateContext->SetPipelineState(m_BoundBoxPSO);
         m_pImmediateContext->CommitShaderResources(m_BoundBoxSRB,
@@ -724,16 +977,157 @@ void GLTFViewer::Update(double CurrTime, double ElapsedTime)
     }
 
     SampleBase::Update(CurrTime, ElapsedTime);
+    UpdateModelLoader();
     UpdateUI();
 
-    if (!m_Model->Animations.empty() && m_PlayAnimation)
+    if (m_Model && !m_Model->Animations.empty())
+    {
+        if (m_PlayAnimation)
+        {
+            float& AnimationTimer = m_AnimationTimers[m_AnimationIndex];
+            AnimationTimer += static_cast<float>(ElapsedTime);
+            AnimationTimer = std::fmod(AnimationTimer,
+                m_Model->Animations[m_AnimationIndex].End);
+        }
+        UpdateAnimations();
+    }
+}
+
+void GLTFViewer::SampleAnimation(Uint32          AnimationIndex,
+                                 float           Time,
+                                 NodeTransforms& Nodes,
+                                 float4x4*       pMeshMatrices,
+                                 float4x4*       pJointMatrices,
+                                 bool            UpdateCameras) const
+{
+    for (size_t i = 0; i < m_AnimatedNodes.size(); ++i)
+    {
+        const auto* node      = m_AnimatedNodes[i].pNode;
+        Nodes.Translations[i] = node->Translation;
+        Nodes.Rotations[i]    = node->Rotation;
+        Nodes.Scales[i]       = node->Scale;
+    }
+
+    const auto& Anim     = m_Model->Animations[AnimationIndex];
+    const auto& NodeIdxs = m_ChannelNodes[AnimationIndex];
+    for (size_t c = 0; c < Anim.Channels.size(); ++c)
+    {
+        const auto& Channel = Anim.Channels[c];
+        const auto  NodeIdx = NodeIdxs[c];
+        if (NodeIdx < 0 || Channel.SamplerIndex >= Anim.Samplers.size())
+            continue;
+
+        const auto& Sampler = Anim.Samplers[Channel.SamplerIndex];
+        const auto& Inputs  = Sampler.Inputs;
+        if (Inputs.size() < 2 || Inputs.size() > Sampler.OutputsVec4.size())
+            continue;
+
+        // Find the key frames around the time, holding the first and the last ones outside of the range
+        auto Key1 = static_cast<size_t>(std::upper_bound(Inputs.begin(), Inputs.end(), Time) - Inputs.begin());
+        Key1      = std::min(std::max(Key1, size_t{1}), Inputs.size() - 1);
+
+        const auto  Key0    = Key1 - 1;
+        const auto  KeyTime = Inputs[Key1] - Inputs[Key0];
+        const float u       = KeyTime > 0 ? clamp((Time - Inputs[Key0]) / KeyTime, 0.f, 1.f) : 0.f;
+        const auto& v0      = Sampler.OutputsVec4[Key0];
+        const auto& v1      = Sampler.OutputsVec4[Key1];
+        switch (Channel.PathType)
+        {
+            case GLTF::AnimationChannel::PATH_TYPE::TRANSLATION:
+            {
+                const auto t                = lerp(v0, v1, u);
+                Nodes.Translations[NodeIdx] = float3{t.x, t.y, t.z};
+                break;
+            }
+
+            case GLTF::AnimationChannel::PATH_TYPE::ROTATION:
+                Nodes.Rotations[NodeIdx] = normalize(slerp(Quaternion{v0.x, v0.y, v0.z, v0.w}, Quaternion{v1.x, v1.y, v1.z, v1.w}, u));
+                break;
+
+            case GLTF::AnimationChannel::PATH_TYPE::SCALE:
+            {
+                const auto sc         = lerp(v0, v1, u);
+                Nodes.Scales[NodeIdx] = float3{sc.x, sc.y, sc.z};
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    // Parents precede their children, so their global matrices are always ready
+    for (size_t i = 0; i < m_AnimatedNodes.size(); ++i)
+    {
+        const auto& AnimNode = m_AnimatedNodes[i];
+        const auto  Local    = float4x4::Scale(Nodes.Scales[i]) * Nodes.Rotations[i].ToMatrix() *
+            float4x4::Translation(Nodes.Translations[i]) * AnimNode.pNode->Matrix;
+        Nodes.GlobalMatrices[i] = AnimNode.ParentIdx >= 0 ? Local * Nodes.GlobalMatrices[AnimNode.ParentIdx] : Local;
+    }
+
+    for (size_t m = 0; m < m_Meshes.size(); ++m)
+    {
+        const auto& Mesh       = m_Meshes[m];
+        const auto& MeshMatrix = Nodes.GlobalMatrices[Mesh.NodeIdx];
+        pMeshMatrices[m]       = MeshMatrix;
+        if (Mesh.JointNodes.empty())
+            continue;
+
+        const auto& InverseBindMatrices = m_AnimatedNodes[Mesh.NodeIdx].pNode->pSkin->InverseBindMatrices;
+        const auto  InvMeshMatrix       = MeshMatrix.Inverse();
+        for (size_t j = 0; j < Mesh.JointNodes.size(); ++j)
+            pJointMatrices[Mesh.FirstJoint + j] = InverseBindMatrices[j] * Nodes.GlobalMatrices[Mesh.JointNodes[j]] * InvMeshMatrix;
+    }
+
+    if (UpdateCameras)
     {
-        float& AnimationTimer = m_AnimationTimers[m_AnimationIndex];
-        AnimationTimer += static_cast<float>(ElapsedTime);
-        AnimationTimer = std::fmod(AnimationTimer,
-            m_Model->Animations[m_AnimationIndex].End);
-        m_Model->UpdateAnimation(m_AnimationIndex, AnimationTimer);
+        for (size_t i = 0; i < m_AnimatedNodes.size(); ++i)
+        {
+            if (auto* pCamera = m_AnimatedNodes[i].pNode->pCamera.get())
+                pCamera->matrix = Nodes.GlobalMatrices[i];
+        }
     }
 }
 
+void GLTFViewer::UpdateAnimations()
+{
+    const auto  AnimationIndex = m_AnimationIndex;
+    const float Duration       = m_Model->Animations[AnimationIndex].End;
+    const float BaseTime       = m_AnimationTimers[AnimationIndex];
+
+    const auto StartTime = std::chrono::high_resolution_clock::now();
+
+    // Every instance is sampled into its own node transforms and its range of the packed mesh and
+    // joint matrices, so instances are independent and are evaluated in parallel. The node cameras
+    // follow the first instance. Instances whose animation time has not changed, e.g. when the
+    // animation is paused, keep the matrices from the previous update.
+    std::atomic<Uint32> NumUpdatedInstances{0};
+    m_pScheduler->ParallelFor(
+        static_cast<Uint32>(m_Instances.size()),
+        [&](Uint32 ThreadId, Uint32, Uint32 Begin, Uint32 End) {
+            auto&  Nodes      = m_ThreadNodeTransforms[ThreadId];
+            Uint32 NumUpdated = 0;
+            for (Uint32 i = Begin; i < End; ++i)
+            {
+                auto&       Inst = m_Instances[i];
+                const float Time = Duration > 0 ? std::fmod(BaseTime + Inst.AnimationPhase * Duration, Duration) : 0.f;
+                if (Inst.UpdatedAnimationIndex == AnimationIndex && Inst.UpdatedAnimationTime == Time)
+                    continue;
+
+                SampleAnimation(static_cast<Uint32>(AnimationIndex), Time, Nodes,
+                                m_MeshMatrices.data() + size_t{i} * m_Meshes.size(),
+                                m_JointMatrices.data() + size_t{i} * m_NumJointsPerInstance,
+                                i == 0);
+                Inst.UpdatedAnimationIndex = AnimationIndex;
+                Inst.UpdatedAnimationTime  = Time;
+                ++NumUpdated;
+            }
+            NumUpdatedInstances.fetch_add(NumUpdated);
+        },
+        4);
+
+    m_NumUpdatedInstances = NumUpdatedInstances.load();
+    m_AnimationUpdateTime = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - StartTime).count();
+}
+
 } // namespace Diligent
@@ -28,11 +28,14 @@
 #pragma once
 
 #include <vector>
+#include <memory>
 #include "SampleBase.hpp"
 #include "RenderStateNotationLoader.h"
 #include "GLTFLoader.hpp"
 #include "GLTF_PBR_Renderer.hpp"
 #include "BasicMath.hpp"
+#include "AsyncModelLoader.hpp"
+#include "TaskScheduler.hpp"
 
 namespace Diligent
 {
@@ -53,6 +56,14 @@ private:
     void CreateEnvMapSRB();
     void CreateBoundBoxPSO(IRenderStateNotationLoader* pRSNLoader);
     void LoadModel(const char* Path);
+    void UpdateModelLoader();
+    void SetModel(std::unique_ptr<GLTF::Model> pModel);
+    void ResizeInstances();
+    void UpdateAnimations();
+
+    struct NodeTransforms;
+    void SampleAnimation(Uint32 AnimationIndex, float Time, NodeTransforms& Nodes,
+                         float4x4* pMeshMatrices, float4x4* pJointMatrices, bool UpdateCameras) const;
     void ResetView();
     void UpdateUI();
     void CreateGLTFResourceCache();
@@ -108,9 +119,76 @@ private:
     RefCntAutoPtr<GLTF::ResourceManager> m_pResourceMgr;
     GLTF::ResourceCacheUseInfo           m_CacheUseInfo;
 
+    // If not empty, models are loaded from baked copies in this directory
+    std::string m_BakedCacheDir;
+
     GLTF_PBR_Renderer::ModelResourceBindings m_ModelResourceBindings;
     GLTF_PBR_Renderer::ResourceCacheBindings m_CacheBindings;
 
+    // All instances share the model and its GPU resources. Every instance samples the active
+    // animation into its own node transforms and never modifies the nodes of the model.
+    struct ModelInstance
+    {
+        // Position of the instance in the scene grid
+        float3 Offset;
+
+        // Fraction of the animation length this instance is ahead of the first one
+        float AnimationPhase = 0;
+
+        // Animation state the node transforms were last computed for
+        int   UpdatedAnimationIndex = -1;
+        float UpdatedAnimationTime  = 0;
+    };
+    std::vector<ModelInstance> m_Instances;
+
+    // Nodes of the model ordered so that every parent precedes its children
+    struct AnimatedNode
+    {
+        const GLTF::Node* pNode     = nullptr;
+        int               ParentIdx = -1;
+    };
+    std::vector<AnimatedNode> m_AnimatedNodes;
+
+    // Index in m_AnimatedNodes of the node targeted by every channel of every animation
+    std::vector<std::vector<int>> m_ChannelNodes;
+
+    struct AnimatedMesh
+    {
+        GLTF::Mesh* pMesh   = nullptr;
+        Uint32      NodeIdx = 0;
+
+        // Joints of the mesh skin in m_AnimatedNodes and the range of their matrices
+        // in the joint matrices of an instance
+        std::vector<Uint32> JointNodes;
+        Uint32              FirstJoint = 0;
+    };
+    std::vector<AnimatedMesh> m_Meshes;
+
+    // Mesh matrices and joint matrices of all instances packed one instance after another
+    std::vector<float4x4> m_MeshMatrices;
+    std::vector<float4x4> m_JointMatrices;
+    Uint32                m_NumJointsPerInstance = 0;
+
+    // Local transforms and global matrices of the nodes while an animation is being sampled
+    struct NodeTransforms
+    {
+        std::vector<float3>     Translations;
+        std::vector<Quaternion> Rotations;
+        std::vector<float3>     Scales;
+        std::vector<float4x4>   GlobalMatrices;
+    };
+    // One set per scheduler thread
+    std::vector<NodeTransforms> m_ThreadNodeTransforms;
+
+    std::unique_ptr<TaskScheduler> m_pScheduler;
+
+    static constexpr int MaxInstances = 256;
+
+    int m_NumInstances = 1;
+
+    double m_AnimationUpdateTime = 0;
+    Uint32 m_NumUpdatedInstances = 0;
+
     MouseState m_LastMouseState;
     float      m_CameraYaw   = 0;
     float      m_CameraPitch = 0;
@@ -118,6 +196,11 @@ private:
     Uint32 m_CameraId = 0;
 
     std::vector<const GLTF::Camera*> m_Cameras;
+
+    // The model that is being loaded. The current model keeps rendering until it is ready.
+    std::unique_ptr<AsyncModelLoader> m_ModelLoader;
+    // Cancelled loads whose threads are still running
+    std::vector<std::unique_ptr<AsyncModelLoader>> m_CancelledLoaders;
 };
 
 } // namespace Diligent
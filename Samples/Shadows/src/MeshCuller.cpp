@@ -0,0 +1,201 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+
+#include "MeshCuller.hpp"
+#include "DebugUtilities.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define SHADOWS_CULL_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define SHADOWS_CULL_NEON 1
+#endif
+
+namespace Diligent
+{
+
+namespace
+{
+
+struct CullPlane
+{
+    float3 Normal;
+    float  Distance;
+    // Select the box corner that is farthest along the plane normal
+    bool MaxX;
+    bool MaxY;
+    bool MaxZ;
+};
+
+} // namespace
+
+void MultiFrustumCuller::SetBoxes(const BoundBox* pBoxes, Uint32 NumBoxes)
+{
+    m_NumBoxes = NumBoxes;
+
+    const size_t PaddedSize = (size_t{NumBoxes} + 3u) & ~size_t{3};
+    for (auto* pArr : {&m_MinX, &m_MinY, &m_MinZ, &m_MaxX, &m_MaxY, &m_MaxZ})
+        pArr->assign(PaddedSize, 0.f);
+
+    for (Uint32 i = 0; i < NumBoxes; ++i)
+    {
+        m_MinX[i] = pBoxes[i].Min.x;
+        m_MinY[i] = pBoxes[i].Min.y;
+        m_MinZ[i] = pBoxes[i].Min.z;
+        m_MaxX[i] = pBoxes[i].Max.x;
+        m_MaxY[i] = pBoxes[i].Max.y;
+        m_MaxZ[i] = pBoxes[i].Max.z;
+    }
+}
+
+void MultiFrustumCuller::Cull(const ViewFrustum* const* ppFrusta,
+                              Uint32                    NumFrusta,
+                              FRUSTUM_PLANE_FLAGS       PlaneFlags,
+                              Uint32*                   pVisibility) const
+{
+    VERIFY(NumFrusta <= MaxFrusta, "Too many frusta");
+    NumFrusta = std::min(NumFrusta, MaxFrusta);
+
+    // Gather the enabled planes of all frusta. Plane i of frustum f is at f * NUM_PLANES + i.
+    CullPlane Planes[MaxFrusta * ViewFrustum::NUM_PLANES];
+    Uint32    NumPlanes[MaxFrusta] = {};
+    for (Uint32 f = 0; f < NumFrusta; ++f)
+    {
+        for (Uint32 i = 0; i < ViewFrustum::NUM_PLANES; ++i)
+        {
+            if ((PlaneFlags & (1u << i)) == 0)
+                continue;
+
+            const auto& Plane = ppFrusta[f]->GetPlane(static_cast<ViewFrustum::PLANE_IDX>(i));
+
+            auto& Dst    = Planes[f * ViewFrustum::NUM_PLANES + NumPlanes[f]++];
+            Dst.Normal   = Plane.Normal;
+            Dst.Distance = Plane.Distance;
+            Dst.MaxX     = Plane.Normal.x > 0;
+            Dst.MaxY     = Plane.Normal.y > 0;
+            Dst.MaxZ     = Plane.Normal.z > 0;
+        }
+    }
+
+    Uint32 box = 0;
+
+#if SHADOWS_CULL_SSE2 || SHADOWS_CULL_NEON
+    // Boxes are padded to a multiple of four, so the last group may be processed with SIMD
+    // as well. Its results go to a temporary array and only valid entries are copied.
+    for (; box < m_NumBoxes; box += 4)
+    {
+#    if SHADOWS_CULL_SSE2
+        __m128i Visibility = _mm_setzero_si128();
+#    else
+        uint32x4_t Visibility = vdupq_n_u32(0);
+#    endif
+        for (Uint32 f = 0; f < NumFrusta; ++f)
+        {
+#    if SHADOWS_CULL_SSE2
+            __m128 Outside = _mm_setzero_ps();
+#    else
+            uint32x4_t Outside = vdupq_n_u32(0);
+#    endif
+            for (Uint32 p = 0; p < NumPlanes[f]; ++p)
+            {
+                const auto& Plane = Planes[f * ViewFrustum::NUM_PLANES + p];
+
+                const float* pX = (Plane.MaxX ? m_MaxX : m_MinX).data() + box;
+                const float* pY = (Plane.MaxY ? m_MaxY : m_MinY).data() + box;
+                const float* pZ = (Plane.MaxZ ? m_MaxZ : m_MinZ).data() + box;
+                // Same operation order as dot(MaxPoint, Normal) + Distance in GetBoxVisibility()
+#    if SHADOWS_CULL_SSE2
+                __m128 Dist = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(pX), _mm_set1_ps(Plane.Normal.x)),
+                                         _mm_mul_ps(_mm_loadu_ps(pY), _mm_set1_ps(Plane.Normal.y)));
+                Dist        = _mm_add_ps(Dist, _mm_mul_ps(_mm_loadu_ps(pZ), _mm_set1_ps(Plane.Normal.z)));
+                Dist        = _mm_add_ps(Dist, _mm_set1_ps(Plane.Distance));
+                Outside     = _mm_or_ps(Outside, _mm_cmplt_ps(Dist, _mm_setzero_ps()));
+#    else
+                float32x4_t Dist = vaddq_f32(vmulq_n_f32(vld1q_f32(pX), Plane.Normal.x),
+                                             vmulq_n_f32(vld1q_f32(pY), Plane.Normal.y));
+                Dist             = vaddq_f32(Dist, vmulq_n_f32(vld1q_f32(pZ), Plane.Normal.z));
+                Dist             = vaddq_f32(Dist, vdupq_n_f32(Plane.Distance));
+                Outside          = vorrq_u32(Outside, vcltq_f32(Dist, vdupq_n_f32(0)));
+#    endif
+            }
+#    if SHADOWS_CULL_SSE2
+            Visibility = _mm_or_si128(Visibility, _mm_andnot_si128(_mm_castps_si128(Outside), _mm_set1_epi32(static_cast<int>(1u << f))));
+#    else
+            Visibility = vorrq_u32(Visibility, vbicq_u32(vdupq_n_u32(1u << f), Outside));
+#    endif
+        }
+
+        if (box + 4 <= m_NumBoxes)
+        {
+#    if SHADOWS_CULL_SSE2
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pVisibility + box), Visibility);
+#    else
+            vst1q_u32(pVisibility + box, Visibility);
+#    endif
+        }
+        else
+        {
+            alignas(16) Uint32 Tail[4];
+#    if SHADOWS_CULL_SSE2
+            _mm_store_si128(reinterpret_cast<__m128i*>(Tail), Visibility);
+#    else
+            vst1q_u32(Tail, Visibility);
+#    endif
+            for (Uint32 i = box; i < m_NumBoxes; ++i)
+                pVisibility[i] = Tail[i - box];
+        }
+    }
+#endif
+
+    for (; box < m_NumBoxes; ++box)
+    {
+        Uint32 Visibility = 0;
+        for (Uint32 f = 0; f < NumFrusta; ++f)
+        {
+            bool IsOutside = false;
+            for (Uint32 p = 0; p < NumPlanes[f] && !IsOutside; ++p)
+            {
+                const auto& Plane = Planes[f * ViewFrustum::NUM_PLANES + p];
+
+                const float3 MaxPoint{
+                    Plane.MaxX ? m_MaxX[box] : m_MinX[box],
+                    Plane.MaxY ? m_MaxY[box] : m_MinY[box],
+                    Plane.MaxZ ? m_MaxZ[box] : m_MinZ[box],
+                };
+                IsOutside = dot(MaxPoint, Plane.Normal) + Plane.Distance < 0;
+            }
+            if (!IsOutside)
+                Visibility |= 1u << f;
+        }
+        pVisibility[box] = Visibility;
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,75 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+#include "AdvancedMath.hpp"
+
+namespace Diligent
+{
+
+/// Culls a fixed set of axis-aligned boxes against several view frusta in a single pass.
+
+/// The boxes are stored in SoA layout, so four of them are tested against a plane at once
+/// with SSE2/NEON. Every group of boxes is loaded once and tested against all frusta,
+/// e.g. all shadow cascades.
+///
+/// The test is the plane test of GetBoxVisibility(): a box is culled if it is fully behind
+/// one of the frustum planes.
+class MultiFrustumCuller
+{
+public:
+    /// The maximum number of frusta that can be tested in one call
+    static constexpr Uint32 MaxFrusta = 32;
+
+    void SetBoxes(const BoundBox* pBoxes, Uint32 NumBoxes);
+
+    Uint32 GetNumBoxes() const { return m_NumBoxes; }
+
+    /// For every box, writes a mask to pVisibility where bit i is set if the box is
+    /// not culled by ppFrusta[i]. Only planes selected by PlaneFlags are tested.
+    void Cull(const ViewFrustum* const* ppFrusta,
+              Uint32                    NumFrusta,
+              FRUSTUM_PLANE_FLAGS       PlaneFlags,
+              Uint32*                   pVisibility) const;
+
+private:
+    Uint32 m_NumBoxes = 0;
+
+    // Box bounds padded to a multiple of four boxes
+    std::vector<float> m_MinX;
+    std::vector<float> m_MinY;
+    std::vector<float> m_MinZ;
+    std::vector<float> m_MaxX;
+    std::vector<float> m_MaxY;
+    std::vector<float> m_MaxZ;
+};
+
+} // namespace Diligent
@@ -25,6 +25,10 @@
  *  of the possibility of such damages.
  */
 
+#include <algorithm>
+#include <tuple>
+#include <thread>
+
 #include "ShadowsSample.hpp"
 #include "MapHelper.hpp"
 #include "FileSystem.hpp"
@@ -37,6 +41,8 @@
 #include "imGuIZMO.h"
 #include "ImGuiUtils.hpp"
 #include "CallbackWrapper.hpp"
+#include "ShaderCache.hpp"
+#include "PipelineStateBatch.hpp"
 
 namespace Diligent
 {
@@ -55,6 +61,8 @@ void ShadowsSample::ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attr
     SampleBase::ModifyEngineInitInfo(Attribs);
 
     Attribs.EngineCI.Features.DepthClamp = DEVICE_FEATURE_STATE_OPTIONAL;
+    // Cascades are recorded in parallel, so there is no use in more contexts than cascades
+    Attribs.EngineCI.NumDeferredContexts = std::min(std::max(std::thread::hardware_concurrency() - 1, 2u), Uint32{MaxCascades});
 
 #if D3D12_SUPPORTED
     if (Attribs.DeviceType == RENDER_DEVICE_TYPE_D3D12)
@@ -76,6 +84,24 @@ void ShadowsSample::Initialize(const SampleInitInfo& InitInfo)
     FileSystem::GetPathComponents(MeshFileName, &Directory, nullptr);
     m_Mesh.LoadGPUResources(Directory.c_str(), m_pDevice, m_pImmediateContext);
 
+    {
+        std::vector<BoundBox> MeshBoxes(m_Mesh.GetNumMeshes());
+        for (Uint32 meshIdx = 0; meshIdx < m_Mesh.GetNumMeshes(); ++meshIdx)
+        {
+            const auto& SubMesh = m_Mesh.GetMesh(meshIdx);
+
+            MeshBoxes[meshIdx].Min = SubMesh.BoundingBoxCenter - SubMesh.BoundingBoxExtents * 0.5f;
+            MeshBoxes[meshIdx].Max = SubMesh.BoundingBoxCenter + SubMesh.BoundingBoxExtents * 0.5f;
+        }
+        m_MeshCuller.SetBoxes(MeshBoxes.data(), m_Mesh.GetNumMeshes());
+        m_ShadowVisibility.resize(m_Mesh.GetNumMeshes());
+        m_CameraVisibility.resize(m_Mesh.GetNumMeshes());
+    }
+
+    // The calling thread uses the last deferred context
+    if (m_pDeferredContexts.size() >= 2)
+        m_pScheduler.reset(new TaskScheduler{static_cast<Uint32>(m_pDeferredContexts.size()) - 1});
+
     m_LightAttribs.ShadowAttribs.iNumCascades     = 4;
     m_LightAttribs.ShadowAttribs.fFixedDepthBias  = 0.0025f;
     m_LightAttribs.ShadowAttribs.iFixedFilterSize = 5;
@@ -135,9 +161,12 @@ void ShadowsSample::UpdateUI()
             }
         }
 
-        if (ImGui::SliderInt("Num cascades", &m_LightAttribs.ShadowAttribs.iNumCascades, 1, 8))
+        if (ImGui::SliderInt("Num cascades", &m_LightAttribs.ShadowAttribs.iNumCascades, 1, MaxCascades))
             CreateShadowMap();
 
+        if (m_pScheduler)
+            ImGui::Checkbox("Record cascades in parallel", &m_ShadowSettings.MultithreadedCascades);
+
         {
             int Is32Bit = m_ShadowSettings.Format == TEX_FORMAT_D16_UNORM ? 0 : 1;
             if (ImGui::Combo("Shadow map format", &Is32Bit,
@@ -322,35 +351,40 @@ void ShadowsSample::DXSDKMESH_VERTEX_ELEMENTtoInputLayoutDesc(const DXSDKMESH_VE
 void ShadowsSample::CreatePipelineStates()
 {
     ShaderMacroHelper Macros;
-    Macros.AddShaderMacro("SHADOW_MODE", m_ShadowSettings.iShadowMode);
-    Macros.AddShaderMacro("SHADOW_FILTER_SIZE", m_LightAttribs.ShadowAttribs.iFixedFilterSize);
-    Macros.AddShaderMacro("FILTER_ACROSS_CASCADES", m_ShadowSettings.FilterAcrossCascades);
-    Macros.AddShaderMacro("BEST_CASCADE_SEARCH", m_ShadowSettings.SearchBestCascade);
-
-    RefCntAutoPtr<IShader> pGeometryVS;
-    RefCntAutoPtr<IShader> pGeometryPS;
+    ShaderMacroHelper ShadowMacros;
+    for (auto* pMacros : {&Macros, &ShadowMacros})
     {
-        auto ModifyCI = MakeCallback([&](ShaderCreateInfo& ShaderCI) {
-            ShaderCI.Macros = Macros;
-        });
-
-        m_pRSNLoader->LoadShader({"Mesh VS", false, ModifyCI, ModifyCI}, &pGeometryVS);
-        m_pRSNLoader->LoadShader({"Mesh PS", false, ModifyCI, ModifyCI}, &pGeometryPS);
+        pMacros->AddShaderMacro("SHADOW_MODE", m_ShadowSettings.iShadowMode);
+        pMacros->AddShaderMacro("SHADOW_FILTER_SIZE", m_LightAttribs.ShadowAttribs.iFixedFilterSize);
+        pMacros->AddShaderMacro("FILTER_ACROSS_CASCADES", m_ShadowSettings.FilterAcrossCascades);
+        pMacros->AddShaderMacro("BEST_CASCADE_SEARCH", m_ShadowSettings.SearchBestCascade);
     }
-
-    Macros.AddShaderMacro("SHADOW_PASS", true);
-    RefCntAutoPtr<IShader> pShadowVS;
-    {
-        auto ModifyCI = MakeCallback([&](ShaderCreateInfo& ShaderCI) {
-            ShaderCI.Macros = Macros;
+    ShadowMacros.AddShaderMacro("SHADOW_PASS", true);
+    // Shaders are loaded concurrently, so the macros are finalized up front
+    Macros.Finalize();
+    ShadowMacros.Finalize();
+
+    PipelineStateBatch PSOBatch{m_pDevice};
+
+    auto AddShader = [&](const char* Name, const ShaderMacroHelper& ShaderMacros) {
+        return PSOBatch.AddShader([this, Name, &ShaderMacros](IShader** ppShader) {
+            auto ModifyCI = MakeCallback([&](ShaderCreateInfo& ShaderCI) {
+                ShaderCI.Macros = ShaderMacros;
+                if (m_pShaderCache != nullptr)
+                    m_pShaderCache->ResolveBytecode(ShaderCI);
+            });
+            m_pRSNLoader->LoadShader({Name, false, ModifyCI, ModifyCI}, ppShader);
         });
+    };
 
-        m_pRSNLoader->LoadShader({"Mesh VS", false, ModifyCI, ModifyCI}, &pShadowVS);
-    }
+    auto GeometryVS = AddShader("Mesh VS", Macros);
+    auto GeometryPS = AddShader("Mesh PS", Macros);
+    auto ShadowVS   = AddShader("Mesh VS", ShadowMacros);
 
+    // Find unique input layouts first, so that one PSO pair per layout can be created in parallel
+    std::vector<std::vector<LayoutElement>> LayoutElements;
+    std::vector<InputLayoutDesc>            InputLayouts;
     m_PSOIndex.resize(m_Mesh.GetNumVBs());
-    m_RenderMeshPSO.clear();
-    m_RenderMeshShadowPSO.clear();
     for (Uint32 vb = 0; vb < m_Mesh.GetNumVBs(); ++vb)
     {
         std::vector<LayoutElement> Elements;
@@ -359,22 +393,30 @@ void ShadowsSample::CreatePipelineStates()
 
         //  Try to find PSO with the same layout
         Uint32 pso;
-        for (pso = 0; pso < m_RenderMeshPSO.size(); ++pso)
+        for (pso = 0; pso < InputLayouts.size(); ++pso)
         {
-            const auto& PSOLayout = m_RenderMeshPSO[pso]->GetGraphicsPipelineDesc().InputLayout;
-            if (PSOLayout == InputLayout)
+            if (InputLayouts[pso] == InputLayout)
                 break;
         }
 
         m_PSOIndex[vb] = pso;
-        if (pso < static_cast<Uint32>(m_RenderMeshPSO.size()))
+        if (pso < static_cast<Uint32>(InputLayouts.size()))
             continue;
 
-        {
-            ShaderResourceVariableDesc Vars[] = {
-                {SHADER_TYPE_PIXEL, "g_tex2DDiffuse", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
-                {SHADER_TYPE_PIXEL, m_ShadowSettings.iShadowMode == SHADOW_MODE_PCF ? "g_tex2DShadowMap" : "g_tex2DFilterableShadowMap", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}};
+        // Moving the vector keeps its storage, so the layout remains valid
+        LayoutElements.emplace_back(std::move(Elements));
+        InputLayouts.emplace_back(InputLayout);
+    }
 
+    ShaderResourceVariableDesc Vars[] = {
+        {SHADER_TYPE_PIXEL, "g_tex2DDiffuse", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_PIXEL, m_ShadowSettings.iShadowMode == SHADOW_MODE_PCF ? "g_tex2DShadowMap" : "g_tex2DFilterableShadowMap", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}};
+
+    std::vector<PipelineStateBatch::PipelineStateFuture> RenderMeshPSOs;
+    std::vector<PipelineStateBatch::PipelineStateFuture> RenderMeshShadowPSOs;
+    for (const auto& InputLayout : InputLayouts)
+    {
+        RenderMeshPSOs.emplace_back(PSOBatch.AddPipelineState([&](IPipelineState** ppPSO) {
             auto ModifyCI = MakeCallback([&](PipelineStateCreateInfo& PipelineCI) {
                 auto& GraphicsPipelineCI = static_cast<GraphicsPipelineStateCreateInfo&>(PipelineCI);
 
@@ -386,35 +428,73 @@ void ShadowsSample::CreatePipelineStates()
                 GraphicsPipelineCI.GraphicsPipeline.DSVFormat        = m_pSwapChain->GetDesc().DepthBufferFormat;
                 GraphicsPipelineCI.GraphicsPipeline.NumRenderTargets = 1;
 
-                GraphicsPipelineCI.pVS = pGeometryVS;
-                GraphicsPipelineCI.pPS = pGeometryPS;
+                GraphicsPipelineCI.pVS = GeometryVS.get();
+                GraphicsPipelineCI.pPS = GeometryPS.get();
             });
+            m_pRSNLoader->LoadPipelineState({"Mesh PSO", PIPELINE_TYPE_GRAPHICS, false, ModifyCI, ModifyCI}, ppPSO);
+        }));
 
-            RefCntAutoPtr<IPipelineState> pRenderMeshPSO;
-            m_pRSNLoader->LoadPipelineState({"Mesh PSO", PIPELINE_TYPE_GRAPHICS, false, ModifyCI, ModifyCI}, &pRenderMeshPSO);
-
-            pRenderMeshPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "cbCameraAttribs")->Set(m_CameraAttribsCB);
-            pRenderMeshPSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "cbLightAttribs")->Set(m_LightAttribsCB);
-            pRenderMeshPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "cbLightAttribs")->Set(m_LightAttribsCB);
-            m_RenderMeshPSO.emplace_back(std::move(pRenderMeshPSO));
-        }
-
-        {
+        RenderMeshShadowPSOs.emplace_back(PSOBatch.AddPipelineState([&](IPipelineState** ppPSO) {
             auto ModifyCI = MakeCallback([&](PipelineStateCreateInfo& PipelineCI) {
                 auto& GraphicsPipelineCI = static_cast<GraphicsPipelineStateCreateInfo&>(PipelineCI);
 
                 GraphicsPipelineCI.GraphicsPipeline.InputLayout = InputLayout;
                 GraphicsPipelineCI.GraphicsPipeline.DSVFormat   = m_ShadowSettings.Format;
 
-                GraphicsPipelineCI.pVS = pShadowVS;
+                GraphicsPipelineCI.pVS = ShadowVS.get();
             });
+            m_pRSNLoader->LoadPipelineState({"Mesh Shadow PSO", PIPELINE_TYPE_GRAPHICS, false, ModifyCI, ModifyCI}, ppPSO);
+        }));
+    }
+
+    PSOBatch.Execute(m_pScheduler.get());
+
+    m_RenderMeshPSO.clear();
+    m_RenderMeshShadowPSO.clear();
+    for (size_t pso = 0; pso < InputLayouts.size(); ++pso)
+    {
+        auto pRenderMeshPSO = RenderMeshPSOs[pso].get();
+        pRenderMeshPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "cbCameraAttribs")->Set(m_CameraAttribsCB);
+        pRenderMeshPSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "cbLightAttribs")->Set(m_LightAttribsCB);
+        pRenderMeshPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "cbLightAttribs")->Set(m_LightAttribsCB);
+        m_RenderMeshPSO.emplace_back(std::move(pRenderMeshPSO));
+
+        auto pRenderMeshShadowPSO = RenderMeshShadowPSOs[pso].get();
+        pRenderMeshShadowPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "cbCameraAttribs")->Set(m_CameraAttribsCB);
+        m_RenderMeshShadowPSO.emplace_back(std::move(pRenderMeshShadowPSO));
+    }
+
+    BuildDrawPackets();
+}
+
+void ShadowsSample::BuildDrawPackets()
+{
+    m_DrawPackets.clear();
+    for (Uint32 meshIdx = 0; meshIdx < m_Mesh.GetNumMeshes(); ++meshIdx)
+    {
+        const auto& SubMesh = m_Mesh.GetMesh(meshIdx);
+        for (Uint32 subsetIdx = 0; subsetIdx < SubMesh.NumSubsets; ++subsetIdx)
+        {
+            const auto& Subset = m_Mesh.GetSubset(meshIdx, subsetIdx);
 
-            RefCntAutoPtr<IPipelineState> pRenderMeshShadowPSO;
-            m_pRSNLoader->LoadPipelineState({"Mesh Shadow PSO", PIPELINE_TYPE_GRAPHICS, false, ModifyCI, ModifyCI}, &pRenderMeshShadowPSO);
-            pRenderMeshShadowPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "cbCameraAttribs")->Set(m_CameraAttribsCB);
-            m_RenderMeshShadowPSO.emplace_back(std::move(pRenderMeshShadowPSO));
+            DrawPacket Packet;
+            Packet.MeshIdx    = meshIdx;
+            Packet.PSOIndex   = m_PSOIndex[SubMesh.VertexBuffers[0]];
+            Packet.VBIndex    = SubMesh.VertexBuffers[0];
+            Packet.MaterialID = Subset.MaterialID;
+            Packet.pVB        = m_Mesh.GetMeshVertexBuffer(meshIdx, 0);
+            Packet.pIB        = m_Mesh.GetMeshIndexBuffer(meshIdx);
+            Packet.IBFormat   = m_Mesh.GetIBFormat(meshIdx);
+            Packet.FirstIndex = static_cast<Uint32>(Subset.IndexStart);
+            Packet.NumIndices = static_cast<Uint32>(Subset.IndexCount);
+            m_DrawPackets.emplace_back(Packet);
         }
     }
+
+    std::stable_sort(m_DrawPackets.begin(), m_DrawPackets.end(),
+                     [](const DrawPacket& P0, const DrawPacket& P1) {
+                         return std::tie(P0.PSOIndex, P0.VBIndex, P0.MaterialID) < std::tie(P1.PSOIndex, P1.VBIndex, P1.MaterialID);
+                     });
 }
 
 void ShadowsSample::InitializeResourceBindings()
@@ -496,41 +576,93 @@ void ShadowsSample::CreateShadowMap()
     InitializeResourceBindings();
 }
 
-void ShadowsSample::RenderShadowMap()
+void ShadowsSample::RenderShadowCascade(IDeviceContext* pCtx, Uint32 iCascade)
 {
-    auto iNumShadowCascades = m_LightAttribs.ShadowAttribs.iNumCascades;
-    for (int iCascade = 0; iCascade < iNumShadowCascades; ++iCascade)
+    const auto CascadeProjMatr = m_ShadowMapMgr.GetCascadeTranform(iCascade).Proj;
+
+    auto WorldToLightViewSpaceMatr = m_LightAttribs.ShadowAttribs.mWorldToLightViewT.Transpose();
+    auto WorldToLightProjSpaceMatr = WorldToLightViewSpaceMatr * CascadeProjMatr;
+
+    CameraAttribs ShadowCameraAttribs = {};
+
+    ShadowCameraAttribs.mViewT     = m_LightAttribs.ShadowAttribs.mWorldToLightViewT;
+    ShadowCameraAttribs.mProjT     = CascadeProjMatr.Transpose();
+    ShadowCameraAttribs.mViewProjT = WorldToLightProjSpaceMatr.Transpose();
+
+    ShadowCameraAttribs.f4ViewportSize.x = static_cast<float>(m_ShadowSettings.Resolution);
+    ShadowCameraAttribs.f4ViewportSize.y = static_cast<float>(m_ShadowSettings.Resolution);
+    ShadowCameraAttribs.f4ViewportSize.z = 1.f / ShadowCameraAttribs.f4ViewportSize.x;
+    ShadowCameraAttribs.f4ViewportSize.w = 1.f / ShadowCameraAttribs.f4ViewportSize.y;
+
     {
-        const auto CascadeProjMatr = m_ShadowMapMgr.GetCascadeTranform(iCascade).Proj;
+        // Dynamic buffers must be mapped in every context that uses them
+        MapHelper<CameraAttribs> CameraData(pCtx, m_CameraAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
+        *CameraData = ShadowCameraAttribs;
+    }
 
-        auto WorldToLightViewSpaceMatr = m_LightAttribs.ShadowAttribs.mWorldToLightViewT.Transpose();
-        auto WorldToLightProjSpaceMatr = WorldToLightViewSpaceMatr * CascadeProjMatr;
+    // The shadow map has been transitioned to the depth write state by RenderShadowMap()
+    auto* pCascadeDSV = m_ShadowMapMgr.GetCascadeDSV(iCascade);
+    pCtx->SetRenderTargets(0, nullptr, pCascadeDSV, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+    pCtx->ClearDepthStencil(pCascadeDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+
+    DrawMesh(pCtx, true, m_ShadowVisibility, 1u << iCascade);
+}
 
-        CameraAttribs ShadowCameraAttribs = {};
+void ShadowsSample::RenderShadowMap()
+{
+    const auto NumCascades = static_cast<Uint32>(m_LightAttribs.ShadowAttribs.iNumCascades);
 
-        ShadowCameraAttribs.mViewT     = m_LightAttribs.ShadowAttribs.mWorldToLightViewT;
-        ShadowCameraAttribs.mProjT     = CascadeProjMatr.Transpose();
-        ShadowCameraAttribs.mViewProjT = WorldToLightProjSpaceMatr.Transpose();
+    // Cull all meshes against all cascades in a single pass
+    ViewFrustum        CascadeFrusta[MaxCascades];
+    const ViewFrustum* pCascadeFrusta[MaxCascades];
+    for (Uint32 iCascade = 0; iCascade < NumCascades; ++iCascade)
+    {
+        auto WorldToLightViewSpaceMatr = m_LightAttribs.ShadowAttribs.mWorldToLightViewT.Transpose();
+        auto WorldToLightProjSpaceMatr = WorldToLightViewSpaceMatr * m_ShadowMapMgr.GetCascadeTranform(iCascade).Proj;
+        ExtractViewFrustumPlanesFromMatrix(WorldToLightProjSpaceMatr, CascadeFrusta[iCascade], m_pDevice->GetDeviceInfo().IsGLDevice());
+        pCascadeFrusta[iCascade] = &CascadeFrusta[iCascade];
+    }
+    // Notice that for shadow pass we test against frustum with open near plane
+    m_MeshCuller.Cull(pCascadeFrusta, NumCascades, FRUSTUM_PLANE_FLAG_OPEN_NEAR, m_ShadowVisibility.data());
 
-        ShadowCameraAttribs.f4ViewportSize.x = static_cast<float>(m_ShadowSettings.Resolution);
-        ShadowCameraAttribs.f4ViewportSize.y = static_cast<float>(m_ShadowSettings.Resolution);
-        ShadowCameraAttribs.f4ViewportSize.z = 1.f / ShadowCameraAttribs.f4ViewportSize.x;
-        ShadowCameraAttribs.f4ViewportSize.w = 1.f / ShadowCameraAttribs.f4ViewportSize.y;
+    // Deferred contexts only verify resource states, so perform all transitions up front
+    StateTransitionDesc Barrier{m_ShadowMapMgr.GetSRV()->GetTexture(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_DEPTH_WRITE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    m_pImmediateContext->TransitionResourceStates(1, &Barrier);
+    m_pImmediateContext->TransitionShaderResources(m_RenderMeshShadowPSO[0], m_ShadowSRBs[0]);
 
-        {
-            MapHelper<CameraAttribs> CameraData(m_pImmediateContext, m_CameraAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
-            *CameraData = ShadowCameraAttribs;
-        }
+    if (m_pScheduler && m_ShadowSettings.MultithreadedCascades && NumCascades > 1)
+    {
+        // Every cascade is a separate chunk, so chunk index is the cascade index
+        m_ShadowCmdLists.resize(NumCascades);
+        m_pScheduler->ParallelFor(
+            NumCascades, NumCascades,
+            [this](Uint32 ThreadId, Uint32 iCascade, Uint32, Uint32) {
+                // Every thread should use its own deferred context
+                IDeviceContext* pDeferredCtx = m_pDeferredContexts[ThreadId];
+                pDeferredCtx->Begin(0);
+                RenderShadowCascade(pDeferredCtx, iCascade);
+                pDeferredCtx->FinishCommandList(&m_ShadowCmdLists[iCascade]);
+            });
 
-        auto* pCascadeDSV = m_ShadowMapMgr.GetCascadeDSV(iCascade);
-        m_pImmediateContext->SetRenderTargets(0, nullptr, pCascadeDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-        m_pImmediateContext->ClearDepthStencil(pCascadeDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_ShadowCmdListPtrs.resize(m_ShadowCmdLists.size());
+        for (Uint32 i = 0; i < m_ShadowCmdLists.size(); ++i)
+            m_ShadowCmdListPtrs[i] = m_ShadowCmdLists[i];
 
-        ViewFrustumExt Frutstum;
-        ExtractViewFrustumPlanesFromMatrix(WorldToLightProjSpaceMatr, Frutstum, m_pDevice->GetDeviceInfo().IsGLDevice());
+        m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_ShadowCmdListPtrs.size()), m_ShadowCmdListPtrs.data());
 
-        //if (iCascade == 0)
-        DrawMesh(m_pImmediateContext, true, Frutstum);
+        for (auto& cmdList : m_ShadowCmdLists)
+            cmdList.Release();
+
+        // FinishFrame() must be called from the thread that recorded the commands
+        m_pScheduler->RunOnEachWorker([this](Uint32 WorkerId) {
+            m_pDeferredContexts[WorkerId]->FinishFrame();
+        });
+        m_pDeferredContexts[m_pScheduler->GetNumWorkers()]->FinishFrame();
+    }
+    else
+    {
+        for (Uint32 iCascade = 0; iCascade < NumCascades; ++iCascade)
+            RenderShadowCascade(m_pImmediateContext, iCascade);
     }
 
     if (m_ShadowSettings.iShadowMode > SHADOW_MODE_PCF)
@@ -575,49 +707,74 @@ void ShadowsSample::Render()
         CamAttribs->f4Position    = float4(CameraWorldPos, 1);
     }
 
-    ViewFrustumExt Frutstum;
-    ExtractViewFrustumPlanesFromMatrix(CameraViewProj, Frutstum, m_pDevice->GetDeviceInfo().IsGLDevice());
-    DrawMesh(m_pImmediateContext, false, Frutstum);
+    ViewFrustum Frustum;
+    ExtractViewFrustumPlanesFromMatrix(CameraViewProj, Frustum, m_pDevice->GetDeviceInfo().IsGLDevice());
+    const ViewFrustum* pFrustum = &Frustum;
+    m_MeshCuller.Cull(&pFrustum, 1, FRUSTUM_PLANE_FLAG_FULL_FRUSTUM, m_CameraVisibility.data());
+    DrawMesh(m_pImmediateContext, false, m_CameraVisibility, 1u);
 }
 
 
-void ShadowsSample::DrawMesh(IDeviceContext* pCtx, bool bIsShadowPass, const ViewFrustumExt& Frustum)
+void ShadowsSample::DrawMesh(IDeviceContext* pCtx, bool bIsShadowPass, const std::vector<Uint32>& Visibility, Uint32 VisibilityMask)
 {
-    // Note that Vulkan requires shadow map to be transitioned to DEPTH_READ state, not SHADER_RESOURCE
-    pCtx->TransitionShaderResources((bIsShadowPass ? m_RenderMeshShadowPSO : m_RenderMeshPSO)[0], (bIsShadowPass ? m_ShadowSRBs : m_SRBs)[0]);
-
-    for (Uint32 meshIdx = 0; meshIdx < m_Mesh.GetNumMeshes(); ++meshIdx)
+    // Shadow pass resources are transitioned by RenderShadowMap() because deferred contexts can't do that
+    if (!bIsShadowPass)
     {
-        const auto& SubMesh = m_Mesh.GetMesh(meshIdx);
-        BoundBox    BB;
-        BB.Min = SubMesh.BoundingBoxCenter - SubMesh.BoundingBoxExtents * 0.5f;
-        BB.Max = SubMesh.BoundingBoxCenter + SubMesh.BoundingBoxExtents * 0.5f;
-        // Notice that for shadow pass we test against frustum with open near plane
-        if (GetBoxVisibility(Frustum, BB, bIsShadowPass ? FRUSTUM_PLANE_FLAG_OPEN_NEAR : FRUSTUM_PLANE_FLAG_FULL_FRUSTUM) == BoxVisibility::Invisible)
-            continue;
+        // Note that Vulkan requires shadow map to be transitioned to DEPTH_READ state, not SHADER_RESOURCE
+        pCtx->TransitionShaderResources(m_RenderMeshPSO[0], m_SRBs[0]);
+    }
 
-        IBuffer* pVBs[] = {m_Mesh.GetMeshVertexBuffer(meshIdx, 0)};
-        pCtx->SetVertexBuffers(0, 1, pVBs, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
+    const auto& PSOs = bIsShadowPass ? m_RenderMeshShadowPSO : m_RenderMeshPSO;
 
-        auto* pIB      = m_Mesh.GetMeshIndexBuffer(meshIdx);
-        auto  IBFormat = m_Mesh.GetIBFormat(meshIdx);
+#ifdef DILIGENT_DEBUG
+    constexpr DRAW_FLAGS DrawFlags = DRAW_FLAG_VERIFY_ALL;
+#else
+    constexpr DRAW_FLAGS DrawFlags = DRAW_FLAG_NONE;
+#endif
 
-        pCtx->SetIndexBuffer(pIB, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+    // Draw packets are sorted by state, so only set the state that differs from the previous packet
+    IPipelineState*         pCurrPSO = nullptr;
+    IShaderResourceBinding* pCurrSRB = nullptr;
+    IBuffer*                pCurrVB  = nullptr;
+    IBuffer*                pCurrIB  = nullptr;
+    for (const auto& Packet : m_DrawPackets)
+    {
+        if ((Visibility[Packet.MeshIdx] & VisibilityMask) == 0)
+            continue;
 
-        auto  PSOIndex = m_PSOIndex[SubMesh.VertexBuffers[0]];
-        auto& pPSO     = (bIsShadowPass ? m_RenderMeshShadowPSO : m_RenderMeshPSO)[PSOIndex];
-        pCtx->SetPipelineState(pPSO);
+        if (Packet.pVB != pCurrVB)
+        {
+            IBuffer* pVBs[] = {Packet.pVB};
+            pCtx->SetVertexBuffers(0, 1, pVBs, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
+            pCurrVB = Packet.pVB;
+        }
 
-        // Draw all subsets
-        for (Uint32 subsetIdx = 0; subsetIdx < SubMesh.NumSubsets; ++subsetIdx)
+        if (Packet.pIB != pCurrIB)
         {
-            const auto& Subset = m_Mesh.GetSubset(meshIdx, subsetIdx);
-            pCtx->CommitShaderResources((bIsShadowPass ? m_ShadowSRBs : m_SRBs)[Subset.MaterialID], RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            pCtx->SetIndexBuffer(Packet.pIB, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            pCurrIB = Packet.pIB;
+        }
 
-            DrawIndexedAttribs drawAttrs(static_cast<Uint32>(Subset.IndexCount), IBFormat, DRAW_FLAG_VERIFY_ALL);
-            drawAttrs.FirstIndexLocation = static_cast<Uint32>(Subset.IndexStart);
-            pCtx->DrawIndexed(drawAttrs);
+        auto* pPSO = PSOs[Packet.PSOIndex].RawPtr();
+        if (pPSO != pCurrPSO)
+        {
+            pCtx->SetPipelineState(pPSO);
+            pCurrPSO = pPSO;
+            // Resources must be committed again after the pipeline changes
+            pCurrSRB = nullptr;
         }
+
+        // Shadow SRBs only reference the camera attribs buffer and are identical for all materials
+        auto* pSRB = (bIsShadowPass ? m_ShadowSRBs[0] : m_SRBs[Packet.MaterialID]).RawPtr();
+        if (pSRB != pCurrSRB)
+        {
+            pCtx->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+            pCurrSRB = pSRB;
+        }
+
+        DrawIndexedAttribs drawAttrs{Packet.NumIndices, Packet.IBFormat, DrawFlags};
+        drawAttrs.FirstIndexLocation = Packet.FirstIndex;
+        pCtx->DrawIndexed(drawAttrs);
     }
 }
 
@@ -33,6 +33,8 @@
 #include "FirstPersonCamera.hpp"
 #include "ShadowMapManager.hpp"
 #include "RenderStateNotationLoader.h"
+#include "TaskScheduler.hpp"
+#include "MeshCuller.hpp"
 
 namespace Diligent
 {
@@ -55,11 +57,15 @@ public:
     virtual void WindowResize(Uint32 Width, Uint32 Height) override final;
 
 private:
-    void DrawMesh(IDeviceContext* pCtx, bool bIsShadowPass, const struct ViewFrustumExt& Frustum);
+    static constexpr int MaxCascades = 8;
+
+    void DrawMesh(IDeviceContext* pCtx, bool bIsShadowPass, const std::vector<Uint32>& Visibility, Uint32 VisibilityMask);
     void CreatePipelineStates();
+    void BuildDrawPackets();
     void InitializeResourceBindings();
     void CreateShadowMap();
     void RenderShadowMap();
+    void RenderShadowCascade(IDeviceContext* pCtx, Uint32 iCascade);
     void UpdateUI();
 
     static void DXSDKMESH_VERTEX_ELEMENTtoInputLayoutDesc(const DXSDKMESH_VERTEX_ELEMENT* VertexElement,
@@ -80,6 +86,8 @@ private:
         int            iShadowMode          = SHADOW_MODE_PCF;
 
         bool Is32BitFilterableFmt = true;
+
+        bool MultithreadedCascades = true;
     } m_ShadowSettings;
 
     DXSDKMesh m_Mesh;
@@ -98,6 +106,32 @@ private:
     std::vector<RefCntAutoPtr<IShaderResourceBinding>> m_SRBs;
     std::vector<RefCntAutoPtr<IShaderResourceBinding>> m_ShadowSRBs;
 
+    // One packet per mesh subset, sorted by PSO, vertex buffer and material to minimize
+    // state changes. Packets are rebuilt when the pipeline states are recreated.
+    struct DrawPacket
+    {
+        Uint32     MeshIdx    = 0;
+        Uint32     PSOIndex   = 0;
+        Uint32     VBIndex    = 0;
+        Uint32     MaterialID = 0;
+        IBuffer*   pVB        = nullptr;
+        IBuffer*   pIB        = nullptr;
+        VALUE_TYPE IBFormat   = VT_UNDEFINED;
+        Uint32     FirstIndex = 0;
+        Uint32     NumIndices = 0;
+    };
+    std::vector<DrawPacket> m_DrawPackets;
+
+    MultiFrustumCuller m_MeshCuller;
+    // Bit i is set if the mesh is visible in cascade i
+    std::vector<Uint32> m_ShadowVisibility;
+    std::vector<Uint32> m_CameraVisibility;
+
+    // Every cascade is recorded by a deferred context into its own command list
+    std::unique_ptr<TaskScheduler>           m_pScheduler;
+    std::vector<RefCntAutoPtr<ICommandList>> m_ShadowCmdLists;
+    std::vector<ICommandList*>               m_ShadowCmdListPtrs;
+
     RefCntAutoPtr<IRenderStateNotationLoader> m_pRSNLoader;
 
     RefCntAutoPtr<ISampler> m_pComparisonSampler;
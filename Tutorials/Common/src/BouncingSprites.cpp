@@ -0,0 +1,247 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#include <cmath>
+
+#include "BouncingSprites.hpp"
+#include "DebugUtilities.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define BOUNCING_SPRITES_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define BOUNCING_SPRITES_NEON 1
+#endif
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Random values are taken from the top 24 bits of the xorshift state
+constexpr float RandNormFactor = 1.f / static_cast<float>(1u << 24);
+
+inline Uint32 NextRandom(Uint32 State)
+{
+    State ^= State << 13;
+    State ^= State >> 17;
+    State ^= State << 5;
+    return State;
+}
+
+struct SpriteArrays
+{
+    float*  PosX;
+    float*  PosY;
+    float*  MoveDirX;
+    float*  MoveDirY;
+    float*  Angle;
+    float*  RotSpeed;
+    Uint32* RandState;
+};
+
+void UpdateSpritesScalar(const SpriteArrays& S, Uint32 Begin, Uint32 End, float ElapsedTime, float Bound, float MaxRotSpeed)
+{
+    const float RandScale = 2.f * MaxRotSpeed * RandNormFactor;
+    for (Uint32 i = Begin; i < End; ++i)
+    {
+        S.Angle[i] += S.RotSpeed[i] * ElapsedTime;
+
+        const bool BounceX = std::abs(S.PosX[i] + S.MoveDirX[i] * ElapsedTime) > Bound;
+        const bool BounceY = std::abs(S.PosY[i] + S.MoveDirY[i] * ElapsedTime) > Bound;
+
+        S.MoveDirX[i] = BounceX ? -S.MoveDirX[i] : S.MoveDirX[i];
+        S.MoveDirY[i] = BounceY ? -S.MoveDirY[i] : S.MoveDirY[i];
+        S.PosX[i] += S.MoveDirX[i] * ElapsedTime;
+        S.PosY[i] += S.MoveDirY[i] * ElapsedTime;
+
+        // Advance the generator unconditionally to match the vectorized path
+        S.RandState[i]           = NextRandom(S.RandState[i]);
+        const float NewRotSpeed = static_cast<float>(static_cast<Int32>(S.RandState[i] >> 8)) * RandScale - MaxRotSpeed;
+        S.RotSpeed[i]            = (BounceX || BounceY) ? NewRotSpeed : S.RotSpeed[i];
+    }
+}
+
+#if BOUNCING_SPRITES_SSE2
+
+Uint32 UpdateSpritesSIMD(const SpriteArrays& S, Uint32 Begin, Uint32 End, float ElapsedTime, float Bound, float MaxRotSpeed)
+{
+    const __m128 dt        = _mm_set1_ps(ElapsedTime);
+    const __m128 bound     = _mm_set1_ps(Bound);
+    const __m128 sign_mask = _mm_set1_ps(-0.f);
+    const __m128 rand_scl  = _mm_set1_ps(2.f * MaxRotSpeed * RandNormFactor);
+    const __m128 max_rot   = _mm_set1_ps(MaxRotSpeed);
+
+    Uint32 i = Begin;
+    for (; i + 4 <= End; i += 4)
+    {
+        __m128 pos_x = _mm_loadu_ps(S.PosX + i);
+        __m128 pos_y = _mm_loadu_ps(S.PosY + i);
+        __m128 dir_x = _mm_loadu_ps(S.MoveDirX + i);
+        __m128 dir_y = _mm_loadu_ps(S.MoveDirY + i);
+        __m128 angle = _mm_loadu_ps(S.Angle + i);
+        __m128 rot   = _mm_loadu_ps(S.RotSpeed + i);
+        __m128i rnd  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(S.RandState + i));
+
+        angle = _mm_add_ps(angle, _mm_mul_ps(rot, dt));
+
+        // |Pos + Dir * dt| > Bound
+        const __m128 bounce_x = _mm_cmpgt_ps(_mm_andnot_ps(sign_mask, _mm_add_ps(pos_x, _mm_mul_ps(dir_x, dt))), bound);
+        const __m128 bounce_y = _mm_cmpgt_ps(_mm_andnot_ps(sign_mask, _mm_add_ps(pos_y, _mm_mul_ps(dir_y, dt))), bound);
+
+        // Flip the sign of the direction of bouncing sprites
+        dir_x = _mm_xor_ps(dir_x, _mm_and_ps(bounce_x, sign_mask));
+        dir_y = _mm_xor_ps(dir_y, _mm_and_ps(bounce_y, sign_mask));
+        pos_x = _mm_add_ps(pos_x, _mm_mul_ps(dir_x, dt));
+        pos_y = _mm_add_ps(pos_y, _mm_mul_ps(dir_y, dt));
+
+        rnd = _mm_xor_si128(rnd, _mm_slli_epi32(rnd, 13));
+        rnd = _mm_xor_si128(rnd, _mm_srli_epi32(rnd, 17));
+        rnd = _mm_xor_si128(rnd, _mm_slli_epi32(rnd, 5));
+
+        const __m128 new_rot = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(rnd, 8)), rand_scl), max_rot);
+        const __m128 bounce  = _mm_or_ps(bounce_x, bounce_y);
+        rot                  = _mm_or_ps(_mm_and_ps(bounce, new_rot), _mm_andnot_ps(bounce, rot));
+
+        _mm_storeu_ps(S.PosX + i, pos_x);
+        _mm_storeu_ps(S.PosY + i, pos_y);
+        _mm_storeu_ps(S.MoveDirX + i, dir_x);
+        _mm_storeu_ps(S.MoveDirY + i, dir_y);
+        _mm_storeu_ps(S.Angle + i, angle);
+        _mm_storeu_ps(S.RotSpeed + i, rot);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(S.RandState + i), rnd);
+    }
+    return i;
+}
+
+#elif BOUNCING_SPRITES_NEON
+
+Uint32 UpdateSpritesSIMD(const SpriteArrays& S, Uint32 Begin, Uint32 End, float ElapsedTime, float Bound, float MaxRotSpeed)
+{
+    const float32x4_t dt        = vdupq_n_f32(ElapsedTime);
+    const float32x4_t bound     = vdupq_n_f32(Bound);
+    const uint32x4_t  sign_mask = vdupq_n_u32(0x80000000u);
+    const float32x4_t rand_scl  = vdupq_n_f32(2.f * MaxRotSpeed * RandNormFactor);
+    const float32x4_t max_rot   = vdupq_n_f32(MaxRotSpeed);
+
+    Uint32 i = Begin;
+    for (; i + 4 <= End; i += 4)
+    {
+        float32x4_t pos_x = vld1q_f32(S.PosX + i);
+        float32x4_t pos_y = vld1q_f32(S.PosY + i);
+        float32x4_t dir_x = vld1q_f32(S.MoveDirX + i);
+        float32x4_t dir_y = vld1q_f32(S.MoveDirY + i);
+        float32x4_t angle = vld1q_f32(S.Angle + i);
+        float32x4_t rot   = vld1q_f32(S.RotSpeed + i);
+        uint32x4_t  rnd   = vld1q_u32(S.RandState + i);
+
+        angle = vaddq_f32(angle, vmulq_f32(rot, dt));
+
+        // |Pos + Dir * dt| > Bound
+        const uint32x4_t bounce_x = vcagtq_f32(vaddq_f32(pos_x, vmulq_f32(dir_x, dt)), bound);
+        const uint32x4_t bounce_y = vcagtq_f32(vaddq_f32(pos_y, vmulq_f32(dir_y, dt)), bound);
+
+        // Flip the sign of the direction of bouncing sprites
+        dir_x = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(dir_x), vandq_u32(bounce_x, sign_mask)));
+        dir_y = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(dir_y), vandq_u32(bounce_y, sign_mask)));
+        pos_x = vaddq_f32(pos_x, vmulq_f32(dir_x, dt));
+        pos_y = vaddq_f32(pos_y, vmulq_f32(dir_y, dt));
+
+        rnd = veorq_u32(rnd, vshlq_n_u32(rnd, 13));
+        rnd = veorq_u32(rnd, vshrq_n_u32(rnd, 17));
+        rnd = veorq_u32(rnd, vshlq_n_u32(rnd, 5));
+
+        const float32x4_t new_rot = vsubq_f32(vmulq_f32(vcvtq_f32_u32(vshrq_n_u32(rnd, 8)), rand_scl), max_rot);
+        rot                       = vbslq_f32(vorrq_u32(bounce_x, bounce_y), new_rot, rot);
+
+        vst1q_f32(S.PosX + i, pos_x);
+        vst1q_f32(S.PosY + i, pos_y);
+        vst1q_f32(S.MoveDirX + i, dir_x);
+        vst1q_f32(S.MoveDirY + i, dir_y);
+        vst1q_f32(S.Angle + i, angle);
+        vst1q_f32(S.RotSpeed + i, rot);
+        vst1q_u32(S.RandState + i, rnd);
+    }
+    return i;
+}
+
+#endif
+
+} // namespace
+
+void BouncingSprites::Resize(size_t Count)
+{
+    PosX.resize(Count);
+    PosY.resize(Count);
+    MoveDirX.resize(Count);
+    MoveDirY.resize(Count);
+    Angle.resize(Count);
+    RotSpeed.resize(Count);
+    RandState.resize(Count);
+
+    for (size_t i = 0; i < Count; ++i)
+    {
+        // Wang hash of the index gives well-distributed seeds for neighboring sprites
+        auto Seed = static_cast<Uint32>(i);
+        Seed      = (Seed ^ 61u) ^ (Seed >> 16);
+        Seed *= 9u;
+        Seed ^= Seed >> 4;
+        Seed *= 0x27d4eb2du;
+        Seed ^= Seed >> 15;
+        // Zero is a fixed point of xorshift
+        RandState[i] = Seed != 0 ? Seed : 1u;
+    }
+}
+
+void UpdateBouncingSprites(BouncingSprites& Sprites,
+                           Uint32           Begin,
+                           Uint32           End,
+                           float            ElapsedTime,
+                           float            Bound,
+                           float            MaxRotSpeed)
+{
+    VERIFY_EXPR(Begin <= End && End <= Sprites.Size());
+
+    const SpriteArrays S{
+        Sprites.PosX.data(),
+        Sprites.PosY.data(),
+        Sprites.MoveDirX.data(),
+        Sprites.MoveDirY.data(),
+        Sprites.Angle.data(),
+        Sprites.RotSpeed.data(),
+        Sprites.RandState.data(),
+    };
+
+#if BOUNCING_SPRITES_SSE2 || BOUNCING_SPRITES_NEON
+    Begin = UpdateSpritesSIMD(S, Begin, End, ElapsedTime, Bound, MaxRotSpeed);
+#endif
+    UpdateSpritesScalar(S, Begin, End, ElapsedTime, Bound, MaxRotSpeed);
+}
+
+} // namespace Diligent
@@ -0,0 +1,70 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Structure-of-arrays storage for sprites that move on straight lines,
+/// rotate at constant speed and bounce off the [-Bound, +Bound] square.
+struct BouncingSprites
+{
+    std::vector<float> PosX;
+    std::vector<float> PosY;
+    std::vector<float> MoveDirX;
+    std::vector<float> MoveDirY;
+    std::vector<float> Angle;
+    std::vector<float> RotSpeed;
+
+    /// Per-sprite xorshift random generator state that selects the new rotation
+    /// speed when the sprite bounces.
+    std::vector<Uint32> RandState;
+
+    /// Resizes all arrays and seeds the random generators.
+    void Resize(size_t Count);
+
+    size_t Size() const { return PosX.size(); }
+};
+
+/// Advances sprites in the range [Begin, End) by ElapsedTime seconds.
+/// A sprite that would leave the square bounces and gets a random rotation
+/// speed in [-MaxRotSpeed, +MaxRotSpeed].
+/// The update is branch-free and uses SSE2 or NEON when available. Disjoint
+/// ranges may be updated from different threads.
+void UpdateBouncingSprites(BouncingSprites& Sprites,
+                           Uint32           Begin,
+                           Uint32           End,
+                           float            ElapsedTime,
+                           float            Bound,
+                           float            MaxRotSpeed);
+
+} // namespace Diligent
@@ -154,7 +154,10 @@ void Tutorial06_Multithreading::Initialize(const SampleInitInfo& InitInfo)
 {
     SampleBase::Initialize(InitInfo);
 
-    m_MaxThreads       = static_cast<int>(m_pDeferredContexts.size());
+    // The thread that calls Render() records chunks too and uses the last deferred context.
+    // If there is only one deferred context, the caller is the only recording thread.
+    const auto NumDeferredCtxs = static_cast<int>(m_pDeferredContexts.size());
+    m_MaxThreads               = NumDeferredCtxs > 1 ? NumDeferredCtxs - 1 : NumDeferredCtxs;
     m_NumWorkerThreads = std::min(4, m_MaxThreads);
 
     std::vector<StateTransitionDesc> Barriers;
@@ -221,77 +224,21 @@ void Tutorial06_Multithreading::PopulateInstanceData()
 
 void Tutorial06_Multithreading::StartWorkerThreads(size_t NumThreads)
 {
-    m_WorkerThreads.resize(NumThreads);
-    for (Uint32 t = 0; t < m_WorkerThreads.size(); ++t)
+    if (NumThreads > 0)
     {
-        m_WorkerThreads[t] = std::thread(WorkerThreadFunc, this, t);
+        // Leave the last deferred context to the caller
+        const auto NumWorkers = std::min(NumThreads, m_pDeferredContexts.size() - 1);
+        m_pScheduler.reset(new TaskScheduler{static_cast<Uint32>(NumWorkers)});
     }
-    m_CmdLists.resize(NumThreads);
 }
 
 void Tutorial06_Multithreading::StopWorkerThreads()
 {
-    m_RenderSubsetSignal.Trigger(true, -1);
-
-    for (auto& thread : m_WorkerThreads)
-    {
-        thread.join();
-    }
-    m_RenderSubsetSignal.Reset();
-    m_WorkerThreads.clear();
+    m_pScheduler.reset();
     m_CmdLists.clear();
 }
 
-void Tutorial06_Multithreading::WorkerThreadFunc(Tutorial06_Multithreading* pThis, Uint32 ThreadNum)
-{
-    // Every thread should use its own deferred context
-    IDeviceContext* pDeferredCtx     = pThis->m_pDeferredContexts[ThreadNum];
-    const int       NumWorkerThreads = static_cast<int>(pThis->m_WorkerThreads.size());
-    for (;;)
-    {
-        // Wait for the signal
-        auto SignaledValue = pThis->m_RenderSubsetSignal.Wait(true, NumWorkerThreads);
-        if (SignaledValue < 0)
-            return;
-
-        pDeferredCtx->Begin(0);
-
-        // Render current subset using the deferred context
-        pThis->RenderSubset(pDeferredCtx, 1 + ThreadNum);
-
-        // Finish command list
-        RefCntAutoPtr<ICommandList> pCmdList;
-        pDeferredCtx->FinishCommandList(&pCmdList);
-        pThis->m_CmdLists[ThreadNum] = pCmdList;
-
-        {
-            // Atomically increment the number of completed threads
-            const auto NumThreadsCompleted = pThis->m_NumThreadsCompleted.fetch_add(1) + 1;
-            if (NumThreadsCompleted == NumWorkerThreads)
-                pThis->m_ExecuteCommandListsSignal.Trigger();
-        }
-
-        pThis->m_GotoNextFrameSignal.Wait(true, NumWorkerThreads);
-
-        // Call FinishFrame() to release dynamic resources allocated by deferred contexts
-        // IMPORTANT: we must wait until the command lists are submitted for execution
-        //            because FinishFrame() invalidates all dynamic resources.
-        // IMPORTANT: In Metal backend FinishFrame must be called from the same
-        //            thread that issued rendering commands.
-        pDeferredCtx->FinishFrame();
-
-        pThis->m_NumThreadsReady.fetch_add(1);
-        // We must wait until all threads reach this point, because
-        // m_GotoNextFrameSignal must be unsignaled before we proceed to
-        // RenderSubsetSignal to avoid one thread going through the loop twice in
-        // a row.
-        while (pThis->m_NumThreadsReady.load() < NumWorkerThreads)
-            std::this_thread::yield();
-        VERIFY_EXPR(!pThis->m_GotoNextFrameSignal.IsTriggered());
-    }
-}
-
-void Tutorial06_Multithreading::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
+void Tutorial06_Multithreading::RenderSubset(IDeviceContext* pCtx, Uint32 StartInst, Uint32 EndInst)
 {
     // Deferred contexts start in default state. We must bind everything to the context.
     // Render targets are set and transitioned to correct states by the main thread, here we only verify the states.
@@ -320,11 +267,6 @@ void Tutorial06_Multithreading::RenderSubset(IDeviceContext* pCtx, Uint32 Subset
 
     // Set the pipeline state
     pCtx->SetPipelineState(m_pPSO);
-    Uint32 NumSubsets   = Uint32{1} + static_cast<Uint32>(m_WorkerThreads.size());
-    Uint32 NumInstances = static_cast<Uint32>(m_InstanceData.size());
-    Uint32 SusbsetSize  = NumInstances / NumSubsets;
-    Uint32 StartInst    = SusbsetSize * Subset;
-    Uint32 EndInst      = (Subset < NumSubsets - 1) ? SusbsetSize * (Subset + 1) : NumInstances;
     for (size_t inst = StartInst; inst < EndInst; ++inst)
     {
         const auto& CurrInstData = m_InstanceData[inst];
@@ -360,37 +302,54 @@ void Tutorial06_Multithreading::Render()
     m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-    if (!m_WorkerThreads.empty())
+    const auto NumInstances = static_cast<Uint32>(m_InstanceData.size());
+    if (!m_pScheduler)
     {
-        m_NumThreadsCompleted.store(0);
-        m_RenderSubsetSignal.Trigger(true);
+        RenderSubset(m_pImmediateContext, 0, NumInstances);
+        return;
     }
 
-    RenderSubset(m_pImmediateContext, 0);
-
-    if (!m_WorkerThreads.empty())
+    // Small chunks let idle threads steal work, but every chunk has to bind all states
+    // and map the constant buffer, so do not make them too small.
+    static constexpr Uint32 MinInstancesPerChunk = 64;
+
+    const auto NumChunks = m_pScheduler->GetRecommendedChunkCount(NumInstances, MinInstancesPerChunk);
+    m_CmdLists.resize(NumChunks);
+    m_pScheduler->ParallelFor(
+        NumInstances, NumChunks,
+        [this](Uint32 ThreadId, Uint32 Chunk, Uint32 StartInst, Uint32 EndInst) {
+            // Every thread should use its own deferred context
+            IDeviceContext* pDeferredCtx = m_pDeferredContexts[ThreadId];
+            pDeferredCtx->Begin(0);
+            RenderSubset(pDeferredCtx, StartInst, EndInst);
+            pDeferredCtx->FinishCommandList(&m_CmdLists[Chunk]);
+        });
+
+    // Execute command lists in chunk order so that the result does not depend on which
+    // thread recorded which chunk.
+    m_CmdListPtrs.resize(m_CmdLists.size());
+    for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
+        m_CmdListPtrs[i] = m_CmdLists[i];
+
+    m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()), m_CmdListPtrs.data());
+
+    for (auto& cmdList : m_CmdLists)
     {
-        m_ExecuteCommandListsSignal.Wait(true, 1);
-
-        m_CmdListPtrs.resize(m_CmdLists.size());
-        for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
-            m_CmdListPtrs[i] = m_CmdLists[i];
-
-        m_pImmediateContext->ExecuteCommandLists(
-            static_cast<Uint32>(m_CmdListPtrs.size()),
-            m_CmdListPtrs.data());
-
-        for (auto& cmdList : m_CmdLists)
-        {
-            // Release command lists now to release all outstanding references.
-            // In d3d11 mode, command lists hold references to the swap chain's back buffer
-            // that cause swap chain resize to fail.
-            cmdList.Release();
-        }
-
-        m_NumThreadsReady.store(0);
-        m_GotoNextFrameSignal.Trigger(true);
+        // Release command lists now to release all outstanding references.
+        // In d3d11 mode, command lists hold references to the swap chain's back buffer
+        // that cause swap chain resize to fail.
+        cmdList.Release();
     }
+
+    // Call FinishFrame() to release dynamic resources allocated by deferred contexts
+    // IMPORTANT: we must wait until the command lists are submitted for execution
+    //            because FinishFrame() invalidates all dynamic resources.
+    // IMPORTANT: In Metal backend FinishFrame must be called from the same
+    //            thread that issued rendering commands.
+    m_pScheduler->RunOnEachWorker([this](Uint32 WorkerId) {
+        m_pDeferredContexts[WorkerId]->FinishFrame();
+    });
+    m_pDeferredContexts[m_pScheduler->GetNumWorkers()]->FinishFrame();
 }
 
 void Tutorial06_Multithreading::Update(double CurrTime, double ElapsedTime)
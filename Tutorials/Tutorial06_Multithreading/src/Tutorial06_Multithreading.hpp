@@ -27,13 +27,12 @@
 
 #pragma once
 
-#include <atomic>
 #include <vector>
+#include <memory>
 #include <thread>
-#include <mutex>
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
-#include "ThreadSignal.hpp"
+#include "TaskScheduler.hpp"
 
 namespace Diligent
 {
@@ -59,25 +58,13 @@ private:
     void StartWorkerThreads(size_t NumThreads);
     void StopWorkerThreads();
 
-    void RenderSubset(IDeviceContext* pCtx, Uint32 Subset);
+    void RenderSubset(IDeviceContext* pCtx, Uint32 StartInst, Uint32 EndInst);
 
-    static void WorkerThreadFunc(Tutorial06_Multithreading* pThis, Uint32 ThreadNum);
-
-    // 下面三个变量类似fence的作用，
-    // 渲染subset 的fence render函数中开启
-    Threading::Signal        m_RenderSubsetSignal;
-
-    // 执行command list的fence，需要所有worker thread record完线程之后才会开启
-    Threading::Signal        m_ExecuteCommandListsSignal;
-
-    // 执行完command list并释放资源后才会开启的，进行下一帧的fence
-    Threading::Signal        m_GotoNextFrameSignal;
-    
-    // 这两个变量会被多个线程访问修改，需要是atomitc的
-    std::atomic_int          m_NumThreadsCompleted;
-    std::atomic_int          m_NumThreadsReady;
-    std::vector<std::thread> m_WorkerThreads;
+    // Records command lists on the worker threads. Idle threads steal chunks of
+    // instances from busy ones, so uneven per-instance cost does not leave cores idle.
+    std::unique_ptr<TaskScheduler> m_pScheduler;
 
+    // One command list per chunk. Lists are executed in chunk order.
     std::vector<RefCntAutoPtr<ICommandList>> m_CmdLists;
     std::vector<ICommandList*>               m_CmdListPtrs;
 
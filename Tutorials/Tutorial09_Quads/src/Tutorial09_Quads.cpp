@@ -39,6 +39,7 @@
 #include "imgui.h"
 #include "ImGuiUtils.hpp"
 #include "QxQuads.h"
+#include "PipelineStateBatch.hpp"
 
 namespace Diligent
 {
@@ -151,19 +152,23 @@ void Tutorial09_Quads::CreatePipelineStates(std::vector<StateTransitionDesc>& Ba
     RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
     m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
     ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+    // Shaders and pipeline states are created in parallel by the batch when Execute() is called
+    PipelineStateBatch PSOBatch{m_pDevice, m_pShaderCache};
+
     // Create a vertex shader
-    RefCntAutoPtr<IShader> pVS, pVSBatched;
+    PipelineStateBatch::ShaderFuture VS, VSBatched;
     {
         ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
         ShaderCI.EntryPoint      = "main";
         ShaderCI.Desc.Name       = "Quad VS";
         // ShaderCI.FilePath        = "quad.vsh";
         ShaderCI.FilePath = "QxQuad.vsh";
-        m_pDevice->CreateShader(ShaderCI, &pVS);
+        VS                = PSOBatch.AddShader(ShaderCI);
         ShaderCI.Desc.Name = "Quad VS Batched";
         // ShaderCI.FilePath  = "quad_batch.vsh";
         ShaderCI.FilePath = "QxQuadBatch.vsh";
-        m_pDevice->CreateShader(ShaderCI, &pVSBatched);
+        VSBatched         = PSOBatch.AddShader(ShaderCI);
 
         // Create dynamic uniform buffer that will store our transformation matrix
         // Dynamic buffers can be frequently updated by the CPU
@@ -176,7 +181,7 @@ void Tutorial09_Quads::CreatePipelineStates(std::vector<StateTransitionDesc>& Ba
     }
 
     // Create pixel shaders
-    RefCntAutoPtr<IShader> pPS, pPSBatched;
+    PipelineStateBatch::ShaderFuture PS, PSBatched;
     {
         ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
         ShaderCI.EntryPoint      = "main";
@@ -184,17 +189,29 @@ void Tutorial09_Quads::CreatePipelineStates(std::vector<StateTransitionDesc>& Ba
         // ShaderCI.FilePath        = "quad.psh";
         ShaderCI.FilePath = "QxQuad.psh";
 
-        m_pDevice->CreateShader(ShaderCI, &pPS);
+        PS = PSOBatch.AddShader(ShaderCI);
 
         ShaderCI.Desc.Name = "Quad PS Batched";
         // ShaderCI.FilePath  = "quad_batch.psh";
         ShaderCI.FilePath = "QxQuadBatch.psh";
         
-        m_pDevice->CreateShader(ShaderCI, &pPSBatched);
+        PSBatched = PSOBatch.AddShader(ShaderCI);
     }
 
-    PSOCreateInfo.pVS = pVS;
-    PSOCreateInfo.pPS = pPS;
+    // Every blend state permutation is a separate pipeline state. The create info is copied
+    // into the request, while the arrays it references live until the batch is executed.
+    PipelineStateBatch::PipelineStateFuture PSOs[2][NumStates];
+    auto AddPipelineStates = [&](int Batched, const PipelineStateBatch::ShaderFuture& QuadVS, const PipelineStateBatch::ShaderFuture& QuadPS) {
+        for (int state = 0; state < NumStates; ++state)
+        {
+            PSOCreateInfo.GraphicsPipeline.BlendDesc = BlendState[state];
+            PSOs[Batched][state]                     = PSOBatch.AddPipelineState([this, PSOCreateInfo, QuadVS, QuadPS](IPipelineState** ppPSO) mutable {
+                PSOCreateInfo.pVS = QuadVS.get();
+                PSOCreateInfo.pPS = QuadPS.get();
+                m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, ppPSO);
+            });
+        }
+    };
 
     // Define variable type that will be used by default
     PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType =
@@ -228,21 +245,7 @@ void Tutorial09_Quads::CreatePipelineStates(std::vector<StateTransitionDesc>& Ba
     // clang-format on
     PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = ImtblSamplers;
     PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(ImtblSamplers);
-    for (int state = 0; state < NumStates; ++state)
-    {
-        PSOCreateInfo.GraphicsPipeline.BlendDesc = BlendState[state];
-        m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pPSO[0][state]);
-
-        // Since we did not explcitly specify the type for 'QuadAttribs' variable, default
-        // type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables never
-        // change and are bound directly to the pipeline state object.
-        m_pPSO[0][state]->GetStaticVariableByName(
-            SHADER_TYPE_VERTEX, "QuadAttribs")->Set(m_QuadAttribsCB);
-
-        if (state > 0)
-            VERIFY(m_pPSO[0][state]->IsCompatibleWith(m_pPSO[0][0]),
-                "PSOs are expected to be compatible");
-    }
+    AddPipelineStates(0, VS, PS);
 
 
     PSOCreateInfo.PSODesc.Name = "Batched Quads PSO";
@@ -261,14 +264,25 @@ void Tutorial09_Quads::CreatePipelineStates(std::vector<StateTransitionDesc>& Ba
     // clang-format on
     PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElems;
     PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements    = _countof(LayoutElems);
+    AddPipelineStates(1, VSBatched, PSBatched);
 
-    PSOCreateInfo.pVS = pVSBatched;
-    PSOCreateInfo.pPS = pPSBatched;
+    // The scheduler is not running yet, so the batch uses a temporary one
+    PSOBatch.Execute();
 
     for (int state = 0; state < NumStates; ++state)
     {
-        PSOCreateInfo.GraphicsPipeline.BlendDesc = BlendState[state];
-        m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pPSO[1][state]);
+        m_pPSO[0][state] = PSOs[0][state].get();
+        m_pPSO[1][state] = PSOs[1][state].get();
+
+        // Since we did not explcitly specify the type for 'QuadAttribs' variable, default
+        // type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables never
+        // change and are bound directly to the pipeline state object.
+        m_pPSO[0][state]->GetStaticVariableByName(
+            SHADER_TYPE_VERTEX, "QuadAttribs")->Set(m_QuadAttribsCB);
+
+        if (state > 0)
+            VERIFY(m_pPSO[0][state]->IsCompatibleWith(m_pPSO[0][0]),
+                "PSOs are expected to be compatible");
 #ifdef DILIGENT_DEBUG
         if (state > 0)
         {
@@ -396,7 +410,10 @@ void Tutorial09_Quads::Initialize(const SampleInitInfo& InitInfo)
 {
     SampleBase::Initialize(InitInfo);
 
-    m_MaxThreads       = static_cast<int>(m_pDeferredContexts.size());
+    // The thread that calls Render() records chunks too and uses the last deferred context.
+    // If there is only one deferred context, the caller is the only recording thread.
+    const auto NumDeferredCtxs = static_cast<int>(m_pDeferredContexts.size());
+    m_MaxThreads               = NumDeferredCtxs > 1 ? NumDeferredCtxs - 1 : NumDeferredCtxs;
     m_NumWorkerThreads = std::min(m_NumWorkerThreads, m_MaxThreads);
 
     std::vector<StateTransitionDesc> Barriers;
@@ -415,6 +432,7 @@ void Tutorial09_Quads::Initialize(const SampleInitInfo& InitInfo)
 void Tutorial09_Quads::InitializeQuads()
 {
     m_Quads.resize(m_NumQuads);
+    m_QuadSprites.Resize(m_NumQuads);
 
     std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
                       // to generate consistent distribution.
@@ -427,16 +445,17 @@ void Tutorial09_Quads::InitializeQuads()
     std::uniform_int_distribution<Int32>  tex_distr(0, NumTextures - 1);
     std::uniform_int_distribution<Int32>  state_distr(0, NumStates - 1);
 
+    auto& Sprites = m_QuadSprites;
     for (int quad = 0; quad < m_NumQuads; ++quad)
     {
-        auto& CurrInst     = m_Quads[quad];
-        CurrInst.Size      = scale_distr(gen);
-        CurrInst.Angle     = angle_distr(gen);
-        CurrInst.Pos.x     = pos_distr(gen);
-        CurrInst.Pos.y     = pos_distr(gen);
-        CurrInst.MoveDir.x = move_dir_distr(gen);
-        CurrInst.MoveDir.y = move_dir_distr(gen);
-        CurrInst.RotSpeed  = rot_distr(gen);
+        auto& CurrInst         = m_Quads[quad];
+        CurrInst.Size          = scale_distr(gen);
+        Sprites.Angle[quad]    = angle_distr(gen);
+        Sprites.PosX[quad]     = pos_distr(gen);
+        Sprites.PosY[quad]     = pos_distr(gen);
+        Sprites.MoveDirX[quad] = move_dir_distr(gen);
+        Sprites.MoveDirY[quad] = move_dir_distr(gen);
+        Sprites.RotSpeed[quad] = rot_distr(gen);
         // Texture array index
         CurrInst.TextureInd = tex_distr(gen);
         CurrInst.StateInd   = state_distr(gen);
@@ -445,117 +464,40 @@ void Tutorial09_Quads::InitializeQuads()
 
 void Tutorial09_Quads::UpdateQuads(float elapsedTime)
 {
-    std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
-                      // to generate consistent distribution.
+    // Each chunk is a contiguous range of every array, so chunks can be updated
+    // in parallel without synchronization.
+    static constexpr Uint32 MinQuadsPerChunk = 16384;
 
-    std::uniform_real_distribution<float> rot_distr(-PI_F * 0.5f, +PI_F * 0.5f);
-    for (int quad = 0; quad < m_NumQuads; ++quad)
-    {
-        auto& CurrInst = m_Quads[quad];
-        CurrInst.Angle += CurrInst.RotSpeed * elapsedTime;
-        if (std::abs(CurrInst.Pos.x + CurrInst.MoveDir.x * elapsedTime) > 0.95)
-        {
-            CurrInst.MoveDir.x *= -1.f;
-            CurrInst.RotSpeed = rot_distr(gen);
-        }
-        CurrInst.Pos.x += CurrInst.MoveDir.x * elapsedTime;
-        if (std::abs(CurrInst.Pos.y + CurrInst.MoveDir.y * elapsedTime) > 0.95)
-        {
-            CurrInst.MoveDir.y *= -1.f;
-            CurrInst.RotSpeed = rot_distr(gen);
-        }
-        CurrInst.Pos.y += CurrInst.MoveDir.y * elapsedTime;
-    }
+    auto UpdateRange = [this, elapsedTime](Uint32 /*ThreadId*/, Uint32 /*Chunk*/, Uint32 StartQuad, Uint32 EndQuad) {
+        UpdateBouncingSprites(m_QuadSprites, StartQuad, EndQuad, elapsedTime, 0.95f, PI_F * 0.5f);
+    };
+
+    const auto NumQuads = static_cast<Uint32>(m_QuadSprites.Size());
+    if (m_pScheduler)
+        m_pScheduler->ParallelFor(NumQuads, UpdateRange, MinQuadsPerChunk);
+    else
+        UpdateRange(0, 0, 0, NumQuads);
 }
 
 void Tutorial09_Quads::StartWorkerThreads(size_t NumThreads)
 {
-    m_WorkerThreads.resize(NumThreads);
-    for (Uint32 t = 0; t < m_WorkerThreads.size(); ++t)
+    if (NumThreads > 0)
     {
-        m_WorkerThreads[t] = std::thread(
-            WorkerThreadFunc, this, t);
+        // Leave the last deferred context to the caller
+        const auto NumWorkers = std::min(NumThreads, m_pDeferredContexts.size() - 1);
+        m_pScheduler.reset(new TaskScheduler{static_cast<Uint32>(NumWorkers)});
     }
-    m_CmdLists.resize(NumThreads);
 }
 
 void Tutorial09_Quads::StopWorkerThreads()
 {
-    m_RenderSubsetSignal.Trigger(
-        true, -1);
-
-    for (auto& thread : m_WorkerThreads)
-    {
-        thread.join();
-    }
-    m_RenderSubsetSignal.Reset();
-    m_WorkerThreads.clear();
+    m_pScheduler.reset();
     m_CmdLists.clear();
 }
 
-void Tutorial09_Quads::WorkerThreadFunc(Tutorial09_Quads* pThis, Uint32 ThreadNum)
-{
-    // Every thread should use its own deferred context
-    IDeviceContext* pDeferredCtx =
-        pThis->m_pDeferredContexts[ThreadNum];
-
-    const int NumWorkerThreads = static_cast<int>(pThis->m_WorkerThreads.size());
-    VERIFY_EXPR(NumWorkerThreads > 0);
-    for (;;)
-    {
-        // Wait for the signal
-        auto SignaledValue = pThis->m_RenderSubsetSignal.Wait(true, NumWorkerThreads);
-        if (SignaledValue < 0)
-            return;
-
-        pDeferredCtx->Begin(0);
-
-        // Render current subset using the deferred context
-        if (pThis->m_BatchSize > 1)
-            pThis->RenderSubset<true>(pDeferredCtx, 1 + ThreadNum);
-        else
-            pThis->RenderSubset<false>(pDeferredCtx,
-                1 + ThreadNum);
-
-        // Finish command list
-        RefCntAutoPtr<ICommandList> pCmdList;
-        pDeferredCtx->FinishCommandList(&pCmdList);
-        pThis->m_CmdLists[ThreadNum] = pCmdList;
-
-        {
-            // Atomically increment the number of completed threads
-            const auto NumThreadsCompleted =
-                pThis->m_NumThreadsCompleted.fetch_add(
-                    1) + 1;
-            if (NumThreadsCompleted == NumWorkerThreads)
-                pThis->m_ExecuteCommandListsSignal.Trigger();
-        }
-
-        pThis->m_GotoNextFrameSignal.Wait(true, NumWorkerThreads);
-
-        // Call FinishFrame() to release dynamic resources allocated by deferred contexts
-        // IMPORTANT: we must wait until the command lists are submitted for execution
-        //            because FinishFrame() invalidates all dynamic resources.
-        // IMPORTANT: In Metal backend FinishFrame must be called from the same
-        //            thread that issued rendering commands.
-        pDeferredCtx->FinishFrame();
-
-        pThis->m_NumThreadsReady.fetch_add(1);
-        // We must wait until all threads reach this point, because
-        // m_GotoNextFrameSignal must be unsignaled before we proceed to
-        // RenderSubsetSignal to avoid one thread go through the loop twice in
-        // a row
-        while (pThis->m_NumThreadsReady.load() <
-            NumWorkerThreads)
-            std::this_thread::yield();
-        VERIFY_EXPR(!pThis->m_GotoNextFrameSignal.
-            IsTriggered());
-    }
-}
-
 template <bool UseBatch>
 void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx,
-    Uint32 SubsetIndex)
+    Uint32 StartBatch, Uint32 EndBatch)
 {
     // Deferred contexts start in default state. We must bind everything to the context
     // Render targets are set and transitioned to correct states by the main thread, here we only verify states
@@ -578,16 +520,6 @@ void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx,
     DrawAttrs.Flags       = DRAW_FLAG_VERIFY_ALL;
     DrawAttrs.NumVertices = 4;
 
-    Uint32       NumSubsets   = Uint32{1} +
-        static_cast<Uint32>(m_WorkerThreads.size());
-    const Uint32 TotalQuads   = static_cast<Uint32>(
-        m_Quads.size());
-    const Uint32 TotalBatches = (TotalQuads +
-        m_BatchSize - 1) / m_BatchSize;
-    const Uint32 SusbsetSize  = TotalBatches / NumSubsets;
-    const Uint32 StartBatch   = SusbsetSize * SubsetIndex;
-    const Uint32 EndBatch     = (SubsetIndex < NumSubsets - 1) ?
-        SusbsetSize * (SubsetIndex + 1) : TotalBatches;
     for (Uint32 batch = StartBatch;
         batch < EndBatch; ++batch)
     {
@@ -632,8 +564,8 @@ void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx,
                     0.f,               CurrInstData.Size
                 };
                 // clang-format on
-                float    sinAngle = sinf(CurrInstData.Angle);
-                float    cosAngle = cosf(CurrInstData.Angle);
+                float    sinAngle = sinf(m_QuadSprites.Angle[inst]);
+                float    cosAngle = cosf(m_QuadSprites.Angle[inst]);
                 float2x2 RotMatr(cosAngle, -sinAngle,
                                  sinAngle, cosAngle);
                 auto     Matr = ScaleMatr * RotMatr;
@@ -649,7 +581,7 @@ void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx,
                     CurrQuad.QuadRotationAndScale =
                         QuadRotationAndScale;
                     CurrQuad.QuadCenter           =
-                        CurrInstData.Pos;
+                        float2{m_QuadSprites.PosX[inst], m_QuadSprites.PosY[inst]};
                     CurrQuad.TexArrInd            =
                         static_cast<float>(CurrInstData.TextureInd);
                 }
@@ -669,9 +601,9 @@ void Tutorial09_Quads::RenderSubset(IDeviceContext* pCtx,
                     InstData->g_QuadRotationAndScale =
                         QuadRotationAndScale;
                     InstData->g_QuadCenter.x         =
-                        CurrInstData.Pos.x;
+                        m_QuadSprites.PosX[inst];
                     InstData->g_QuadCenter.y         =
-                        CurrInstData.Pos.y;
+                        m_QuadSprites.PosY[inst];
                 }
             }
         }
@@ -696,39 +628,64 @@ void Tutorial09_Quads::Render()
     m_pImmediateContext->ClearDepthStencil(pDSV,
     CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-    if (!m_WorkerThreads.empty())
+    const Uint32 TotalQuads   = static_cast<Uint32>(m_Quads.size());
+    const Uint32 TotalBatches = (TotalQuads + m_BatchSize - 1) / m_BatchSize;
+    if (!m_pScheduler)
     {
-        m_NumThreadsCompleted.store(0);
-        m_RenderSubsetSignal.Trigger(true);
+        if (m_BatchSize > 1)
+            RenderSubset<true>(m_pImmediateContext, 0, TotalBatches);
+        else
+            RenderSubset<false>(m_pImmediateContext, 0, TotalBatches);
+        return;
     }
 
-    if (m_BatchSize > 1)
-        RenderSubset<true>(m_pImmediateContext, 0);
-    else
-        RenderSubset<false>(m_pImmediateContext, 0);
-
-    if (!m_WorkerThreads.empty())
+    // Every chunk binds render targets and vertex buffers, so keep chunks large
+    // enough for the setup cost to be negligible.
+    static constexpr Uint32 MinQuadsPerChunk = 256;
+
+    const Uint32 MinBatchesPerChunk = std::max(MinQuadsPerChunk / static_cast<Uint32>(m_BatchSize), 1u);
+    const Uint32 NumChunks          = m_pScheduler->GetRecommendedChunkCount(TotalBatches, MinBatchesPerChunk);
+    m_CmdLists.resize(NumChunks);
+    m_pScheduler->ParallelFor(
+        TotalBatches, NumChunks,
+        [this](Uint32 ThreadId, Uint32 Chunk, Uint32 StartBatch, Uint32 EndBatch) {
+            // Every thread should use its own deferred context
+            IDeviceContext* pDeferredCtx = m_pDeferredContexts[ThreadId];
+            pDeferredCtx->Begin(0);
+
+            if (m_BatchSize > 1)
+                RenderSubset<true>(pDeferredCtx, StartBatch, EndBatch);
+            else
+                RenderSubset<false>(pDeferredCtx, StartBatch, EndBatch);
+
+            pDeferredCtx->FinishCommandList(&m_CmdLists[Chunk]);
+        });
+
+    // Quads are alpha-blended, so command lists must be executed in chunk order
+    m_CmdListPtrs.resize(m_CmdLists.size());
+    for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
+        m_CmdListPtrs[i] = m_CmdLists[i];
+
+    m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()),
+        m_CmdListPtrs.data());
+
+    for (auto& cmdList : m_CmdLists)
     {
-        m_ExecuteCommandListsSignal.Wait(true, 1);
-
-        m_CmdListPtrs.resize(m_CmdLists.size());
-        for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
-            m_CmdListPtrs[i] = m_CmdLists[i];
-
-        m_pImmediateContext->ExecuteCommandLists(static_cast<Uint32>(m_CmdListPtrs.size()),
-            m_CmdListPtrs.data());
-
-        for (auto& cmdList : m_CmdLists)
-        {
-            // Release command lists now to release all outstanding references
-            // In d3d11 mode, command lists hold references to the swap chain's back buffer
-            // that cause swap chain resize to fail
-            cmdList.Release();
-        }
-
-        m_NumThreadsReady.store(0);
-        m_GotoNextFrameSignal.Trigger(true);
+        // Release command lists now to release all outstanding references
+        // In d3d11 mode, command lists hold references to the swap chain's back buffer
+        // that cause swap chain resize to fail
+        cmdList.Release();
     }
+
+    // Call FinishFrame() to release dynamic resources allocated by deferred contexts
+    // IMPORTANT: we must wait until the command lists are submitted for execution
+    //            because FinishFrame() invalidates all dynamic resources.
+    // IMPORTANT: In Metal backend FinishFrame must be called from the same
+    //            thread that issued rendering commands.
+    m_pScheduler->RunOnEachWorker([this](Uint32 WorkerId) {
+        m_pDeferredContexts[WorkerId]->FinishFrame();
+    });
+    m_pDeferredContexts[m_pScheduler->GetNumWorkers()]->FinishFrame();
 }
 
 void Tutorial09_Quads::CreateInstanceBuffer()
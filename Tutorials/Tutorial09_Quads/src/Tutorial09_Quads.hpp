@@ -27,13 +27,13 @@
 
 #pragma once
 
-#include <atomic>
 #include <vector>
+#include <memory>
 #include <thread>
-#include <mutex>
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
-#include "ThreadSignal.hpp"
+#include "TaskScheduler.hpp"
+#include "../../Common/src/BouncingSprites.hpp"
 
 namespace Diligent
 {
@@ -63,18 +63,12 @@ private:
     void StartWorkerThreads(size_t NumThreads);
     void StopWorkerThreads();
     template <bool UseBatch>
-    void RenderSubset(IDeviceContext* pCtx, Uint32 SubsetIndex);
+    void RenderSubset(IDeviceContext* pCtx, Uint32 StartBatch, Uint32 EndBatch);
 
-    static void WorkerThreadFunc(Tutorial09_Quads* pThis, Uint32 ThreadNum);
+    std::unique_ptr<TaskScheduler> m_pScheduler;
 
-    Threading::Signal m_RenderSubsetSignal;
-    Threading::Signal m_ExecuteCommandListsSignal;
-    Threading::Signal m_GotoNextFrameSignal;
-
-    std::atomic_int m_NumThreadsCompleted;
-    std::atomic_int m_NumThreadsReady;
-
-    std::vector<std::thread>                 m_WorkerThreads;
+    // One command list per chunk of batches. Lists are executed in chunk order
+    // to preserve the blending order.
     std::vector<RefCntAutoPtr<ICommandList>> m_CmdLists;
     std::vector<ICommandList*>               m_CmdListPtrs;
 
@@ -89,7 +83,7 @@ private:
     RefCntAutoPtr<ITextureView>           m_TextureSRV[NumTextures];
     RefCntAutoPtr<ITextureView>           m_TexArraySRV;
 
-    static constexpr int MaxQuads     = 100000;
+    static constexpr int MaxQuads     = 2000000;
     static constexpr int MaxBatchSize = 100;
 
     int m_NumQuads  = 1000;
@@ -98,18 +92,19 @@ private:
     int m_MaxThreads       = 8;
     int m_NumWorkerThreads = 4;
 
+    // Attributes that do not change after the quads are initialized
     struct QuadData
     {
-        float2 Pos;
-        float2 MoveDir;
-        float  Size       = 0;
-        float  Angle      = 0;
-        float  RotSpeed   = 0;
-        int    TextureInd = 0;
-        int    StateInd   = 0;
+        float Size       = 0;
+        int   TextureInd = 0;
+        int   StateInd   = 0;
     };
     std::vector<QuadData> m_Quads;
 
+    // Position, direction, angle and rotation speed are updated every frame
+    // and are stored as structure of arrays to vectorize the update.
+    BouncingSprites m_QuadSprites;
+
     struct InstanceData
     {
         float4 QuadRotationAndScale;
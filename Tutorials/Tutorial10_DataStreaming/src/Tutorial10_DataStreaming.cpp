@@ -38,94 +38,11 @@
 #include "TextureUtilities.h"
 #include "imgui.h"
 #include "ImGuiUtils.hpp"
+#include "PipelineStateBatch.hpp"
 
 namespace Diligent
 {
 
-class StreamingBuffer
-{
-public:
-    StreamingBuffer(IRenderDevice* pDevice, BIND_FLAGS BindFlags,
-        Uint32 Size, size_t NumContexts, const Char* Name) :
-        m_BufferSize{Size},
-        m_MapInfo(NumContexts)
-    {
-        BufferDesc BuffDesc;
-        BuffDesc.Name           = Name;
-        BuffDesc.Usage          = USAGE_DYNAMIC;
-        BuffDesc.BindFlags      = BindFlags;
-        BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
-        BuffDesc.Size           = Size;
-        pDevice->CreateBuffer(BuffDesc, nullptr, &m_pBuffer);
-    }
-
-    // Returns offset of the allocated region
-    Uint32 Allocate(IDeviceContext* pCtx, Uint32 Size, size_t CtxNum)
-    {
-        auto& MapInfo = m_MapInfo[CtxNum];
-        // Check if there is enough space in the buffer
-        if (MapInfo.m_CurrOffset + Size > m_BufferSize)
-        {
-            // Unmap the buffer
-            Flush(CtxNum);
-        }
-
-        if (MapInfo.m_MappedData == nullptr)
-        {
-            // If current offset is zero, we are mapping the buffer for the first time after it has been flushed. Use MAP_FLAG_DISCARD flag.
-            // Otherwise use MAP_FLAG_NO_OVERWRITE flag.
-            MapInfo.m_MappedData.Map(pCtx, m_pBuffer,
-                MAP_WRITE,
-                MapInfo.m_CurrOffset == 0 ?
-                    MAP_FLAG_DISCARD : MAP_FLAG_NO_OVERWRITE);
-        }
-
-        auto Offset = MapInfo.m_CurrOffset;
-        // Update offset
-        MapInfo.m_CurrOffset += Size;
-        return Offset;
-    }
-
-    void Release(size_t CtxNum)
-    {
-        if (!m_AllowPersistentMap)
-        {
-            m_MapInfo[CtxNum].m_MappedData.Unmap();
-        }
-    }
-
-    void Flush(size_t CtxNum)
-    {
-        m_MapInfo[CtxNum].m_MappedData.Unmap();
-        m_MapInfo[CtxNum].m_CurrOffset = 0;
-    }
-
-    IBuffer* GetBuffer() { return m_pBuffer; }
-    void*    GetMappedCPUAddress(size_t CtxNum)
-    {
-        return m_MapInfo[CtxNum].m_MappedData;
-    }
-
-    void AllowPersistentMapping(bool AllowMapping)
-    {
-        m_AllowPersistentMap = AllowMapping;
-    }
-
-private:
-    RefCntAutoPtr<IBuffer> m_pBuffer;
-    const Uint32           m_BufferSize;
-
-    bool m_AllowPersistentMap = false;
-
-    struct MapInfo
-    {
-        MapHelper<Uint8> m_MappedData;
-        Uint32           m_CurrOffset = 0;
-    };
-    // We need to keep track of mapped data for every context
-    std::vector<MapInfo> m_MapInfo;
-};
-
 SampleBase* CreateSample()
 {
     return new Tutorial10_DataStreaming();
@@ -238,23 +155,25 @@ void Tutorial10_DataStreaming::CreatePipelineStates(std::vector<StateTransitionD
     RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
     m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
     ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+    // Shaders and pipeline states are created in parallel by the batch when Execute() is called
+    PipelineStateBatch PSOBatch{m_pDevice, m_pShaderCache};
+
     // Create a vertex shader
-    RefCntAutoPtr<IShader> pVS, pVSBatched;
+    PipelineStateBatch::ShaderFuture VS, VSBatched;
     {
         ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
         ShaderCI.EntryPoint      = "main";
         ShaderCI.Desc.Name       = "Polygon VS";
         // ShaderCI.FilePath        = "polygon.vsh";
         ShaderCI.FilePath = "QxPolygon.vsh";
-        m_pDevice->CreateShader(ShaderCI, &pVS);
-        VERIFY(pVS);
+        VS                = PSOBatch.AddShader(ShaderCI);
 
 
         ShaderCI.Desc.Name = "Polygon VS Batched";
         // ShaderCI.FilePath  = "polygon_batch.vsh";
         ShaderCI.FilePath = "QxPolygonBatch.vsh";
-        m_pDevice->CreateShader(ShaderCI, &pVSBatched);
-        VERIFY(pVSBatched);
+        VSBatched         = PSOBatch.AddShader(ShaderCI);
 
         // Create dynamic uniform buffer that will store our transformation matrix
         // Dynamic buffers can be frequently updated by the CPU
@@ -270,23 +189,36 @@ void Tutorial10_DataStreaming::CreatePipelineStates(std::vector<StateTransitionD
     }
 
     // Create a pixel shader
-    RefCntAutoPtr<IShader> pPS, pPSBatched;
+    PipelineStateBatch::ShaderFuture PS, PSBatched;
     {
         ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
         ShaderCI.EntryPoint      = "main";
         ShaderCI.Desc.Name       = "Polygon PS";
         // ShaderCI.FilePath        = "polygon.psh";
         ShaderCI.FilePath = "QxPolygon.psh";
-        m_pDevice->CreateShader(ShaderCI, &pPS);
+        PS                = PSOBatch.AddShader(ShaderCI);
 
         ShaderCI.Desc.Name = "Polygon PS Batched";
         // ShaderCI.FilePath  = "polygon_batch.psh";
         ShaderCI.FilePath = "QxPolygonBatch.psh";
-        m_pDevice->CreateShader(ShaderCI, &pPSBatched);
-
-        VERIFY(pPSBatched);
+        PSBatched         = PSOBatch.AddShader(ShaderCI);
     }
 
+    // Every blend state permutation is a separate pipeline state. The create info is copied
+    // into the request, while the arrays it references live until the batch is executed.
+    PipelineStateBatch::PipelineStateFuture PSOs[2][NumStates];
+    auto AddPipelineStates = [&](int Batched, const PipelineStateBatch::ShaderFuture& PolygonVS, const PipelineStateBatch::ShaderFuture& PolygonPS) {
+        for (int state = 0; state < NumStates; ++state)
+        {
+            PSOCreateInfo.GraphicsPipeline.BlendDesc = BlendState[state];
+            PSOs[Batched][state]                     = PSOBatch.AddPipelineState([this, PSOCreateInfo, PolygonVS, PolygonPS](IPipelineState** ppPSO) mutable {
+                PSOCreateInfo.pVS = PolygonVS.get();
+                PSOCreateInfo.pPS = PolygonPS.get();
+                m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, ppPSO);
+            });
+        }
+    };
+
     // clang-format off
     LayoutElement LayoutElem[] =
     {
@@ -302,9 +234,6 @@ void Tutorial10_DataStreaming::CreatePipelineStates(std::vector<StateTransitionD
     PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElem;
     PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements    = _countof(LayoutElem);
 
-    PSOCreateInfo.pVS = pVS;
-    PSOCreateInfo.pPS = pPS;
-
     // Define variable type that will be used by default
     PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
 
@@ -336,23 +265,7 @@ void Tutorial10_DataStreaming::CreatePipelineStates(std::vector<StateTransitionD
     // clang-format on
     PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = ImtblSamplers;
     PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(ImtblSamplers);
-
-    for (int state = 0; state < NumStates; ++state)
-    {
-        PSOCreateInfo.GraphicsPipeline.BlendDesc = BlendState[state];
-        m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo,
-            &m_pPSO[0][state]);
-        // Since we did not explcitly specify the type for 'PolygonAttribs' variable, default
-        // type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables never
-        // change and are bound directly to the pipeline state object.
-        m_pPSO[0][state]->GetStaticVariableByName(
-            SHADER_TYPE_VERTEX,
-            "PolygonAttribs")->Set(m_PolygonAttribsCB);
-
-        if (state > 0)
-            VERIFY(m_pPSO[0][state]->IsCompatibleWith(m_pPSO[0][0]),
-                "PSOs are expected to be compatible");
-    }
+    AddPipelineStates(0, VS, PS);
 
 
     PSOCreateInfo.PSODesc.Name = "Batched Polygon PSO";
@@ -382,15 +295,27 @@ void Tutorial10_DataStreaming::CreatePipelineStates(std::vector<StateTransitionD
     // clang-format on
     PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = BatchLayoutElems;
     PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements    = _countof(BatchLayoutElems);
+    AddPipelineStates(1, VSBatched, PSBatched);
 
-    PSOCreateInfo.pVS = pVSBatched;
-    PSOCreateInfo.pPS = pPSBatched;
+    // The scheduler is not running yet, so the batch uses a temporary one
+    PSOBatch.Execute();
 
     for (int state = 0; state < NumStates; ++state)
     {
-        PSOCreateInfo.GraphicsPipeline.BlendDesc = BlendState[state];
-        m_pDevice->CreateGraphicsPipelineState(
-            PSOCreateInfo, &m_pPSO[1][state]);
+        m_pPSO[0][state] = PSOs[0][state].get();
+        m_pPSO[1][state] = PSOs[1][state].get();
+        VERIFY(m_pPSO[0][state] && m_pPSO[1][state], "Failed to create polygon PSOs");
+
+        // Since we did not explcitly specify the type for 'PolygonAttribs' variable, default
+        // type (SHADER_RESOURCE_VARIABLE_TYPE_STATIC) will be used. Static variables never
+        // change and are bound directly to the pipeline state object.
+        m_pPSO[0][state]->GetStaticVariableByName(
+            SHADER_TYPE_VERTEX,
+            "PolygonAttribs")->Set(m_PolygonAttribsCB);
+
+        if (state > 0)
+            VERIFY(m_pPSO[0][state]->IsCompatibleWith(m_pPSO[0][0]),
+                "PSOs are expected to be compatible");
 #ifdef DILIGENT_DEBUG
         if (state > 0)
         {
@@ -489,11 +414,13 @@ void Tutorial10_DataStreaming::UpdateUI()
         {
             m_NumPolygons = clamp(m_NumPolygons, 1, MaxPolygons);
             InitializePolygons();
+            CreateStreamingBuffers();
         }
         if (ImGui::InputInt("Batch Size", &m_BatchSize, 1, 5))
         {
             m_BatchSize = clamp(m_BatchSize, 1, MaxBatchSize);
             CreateInstanceBuffer();
+            CreateStreamingBuffers();
         }
         {
             ImGui::ScopedDisabler Disable(m_MaxThreads == 0);
@@ -504,11 +431,22 @@ void Tutorial10_DataStreaming::UpdateUI()
                 StartWorkerThreads(m_NumWorkerThreads);
             }
         }
-        if (m_pDevice->GetDeviceInfo().Type == RENDER_DEVICE_TYPE_D3D12 ||
-            m_pDevice->GetDeviceInfo().Type == RENDER_DEVICE_TYPE_VULKAN)
         {
-            ImGui::Checkbox("Persistent map", &m_bAllowPersistentMap);
+            // Persistent mapping requires CPU-writable unified memory
+            const auto& MemInfo = m_pDevice->GetAdapterInfo().Memory;
+            ImGui::ScopedDisabler Disable(MemInfo.UnifiedMemory == 0 || (MemInfo.UnifiedMemoryCPUAccess & CPU_ACCESS_WRITE) == 0);
+            if (ImGui::Checkbox("Persistent map", &m_bAllowPersistentMap))
+                CreateStreamingBuffers();
         }
+
+        const auto VBStats = m_StreamingVB->GetStatistics();
+        const auto IBStats = m_StreamingIB->GetStatistics();
+        ImGui::Text("Streaming: %s", m_StreamingVB->IsPersistentlyMapped() ? "persistent map" : "staged upload");
+        ImGui::Text("Frame data: %.1f KB", static_cast<double>(VBStats.LastFrameSize + IBStats.LastFrameSize) / 1024.0);
+        ImGui::Text("Ring peak use: %.1f / %.1f MB",
+                    static_cast<double>(VBStats.PeakUsedSize + IBStats.PeakUsedSize) / (1 << 20),
+                    static_cast<double>(VBStats.Capacity + IBStats.Capacity) / (1 << 20));
+        ImGui::Text("GPU stalls: %u", VBStats.NumStalls + IBStats.NumStalls);
     }
     ImGui::End();
 }
@@ -518,27 +456,19 @@ void Tutorial10_DataStreaming::Initialize(const SampleInitInfo& InitInfo)
 {
     SampleBase::Initialize(InitInfo);
 
-    m_MaxThreads       = static_cast<int>(m_pDeferredContexts.size());
+    // The thread that calls Render() records chunks too and uses the last deferred context.
+    // If there is only one deferred context, the caller is the only recording thread.
+    const auto NumDeferredCtxs = static_cast<int>(m_pDeferredContexts.size());
+    m_MaxThreads               = NumDeferredCtxs > 1 ? NumDeferredCtxs - 1 : NumDeferredCtxs;
     m_NumWorkerThreads = std::min(m_NumWorkerThreads, m_MaxThreads);
 
     std::vector<StateTransitionDesc> Barriers;
     CreatePipelineStates(Barriers);
     LoadTextures(Barriers);
 
-    m_StreamingVB = std::make_unique<StreamingBuffer>(
-        m_pDevice,
-        BIND_VERTEX_BUFFER,
-        MaxVertsInStreamingBuffer * Uint32{sizeof(float2)},
-        1u + InitInfo.NumDeferredCtx,
-        "Streaming vertex buffer");
-    m_StreamingIB = std::make_unique<StreamingBuffer>(m_pDevice, BIND_INDEX_BUFFER, MaxVertsInStreamingBuffer * 3u * Uint32{sizeof(Uint32)}, 1u + InitInfo.NumDeferredCtx, "Streaming index buffer");
-
-    // Transition the buffers to required state
-    Barriers.emplace_back(m_StreamingVB->GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
-    Barriers.emplace_back(m_StreamingIB->GetBuffer(), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE);
-
     InitializePolygonGeometry();
     InitializePolygons();
+    CreateStreamingBuffers();
 
     m_pImmediateContext->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
 
@@ -575,6 +505,7 @@ void Tutorial10_DataStreaming::InitializePolygonGeometry()
 void Tutorial10_DataStreaming::InitializePolygons()
 {
     m_Polygons.resize(m_NumPolygons);
+    m_PolygonSprites.Resize(m_NumPolygons);
 
     std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
                       // to generate consistent distribution.
@@ -588,16 +519,17 @@ void Tutorial10_DataStreaming::InitializePolygons()
     std::uniform_int_distribution<Int32>  state_distr(0, NumStates - 1);
     std::uniform_int_distribution<Int32>  num_verts_distr(MinPolygonVerts, MaxPolygonVerts);
 
+    auto& Sprites = m_PolygonSprites;
     for (int Polygon = 0; Polygon < m_NumPolygons; ++Polygon)
     {
-        auto& CurrInst     = m_Polygons[Polygon];
-        CurrInst.Size      = scale_distr(gen);
-        CurrInst.Angle     = angle_distr(gen);
-        CurrInst.Pos.x     = pos_distr(gen);
-        CurrInst.Pos.y     = pos_distr(gen);
-        CurrInst.MoveDir.x = move_dir_distr(gen);
-        CurrInst.MoveDir.y = move_dir_distr(gen);
-        CurrInst.RotSpeed  = rot_distr(gen);
+        auto& CurrInst            = m_Polygons[Polygon];
+        CurrInst.Size             = scale_distr(gen);
+        Sprites.Angle[Polygon]    = angle_distr(gen);
+        Sprites.PosX[Polygon]     = pos_distr(gen);
+        Sprites.PosY[Polygon]     = pos_distr(gen);
+        Sprites.MoveDirX[Polygon] = move_dir_distr(gen);
+        Sprites.MoveDirY[Polygon] = move_dir_distr(gen);
+        Sprites.RotSpeed[Polygon] = rot_distr(gen);
         // Texture array index
         CurrInst.TextureInd = tex_distr(gen);
         CurrInst.StateInd   = state_distr(gen);
@@ -605,130 +537,108 @@ void Tutorial10_DataStreaming::InitializePolygons()
     }
 }
 
-std::pair<Diligent::Uint32, Diligent::Uint32> Tutorial10_DataStreaming::WritePolygon(const PolygonGeometry& PolygonGeo, IDeviceContext* pCtx, size_t CtxNum)
+void Tutorial10_DataStreaming::CreateStreamingBuffers()
 {
-    // Request memory for vertices and indices
-    auto  VBOffset   = m_StreamingVB->Allocate(pCtx, static_cast<Uint32>(PolygonGeo.Verts.size()) * sizeof(float2), CtxNum);
-    auto  IBOffset   = m_StreamingIB->Allocate(pCtx, static_cast<Uint32>(PolygonGeo.Inds.size()) * sizeof(Uint32), CtxNum);
-    auto* VertexData = reinterpret_cast<float2*>(reinterpret_cast<Uint8*>(m_StreamingVB->GetMappedCPUAddress(CtxNum)) + VBOffset);
-    auto* IndexData  = reinterpret_cast<Uint32*>(reinterpret_cast<Uint8*>(m_StreamingIB->GetMappedCPUAddress(CtxNum)) + IBOffset);
-    memcpy(VertexData, PolygonGeo.Verts.data(), PolygonGeo.Verts.size() * sizeof(float2));
-    memcpy(IndexData, PolygonGeo.Inds.data(), PolygonGeo.Inds.size() * sizeof(Uint32));
-
-    m_StreamingVB->Release(CtxNum);
-    m_StreamingIB->Release(CtxNum);
-
-    return {VBOffset, IBOffset};
+    // Every batch draws a single polygon geometry
+    static constexpr Uint64 MaxBatchVBSize = MaxPolygonVerts * sizeof(float2);
+    static constexpr Uint64 MaxBatchIBSize = (MaxPolygonVerts - 2) * 3 * sizeof(Uint32);
+
+    // Leave room for the frame being recorded and two frames in flight,
+    // so that the CPU normally never waits for the GPU.
+    static constexpr Uint64 NumFramesInRing = 3;
+    static constexpr Uint64 MinRingSize     = Uint64{64} << 10;
+    static constexpr Uint64 MaxRingSize     = Uint64{256} << 20;
+
+    const Uint64 NumBatches = (static_cast<Uint64>(m_NumPolygons) + m_BatchSize - 1) / m_BatchSize;
+
+    // Both rings have the same size so that the stall statistics are comparable
+    RingUploadBuffer::CreateInfo RingCI;
+    RingCI.Size                   = clamp(NumBatches * std::max(MaxBatchVBSize, MaxBatchIBSize) * NumFramesInRing, MinRingSize, MaxRingSize);
+    RingCI.AllowPersistentMapping = m_bAllowPersistentMap;
+
+    // The previous buffers are released by the engine when the GPU no longer uses them
+    RingCI.Name      = "Streaming vertex buffer";
+    RingCI.BindFlags = BIND_VERTEX_BUFFER;
+    m_StreamingVB    = std::make_unique<RingUploadBuffer>(m_pDevice, m_pImmediateContext, RingCI);
+
+    RingCI.Name      = "Streaming index buffer";
+    RingCI.BindFlags = BIND_INDEX_BUFFER;
+    m_StreamingIB    = std::make_unique<RingUploadBuffer>(m_pDevice, m_pImmediateContext, RingCI);
 }
 
-void Tutorial10_DataStreaming::UpdatePolygons(float elapsedTime)
+Tutorial10_DataStreaming::BatchGeometry Tutorial10_DataStreaming::WritePolygon(const PolygonGeometry& PolygonGeo)
 {
-    std::mt19937 gen; // Standard mersenne_twister_engine. Use default seed
-                      // to generate consistent distribution.
+    const auto VBSize = PolygonGeo.Verts.size() * sizeof(float2);
+    const auto IBSize = PolygonGeo.Inds.size() * sizeof(Uint32);
 
-    std::uniform_real_distribution<float> rot_distr(-PI_F * 0.5f, +PI_F * 0.5f);
-    for (int Polygon = 0; Polygon < m_NumPolygons; ++Polygon)
-    {
-        auto& CurrInst = m_Polygons[Polygon];
-        CurrInst.Angle += CurrInst.RotSpeed * elapsedTime;
-        if (std::abs(CurrInst.Pos.x + CurrInst.MoveDir.x * elapsedTime) > 0.95)
-        {
-            CurrInst.MoveDir.x *= -1.f;
-            CurrInst.RotSpeed = rot_distr(gen);
-        }
-        CurrInst.Pos.x += CurrInst.MoveDir.x * elapsedTime;
-        if (std::abs(CurrInst.Pos.y + CurrInst.MoveDir.y * elapsedTime) > 0.95)
+    // Request memory for vertices and indices. Allocation is thread-safe.
+    auto VBAlloc = m_StreamingVB->Allocate(VBSize);
+    auto IBAlloc = m_StreamingIB->Allocate(IBSize);
+    if (!VBAlloc || !IBAlloc)
+        return {};
+
+    memcpy(VBAlloc.pData, PolygonGeo.Verts.data(), VBSize);
+    memcpy(IBAlloc.pData, PolygonGeo.Inds.data(), IBSize);
+
+    return {VBAlloc.Offset, IBAlloc.Offset};
+}
+
+void Tutorial10_DataStreaming::WriteGeometry()
+{
+    // Writing geometry is cheap, so use large chunks
+    static constexpr Uint32 MinBatchesPerChunk = 4096;
+
+    const Uint32 TotalBatches = static_cast<Uint32>(m_BatchGeometry.size());
+
+    auto WriteRange = [this](Uint32 /*ThreadId*/, Uint32 /*Chunk*/, Uint32 StartBatch, Uint32 EndBatch) {
+        for (Uint32 batch = StartBatch; batch < EndBatch; ++batch)
         {
-            CurrInst.MoveDir.y *= -1.f;
-            CurrInst.RotSpeed = rot_distr(gen);
+            const auto& FirstPolygon = m_Polygons[size_t{batch} * m_BatchSize];
+            m_BatchGeometry[batch]   = WritePolygon(m_PolygonGeo[FirstPolygon.NumVerts]);
         }
-        CurrInst.Pos.y += CurrInst.MoveDir.y * elapsedTime;
-    }
+    };
+
+    if (m_pScheduler)
+        m_pScheduler->ParallelFor(TotalBatches, WriteRange, MinBatchesPerChunk);
+    else
+        WriteRange(0, 0, 0, TotalBatches);
 }
 
-void Tutorial10_DataStreaming::StartWorkerThreads(size_t NumThreads)
+void Tutorial10_DataStreaming::UpdatePolygons(float elapsedTime)
 {
-    m_WorkerThreads.resize(NumThreads);
-    for (Uint32 t = 0; t < m_WorkerThreads.size(); ++t)
-    {
-        m_WorkerThreads[t] = std::thread(WorkerThreadFunc, this, t);
-    }
-    m_CmdLists.resize(NumThreads);
+    // Each chunk is a contiguous range of every array, so chunks can be updated
+    // in parallel without synchronization.
+    static constexpr Uint32 MinPolygonsPerChunk = 16384;
+
+    auto UpdateRange = [this, elapsedTime](Uint32 /*ThreadId*/, Uint32 /*Chunk*/, Uint32 StartPolygon, Uint32 EndPolygon) {
+        UpdateBouncingSprites(m_PolygonSprites, StartPolygon, EndPolygon, elapsedTime, 0.95f, PI_F * 0.5f);
+    };
+
+    const auto NumPolygons = static_cast<Uint32>(m_PolygonSprites.Size());
+    if (m_pScheduler)
+        m_pScheduler->ParallelFor(NumPolygons, UpdateRange, MinPolygonsPerChunk);
+    else
+        UpdateRange(0, 0, 0, NumPolygons);
 }
 
-void Tutorial10_DataStreaming::StopWorkerThreads()
+void Tutorial10_DataStreaming::StartWorkerThreads(size_t NumThreads)
 {
-    m_RenderSubsetSignal.Trigger(true, -1);
-
-    for (auto& thread : m_WorkerThreads)
+    if (NumThreads > 0)
     {
-        thread.join();
+        // Leave the last deferred context to the caller
+        const auto NumWorkers = std::min(NumThreads, m_pDeferredContexts.size() - 1);
+        m_pScheduler.reset(new TaskScheduler{static_cast<Uint32>(NumWorkers)});
     }
-    m_RenderSubsetSignal.Reset();
-    m_WorkerThreads.clear();
-    m_CmdLists.clear();
 }
 
-void Tutorial10_DataStreaming::WorkerThreadFunc(Tutorial10_DataStreaming* pThis, Uint32 ThreadNum)
+void Tutorial10_DataStreaming::StopWorkerThreads()
 {
-    // Every thread should use its own deferred context
-    IDeviceContext* pDeferredCtx     = pThis->m_pDeferredContexts[ThreadNum];
-    const int       NumWorkerThreads = static_cast<int>(
-        pThis->m_WorkerThreads.size());
-    VERIFY_EXPR(NumWorkerThreads > 0);
-    for (;;)
-    {
-        // Wait for the signal
-        auto SignaledValue = pThis->m_RenderSubsetSignal.Wait(
-            true, NumWorkerThreads);
-        if (SignaledValue < 0)
-            return;
-
-        pDeferredCtx->Begin(0);
-
-        // Render current subset using the deferred context
-        if (pThis->m_BatchSize > 1)
-            pThis->RenderSubset<true>(pDeferredCtx, 1 + ThreadNum);
-        else
-            pThis->RenderSubset<false>(pDeferredCtx, 1 + ThreadNum);
-
-        // Finish command list
-        RefCntAutoPtr<ICommandList> pCmdList;
-        pDeferredCtx->FinishCommandList(&pCmdList);
-        pThis->m_CmdLists[ThreadNum] = pCmdList;
-
-        {
-            // Atomically increment the number of completed threads
-            const auto NumThreadsCompleted =
-                pThis->m_NumThreadsCompleted.fetch_add(1)
-                    + 1;
-            if (NumThreadsCompleted == NumWorkerThreads)
-                pThis->m_ExecuteCommandListsSignal.Trigger();
-        }
-
-        pThis->m_GotoNextFrameSignal.Wait(
-            true, NumWorkerThreads);
-
-        // Call FinishFrame() to release dynamic resources allocated by deferred contexts
-        // IMPORTANT: we must wait until the command lists are submitted for execution
-        //            because FinishFrame() invalidates all dynamic resources.
-        // IMPORTANT: In Metal backend FinishFrame must be called from the same
-        //            thread that issued rendering commands.
-        pDeferredCtx->FinishFrame();
-
-        pThis->m_NumThreadsReady.fetch_add(1);
-        // We must wait until all threads reach this point, because
-        // m_GotoNextFrameSignal must be unsignaled before we proceed to
-        // RenderSubsetSignal to avoid one thread go through the loop twice in
-        // a row
-        while (pThis->m_NumThreadsReady.load() < NumWorkerThreads)
-            std::this_thread::yield();
-        VERIFY_EXPR(!pThis->m_GotoNextFrameSignal.IsTriggered());
-    }
+    m_pScheduler.reset();
+    m_CmdLists.clear();
 }
 
 template <bool UseBatch>
-void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
+void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 StartBatch, Uint32 EndBatch)
 {
     // Deferred contexts start in default state. We must bind everything to the context
     // Render targets are set and transitioned to correct states by the main thread, here we only verify states
@@ -739,14 +649,13 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
     DrawAttrs.IndexType = VT_UINT32;
     DrawAttrs.Flags     = DRAW_FLAG_VERIFY_ALL;
 
-    Uint32       NumSubsets    = Uint32{1} + static_cast<Uint32>(m_WorkerThreads.size());
-    const Uint32 TotalPolygons = static_cast<Uint32>(m_Polygons.size());
-    const Uint32 TotalBatches  = (TotalPolygons + m_BatchSize - 1) / m_BatchSize;
-    const Uint32 SusbsetSize   = TotalBatches / NumSubsets;
-    const Uint32 StartBatch    = SusbsetSize * Subset;
-    const Uint32 EndBatch      = (Subset < NumSubsets - 1) ? SusbsetSize * (Subset + 1) : TotalBatches;
     for (Uint32 batch = StartBatch; batch < EndBatch; ++batch)
     {
+        // The batch is skipped if its geometry did not fit into the ring
+        const auto& Geometry = m_BatchGeometry[batch];
+        if (Geometry.VBOffset == InvalidOffset)
+            continue;
+
         const Uint32 StartInst = batch * m_BatchSize;
         const Uint32 EndInst   = std::min(StartInst + static_cast<Uint32>(m_BatchSize), static_cast<Uint32>(m_NumPolygons));
 
@@ -755,12 +664,11 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
         pCtx->SetPipelineState(m_pPSO[UseBatch ? 1 : 0][StateInd]);
 
         const auto&  PolygonGeo = m_PolygonGeo[m_Polygons[StartInst].NumVerts];
-        auto         Offsets    = WritePolygon(PolygonGeo, pCtx, Subset);
-        const Uint64 offsets[]  = {Offsets.first, 0};
+        const Uint64 offsets[]  = {Geometry.VBOffset, 0};
         IBuffer*     pBuffs[]   = {m_StreamingVB->GetBuffer(), m_BatchDataBuffer};
         pCtx->SetVertexBuffers(0, UseBatch ? 2 : 1, pBuffs, offsets, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
 
-        pCtx->SetIndexBuffer(m_StreamingIB->GetBuffer(), Offsets.second, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
+        pCtx->SetIndexBuffer(m_StreamingIB->GetBuffer(), Geometry.IBOffset, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
         MapHelper<InstanceData> BatchData;
         if (UseBatch)
@@ -788,8 +696,8 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
                     0.f,               CurrInstData.Size
                 };
                 // clang-format on
-                float    sinAngle = sinf(CurrInstData.Angle);
-                float    cosAngle = cosf(CurrInstData.Angle);
+                float    sinAngle = sinf(m_PolygonSprites.Angle[inst]);
+                float    cosAngle = cosf(m_PolygonSprites.Angle[inst]);
                 float2x2 RotMatr(cosAngle, -sinAngle,
                                  sinAngle, cosAngle);
 
@@ -801,7 +709,7 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
                 {
                     auto& CurrPolygon                   = BatchData[inst - StartInst];
                     CurrPolygon.PolygonRotationAndScale = PolygonRotationAndScale;
-                    CurrPolygon.PolygonCenter           = CurrInstData.Pos;
+                    CurrPolygon.PolygonCenter           = float2{m_PolygonSprites.PosX[inst], m_PolygonSprites.PosY[inst]};
                     CurrPolygon.TexArrInd               = static_cast<float>(CurrInstData.TextureInd);
                 }
                 else
@@ -816,8 +724,8 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
                     MapHelper<PolygonAttribs> InstData(pCtx, m_PolygonAttribsCB, MAP_WRITE, MAP_FLAG_DISCARD);
 
                     InstData->g_PolygonRotationAndScale = PolygonRotationAndScale;
-                    InstData->g_PolygonCenter.x         = CurrInstData.Pos.x;
-                    InstData->g_PolygonCenter.y         = CurrInstData.Pos.y;
+                    InstData->g_PolygonCenter.x         = m_PolygonSprites.PosX[inst];
+                    InstData->g_PolygonCenter.y         = m_PolygonSprites.PosY[inst];
                 }
             }
         }
@@ -829,14 +737,21 @@ void Tutorial10_DataStreaming::RenderSubset(IDeviceContext* pCtx, Uint32 Subset)
         DrawAttrs.NumInstances = EndInst - StartInst;
         pCtx->DrawIndexed(DrawAttrs);
     }
-
-    m_StreamingVB->Flush(Subset);
-    m_StreamingIB->Flush(Subset);
 }
 
 // Render a frame
 void Tutorial10_DataStreaming::Render()
 {
+    const Uint32 TotalPolygons = static_cast<Uint32>(m_Polygons.size());
+    const Uint32 TotalBatches  = (TotalPolygons + m_BatchSize - 1) / m_BatchSize;
+
+    // Write the geometry of all batches to the streaming rings, then upload it
+    // before any command that reads it is executed.
+    m_BatchGeometry.resize(TotalBatches);
+    WriteGeometry();
+    m_StreamingVB->Commit(m_pImmediateContext);
+    m_StreamingIB->Commit(m_pImmediateContext);
+
     auto* pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
     auto* pDSV = m_pSwapChain->GetDepthBufferDSV();
     // Clear the back buffer
@@ -847,44 +762,68 @@ void Tutorial10_DataStreaming::Render()
         CLEAR_DEPTH_FLAG, 1.f,
         0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-    m_StreamingIB->AllowPersistentMapping(m_bAllowPersistentMap);
-    m_StreamingVB->AllowPersistentMapping(m_bAllowPersistentMap);
-
-    if (!m_WorkerThreads.empty())
-    {
-        m_NumThreadsCompleted.store(0);
-        m_RenderSubsetSignal.Trigger(true);
-    }
-
-    if (m_BatchSize > 1)
-        RenderSubset<true>(m_pImmediateContext, 0);
+    if (m_pScheduler)
+        RenderParallel(TotalBatches);
+    else if (m_BatchSize > 1)
+        RenderSubset<true>(m_pImmediateContext, 0, TotalBatches);
     else
-        RenderSubset<false>(m_pImmediateContext, 0);
-
-    if (!m_WorkerThreads.empty())
-    {
-        m_ExecuteCommandListsSignal.Wait(true,
-            1);
+        RenderSubset<false>(m_pImmediateContext, 0, TotalBatches);
 
-        m_CmdListPtrs.resize(m_CmdLists.size());
-        for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
-            m_CmdListPtrs[i] = m_CmdLists[i];
-
-        m_pImmediateContext->ExecuteCommandLists(
-            static_cast<Uint32>(m_CmdListPtrs.size()),
-            m_CmdListPtrs.data());
-
-        for (auto& cmdList : m_CmdLists)
-        {
-            // Release command lists now to release all outstanding references
-            // In d3d11 mode, command lists hold references to the swap chain's back buffer
-            // that cause swap chain resize to fail
-            cmdList.Release();
-        }
+    // The ring memory written this frame is reused once the GPU completes the commands above
+    m_StreamingVB->FinishFrame(m_pImmediateContext);
+    m_StreamingIB->FinishFrame(m_pImmediateContext);
+}
 
-        m_NumThreadsReady.store(0);
-        m_GotoNextFrameSignal.Trigger(true);
+void Tutorial10_DataStreaming::RenderParallel(Uint32 TotalBatches)
+{
+    // Every chunk binds render targets and starts a command list, so keep chunks
+    // large enough for the setup cost to be negligible.
+    static constexpr Uint32 MinPolygonsPerChunk = 256;
+
+    const Uint32 MinBatchesPerChunk = std::max(MinPolygonsPerChunk / static_cast<Uint32>(m_BatchSize), 1u);
+    const Uint32 NumChunks          = m_pScheduler->GetRecommendedChunkCount(TotalBatches, MinBatchesPerChunk);
+    m_CmdLists.resize(NumChunks);
+    m_pScheduler->ParallelFor(
+        TotalBatches, NumChunks,
+        [this](Uint32 ThreadId, Uint32 Chunk, Uint32 StartBatch, Uint32 EndBatch) {
+            // Every thread should use its own deferred context
+            IDeviceContext* pDeferredCtx = m_pDeferredContexts[ThreadId];
+            pDeferredCtx->Begin(0);
+
+            if (m_BatchSize > 1)
+                RenderSubset<true>(pDeferredCtx, StartBatch, EndBatch);
+            else
+                RenderSubset<false>(pDeferredCtx, StartBatch, EndBatch);
+
+            pDeferredCtx->FinishCommandList(&m_CmdLists[Chunk]);
+        });
+
+    // Polygons are alpha-blended, so command lists must be executed in chunk order
+    m_CmdListPtrs.resize(m_CmdLists.size());
+    for (Uint32 i = 0; i < m_CmdLists.size(); ++i)
+        m_CmdListPtrs[i] = m_CmdLists[i];
+
+    m_pImmediateContext->ExecuteCommandLists(
+        static_cast<Uint32>(m_CmdListPtrs.size()),
+        m_CmdListPtrs.data());
+
+    for (auto& cmdList : m_CmdLists)
+    {
+        // Release command lists now to release all outstanding references
+        // In d3d11 mode, command lists hold references to the swap chain's back buffer
+        // that cause swap chain resize to fail
+        cmdList.Release();
     }
+
+    // Call FinishFrame() to release dynamic resources allocated by deferred contexts
+    // IMPORTANT: we must wait until the command lists are submitted for execution
+    //            because FinishFrame() invalidates all dynamic resources.
+    // IMPORTANT: In Metal backend FinishFrame must be called from the same
+    //            thread that issued rendering commands.
+    m_pScheduler->RunOnEachWorker([this](Uint32 WorkerId) {
+        m_pDeferredContexts[WorkerId]->FinishFrame();
+    });
+    m_pDeferredContexts[m_pScheduler->GetNumWorkers()]->FinishFrame();
 }
 
 void Tutorial10_DataStreaming::CreateInstanceBuffer()
@@ -27,14 +27,14 @@
 
 #pragma once
 
-#include <atomic>
 #include <memory>
 #include <vector>
 #include <thread>
-#include <mutex>
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
-#include "ThreadSignal.hpp"
+#include "TaskScheduler.hpp"
+#include "RingUploadBuffer.hpp"
+#include "../../Common/src/BouncingSprites.hpp"
 
 namespace Diligent
 {
@@ -61,24 +61,21 @@ private:
     void InitializePolygons();
     void InitializePolygonGeometry();
     void CreateInstanceBuffer();
+    void CreateStreamingBuffers();
     void UpdatePolygons(float elapsedTime);
+    void WriteGeometry();
     void StartWorkerThreads(size_t NumThreads);
     void StopWorkerThreads();
 
-    template <bool UseBatch>
-    void RenderSubset(IDeviceContext* pCtx, Uint32 Subset);
-
-    static void WorkerThreadFunc(Tutorial10_DataStreaming* pThis, Uint32 ThreadNum);
-
-    Threading::Signal m_RenderSubsetSignal;
-    Threading::Signal m_ExecuteCommandListsSignal;
-    Threading::Signal m_GotoNextFrameSignal;
+    void RenderParallel(Uint32 TotalBatches);
 
-    std::atomic_int m_NumThreadsCompleted;
-    std::atomic_int m_NumThreadsReady;
+    template <bool UseBatch>
+    void RenderSubset(IDeviceContext* pCtx, Uint32 StartBatch, Uint32 EndBatch);
 
-    std::vector<std::thread> m_WorkerThreads;
+    std::unique_ptr<TaskScheduler> m_pScheduler;
 
+    // One command list per chunk of batches. Lists are executed in chunk order
+    // to preserve the blending order.
     std::vector<RefCntAutoPtr<ICommandList>> m_CmdLists;
     std::vector<ICommandList*>               m_CmdListPtrs;
 
@@ -87,9 +84,9 @@ private:
     RefCntAutoPtr<IBuffer>        m_PolygonAttribsCB;
     RefCntAutoPtr<IBuffer>        m_BatchDataBuffer;
 
-    static constexpr const int             MaxVertsInStreamingBuffer = 1024;
-    std::unique_ptr<class StreamingBuffer> m_StreamingVB;
-    std::unique_ptr<class StreamingBuffer> m_StreamingIB;
+    // Polygon geometry is streamed through ring buffers shared by all threads
+    std::unique_ptr<RingUploadBuffer> m_StreamingVB;
+    std::unique_ptr<RingUploadBuffer> m_StreamingIB;
 
     static constexpr int                  NumTextures = 4;
     RefCntAutoPtr<IShaderResourceBinding> m_SRB[NumTextures];
@@ -97,7 +94,7 @@ private:
     RefCntAutoPtr<ITextureView>           m_TextureSRV[NumTextures];
     RefCntAutoPtr<ITextureView>           m_TexArraySRV;
 
-    static constexpr int MaxPolygons  = 100000;
+    static constexpr int MaxPolygons  = 2000000;
     static constexpr int MaxBatchSize = 100;
 
     int m_NumPolygons = 1000;
@@ -106,19 +103,20 @@ private:
     int m_MaxThreads       = 8;
     int m_NumWorkerThreads = 4;
 
+    // Attributes that do not change after the polygons are initialized
     struct PolygonData
     {
-        float2 Pos;
-        float2 MoveDir;
-        float  Size       = 0;
-        float  Angle      = 0;
-        float  RotSpeed   = 0;
-        int    TextureInd = 0;
-        int    StateInd   = 0;
-        int    NumVerts   = 0;
+        float Size       = 0;
+        int   TextureInd = 0;
+        int   StateInd   = 0;
+        int   NumVerts   = 0;
     };
     std::vector<PolygonData> m_Polygons;
 
+    // Position, direction, angle and rotation speed are updated every frame
+    // and are stored as structure of arrays to vectorize the update.
+    BouncingSprites m_PolygonSprites;
+
     struct InstanceData
     {
         float4 PolygonRotationAndScale;
@@ -134,8 +132,19 @@ private:
         std::vector<Uint32> Inds;
     };
     std::vector<PolygonGeometry> m_PolygonGeo;
-    bool                         m_bAllowPersistentMap = false;
-    std::pair<Uint32, Uint32>    WritePolygon(const PolygonGeometry& PolygonGeo, IDeviceContext* pCtx, size_t CtxNum);
+    bool                         m_bAllowPersistentMap = true;
+
+    static constexpr Uint64 InvalidOffset = ~Uint64{0};
+
+    // Offsets of the batch geometry in the streaming buffers for the current frame
+    struct BatchGeometry
+    {
+        Uint64 VBOffset = InvalidOffset;
+        Uint64 IBOffset = InvalidOffset;
+    };
+    std::vector<BatchGeometry> m_BatchGeometry;
+
+    BatchGeometry WritePolygon(const PolygonGeometry& PolygonGeo);
 };
 
 } // namespace Diligent
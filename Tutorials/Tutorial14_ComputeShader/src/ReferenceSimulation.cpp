@@ -0,0 +1,330 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "ReferenceSimulation.hpp"
+#include "DebugUtilities.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define PARTICLES_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define PARTICLES_NEON 1
+#endif
+
+namespace Diligent
+{
+
+namespace
+{
+
+// The functions below replicate the shader code in particles.fxh and collide_particles.csh
+
+void ClampParticlePosition(float2& f2Pos, float2& f2Speed, float fSize, const float2& f2Scale)
+{
+    if (f2Pos.x + fSize * f2Scale.x > 1.f)
+    {
+        f2Pos.x -= f2Pos.x + fSize * f2Scale.x - 1.f;
+        f2Speed.x *= -1.f;
+    }
+
+    if (f2Pos.x - fSize * f2Scale.x < -1.f)
+    {
+        f2Pos.x += -1.f - (f2Pos.x - fSize * f2Scale.x);
+        f2Speed.x *= -1.f;
+    }
+
+    if (f2Pos.y + fSize * f2Scale.y > 1.f)
+    {
+        f2Pos.y -= f2Pos.y + fSize * f2Scale.y - 1.f;
+        f2Speed.y *= -1.f;
+    }
+
+    if (f2Pos.y - fSize * f2Scale.y < -1.f)
+    {
+        f2Pos.y += -1.f - (f2Pos.y - fSize * f2Scale.y);
+        f2Speed.y *= -1.f;
+    }
+}
+
+int2 GetGridLocation(const float2& f2Pos, const int2& i2ParticleGridSize)
+{
+    int2 i2GridPos;
+    i2GridPos.x = std::min(std::max(static_cast<int>((f2Pos.x + 1.f) * 0.5f * static_cast<float>(i2ParticleGridSize.x)), 0), i2ParticleGridSize.x - 1);
+    i2GridPos.y = std::min(std::max(static_cast<int>((f2Pos.y + 1.f) * 0.5f * static_cast<float>(i2ParticleGridSize.y)), 0), i2ParticleGridSize.y - 1);
+    return i2GridPos;
+}
+
+int GetGridIndex(const float2& f2Pos, const int2& i2ParticleGridSize)
+{
+    const auto i2GridPos = GetGridLocation(f2Pos, i2ParticleGridSize);
+    return i2GridPos.x + i2GridPos.y * i2ParticleGridSize.x;
+}
+
+// Returns the normalized direction from P0 to P1 and the distance between the particles
+float2 GetCollisionNormal(const ParticleAttribs& P0, const ParticleAttribs& P1, const float2& f2Scale, float& d01)
+{
+    float2 R01 = (P1.f2Pos - P0.f2Pos) / f2Scale;
+    d01        = length(R01);
+    return R01 / d01;
+}
+
+} // namespace
+
+template <typename HandlerType>
+void ReferenceSimulation::ForEachOverlap(Uint32 ParticleIdx, Uint32 First, Uint32 End, const float2& f2Scale, HandlerType&& Handler) const
+{
+    const float PosX = m_PosX[ParticleIdx];
+    const float PosY = m_PosY[ParticleIdx];
+    const float Size = m_Size[ParticleIdx];
+
+#if PARTICLES_SSE2 || PARTICLES_NEON
+    // SoA arrays are padded, so the last group of four may read past the end of the range.
+    // Lanes outside of the range are masked out.
+#    if PARTICLES_SSE2
+    const __m128 vPosX   = _mm_set1_ps(PosX);
+    const __m128 vPosY   = _mm_set1_ps(PosY);
+    const __m128 vSize   = _mm_set1_ps(Size);
+    const __m128 vScaleX = _mm_set1_ps(f2Scale.x);
+    const __m128 vScaleY = _mm_set1_ps(f2Scale.y);
+#    else
+    const float32x4_t vPosX   = vdupq_n_f32(PosX);
+    const float32x4_t vPosY   = vdupq_n_f32(PosY);
+    const float32x4_t vSize   = vdupq_n_f32(Size);
+    const float32x4_t vScaleX = vdupq_n_f32(f2Scale.x);
+    const float32x4_t vScaleY = vdupq_n_f32(f2Scale.y);
+    static constexpr Uint32 LaneBits[] = {1, 2, 4, 8};
+    const uint32x4_t        LaneBit    = vld1q_u32(LaneBits);
+#    endif
+    for (Uint32 i = First; i < End; i += 4)
+    {
+        // Same operation order as length((P1.f2Pos - P0.f2Pos) / f2Scale) < P0.fSize + P1.fSize
+#    if PARTICLES_SSE2
+        const __m128 dx   = _mm_div_ps(_mm_sub_ps(_mm_loadu_ps(&m_PosX[i]), vPosX), vScaleX);
+        const __m128 dy   = _mm_div_ps(_mm_sub_ps(_mm_loadu_ps(&m_PosY[i]), vPosY), vScaleY);
+        const __m128 Dist = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        Uint32       Mask = static_cast<Uint32>(_mm_movemask_ps(_mm_cmplt_ps(Dist, _mm_add_ps(vSize, _mm_loadu_ps(&m_Size[i])))));
+#    else
+        const float32x4_t dx   = vdivq_f32(vsubq_f32(vld1q_f32(&m_PosX[i]), vPosX), vScaleX);
+        const float32x4_t dy   = vdivq_f32(vsubq_f32(vld1q_f32(&m_PosY[i]), vPosY), vScaleY);
+        const float32x4_t Dist = vsqrtq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)));
+        Uint32            Mask = vaddvq_u32(vandq_u32(vcltq_f32(Dist, vaddq_f32(vSize, vld1q_f32(&m_Size[i]))), LaneBit));
+#    endif
+        if (End - i < 4)
+            Mask &= (1u << (End - i)) - 1u;
+
+        for (Uint32 Lane = 0; Mask != 0; ++Lane, Mask >>= 1u)
+        {
+            if ((Mask & 1u) != 0 && i + Lane != ParticleIdx)
+                Handler(i + Lane);
+        }
+    }
+#else
+    for (Uint32 i = First; i < End; ++i)
+    {
+        const float dx = (m_PosX[i] - PosX) / f2Scale.x;
+        const float dy = (m_PosY[i] - PosY) / f2Scale.y;
+        if (i != ParticleIdx && std::sqrt(dx * dx + dy * dy) < Size + m_Size[i])
+            Handler(i);
+    }
+#endif
+}
+
+template <typename HandlerType>
+void ReferenceSimulation::ForEachNeighbor(Uint32 ParticleIdx, const SimulationConstants& Constants, HandlerType&& Handler) const
+{
+    const auto  i2GridPos  = GetGridLocation(float2{m_PosX[ParticleIdx], m_PosY[ParticleIdx]}, Constants.i2ParticleGridSize);
+    const auto& GridWidth  = Constants.i2ParticleGridSize.x;
+    const auto& GridHeight = Constants.i2ParticleGridSize.y;
+
+    const int MinX = std::max(i2GridPos.x - 1, 0);
+    const int MaxX = std::min(i2GridPos.x + 1, GridWidth - 1);
+    for (int y = std::max(i2GridPos.y - 1, 0); y <= std::min(i2GridPos.y + 1, GridHeight - 1); ++y)
+    {
+        // Bins of the row are contiguous in the sorted array
+        const auto First = m_CellStart[MinX + y * GridWidth];
+        const auto End   = m_CellStart[MaxX + y * GridWidth + 1];
+        ForEachOverlap(ParticleIdx, First, End, Constants.f2Scale, Handler);
+    }
+}
+
+void ReferenceSimulation::Step(const SimulationConstants& Constants, const ParticleAttribs* pParticles, std::vector<ParticleAttribs>& Result)
+{
+    const Uint32 NumParticles = Constants.uiNumParticles;
+    const Uint32 NumCells     = static_cast<Uint32>(Constants.i2ParticleGridSize.x * Constants.i2ParticleGridSize.y);
+    VERIFY_EXPR(NumCells > 0);
+
+    // Move particles and count particles in every bin
+    m_CellStart.assign(size_t{NumCells} + 1, 0);
+    m_BinOffsets.resize(NumParticles);
+    m_ParticleCells.resize(NumParticles);
+    m_MovedParticles.resize(NumParticles);
+    for (Uint32 i = 0; i < NumParticles; ++i)
+    {
+        auto& Particle = m_MovedParticles[i];
+
+        Particle         = pParticles[i];
+        Particle.f2Pos   = Particle.f2NewPos;
+        Particle.f2Speed = Particle.f2NewSpeed;
+        Particle.f2Pos += Particle.f2Speed * Constants.f2Scale * Constants.fDeltaTime;
+        Particle.fTemperature -= Particle.fTemperature * std::min(Constants.fDeltaTime * 2.f, 1.f);
+        ClampParticlePosition(Particle.f2Pos, Particle.f2Speed, Particle.fSize, Constants.f2Scale);
+
+        const auto Cell    = GetGridIndex(Particle.f2Pos, Constants.i2ParticleGridSize);
+        m_ParticleCells[i] = Cell;
+        m_BinOffsets[i]    = m_CellStart[Cell]++;
+    }
+
+    // Exclusive prefix sum of bin sizes gives the first particle of every bin
+    Uint32 Sum = 0;
+    for (auto& Start : m_CellStart)
+    {
+        const auto Count = Start;
+        Start            = Sum;
+        Sum += Count;
+    }
+    VERIFY_EXPR(Sum == NumParticles);
+
+    // Sort particles by bins
+    Result.resize(NumParticles);
+    for (Uint32 i = 0; i < NumParticles; ++i)
+        Result[m_CellStart[m_ParticleCells[i]] + m_BinOffsets[i]] = m_MovedParticles[i];
+
+    // Padding lets the SIMD loop read whole groups of four
+    const size_t PaddedSize = (size_t{NumParticles} + 3u) & ~size_t{3};
+    m_PosX.assign(PaddedSize, 0.f);
+    m_PosY.assign(PaddedSize, 0.f);
+    m_Size.assign(PaddedSize, 0.f);
+    for (Uint32 i = 0; i < NumParticles; ++i)
+    {
+        m_PosX[i] = Result[i].f2Pos.x;
+        m_PosY[i] = Result[i].f2Pos.y;
+        m_Size[i] = Result[i].fSize;
+    }
+
+    // Collision - position update
+    for (Uint32 i = 0; i < NumParticles; ++i)
+    {
+        auto& Particle          = Result[i];
+        Particle.f2NewPos       = Particle.f2Pos;
+        Particle.iNumCollisions = 0;
+        ForEachNeighbor(i, Constants, [&](Uint32 j) {
+            const auto& AnotherParticle = Result[j];
+
+            float      d01 = 0;
+            const auto R01 = GetCollisionNormal(Particle, AnotherParticle, Constants.f2Scale, d01);
+            Particle.f2NewPos += -R01 * (Particle.fSize + AnotherParticle.fSize - d01) * Constants.f2Scale * 0.51f;
+            Particle.fTemperature = 1.f;
+            Particle.iNumCollisions += 1;
+        });
+        ClampParticlePosition(Particle.f2NewPos, Particle.f2Speed, Particle.fSize, Constants.f2Scale);
+    }
+
+    // Collision - speed update
+    for (Uint32 i = 0; i < NumParticles; ++i)
+    {
+        auto& Particle      = Result[i];
+        Particle.f2NewSpeed = Particle.f2Speed;
+        if (Particle.iNumCollisions == 1)
+        {
+            ForEachNeighbor(i, Constants, [&](Uint32 j) {
+                const auto& AnotherParticle = Result[j];
+                if (AnotherParticle.iNumCollisions != 1)
+                    return;
+
+                float      d01 = 0;
+                const auto R01 = GetCollisionNormal(Particle, AnotherParticle, Constants.f2Scale, d01);
+
+                const float v0 = dot(Particle.f2Speed, R01);
+                const float v1 = dot(AnotherParticle.f2Speed, R01);
+
+                const float m0 = Particle.fSize * Particle.fSize;
+                const float m1 = AnotherParticle.fSize * AnotherParticle.fSize;
+
+                const float new_v0 = ((m0 - m1) * v0 + 2.f * m1 * v1) / (m0 + m1);
+                Particle.f2NewSpeed += (new_v0 - v0) * R01;
+            });
+        }
+        else if (Particle.iNumCollisions > 1)
+        {
+            Particle.f2NewSpeed = -Particle.f2Speed;
+        }
+    }
+}
+
+ReferenceSimulation::ValidationResult ReferenceSimulation::Validate(const SimulationConstants& Constants, const ParticleAttribs* pInput, const ParticleAttribs* pGPUOutput)
+{
+    Step(Constants, pInput, m_Reference);
+
+    const Uint32 NumParticles = Constants.uiNumParticles;
+
+    ValidationResult Res;
+    Res.NumParticles = NumParticles;
+
+    // Find every particle in the GPU output by its id and check that the output is sorted by bins
+    std::vector<Uint32> GPUIndices(NumParticles, ~0u);
+    int                 PrevCell = 0;
+    for (Uint32 i = 0; i < NumParticles; ++i)
+    {
+        const auto& Particle = pGPUOutput[i];
+
+        const auto Cell = GetGridIndex(Particle.f2Pos, Constants.i2ParticleGridSize);
+        if (Cell < PrevCell)
+            ++Res.NumUnsortedParticles;
+        PrevCell = Cell;
+
+        if (Particle.iId >= 0 && static_cast<Uint32>(Particle.iId) < NumParticles)
+            GPUIndices[Particle.iId] = i;
+    }
+
+    for (const auto& Ref : m_Reference)
+    {
+        const auto GPUIdx = GPUIndices[Ref.iId];
+        if (GPUIdx == ~0u)
+        {
+            ++Res.NumMissingParticles;
+            continue;
+        }
+
+        const auto& Particle = pGPUOutput[GPUIdx];
+        if (Particle.iNumCollisions != Ref.iNumCollisions)
+        {
+            ++Res.NumCollisionMismatches;
+            continue;
+        }
+
+        Res.MaxPositionError = std::max(Res.MaxPositionError, length(Particle.f2NewPos - Ref.f2NewPos));
+        Res.MaxSpeedError    = std::max(Res.MaxSpeedError, length(Particle.f2NewSpeed - Ref.f2NewSpeed));
+    }
+
+    return Res;
+}
+
+} // namespace Diligent
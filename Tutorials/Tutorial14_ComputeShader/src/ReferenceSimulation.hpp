@@ -0,0 +1,120 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *  
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *  
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *  
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence), 
+ *  contract, or otherwise, unless required by applicable law (such as deliberate 
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental, 
+ *  or consequential damages of any character arising as a result of this License or 
+ *  out of the use or inability to use the software (including but not limited to damages 
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and 
+ *  all other commercial damages or losses), even if such Contributor has been advised 
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+// Must match the structures in structures.fxh
+struct ParticleAttribs
+{
+    float2 f2Pos;
+    float2 f2NewPos;
+
+    float2 f2Speed;
+    float2 f2NewSpeed;
+
+    float fSize          = 0;
+    float fTemperature   = 0;
+    int   iNumCollisions = 0;
+    int   iId            = 0;
+};
+
+struct SimulationConstants
+{
+    uint  uiNumParticles;
+    float fDeltaTime;
+    float fDummy0;
+    float fDummy1;
+
+    float2 f2Scale;
+    int2   i2ParticleGridSize;
+};
+
+// CPU implementation of the particle simulation that performs the same steps as the compute
+// shaders (move, bin with a counting sort, collide, update speed) and is used to validate them.
+class ReferenceSimulation
+{
+public:
+    struct ValidationResult
+    {
+        Uint32 NumParticles = 0;
+
+        // The number of particles in the GPU output that are not sorted by bins
+        Uint32 NumUnsortedParticles = 0;
+
+        // The number of particles that are missing in the GPU output or occur more than once
+        Uint32 NumMissingParticles = 0;
+
+        // The number of particles whose collision count differs from the reference.
+        // Borderline collisions may legitimately differ due to floating-point precision.
+        Uint32 NumCollisionMismatches = 0;
+
+        // Maximum errors of the particles whose collision counts match
+        float MaxPositionError = 0;
+        float MaxSpeedError    = 0;
+
+        bool IsValid() const
+        {
+            return NumUnsortedParticles == 0 && NumMissingParticles == 0 && NumCollisionMismatches <= NumParticles / 1000 &&
+                MaxPositionError < 1e-4f && MaxSpeedError < 1e-3f;
+        }
+    };
+
+    // Runs one simulation step on the input particles. The result is sorted by bins.
+    void Step(const SimulationConstants& Constants, const ParticleAttribs* pParticles, std::vector<ParticleAttribs>& Result);
+
+    // Runs one simulation step on the input and compares the result with the output of the compute shaders.
+    ValidationResult Validate(const SimulationConstants& Constants, const ParticleAttribs* pInput, const ParticleAttribs* pGPUOutput);
+
+private:
+    template <typename HandlerType>
+    void ForEachOverlap(Uint32 ParticleIdx, Uint32 First, Uint32 End, const float2& f2Scale, HandlerType&& Handler) const;
+
+    template <typename HandlerType>
+    void ForEachNeighbor(Uint32 ParticleIdx, const SimulationConstants& Constants, HandlerType&& Handler) const;
+
+    // Exclusive prefix sum of bin sizes, with one extra element that holds the total count
+    std::vector<Uint32> m_CellStart;
+    std::vector<Uint32> m_BinOffsets;
+    std::vector<int>    m_ParticleCells;
+
+    // Positions and sizes of sorted particles in SoA layout for SIMD overlap tests
+    std::vector<float> m_PosX;
+    std::vector<float> m_PosY;
+    std::vector<float> m_Size;
+
+    std::vector<ParticleAttribs> m_MovedParticles;
+    std::vector<ParticleAttribs> m_Reference;
+};
+
+} // namespace Diligent
@@ -26,6 +26,7 @@
  */
 
 #include <random>
+#include <sstream>
 
 #include "Tutorial14_ComputeShader.hpp"
 #include "BasicMath.hpp"
@@ -44,18 +45,13 @@ SampleBase* CreateSample()
 namespace
 {
 
-struct ParticleAttribs
+// Must match the structure in structures.fxh
+struct ScanAttribs
 {
-    float2 f2Pos;
-    float2 f2NewPos;
-
-    float2 f2Speed;
-    float2 f2NewSpeed;
-
-    float fSize          = 0;
-    float fTemperature   = 0;
-    int   iNumCollisions = 0;
-    float fPadding0      = 0;
+    Uint32 uiCount;
+    Uint32 uiDataOffset;
+    Uint32 uiBlockSumOffset;
+    Uint32 uiPadding0;
 };
 
 } // namespace
@@ -110,7 +106,7 @@ void Tutorial14_ComputeShader::CreateRenderParticlePSO()
         ShaderCI.EntryPoint      = "main";
         ShaderCI.Desc.Name       = "Particle VS";
         ShaderCI.FilePath        = "particle.vsh";
-        m_pDevice->CreateShader(ShaderCI, &pVS);
+        CreateShader(ShaderCI, &pVS);
     }
 
     // Create particle pixel shader
@@ -120,7 +116,7 @@ void Tutorial14_ComputeShader::CreateRenderParticlePSO()
         ShaderCI.EntryPoint      = "main";
         ShaderCI.Desc.Name       = "Particle PS";
         ShaderCI.FilePath        = "particle.psh";
-        m_pDevice->CreateShader(ShaderCI, &pPS);
+        CreateShader(ShaderCI, &pPS);
     }
 
     PSOCreateInfo.pVS = pVS;
@@ -163,14 +159,14 @@ void Tutorial14_ComputeShader::CreateUpdateParticlePSO()
     Macros.AddShaderMacro("THREAD_GROUP_SIZE", m_ThreadGroupSize);
     Macros.Finalize();
 
-    RefCntAutoPtr<IShader> pResetParticleListsCS;
+    RefCntAutoPtr<IShader> pResetCellCountsCS;
     {
         ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
         ShaderCI.EntryPoint      = "main";
-        ShaderCI.Desc.Name       = "Reset particle lists CS";
-        ShaderCI.FilePath        = "reset_particle_lists.csh";
+        ShaderCI.Desc.Name       = "Reset cell counts CS";
+        ShaderCI.FilePath        = "reset_cell_counts.csh";
         ShaderCI.Macros          = Macros;
-        m_pDevice->CreateShader(ShaderCI, &pResetParticleListsCS);
+        CreateShader(ShaderCI, &pResetCellCountsCS);
     }
 
     RefCntAutoPtr<IShader> pMoveParticlesCS;
@@ -180,7 +176,27 @@ void Tutorial14_ComputeShader::CreateUpdateParticlePSO()
         ShaderCI.Desc.Name       = "Move particles CS";
         ShaderCI.FilePath        = "move_particles.csh";
         ShaderCI.Macros          = Macros;
-        m_pDevice->CreateShader(ShaderCI, &pMoveParticlesCS);
+        CreateShader(ShaderCI, &pMoveParticlesCS);
+    }
+
+    RefCntAutoPtr<IShader> pPrefixSumCS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+        ShaderCI.EntryPoint      = "main";
+        ShaderCI.Desc.Name       = "Prefix sum CS";
+        ShaderCI.FilePath        = "prefix_sum.csh";
+        ShaderCI.Macros          = Macros;
+        CreateShader(ShaderCI, &pPrefixSumCS);
+    }
+
+    RefCntAutoPtr<IShader> pSortParticlesCS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+        ShaderCI.EntryPoint      = "main";
+        ShaderCI.Desc.Name       = "Sort particles CS";
+        ShaderCI.FilePath        = "sort_particles.csh";
+        ShaderCI.Macros          = Macros;
+        CreateShader(ShaderCI, &pSortParticlesCS);
     }
 
     RefCntAutoPtr<IShader> pCollideParticlesCS;
@@ -190,7 +206,7 @@ void Tutorial14_ComputeShader::CreateUpdateParticlePSO()
         ShaderCI.Desc.Name       = "Collide particles CS";
         ShaderCI.FilePath        = "collide_particles.csh";
         ShaderCI.Macros          = Macros;
-        m_pDevice->CreateShader(ShaderCI, &pCollideParticlesCS);
+        CreateShader(ShaderCI, &pCollideParticlesCS);
     }
 
     RefCntAutoPtr<IShader> pUpdatedSpeedCS;
@@ -201,7 +217,23 @@ void Tutorial14_ComputeShader::CreateUpdateParticlePSO()
         ShaderCI.FilePath        = "collide_particles.csh";
         Macros.AddShaderMacro("UPDATE_SPEED", 1);
         ShaderCI.Macros = Macros;
-        m_pDevice->CreateShader(ShaderCI, &pUpdatedSpeedCS);
+        CreateShader(ShaderCI, &pUpdatedSpeedCS);
+    }
+
+    RefCntAutoPtr<IShader> pAddBlockSumsCS;
+    {
+        // Macros now define UPDATE_SPEED, so use a separate set
+        ShaderMacroHelper ScanMacros;
+        ScanMacros.AddShaderMacro("THREAD_GROUP_SIZE", m_ThreadGroupSize);
+        ScanMacros.AddShaderMacro("ADD_BLOCK_SUMS", 1);
+        ScanMacros.Finalize();
+
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+        ShaderCI.EntryPoint      = "main";
+        ShaderCI.Desc.Name       = "Add block sums CS";
+        ShaderCI.FilePath        = "prefix_sum.csh";
+        ShaderCI.Macros          = ScanMacros;
+        CreateShader(ShaderCI, &pAddBlockSumsCS);
     }
 
     ComputePipelineStateCreateInfo PSOCreateInfo;
@@ -220,16 +252,21 @@ void Tutorial14_ComputeShader::CreateUpdateParticlePSO()
     PSODesc.ResourceLayout.Variables    = Vars;
     PSODesc.ResourceLayout.NumVariables = _countof(Vars);
 
-    PSODesc.Name      = "Reset particle lists PSO";
-    PSOCreateInfo.pCS = pResetParticleListsCS;
-    m_pDevice->CreateComputePipelineState(PSOCreateInfo, &m_pResetParticleListsPSO);
-    m_pResetParticleListsPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "Constants")->Set(m_Constants);
+    PSODesc.Name      = "Reset cell counts PSO";
+    PSOCreateInfo.pCS = pResetCellCountsCS;
+    m_pDevice->CreateComputePipelineState(PSOCreateInfo, &m_pResetCellCountsPSO);
+    m_pResetCellCountsPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "Constants")->Set(m_Constants);
 
     PSODesc.Name      = "Move particles PSO";
     PSOCreateInfo.pCS = pMoveParticlesCS;
     m_pDevice->CreateComputePipelineState(PSOCreateInfo, &m_pMoveParticlesPSO);
     m_pMoveParticlesPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "Constants")->Set(m_Constants);
 
+    PSODesc.Name      = "Sort particles PSO";
+    PSOCreateInfo.pCS = pSortParticlesCS;
+    m_pDevice->CreateComputePipelineState(PSOCreateInfo, &m_pSortParticlesPSO);
+    m_pSortParticlesPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "Constants")->Set(m_Constants);
+
     PSODesc.Name      = "Collidse particles PSO";
     PSOCreateInfo.pCS = pCollideParticlesCS;
     m_pDevice->CreateComputePipelineState(PSOCreateInfo, &m_pCollideParticlesPSO);
@@ -239,13 +276,39 @@ void Tutorial14_ComputeShader::CreateUpdateParticlePSO()
     PSOCreateInfo.pCS = pUpdatedSpeedCS;
     m_pDevice->CreateComputePipelineState(PSOCreateInfo, &m_pUpdateParticleSpeedPSO);
     m_pUpdateParticleSpeedPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "Constants")->Set(m_Constants);
+
+    // Prefix sum shaders use their own constant buffer
+    // clang-format off
+    ShaderResourceVariableDesc ScanVars[] = 
+    {
+        {SHADER_TYPE_COMPUTE, "ScanConstants", SHADER_RESOURCE_VARIABLE_TYPE_STATIC}
+    };
+    // clang-format on
+    PSODesc.ResourceLayout.Variables    = ScanVars;
+    PSODesc.ResourceLayout.NumVariables = _countof(ScanVars);
+
+    PSODesc.Name      = "Prefix sum PSO";
+    PSOCreateInfo.pCS = pPrefixSumCS;
+    m_pDevice->CreateComputePipelineState(PSOCreateInfo, &m_pPrefixSumPSO);
+    m_pPrefixSumPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "ScanConstants")->Set(m_ScanConstants);
+
+    PSODesc.Name      = "Add block sums PSO";
+    PSOCreateInfo.pCS = pAddBlockSumsCS;
+    m_pDevice->CreateComputePipelineState(PSOCreateInfo, &m_pAddBlockSumsPSO);
+    m_pAddBlockSumsPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "ScanConstants")->Set(m_ScanConstants);
 }
 
 void Tutorial14_ComputeShader::CreateParticleBuffers()
 {
-    m_pParticleAttribsBuffer.Release();
-    m_pParticleListHeadsBuffer.Release();
-    m_pParticleListsBuffer.Release();
+    for (auto& pBuffer : m_pParticleAttribsBuffer)
+        pBuffer.Release();
+    m_pParticleBinOffsetsBuffer.Release();
+    m_pCellScanBuffer.Release();
+
+    // Pending validation refers to the old buffers
+    for (auto& pBuffer : m_pValidationStagingBuffers)
+        pBuffer.Release();
+    m_ValidationPending = false;
 
     BufferDesc BuffDesc;
     BuffDesc.Name              = "Particle attribs buffer";
@@ -253,7 +316,7 @@ void Tutorial14_ComputeShader::CreateParticleBuffers()
     BuffDesc.BindFlags         = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
     BuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
     BuffDesc.ElementByteStride = sizeof(ParticleAttribs);
-    BuffDesc.Size              = sizeof(ParticleAttribs) * m_NumParticles;
+    BuffDesc.Size              = Uint64{sizeof(ParticleAttribs)} * static_cast<Uint64>(m_NumParticles);
 
     std::vector<ParticleAttribs> ParticleData(m_NumParticles);
 
@@ -266,64 +329,106 @@ void Tutorial14_ComputeShader::CreateParticleBuffers()
     constexpr float fMaxParticleSize = 0.05f;
     float           fSize            = 0.7f / std::sqrt(static_cast<float>(m_NumParticles));
     fSize                            = std::min(fMaxParticleSize, fSize);
-    for (auto& particle : ParticleData)
+    for (size_t i = 0; i < ParticleData.size(); ++i)
     {
+        auto& particle        = ParticleData[i];
         particle.f2NewPos.x   = pos_distr(gen);
         particle.f2NewPos.y   = pos_distr(gen);
         particle.f2NewSpeed.x = pos_distr(gen) * fSize * 5.f;
         particle.f2NewSpeed.y = pos_distr(gen) * fSize * 5.f;
         particle.fSize        = fSize * size_distr(gen);
+        particle.iId          = static_cast<int>(i);
     }
 
     BufferData VBData;
     VBData.pData    = ParticleData.data();
-    VBData.DataSize = sizeof(ParticleAttribs) * static_cast<Uint32>(ParticleData.size());
-    m_pDevice->CreateBuffer(BuffDesc, &VBData, &m_pParticleAttribsBuffer);
-    IBufferView* pParticleAttribsBufferSRV = m_pParticleAttribsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE);
-    IBufferView* pParticleAttribsBufferUAV = m_pParticleAttribsBuffer->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS);
+    VBData.DataSize = BuffDesc.Size;
+    m_pDevice->CreateBuffer(BuffDesc, &VBData, &m_pParticleAttribsBuffer[0]);
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pParticleAttribsBuffer[1]);
+    m_BufferIdx = 0;
+
+    // The bin sizes need one extra element for the total count. Every next scan level
+    // contains one element per thread group of the previous level.
+    m_ScanLevels.clear();
+    {
+        Uint32 Count  = static_cast<Uint32>(m_NumParticles) + 1;
+        Uint32 Offset = 0;
+        while (true)
+        {
+            m_ScanLevels.push_back({Count, Offset});
+            Offset += Count;
+            if (Count == 1)
+                break;
+            Count = (Count + m_ThreadGroupSize - 1) / m_ThreadGroupSize;
+        }
+    }
 
+    BuffDesc.Name              = "Particle bin offsets buffer";
     BuffDesc.ElementByteStride = sizeof(int);
     BuffDesc.Mode              = BUFFER_MODE_FORMATTED;
     BuffDesc.Size              = Uint64{BuffDesc.ElementByteStride} * static_cast<Uint64>(m_NumParticles);
     BuffDesc.BindFlags         = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
-    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pParticleListHeadsBuffer);
-    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pParticleListsBuffer);
-    RefCntAutoPtr<IBufferView> pParticleListHeadsBufferUAV;
-    RefCntAutoPtr<IBufferView> pParticleListsBufferUAV;
-    RefCntAutoPtr<IBufferView> pParticleListHeadsBufferSRV;
-    RefCntAutoPtr<IBufferView> pParticleListsBufferSRV;
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pParticleBinOffsetsBuffer);
+
+    BuffDesc.Name = "Cell scan buffer";
+    BuffDesc.Size = Uint64{BuffDesc.ElementByteStride} * (m_ScanLevels.back().Offset + m_ScanLevels.back().Count);
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pCellScanBuffer);
+
+    RefCntAutoPtr<IBufferView> pParticleBinOffsetsBufferUAV;
+    RefCntAutoPtr<IBufferView> pCellScanBufferUAV;
+    RefCntAutoPtr<IBufferView> pParticleBinOffsetsBufferSRV;
+    RefCntAutoPtr<IBufferView> pCellScanBufferSRV;
     {
         BufferViewDesc ViewDesc;
         ViewDesc.ViewType             = BUFFER_VIEW_UNORDERED_ACCESS;
         ViewDesc.Format.ValueType     = VT_INT32;
         ViewDesc.Format.NumComponents = 1;
-        m_pParticleListHeadsBuffer->CreateView(ViewDesc, &pParticleListHeadsBufferUAV);
-        m_pParticleListsBuffer->CreateView(ViewDesc, &pParticleListsBufferUAV);
+        m_pParticleBinOffsetsBuffer->CreateView(ViewDesc, &pParticleBinOffsetsBufferUAV);
+        m_pCellScanBuffer->CreateView(ViewDesc, &pCellScanBufferUAV);
 
         ViewDesc.ViewType = BUFFER_VIEW_SHADER_RESOURCE;
-        m_pParticleListHeadsBuffer->CreateView(ViewDesc, &pParticleListHeadsBufferSRV);
-        m_pParticleListsBuffer->CreateView(ViewDesc, &pParticleListsBufferSRV);
+        m_pParticleBinOffsetsBuffer->CreateView(ViewDesc, &pParticleBinOffsetsBufferSRV);
+        m_pCellScanBuffer->CreateView(ViewDesc, &pCellScanBufferSRV);
     }
 
-    m_pResetParticleListsSRB.Release();
-    m_pResetParticleListsPSO->CreateShaderResourceBinding(&m_pResetParticleListsSRB, true);
-    m_pResetParticleListsSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ParticleListHead")->Set(pParticleListHeadsBufferUAV);
-
-    m_pRenderParticleSRB.Release();
-    m_pRenderParticlePSO->CreateShaderResourceBinding(&m_pRenderParticleSRB, true);
-    m_pRenderParticleSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_Particles")->Set(pParticleAttribsBufferSRV);
-
-    m_pMoveParticlesSRB.Release();
-    m_pMoveParticlesPSO->CreateShaderResourceBinding(&m_pMoveParticlesSRB, true);
-    m_pMoveParticlesSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Particles")->Set(pParticleAttribsBufferUAV);
-    m_pMoveParticlesSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ParticleListHead")->Set(pParticleListHeadsBufferUAV);
-    m_pMoveParticlesSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ParticleLists")->Set(pParticleListsBufferUAV);
-
-    m_pCollideParticlesSRB.Release();
-    m_pCollideParticlesPSO->CreateShaderResourceBinding(&m_pCollideParticlesSRB, true);
-    m_pCollideParticlesSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Particles")->Set(pParticleAttribsBufferUAV);
-    m_pCollideParticlesSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ParticleListHead")->Set(pParticleListHeadsBufferSRV);
-    m_pCollideParticlesSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ParticleLists")->Set(pParticleListsBufferSRV);
+    m_pResetCellCountsSRB.Release();
+    m_pResetCellCountsPSO->CreateShaderResourceBinding(&m_pResetCellCountsSRB, true);
+    m_pResetCellCountsSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_CellCounts")->Set(pCellScanBufferUAV);
+
+    // Same SRB is used by both prefix sum pipelines
+    m_pPrefixSumSRB.Release();
+    m_pPrefixSumPSO->CreateShaderResourceBinding(&m_pPrefixSumSRB, true);
+    m_pPrefixSumSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ScanData")->Set(pCellScanBufferUAV);
+
+    for (Uint32 i = 0; i < m_pParticleAttribsBuffer.size(); ++i)
+    {
+        IBufferView* pParticleAttribsBufferSRV       = m_pParticleAttribsBuffer[i]->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE);
+        IBufferView* pParticleAttribsBufferUAV       = m_pParticleAttribsBuffer[i]->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS);
+        IBufferView* pSortedParticleAttribsBufferUAV = m_pParticleAttribsBuffer[1 - i]->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS);
+
+        m_pRenderParticleSRB[i].Release();
+        m_pRenderParticlePSO->CreateShaderResourceBinding(&m_pRenderParticleSRB[i], true);
+        m_pRenderParticleSRB[i]->GetVariableByName(SHADER_TYPE_VERTEX, "g_Particles")->Set(pParticleAttribsBufferSRV);
+
+        m_pMoveParticlesSRB[i].Release();
+        m_pMoveParticlesPSO->CreateShaderResourceBinding(&m_pMoveParticlesSRB[i], true);
+        m_pMoveParticlesSRB[i]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Particles")->Set(pParticleAttribsBufferUAV);
+        m_pMoveParticlesSRB[i]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_CellCounts")->Set(pCellScanBufferUAV);
+        m_pMoveParticlesSRB[i]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ParticleBinOffsets")->Set(pParticleBinOffsetsBufferUAV);
+
+        // Sorts the particles from buffer i into the other buffer
+        m_pSortParticlesSRB[i].Release();
+        m_pSortParticlesPSO->CreateShaderResourceBinding(&m_pSortParticlesSRB[i], true);
+        m_pSortParticlesSRB[i]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Particles")->Set(pParticleAttribsBufferSRV);
+        m_pSortParticlesSRB[i]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_SortedParticles")->Set(pSortedParticleAttribsBufferUAV);
+        m_pSortParticlesSRB[i]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_CellStart")->Set(pCellScanBufferSRV);
+        m_pSortParticlesSRB[i]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ParticleBinOffsets")->Set(pParticleBinOffsetsBufferSRV);
+
+        m_pCollideParticlesSRB[i].Release();
+        m_pCollideParticlesPSO->CreateShaderResourceBinding(&m_pCollideParticlesSRB[i], true);
+        m_pCollideParticlesSRB[i]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Particles")->Set(pParticleAttribsBufferUAV);
+        m_pCollideParticlesSRB[i]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_CellStart")->Set(pCellScanBufferSRV);
+    }
 }
 
 void Tutorial14_ComputeShader::CreateConsantBuffer()
@@ -333,8 +438,12 @@ void Tutorial14_ComputeShader::CreateConsantBuffer()
     BuffDesc.Usage          = USAGE_DYNAMIC;
     BuffDesc.BindFlags      = BIND_UNIFORM_BUFFER;
     BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
-    BuffDesc.Size           = sizeof(float4) * 2;
+    BuffDesc.Size           = sizeof(SimulationConstants);
     m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_Constants);
+
+    BuffDesc.Name = "Scan constants buffer";
+    BuffDesc.Size = sizeof(ScanAttribs);
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_ScanConstants);
 }
 
 void Tutorial14_ComputeShader::UpdateUI()
@@ -342,12 +451,17 @@ void Tutorial14_ComputeShader::UpdateUI()
     ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
     if (ImGui::Begin("Settings", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
     {
-        if (ImGui::InputInt("Num Particles", &m_NumParticles, 100, 1000, ImGuiInputTextFlags_EnterReturnsTrue))
+        if (ImGui::InputInt("Num Particles", &m_NumParticles, 1000, 100000, ImGuiInputTextFlags_EnterReturnsTrue))
         {
-            m_NumParticles = std::min(std::max(m_NumParticles, 100), 100000);
+            m_NumParticles = std::min(std::max(m_NumParticles, 100), MaxParticles);
             CreateParticleBuffers();
         }
         ImGui::SliderFloat("Simulation Speed", &m_fSimulationSpeed, 0.1f, 5.f);
+
+        if (ImGui::Button("Validate on CPU"))
+            m_ValidationRequested = true;
+        if (!m_ValidationStatus.empty())
+            ImGui::TextDisabled("%s", m_ValidationStatus.c_str());
     }
     ImGui::End();
 }
@@ -367,6 +481,37 @@ void Tutorial14_ComputeShader::Initialize(const SampleInitInfo& InitInfo)
     CreateRenderParticlePSO();
     CreateUpdateParticlePSO();
     CreateParticleBuffers();
+
+    FenceDesc FDesc;
+    FDesc.Name = "Validation data available";
+    m_pDevice->CreateFence(FDesc, &m_pValidationFence);
+}
+
+void Tutorial14_ComputeShader::ComputeCellOffsets()
+{
+    const auto Dispatch = [this](IPipelineState* pPSO, size_t Level) {
+        {
+            MapHelper<ScanAttribs> ScanConsts(m_pImmediateContext, m_ScanConstants, MAP_WRITE, MAP_FLAG_DISCARD);
+            ScanConsts->uiCount          = m_ScanLevels[Level].Count;
+            ScanConsts->uiDataOffset     = m_ScanLevels[Level].Offset;
+            ScanConsts->uiBlockSumOffset = m_ScanLevels[Level + 1].Offset;
+        }
+
+        DispatchComputeAttribs DispatAttribs;
+        DispatAttribs.ThreadGroupCountX = m_ScanLevels[Level + 1].Count;
+        m_pImmediateContext->SetPipelineState(pPSO);
+        m_pImmediateContext->CommitShaderResources(m_pPrefixSumSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->DispatchCompute(DispatAttribs);
+    };
+
+    // Every level is scanned within thread groups, and group sums are written to the next level.
+    // The last level has a single element, so the level before it fits into one thread group.
+    for (size_t Level = 0; Level + 1 < m_ScanLevels.size(); ++Level)
+        Dispatch(m_pPrefixSumPSO, Level);
+
+    // Propagate group offsets down to the first level
+    for (size_t Level = m_ScanLevels.size() - 2; Level-- > 0;)
+        Dispatch(m_pAddBlockSumsPSO, Level);
 }
 
 // Render a frame
@@ -380,62 +525,137 @@ void Tutorial14_ComputeShader::Render()
     m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
+    SimulationConstants Constants;
+    Constants.uiNumParticles = static_cast<Uint32>(m_NumParticles);
+    Constants.fDeltaTime     = std::min(m_fTimeDelta, 1.f / 60.f) * m_fSimulationSpeed;
+    Constants.fDummy0        = 0;
+    Constants.fDummy1        = 0;
+
+    float AspectRatio = static_cast<float>(m_pSwapChain->GetDesc().Width) / static_cast<float>(m_pSwapChain->GetDesc().Height);
+    Constants.f2Scale = float2(std::sqrt(1.f / AspectRatio), std::sqrt(AspectRatio));
+
+    int iParticleGridWidth         = static_cast<int>(std::sqrt(static_cast<float>(m_NumParticles)) / Constants.f2Scale.x);
+    Constants.i2ParticleGridSize.x = iParticleGridWidth;
+    Constants.i2ParticleGridSize.y = m_NumParticles / iParticleGridWidth;
     {
-        struct Constants
+        // Map the buffer and write the simulation constants
+        MapHelper<SimulationConstants> ConstData(m_pImmediateContext, m_Constants, MAP_WRITE, MAP_FLAG_DISCARD);
+        *ConstData = Constants;
+    }
+
+    // Particles are moved in the source buffer and sorted into the destination buffer
+    const Uint32 SrcIdx = m_BufferIdx;
+    const Uint32 DstIdx = 1 - m_BufferIdx;
+
+    const bool   Validate   = m_ValidationRequested && !m_ValidationPending;
+    const Uint64 BufferSize = m_pParticleAttribsBuffer[SrcIdx]->GetDesc().Size;
+    if (Validate)
+    {
+        if (!m_pValidationStagingBuffers[0])
         {
-            uint  uiNumParticles;
-            float fDeltaTime;
-            float fDummy0;
-            float fDummy1;
-
-            float2 f2Scale;
-            int2   i2ParticleGridSize;
-        };
-        // Map the buffer and write current world-view-projection matrix
-        MapHelper<Constants> ConstData(m_pImmediateContext, m_Constants, MAP_WRITE, MAP_FLAG_DISCARD);
-        ConstData->uiNumParticles = static_cast<Uint32>(m_NumParticles);
-        ConstData->fDeltaTime     = std::min(m_fTimeDelta, 1.f / 60.f) * m_fSimulationSpeed;
-
-        float  AspectRatio = static_cast<float>(m_pSwapChain->GetDesc().Width) / static_cast<float>(m_pSwapChain->GetDesc().Height);
-        float2 f2Scale     = float2(std::sqrt(1.f / AspectRatio), std::sqrt(AspectRatio));
-        ConstData->f2Scale = f2Scale;
-
-        int iParticleGridWidth          = static_cast<int>(std::sqrt(static_cast<float>(m_NumParticles)) / f2Scale.x);
-        ConstData->i2ParticleGridSize.x = iParticleGridWidth;
-        ConstData->i2ParticleGridSize.y = m_NumParticles / iParticleGridWidth;
+            BufferDesc BuffDesc;
+            BuffDesc.Name           = "Validation staging buffer";
+            BuffDesc.Usage          = USAGE_STAGING;
+            BuffDesc.CPUAccessFlags = CPU_ACCESS_READ;
+            BuffDesc.Size           = BufferSize;
+            for (auto& pBuffer : m_pValidationStagingBuffers)
+                m_pDevice->CreateBuffer(BuffDesc, nullptr, &pBuffer);
+        }
+
+        // Save the simulation input
+        m_pImmediateContext->CopyBuffer(m_pParticleAttribsBuffer[SrcIdx], 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                        m_pValidationStagingBuffers[0], 0, BufferSize, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     }
 
     DispatchComputeAttribs DispatAttribs;
     DispatAttribs.ThreadGroupCountX = (m_NumParticles + m_ThreadGroupSize - 1) / m_ThreadGroupSize;
 
-    m_pImmediateContext->SetPipelineState(m_pResetParticleListsPSO);
-    m_pImmediateContext->CommitShaderResources(m_pResetParticleListsSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-    m_pImmediateContext->DispatchCompute(DispatAttribs);
+    // Bin sizes are reset for all possible bins plus the total count
+    DispatchComputeAttribs ResetDispatAttribs;
+    ResetDispatAttribs.ThreadGroupCountX = (m_NumParticles + m_ThreadGroupSize) / m_ThreadGroupSize;
+
+    m_pImmediateContext->SetPipelineState(m_pResetCellCountsPSO);
+    m_pImmediateContext->CommitShaderResources(m_pResetCellCountsSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pImmediateContext->DispatchCompute(ResetDispatAttribs);
 
     m_pImmediateContext->SetPipelineState(m_pMoveParticlesPSO);
-    m_pImmediateContext->CommitShaderResources(m_pMoveParticlesSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pImmediateContext->CommitShaderResources(m_pMoveParticlesSRB[SrcIdx], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pImmediateContext->DispatchCompute(DispatAttribs);
+
+    ComputeCellOffsets();
+
+    m_pImmediateContext->SetPipelineState(m_pSortParticlesPSO);
+    m_pImmediateContext->CommitShaderResources(m_pSortParticlesSRB[SrcIdx], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     m_pImmediateContext->DispatchCompute(DispatAttribs);
 
     m_pImmediateContext->SetPipelineState(m_pCollideParticlesPSO);
-    m_pImmediateContext->CommitShaderResources(m_pCollideParticlesSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pImmediateContext->CommitShaderResources(m_pCollideParticlesSRB[DstIdx], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     m_pImmediateContext->DispatchCompute(DispatAttribs);
 
     m_pImmediateContext->SetPipelineState(m_pUpdateParticleSpeedPSO);
     // Use the same SRB
-    m_pImmediateContext->CommitShaderResources(m_pCollideParticlesSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pImmediateContext->CommitShaderResources(m_pCollideParticlesSRB[DstIdx], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     m_pImmediateContext->DispatchCompute(DispatAttribs);
 
+    if (Validate)
+    {
+        // Save the simulation output and read both buffers when the GPU is done
+        m_pImmediateContext->CopyBuffer(m_pParticleAttribsBuffer[DstIdx], 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                        m_pValidationStagingBuffers[1], 0, BufferSize, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->EnqueueSignal(m_pValidationFence, ++m_ValidationFenceValue);
+
+        m_ValidationConstants = Constants;
+        m_ValidationRequested = false;
+        m_ValidationPending   = true;
+        m_ValidationStatus    = "Validating...";
+    }
+
     m_pImmediateContext->SetPipelineState(m_pRenderParticlePSO);
-    m_pImmediateContext->CommitShaderResources(m_pRenderParticleSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pImmediateContext->CommitShaderResources(m_pRenderParticleSRB[DstIdx], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     DrawAttribs drawAttrs;
     drawAttrs.NumVertices  = 4;
     drawAttrs.NumInstances = static_cast<Uint32>(m_NumParticles);
     m_pImmediateContext->Draw(drawAttrs);
+
+    m_BufferIdx = DstIdx;
+}
+
+void Tutorial14_ComputeShader::ProcessValidationResults()
+{
+    if (!m_ValidationPending || m_pValidationFence->GetCompletedValue() < m_ValidationFenceValue)
+        return;
+
+    m_ValidationPending = false;
+
+    MapHelper<ParticleAttribs> InputData(m_pImmediateContext, m_pValidationStagingBuffers[0], MAP_READ, MAP_FLAG_DO_NOT_WAIT);
+    MapHelper<ParticleAttribs> OutputData(m_pImmediateContext, m_pValidationStagingBuffers[1], MAP_READ, MAP_FLAG_DO_NOT_WAIT);
+    if (!InputData || !OutputData)
+    {
+        m_ValidationStatus = "Failed to read simulation data";
+        return;
+    }
+
+    const auto Res = m_ReferenceSimulation.Validate(m_ValidationConstants, InputData, OutputData);
+
+    std::stringstream ss;
+    ss << (Res.IsValid() ? "GPU simulation matches CPU reference" : "GPU simulation does NOT match CPU reference") << std::endl
+       << "Unsorted particles: " << Res.NumUnsortedParticles << std::endl
+       << "Missing particles: " << Res.NumMissingParticles << std::endl
+       << "Collision mismatches: " << Res.NumCollisionMismatches << std::endl
+       << "Max position error: " << Res.MaxPositionError << std::endl
+       << "Max speed error: " << Res.MaxSpeedError;
+    m_ValidationStatus = ss.str();
+
+    if (Res.IsValid())
+        LOG_INFO_MESSAGE(m_ValidationStatus);
+    else
+        LOG_WARNING_MESSAGE(m_ValidationStatus);
 }
 
 void Tutorial14_ComputeShader::Update(double CurrTime, double ElapsedTime)
 {
     SampleBase::Update(CurrTime, ElapsedTime);
+    ProcessValidationResults();
     UpdateUI();
 
     m_fTimeDelta = static_cast<float>(ElapsedTime);
@@ -27,9 +27,13 @@
 
 #pragma once
 
+#include <array>
+#include <vector>
+
 #include "SampleBase.hpp"
 #include "ResourceMapping.h"
 #include "BasicMath.hpp"
+#include "ReferenceSimulation.hpp"
 
 namespace Diligent
 {
@@ -52,25 +56,59 @@ private:
     void CreateParticleBuffers();
     void CreateConsantBuffer();
     void UpdateUI();
+    void ComputeCellOffsets();
+    void ProcessValidationResults();
+
+    static constexpr int MaxParticles = 1 << 21;
 
     int m_NumParticles    = 2000;
     int m_ThreadGroupSize = 256;
 
+    // Particles are sorted by bins every frame, so the simulation alternates between two buffers:
+    // the particles are moved in one buffer and sorted into the other one, which is then
+    // used for collisions and rendering. Resource bindings are indexed by the buffer they update.
+    std::array<RefCntAutoPtr<IBuffer>, 2>                m_pParticleAttribsBuffer;
+    std::array<RefCntAutoPtr<IShaderResourceBinding>, 2> m_pRenderParticleSRB;
+    std::array<RefCntAutoPtr<IShaderResourceBinding>, 2> m_pMoveParticlesSRB;
+    std::array<RefCntAutoPtr<IShaderResourceBinding>, 2> m_pSortParticlesSRB;
+    std::array<RefCntAutoPtr<IShaderResourceBinding>, 2> m_pCollideParticlesSRB;
+    Uint32                                               m_BufferIdx = 0;
+
     RefCntAutoPtr<IPipelineState>         m_pRenderParticlePSO;
-    RefCntAutoPtr<IShaderResourceBinding> m_pRenderParticleSRB;
-    RefCntAutoPtr<IPipelineState>         m_pResetParticleListsPSO;
-    RefCntAutoPtr<IShaderResourceBinding> m_pResetParticleListsSRB;
+    RefCntAutoPtr<IPipelineState>         m_pResetCellCountsPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pResetCellCountsSRB;
     RefCntAutoPtr<IPipelineState>         m_pMoveParticlesPSO;
-    RefCntAutoPtr<IShaderResourceBinding> m_pMoveParticlesSRB;
+    RefCntAutoPtr<IPipelineState>         m_pPrefixSumPSO;
+    RefCntAutoPtr<IPipelineState>         m_pAddBlockSumsPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pPrefixSumSRB;
+    RefCntAutoPtr<IPipelineState>         m_pSortParticlesPSO;
     RefCntAutoPtr<IPipelineState>         m_pCollideParticlesPSO;
-    RefCntAutoPtr<IShaderResourceBinding> m_pCollideParticlesSRB;
     RefCntAutoPtr<IPipelineState>         m_pUpdateParticleSpeedPSO;
     RefCntAutoPtr<IBuffer>                m_Constants;
-    RefCntAutoPtr<IBuffer>                m_pParticleAttribsBuffer;
-    RefCntAutoPtr<IBuffer>                m_pParticleListsBuffer;
-    RefCntAutoPtr<IBuffer>                m_pParticleListHeadsBuffer;
+    RefCntAutoPtr<IBuffer>                m_ScanConstants;
+    RefCntAutoPtr<IBuffer>                m_pParticleBinOffsetsBuffer;
+    RefCntAutoPtr<IBuffer>                m_pCellScanBuffer;
     RefCntAutoPtr<IResourceMapping>       m_pResMapping;
 
+    // The scan buffer starts with the bin sizes that are turned into the offsets of the first
+    // particle in every bin. Every next level contains the sums of thread groups of the previous one.
+    struct ScanLevel
+    {
+        Uint32 Count;
+        Uint32 Offset;
+    };
+    std::vector<ScanLevel> m_ScanLevels;
+
+    // Validation of one simulation step against the CPU reference
+    std::array<RefCntAutoPtr<IBuffer>, 2> m_pValidationStagingBuffers;
+    RefCntAutoPtr<IFence>                 m_pValidationFence;
+    Uint64                                m_ValidationFenceValue = 0;
+    bool                                  m_ValidationRequested  = false;
+    bool                                  m_ValidationPending    = false;
+    SimulationConstants                   m_ValidationConstants  = {};
+    ReferenceSimulation                   m_ReferenceSimulation;
+    String                                m_ValidationStatus;
+
     float m_fTimeDelta       = 0;
     float m_fSimulationSpeed = 1;
 };
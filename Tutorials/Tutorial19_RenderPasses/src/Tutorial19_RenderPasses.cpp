@@ -66,7 +66,7 @@ void Tutorial19_RenderPasses::ModifyEngineInitInfo(const ModifyEngineInitInfoAtt
 }
 
 
-void Tutorial19_RenderPasses::CreateCubePSO(IShaderSourceInputStreamFactory* pShaderSourceFactory)
+PipelineStateBatch::PipelineStateFuture Tutorial19_RenderPasses::CreateCubePSO(PipelineStateBatch& PSOBatch, IShaderSourceInputStreamFactory* pShaderSourceFactory)
 {
     GraphicsPipelineStateCreateInfo PSOCreateInfo;
     PipelineStateDesc&              PSODesc = PSOCreateInfo.PSODesc;
@@ -93,25 +93,23 @@ void Tutorial19_RenderPasses::CreateCubePSO(IShaderSourceInputStreamFactory* pSh
 
     ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
     // Create cube vertex shader
-    RefCntAutoPtr<IShader> pVS;
+    PipelineStateBatch::ShaderFuture VS;
     {
         ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
         ShaderCI.EntryPoint      = "main";
         ShaderCI.Desc.Name       = "Cube VS";
         ShaderCI.FilePath        = "cube.vsh";
-        m_pDevice->CreateShader(ShaderCI, &pVS);
-        VERIFY_EXPR(pVS != nullptr);
+        VS = PSOBatch.AddShader(ShaderCI);
     }
 
     // Create cube pixel shader
-    RefCntAutoPtr<IShader> pPS;
+    PipelineStateBatch::ShaderFuture PS;
     {
         ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
         ShaderCI.EntryPoint      = "main";
         ShaderCI.Desc.Name       = "Cube PS";
         ShaderCI.FilePath        = "cube.psh";
-        m_pDevice->CreateShader(ShaderCI, &pPS);
-        VERIFY_EXPR(pPS != nullptr);
+        PS = PSOBatch.AddShader(ShaderCI);
     }
 
     // clang-format off
@@ -122,9 +120,6 @@ void Tutorial19_RenderPasses::CreateCubePSO(IShaderSourceInputStreamFactory* pSh
     };
     // clang-format on
 
-    PSOCreateInfo.pVS = pVS;
-    PSOCreateInfo.pPS = pPS;
-
     PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElems;
     PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements    = _countof(LayoutElems);
 
@@ -155,17 +150,23 @@ void Tutorial19_RenderPasses::CreateCubePSO(IShaderSourceInputStreamFactory* pSh
     PSODesc.ResourceLayout.ImmutableSamplers    = ImtblSamplers;
     PSODesc.ResourceLayout.NumImmutableSamplers = _countof(ImtblSamplers);
 
-    m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pCubePSO);
-    VERIFY_EXPR(m_pCubePSO != nullptr);
+    // The pipeline state is created on a worker thread after this function returns, so the request
+    // keeps copies of the arrays the create info references.
+    return PSOBatch.AddPipelineState([this, PSOCreateInfo, LayoutElems, Vars, ImtblSamplers, VS, PS](IPipelineState** ppPSO) mutable {
+        PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElems;
+        PSOCreateInfo.PSODesc.ResourceLayout.Variables            = Vars;
+        PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = ImtblSamplers;
 
-    m_pCubePSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "ShaderConstants")->Set(m_pShaderConstantsCB);
+        PSOCreateInfo.pVS = VS.get();
+        PSOCreateInfo.pPS = PS.get();
+        m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, ppPSO);
+        VERIFY_EXPR(*ppPSO != nullptr);
 
-    m_pCubePSO->CreateShaderResourceBinding(&m_pCubeSRB, true);
-    VERIFY_EXPR(m_pCubeSRB != nullptr);
-    m_pCubeSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_CubeTextureSRV);
+        (*ppPSO)->GetStaticVariableByName(SHADER_TYPE_VERTEX, "ShaderConstants")->Set(m_pShaderConstantsCB);
+    });
 }
 
-void Tutorial19_RenderPasses::CreateLightVolumePSO(IShaderSourceInputStreamFactory* pShaderSourceFactory)
+PipelineStateBatch::PipelineStateFuture Tutorial19_RenderPasses::CreateLightVolumePSO(PipelineStateBatch& PSOBatch, IShaderSourceInputStreamFactory* pShaderSourceFactory)
 {
     GraphicsPipelineStateCreateInfo PSOCreateInfo;
     PipelineStateDesc&              PSODesc = PSOCreateInfo.PSODesc;
@@ -197,18 +198,17 @@ void Tutorial19_RenderPasses::CreateLightVolumePSO(IShaderSourceInputStreamFacto
 
     ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
     // Create a vertex shader
-    RefCntAutoPtr<IShader> pVS;
+    PipelineStateBatch::ShaderFuture VS;
     {
         ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
         ShaderCI.EntryPoint      = "main";
         ShaderCI.Desc.Name       = "Light volume VS";
         ShaderCI.FilePath        = "light_volume.vsh";
-        m_pDevice->CreateShader(ShaderCI, &pVS);
-        VERIFY_EXPR(pVS != nullptr);
+        VS = PSOBatch.AddShader(ShaderCI);
     }
 
     // Create a pixel shader
-    RefCntAutoPtr<IShader> pPS;
+    PipelineStateBatch::ShaderFuture PS;
     {
         // For Vulkan and Metal, we will use a special GLSL shader that uses native input attachments
         const auto UseGLSL =
@@ -220,8 +220,7 @@ void Tutorial19_RenderPasses::CreateLightVolumePSO(IShaderSourceInputStreamFacto
         ShaderCI.EntryPoint      = "main";
         ShaderCI.Desc.Name       = "Light volume PS";
         ShaderCI.FilePath        = UseGLSL ? "light_volume_glsl.psh" : "light_volume_hlsl.psh";
-        m_pDevice->CreateShader(ShaderCI, &pPS);
-        VERIFY_EXPR(pPS != nullptr);
+        PS = PSOBatch.AddShader(ShaderCI);
     }
 
     // clang-format off
@@ -234,9 +233,6 @@ void Tutorial19_RenderPasses::CreateLightVolumePSO(IShaderSourceInputStreamFacto
     };
     // clang-format on
 
-    PSOCreateInfo.pVS = pVS;
-    PSOCreateInfo.pPS = pPS;
-
     PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElems;
     PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements    = _countof(LayoutElems);
 
@@ -253,14 +249,21 @@ void Tutorial19_RenderPasses::CreateLightVolumePSO(IShaderSourceInputStreamFacto
     PSODesc.ResourceLayout.Variables    = Vars;
     PSODesc.ResourceLayout.NumVariables = _countof(Vars);
 
-    m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pLightVolumePSO);
-    VERIFY_EXPR(m_pLightVolumePSO != nullptr);
+    return PSOBatch.AddPipelineState([this, PSOCreateInfo, LayoutElems, Vars, VS, PS](IPipelineState** ppPSO) mutable {
+        PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElems;
+        PSOCreateInfo.PSODesc.ResourceLayout.Variables            = Vars;
+
+        PSOCreateInfo.pVS = VS.get();
+        PSOCreateInfo.pPS = PS.get();
+        m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, ppPSO);
+        VERIFY_EXPR(*ppPSO != nullptr);
 
-    m_pLightVolumePSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "ShaderConstants")->Set(m_pShaderConstantsCB);
-    m_pLightVolumePSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "ShaderConstants")->Set(m_pShaderConstantsCB);
+        (*ppPSO)->GetStaticVariableByName(SHADER_TYPE_VERTEX, "ShaderConstants")->Set(m_pShaderConstantsCB);
+        (*ppPSO)->GetStaticVariableByName(SHADER_TYPE_PIXEL, "ShaderConstants")->Set(m_pShaderConstantsCB);
+    });
 }
 
-void Tutorial19_RenderPasses::CreateAmbientLightPSO(IShaderSourceInputStreamFactory* pShaderSourceFactory)
+PipelineStateBatch::PipelineStateFuture Tutorial19_RenderPasses::CreateAmbientLightPSO(PipelineStateBatch& PSOBatch, IShaderSourceInputStreamFactory* pShaderSourceFactory)
 {
     GraphicsPipelineStateCreateInfo PSOCreateInfo;
     PipelineStateDesc&              PSODesc = PSOCreateInfo.PSODesc;
@@ -281,18 +284,17 @@ void Tutorial19_RenderPasses::CreateAmbientLightPSO(IShaderSourceInputStreamFact
 
     ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
     // Create a vertex shader
-    RefCntAutoPtr<IShader> pVS;
+    PipelineStateBatch::ShaderFuture VS;
     {
         ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
         ShaderCI.EntryPoint      = "main";
         ShaderCI.Desc.Name       = "Ambient light VS";
         ShaderCI.FilePath        = "ambient_light.vsh";
-        m_pDevice->CreateShader(ShaderCI, &pVS);
-        VERIFY_EXPR(pVS != nullptr);
+        VS = PSOBatch.AddShader(ShaderCI);
     }
 
     // Create a pixel shader
-    RefCntAutoPtr<IShader> pPS;
+    PipelineStateBatch::ShaderFuture PS;
     {
         // For Vulkan and Metal, we will use a special GLSL shader that uses native input attachments
         const auto UseGLSL =
@@ -304,13 +306,9 @@ void Tutorial19_RenderPasses::CreateAmbientLightPSO(IShaderSourceInputStreamFact
         ShaderCI.EntryPoint      = "main";
         ShaderCI.Desc.Name       = "Ambient light PS";
         ShaderCI.FilePath        = UseGLSL ? "ambient_light_glsl.psh" : "ambient_light_hlsl.psh";
-        m_pDevice->CreateShader(ShaderCI, &pPS);
-        VERIFY_EXPR(pPS != nullptr);
+        PS = PSOBatch.AddShader(ShaderCI);
     }
 
-    PSOCreateInfo.pVS = pVS;
-    PSOCreateInfo.pPS = pPS;
-
     PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
 
     // clang-format off
@@ -323,8 +321,14 @@ void Tutorial19_RenderPasses::CreateAmbientLightPSO(IShaderSourceInputStreamFact
     PSODesc.ResourceLayout.Variables    = Vars;
     PSODesc.ResourceLayout.NumVariables = _countof(Vars);
 
-    m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pAmbientLightPSO);
-    VERIFY_EXPR(m_pAmbientLightPSO != nullptr);
+    return PSOBatch.AddPipelineState([this, PSOCreateInfo, Vars, VS, PS](IPipelineState** ppPSO) mutable {
+        PSOCreateInfo.PSODesc.ResourceLayout.Variables = Vars;
+
+        PSOCreateInfo.pVS = VS.get();
+        PSOCreateInfo.pPS = PS.get();
+        m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, ppPSO);
+        VERIFY_EXPR(*ppPSO != nullptr);
+    });
 }
 
 
@@ -479,9 +483,21 @@ void Tutorial19_RenderPasses::Initialize(const SampleInitInfo& InitInfo)
     RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
     m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
 
-    CreateCubePSO(pShaderSourceFactory);
-    CreateLightVolumePSO(pShaderSourceFactory);
-    CreateAmbientLightPSO(pShaderSourceFactory);
+    // Shaders and pipeline states of all passes are created in parallel
+    PipelineStateBatch PSOBatch{m_pDevice, m_pShaderCache};
+
+    auto CubePSO         = CreateCubePSO(PSOBatch, pShaderSourceFactory);
+    auto LightVolumePSO  = CreateLightVolumePSO(PSOBatch, pShaderSourceFactory);
+    auto AmbientLightPSO = CreateAmbientLightPSO(PSOBatch, pShaderSourceFactory);
+    PSOBatch.Execute();
+
+    m_pCubePSO         = CubePSO.get();
+    m_pLightVolumePSO  = LightVolumePSO.get();
+    m_pAmbientLightPSO = AmbientLightPSO.get();
+
+    m_pCubePSO->CreateShaderResourceBinding(&m_pCubeSRB, true);
+    VERIFY_EXPR(m_pCubeSRB != nullptr);
+    m_pCubeSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_CubeTextureSRV);
 
     // Transition all resources to required states as no transitions are allowed within the render pass.
     StateTransitionDesc Barriers[] = //
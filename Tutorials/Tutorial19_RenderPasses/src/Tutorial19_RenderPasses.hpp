@@ -32,6 +32,7 @@
 
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
+#include "PipelineStateBatch.hpp"
 
 namespace Diligent
 {
@@ -52,9 +53,9 @@ public:
     virtual void WindowResize(Uint32 Width, Uint32 Height) override final;
 
 private:
-    void CreateCubePSO(IShaderSourceInputStreamFactory* pShaderSourceFactory);
-    void CreateLightVolumePSO(IShaderSourceInputStreamFactory* pShaderSourceFactory);
-    void CreateAmbientLightPSO(IShaderSourceInputStreamFactory* pShaderSourceFactory);
+    PipelineStateBatch::PipelineStateFuture CreateCubePSO(PipelineStateBatch& PSOBatch, IShaderSourceInputStreamFactory* pShaderSourceFactory);
+    PipelineStateBatch::PipelineStateFuture CreateLightVolumePSO(PipelineStateBatch& PSOBatch, IShaderSourceInputStreamFactory* pShaderSourceFactory);
+    PipelineStateBatch::PipelineStateFuture CreateAmbientLightPSO(PipelineStateBatch& PSOBatch, IShaderSourceInputStreamFactory* pShaderSourceFactory);
     void UpdateUI();
     void CreateRenderPass();
     void DrawScene();
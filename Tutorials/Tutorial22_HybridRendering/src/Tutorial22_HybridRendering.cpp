@@ -47,6 +47,18 @@ SampleBase* CreateSample()
     return new Tutorial22_HybridRendering();
 }
 
+namespace
+{
+
+// ModelMat is the row-major model matrix, i.e. the transposed HLSL::ObjectAttribs::ModelMat
+void SetInstanceTransform(InstanceMatrix& Transform, const float4x4& ModelMat)
+{
+    Transform.SetRotation(ModelMat.Data(), 4);
+    Transform.SetTranslation(ModelMat.m30, ModelMat.m31, ModelMat.m32);
+}
+
+} // namespace
+
 void Tutorial22_HybridRendering::CreateSceneMaterials(uint2& CubeMaterialRange, Uint32& GroundMaterial, std::vector<HLSL::MaterialAttribs>& Materials)
 {
     Uint32 AnisotropicClampSampInd = 0;
@@ -390,11 +402,39 @@ void Tutorial22_HybridRendering::CreateSceneAccelStructs()
         TLASDesc.Flags            = RAYTRACING_BUILD_AS_ALLOW_UPDATE | RAYTRACING_BUILD_AS_PREFER_FAST_TRACE;
         m_pDevice->CreateTLAS(TLASDesc, &m_Scene.TLAS);
     }
+
+    InitTLASInstances();
 }
 
-void Tutorial22_HybridRendering::UpdateTLAS()
+void Tutorial22_HybridRendering::InitTLASInstances()
 {
     const Uint32 NumInstances = static_cast<Uint32>(m_Scene.Objects.size());
+
+    m_Scene.TLASInstances.resize(NumInstances);
+    m_Scene.TLASInstanceNames.resize(NumInstances);
+    for (Uint32 i = 0; i < NumInstances; ++i)
+    {
+        const auto& Obj  = m_Scene.Objects[i];
+        auto&       Inst = m_Scene.TLASInstances[i];
+        auto&       Name = m_Scene.TLASInstanceNames[i];
+        const auto& Mesh = m_Scene.Meshes[Obj.MeshId];
+
+        Name = Mesh.Name + " Instance (" + std::to_string(i) + ")";
+
+        Inst.InstanceName = Name.c_str();
+        Inst.pBLAS        = Mesh.BLAS.RawPtr<IBottomLevelAS>();
+        Inst.Mask         = 0xFF;
+
+        // CustomId will be read in shader by RayQuery::CommittedInstanceID()
+        Inst.CustomId = i;
+
+        SetInstanceTransform(Inst.Transform, Obj.ModelMat.Transpose());
+    }
+}
+
+void Tutorial22_HybridRendering::UpdateTLAS()
+{
+    const Uint32 NumInstances = static_cast<Uint32>(m_Scene.TLASInstances.size());
     bool         Update       = true;
 
     // Create scratch buffer
@@ -420,30 +460,18 @@ void Tutorial22_HybridRendering::UpdateTLAS()
         m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_Scene.TLASInstancesBuffer);
     }
 
-    // Setup instances
-    std::vector<TLASBuildInstanceData> Instances(NumInstances);
-    std::vector<String>                InstanceNames(NumInstances);
-    for (Uint32 i = 0; i < NumInstances; ++i)
+    // Transforms of moved objects have already been written to the instances by Update()
+    bool HasMovedInstances = false;
+    for (auto& DynObj : m_Scene.DynamicObjects)
     {
-        const auto& Obj      = m_Scene.Objects[i];
-        auto&       Inst     = Instances[i];
-        auto&       Name     = InstanceNames[i];
-        const auto& Mesh     = m_Scene.Meshes[Obj.MeshId];
-        const auto  ModelMat = Obj.ModelMat.Transpose();
-
-        Name = Mesh.Name + " Instance (" + std::to_string(i) + ")";
-
-        Inst.InstanceName = Name.c_str();
-        Inst.pBLAS        = Mesh.BLAS.RawPtr<IBottomLevelAS>();
-        Inst.Mask         = 0xFF;
-
-        // CustomId will be read in shader by RayQuery::CommittedInstanceID()
-        Inst.CustomId = i;
-
-        Inst.Transform.SetRotation(ModelMat.Data(), 4);
-        Inst.Transform.SetTranslation(ModelMat.m30, ModelMat.m31, ModelMat.m32);
+        HasMovedInstances = HasMovedInstances || DynObj.IsDirty;
+        DynObj.IsDirty    = false;
     }
 
+    // Static instances never change, so the TLAS only needs to be updated when an object has moved
+    if (Update && !HasMovedInstances)
+        return;
+
     // Build  TLAS
     BuildTLASAttribs Attribs;
     Attribs.pTLAS  = m_Scene.TLAS;
@@ -458,7 +486,7 @@ void Tutorial22_HybridRendering::UpdateTLAS()
     Attribs.pInstanceBuffer = m_Scene.TLASInstancesBuffer;
 
     // Instances will be converted to the format that is required by the graphics driver and copied to the instance buffer.
-    Attribs.pInstances    = Instances.data();
+    Attribs.pInstances    = m_Scene.TLASInstances.data();
     Attribs.InstanceCount = NumInstances;
 
     // Allow engine to change resource states.
@@ -488,7 +516,10 @@ void Tutorial22_HybridRendering::CreateScene()
         BuffDesc.Size              = static_cast<Uint64>(sizeof(m_Scene.Objects[0]) * m_Scene.Objects.size());
         BuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
         BuffDesc.ElementByteStride = sizeof(m_Scene.Objects[0]);
-        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_Scene.ObjectAttribsBuffer);
+
+        // Only the attribs of dynamic objects are updated every frame
+        BufferData BuffData{m_Scene.Objects.data(), BuffDesc.Size};
+        m_pDevice->CreateBuffer(BuffDesc, &BuffData, &m_Scene.ObjectAttribsBuffer);
     }
 
     // Create and initialize buffer for material attribs
@@ -848,9 +879,16 @@ void Tutorial22_HybridRendering::Render()
         GConst.AmbientLight = 0.1f;
         m_pImmediateContext->UpdateBuffer(m_Constants, 0, static_cast<Uint32>(sizeof(GConst)), &GConst, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-        // Update transformation for scene objects
-        m_pImmediateContext->UpdateBuffer(m_Scene.ObjectAttribsBuffer, 0, static_cast<Uint32>(sizeof(HLSL::ObjectAttribs) * m_Scene.Objects.size()),
-                                          m_Scene.Objects.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        // Update transformations of the objects that have moved
+        for (const auto& DynObj : m_Scene.DynamicObjects)
+        {
+            if (!DynObj.IsDirty)
+                continue;
+
+            const Uint32 ObjInd = DynObj.ObjectAttribsIndex;
+            m_pImmediateContext->UpdateBuffer(m_Scene.ObjectAttribsBuffer, Uint64{sizeof(HLSL::ObjectAttribs)} * ObjInd, static_cast<Uint32>(sizeof(HLSL::ObjectAttribs)),
+                                              &m_Scene.Objects[ObjInd], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        }
     }
 
     UpdateTLAS();
@@ -957,10 +995,13 @@ void Tutorial22_HybridRendering::Update(double CurrTime, double ElapsedTime)
     float RotationSpeed = 0.15f;
     for (auto& DynObj : m_Scene.DynamicObjects)
     {
-        auto& Obj      = m_Scene.Objects[DynObj.ObjectAttribsIndex];
-        auto  ModelMat = Obj.ModelMat.Transpose();
-        Obj.ModelMat   = (float4x4::RotationY(PI_F * dt * RotationSpeed) * ModelMat).Transpose();
-        Obj.NormalMat  = float4x3{Obj.ModelMat};
+        auto&      Obj      = m_Scene.Objects[DynObj.ObjectAttribsIndex];
+        const auto ModelMat = float4x4::RotationY(PI_F * dt * RotationSpeed) * Obj.ModelMat.Transpose();
+        Obj.ModelMat        = ModelMat.Transpose();
+        Obj.NormalMat       = float4x3{Obj.ModelMat};
+
+        SetInstanceTransform(m_Scene.TLASInstances[DynObj.ObjectAttribsIndex].Transform, ModelMat);
+        DynObj.IsDirty = true;
 
         RotationSpeed *= 1.5f;
     }
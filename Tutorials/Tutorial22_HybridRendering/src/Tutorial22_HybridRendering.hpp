@@ -90,6 +90,7 @@ private:
     void CreateSceneMaterials(uint2& CubeMaterialRange, Uint32& GroundMaterial, std::vector<HLSL::MaterialAttribs>& Materials);
     void CreateSceneObjects(uint2 CubeMaterialRange, Uint32 GroundMaterial);
     void CreateSceneAccelStructs();
+    void InitTLASInstances();
     void UpdateTLAS();
     void CreateRasterizationPSO(IShaderSourceInputStreamFactory* pShaderSourceFactory);
     void CreatePostProcessPSO(IShaderSourceInputStreamFactory* pShaderSourceFactory);
@@ -141,7 +142,8 @@ private:
 
     struct DynamicObject
     {
-        Uint32 ObjectAttribsIndex = 0; // Index in m_Scene.ObjectAttribsBuffer
+        Uint32 ObjectAttribsIndex = 0;     // Index in m_Scene.ObjectAttribsBuffer
+        bool   IsDirty            = false; // Transform changed since the last TLAS update
     };
 
     struct Scene
@@ -162,6 +164,11 @@ private:
         RefCntAutoPtr<ITopLevelAS> TLAS;
         RefCntAutoPtr<IBuffer>     TLASInstancesBuffer; // Used to update TLAS
         RefCntAutoPtr<IBuffer>     TLASScratchBuffer;   // Used to update TLAS
+
+        // TLAS instances are set up once and only the transforms of dynamic objects are rewritten.
+        // Instance names are referenced by TLASInstances and never change.
+        std::vector<TLASBuildInstanceData> TLASInstances;
+        std::vector<String>                TLASInstanceNames;
     };
     Scene m_Scene;
 
@@ -30,6 +30,14 @@
 #include "MapHelper.hpp"
 #include "PlatformMisc.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define BUILDINGS_MIPMAP_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define BUILDINGS_MIPMAP_NEON 1
+#endif
+
 namespace Diligent
 {
 namespace HLSL
@@ -646,8 +654,9 @@ void Buildings::CreateResources(IDeviceContext* pContext)
         for (Uint32 Mip = 0; Mip < TexDesc.MipLevels; ++Mip)
             SliceSize += std::max(1u, TexDesc.Width >> Mip) * std::max(1u, TexDesc.Height >> Mip);
 
-        m_OpaqueTexAtlasPixels.resize(size_t{SliceSize} * size_t{TexDesc.ArraySize});
-        m_GenTexTask.Pixels.resize(SliceSize);
+        m_OpaqueTexAtlasSlices.resize(TexDesc.ArraySize);
+        for (auto& SlicePixels : m_OpaqueTexAtlasSlices)
+            SlicePixels.resize(SliceSize);
         m_OpaqueTexAtlasSliceSize = SliceSize * 4;
 
         // Initialize content
@@ -656,14 +665,23 @@ void Buildings::CreateResources(IDeviceContext* pContext)
         UpdateAtlas(pContext, ~0u, Unused);
         pContext->Flush();
 
-        // Begin texture generation in async thread
+        // Begin texture generation in worker threads
         {
-            m_GenTexTask.ArraySlice = 0;
-            m_GenTexTask.Time       = CurrentTime;
+            const auto NumJobs = std::min(static_cast<Uint32>(m_GenTexThreads.size()) * 2u, TexDesc.ArraySize);
 
-            const auto OldStatus = m_GenTexTask.Status.exchange(TaskStatus::NewTask, std::memory_order_release);
-            VERIFY_EXPR(OldStatus == TaskStatus::Initial);
+            std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+            m_GenTexJobs.resize(NumJobs);
+            for (Uint32 i = 0; i < NumJobs; ++i)
+            {
+                auto& Job = m_GenTexJobs[i];
+                Job.Pixels.resize(SliceSize);
+                Job.ArraySlice    = m_NextGenTexSlice;
+                Job.Time          = CurrentTime;
+                m_NextGenTexSlice = (m_NextGenTexSlice + 1) % TexDesc.ArraySize;
+                m_PendingGenTexJobs.push_back(i);
+            }
         }
+        m_GenTexCV.notify_all();
     }
 
     m_DrawOpaqueSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_OpaqueTexAtlas")->Set(m_OpaqueTexAtlas->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
@@ -971,26 +989,108 @@ static void GenWindowsAndTopNeonLineTexture(Uint32* Pixels, const Uint32 W, cons
     }
 }
 
+// Averages 2x2 blocks of source pixels. Self-emission (alpha) is kept only if at least
+// three of the four source pixels are emissive.
 static void GenMipmap(const Uint32* SrcPixels, const Uint32 SrcW, const Uint32 SrcH, Uint32* DstPixels, const Uint32 DstW, const Uint32 DstH)
 {
     VERIFY_EXPR(SrcW >= 2 && SrcH >= 2);
 
     for (Uint32 y = 0; y < DstH; ++y)
     {
-        for (Uint32 x = 0; x < DstW; ++x)
+        const Uint32* Row0 = SrcPixels + (y * 2 + 0) * SrcW;
+        const Uint32* Row1 = SrcPixels + (y * 2 + 1) * SrcW;
+        Uint32*       Dst  = DstPixels + y * DstW;
+
+        Uint32 x = 0;
+#if BUILDINGS_MIPMAP_SSE2
+        // Four destination pixels per iteration. Channels are summed as 16-bit integers,
+        // two pixels per register.
+        const __m128i Zero      = _mm_setzero_si128();
+        const __m128i ColorMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+        const __m128i MinZeros  = _mm_set1_epi16(-2);
+        for (; x + 4 <= DstW; x += 4)
         {
-            float4 c0  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 0) + (y * 2 + 0) * SrcW]);
-            float4 c1  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 1) + (y * 2 + 0) * SrcW]);
-            float4 c2  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 0) + (y * 2 + 1) * SrcW]);
-            float4 c3  = RGBA8Unorm_To_F4Color(SrcPixels[(x * 2 + 1) + (y * 2 + 1) * SrcW]);
-            float4 col = (c0 + c1 + c2 + c3) * 0.25f;
+            __m128i Sum[2];
+            __m128i Keep[2];
+            for (Uint32 half = 0; half < 2; ++half)
+            {
+                const __m128i Src0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row0 + x * 2 + half * 4));
+                const __m128i Src1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row1 + x * 2 + half * 4));
+
+                const __m128i Src0Lo = _mm_unpacklo_epi8(Src0, Zero);
+                const __m128i Src0Hi = _mm_unpackhi_epi8(Src0, Zero);
+                const __m128i Src1Lo = _mm_unpacklo_epi8(Src1, Zero);
+                const __m128i Src1Hi = _mm_unpackhi_epi8(Src1, Zero);
+
+                // Vertical sums of the columns, then horizontal sums of the column pairs
+                const __m128i ColLo = _mm_add_epi16(Src0Lo, Src1Lo);
+                const __m128i ColHi = _mm_add_epi16(Src0Hi, Src1Hi);
+                Sum[half]           = _mm_add_epi16(_mm_unpacklo_epi64(ColLo, ColHi), _mm_unpackhi_epi64(ColLo, ColHi));
+
+                // Every zero channel adds -1, so a sum greater than -2 means at most one zero
+                const __m128i ZeroLo = _mm_add_epi16(_mm_cmpeq_epi16(Src0Lo, Zero), _mm_cmpeq_epi16(Src1Lo, Zero));
+                const __m128i ZeroHi = _mm_add_epi16(_mm_cmpeq_epi16(Src0Hi, Zero), _mm_cmpeq_epi16(Src1Hi, Zero));
+                const __m128i Zeros  = _mm_add_epi16(_mm_unpacklo_epi64(ZeroLo, ZeroHi), _mm_unpackhi_epi64(ZeroLo, ZeroHi));
+                Keep[half]           = _mm_or_si128(_mm_cmpgt_epi16(Zeros, MinZeros), ColorMask);
+            }
+
+            const __m128i Avg01 = _mm_and_si128(_mm_srli_epi16(Sum[0], 2), Keep[0]);
+            const __m128i Avg23 = _mm_and_si128(_mm_srli_epi16(Sum[1], 2), Keep[1]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(Dst + x), _mm_packus_epi16(Avg01, Avg23));
+        }
+#elif BUILDINGS_MIPMAP_NEON
+        const uint16x8_t ColorMask = vcombine_u16(vcreate_u16(0x0000FFFFFFFFFFFFull), vcreate_u16(0x0000FFFFFFFFFFFFull));
+        const int16x8_t  MinZeros  = vdupq_n_s16(-2);
+        for (; x + 4 <= DstW; x += 4)
+        {
+            uint16x8_t Avg[2];
+            for (Uint32 half = 0; half < 2; ++half)
+            {
+                const uint8x16_t Src0 = vld1q_u8(reinterpret_cast<const uint8_t*>(Row0 + x * 2 + half * 4));
+                const uint8x16_t Src1 = vld1q_u8(reinterpret_cast<const uint8_t*>(Row1 + x * 2 + half * 4));
+
+                const uint16x8_t Src0Lo = vmovl_u8(vget_low_u8(Src0));
+                const uint16x8_t Src0Hi = vmovl_u8(vget_high_u8(Src0));
+                const uint16x8_t Src1Lo = vmovl_u8(vget_low_u8(Src1));
+                const uint16x8_t Src1Hi = vmovl_u8(vget_high_u8(Src1));
+
+                const uint16x8_t ColLo = vaddq_u16(Src0Lo, Src1Lo);
+                const uint16x8_t ColHi = vaddq_u16(Src0Hi, Src1Hi);
+                const uint16x8_t Sum   = vaddq_u16(vcombine_u16(vget_low_u16(ColLo), vget_low_u16(ColHi)),
+                                                 vcombine_u16(vget_high_u16(ColLo), vget_high_u16(ColHi)));
+
+                const uint16x8_t ZeroLo = vaddq_u16(vceqzq_u16(Src0Lo), vceqzq_u16(Src1Lo));
+                const uint16x8_t ZeroHi = vaddq_u16(vceqzq_u16(Src0Hi), vceqzq_u16(Src1Hi));
+                const int16x8_t  Zeros  = vreinterpretq_s16_u16(vaddq_u16(vcombine_u16(vget_low_u16(ZeroLo), vget_low_u16(ZeroHi)),
+                                                                         vcombine_u16(vget_high_u16(ZeroLo), vget_high_u16(ZeroHi))));
+                const uint16x8_t Keep   = vorrq_u16(vcgtq_s16(Zeros, MinZeros), ColorMask);
+
+                Avg[half] = vandq_u16(vshrq_n_u16(Sum, 2), Keep);
+            }
+            vst1q_u8(reinterpret_cast<uint8_t*>(Dst + x), vcombine_u8(vmovn_u16(Avg[0]), vmovn_u16(Avg[1])));
+        }
+#endif
+
+        for (; x < DstW; ++x)
+        {
+            const Uint32 c0 = Row0[x * 2 + 0];
+            const Uint32 c1 = Row0[x * 2 + 1];
+            const Uint32 c2 = Row1[x * 2 + 0];
+            const Uint32 c3 = Row1[x * 2 + 1];
+
+            Uint32 col = 0;
+            for (Uint32 Shift = 0; Shift < 32; Shift += 8)
+            {
+                const Uint32 Sum = ((c0 >> Shift) & 0xFFu) + ((c1 >> Shift) & 0xFFu) + ((c2 >> Shift) & 0xFFu) + ((c3 >> Shift) & 0xFFu);
+                col |= (Sum >> 2) << Shift;
+            }
 
             // disable self-emission
-            Uint32 NumEmissionPix = (c0.a > 0.f) + (c1.a > 0.f) + (c2.a > 0.f) + (c3.a > 0.f);
+            Uint32 NumEmissionPix = ((c0 >> 24) != 0) + ((c1 >> 24) != 0) + ((c2 >> 24) != 0) + ((c3 >> 24) != 0);
             if (NumEmissionPix <= 2)
-                col.a = 0.f;
+                col &= 0x00FFFFFFu;
 
-            DstPixels[x + y * DstW] = F4Color_To_RGBA8Unorm(col);
+            Dst[x] = col;
         }
     }
 }
@@ -1019,6 +1119,27 @@ static void GenTexture(Uint32* Pixels, Uint32 Width, Uint32 Height, Uint32 Slice
     }
 }
 
+// Generates the top level of the slice followed by all mip levels
+static void GenTextureWithMips(Uint32* Pixels, const TextureDesc& TexDesc, Uint32 Slice, Uint32 CurrTime)
+{
+    Uint32 SrcOffset = 0;
+    GenTexture(&Pixels[SrcOffset], TexDesc.Width, TexDesc.Height, Slice, CurrTime);
+
+    for (Uint32 Mipmap = 1; Mipmap < TexDesc.MipLevels; ++Mipmap)
+    {
+        const Uint32* SrcPixels = &Pixels[SrcOffset];
+        const auto    SrcW      = std::max(1u, TexDesc.Width >> (Mipmap - 1));
+        const auto    SrcH      = std::max(1u, TexDesc.Height >> (Mipmap - 1));
+        const Uint32  DstOffset = SrcOffset + SrcW * SrcH;
+        Uint32*       DstPixels = &Pixels[DstOffset];
+        const auto    DstW      = std::max(1u, TexDesc.Width >> Mipmap);
+        const auto    DstH      = std::max(1u, TexDesc.Height >> Mipmap);
+
+        GenMipmap(SrcPixels, SrcW, SrcH, DstPixels, DstW, DstH);
+        SrcOffset = DstOffset;
+    }
+}
+
 
 void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRateMb, Uint32& ActualTransferRateMb)
 {
@@ -1027,24 +1148,26 @@ void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRat
 
     const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
 
-    // Try to read a new texture
-    for (Uint32 i = 0; i < 100; ++i)
+    // Swap all generated slices into the atlas and give the old slice buffers back to the workers.
+    // This never blocks on the workers: the mutex is only held to move job indices between the queues.
+    bool HasNewJobs = false;
     {
-        TaskStatus Expected = TaskStatus::TexReady;
-        if (m_GenTexTask.Status.compare_exchange_weak(Expected, TaskStatus::CopyTex, std::memory_order_acquire, std::memory_order_relaxed))
+        std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+        for (Uint32 JobIdx : m_ReadyGenTexJobs)
         {
-            Uint32 Offset = (m_OpaqueTexAtlasSliceSize / 4) * m_GenTexTask.ArraySlice;
-            memcpy(&m_OpaqueTexAtlasPixels[Offset], m_GenTexTask.Pixels.data(), m_OpaqueTexAtlasSliceSize);
+            auto& Job = m_GenTexJobs[JobIdx];
+            std::swap(Job.Pixels, m_OpaqueTexAtlasSlices[Job.ArraySlice]);
 
-            // Update task parameters
-            m_GenTexTask.ArraySlice = (m_GenTexTask.ArraySlice + 1) % TexDesc.ArraySize;
-            m_GenTexTask.Time       = CurrentTime;
-
-            const auto OldStatus = m_GenTexTask.Status.exchange(TaskStatus::NewTask, std::memory_order_release);
-            VERIFY_EXPR(OldStatus == TaskStatus::CopyTex);
-            break;
+            Job.ArraySlice    = m_NextGenTexSlice;
+            Job.Time          = CurrentTime;
+            m_NextGenTexSlice = (m_NextGenTexSlice + 1) % TexDesc.ArraySize;
+            m_PendingGenTexJobs.push_back(JobIdx);
         }
+        HasNewJobs = !m_ReadyGenTexJobs.empty();
+        m_ReadyGenTexJobs.clear();
     }
+    if (HasNewJobs)
+        m_GenTexCV.notify_all();
 
 #if USE_STAGING_TEXTURE
     m_UploadCompleteFence->Wait(m_UploadCompleteFenceValue);
@@ -1067,8 +1190,9 @@ void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRat
     // Each frame we copy pixels from CPU side to GPU side.
     for (Uint32 SliceInd = 0; SliceInd < TexDesc.ArraySize; ++SliceInd)
     {
-        Uint32 Slice  = (FirstSlice + SliceInd) % TexDesc.ArraySize;
-        Uint32 Offset = (m_OpaqueTexAtlasSliceSize / 4) * Slice;
+        Uint32        Slice       = (FirstSlice + SliceInd) % TexDesc.ArraySize;
+        const Uint32* SlicePixels = m_OpaqueTexAtlasSlices[Slice].data();
+        Uint32        Offset      = 0;
         for (Uint32 Mipmap = 0; Mipmap < TexDesc.MipLevels; ++Mipmap)
         {
             const auto W = std::max(1u, TexDesc.Width >> Mipmap);
@@ -1077,7 +1201,7 @@ void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRat
 #if USE_STAGING_TEXTURE
             MappedTextureSubresource SubRes;
             pContext->MapTextureSubresource(m_OpaqueTexAtlasStaging, Mipmap, Slice, MAP_WRITE, MAP_FLAG_DO_NOT_WAIT | MAP_FLAG_DISCARD | MAP_FLAG_NO_OVERWRITE, nullptr, SubRes);
-            memcpy(SubRes.pData, &m_OpaqueTexAtlasPixels[Offset], W * H * 4);
+            memcpy(SubRes.pData, &SlicePixels[Offset], W * H * 4);
             pContext->UnmapTextureSubresource(m_OpaqueTexAtlasStaging, Mipmap, Slice);
 
             CopyTextureAttribs Attribs;
@@ -1091,7 +1215,7 @@ void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRat
 #else
             TextureSubResData SubRes;
             SubRes.Stride = Uint64{W} * 4u;
-            SubRes.pData = &m_OpaqueTexAtlasPixels[Offset];
+            SubRes.pData = &SlicePixels[Offset];
             Box Region{0u, W, 0u, H};
             pContext->UpdateTexture(m_OpaqueTexAtlas, Mipmap, Slice, Region, SubRes, RESOURCE_STATE_TRANSITION_MODE_NONE, RESOURCE_STATE_TRANSITION_MODE_NONE);
 #endif
@@ -1124,55 +1248,47 @@ void Buildings::UpdateAtlas(IDeviceContext* pContext, Uint32 RequiredTransferRat
 
 Buildings::Buildings()
 {
-    m_GenTexThreadLooping.store(true);
-    m_GenTexThread = std::thread{&Buildings::ThreadProc, this};
+    // Leave the remaining cores to the render and transfer threads
+    const Uint32 NumThreads = std::min(std::max(std::thread::hardware_concurrency(), 2u) - 1u, 4u);
+    for (Uint32 i = 0; i < NumThreads; ++i)
+        m_GenTexThreads.emplace_back(&Buildings::ThreadProc, this);
 }
 
 Buildings::~Buildings()
 {
-    m_GenTexThreadLooping.store(false);
-    m_GenTexThread.join();
+    {
+        std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+        m_StopGenTexThreads = true;
+    }
+    m_GenTexCV.notify_all();
+
+    for (auto& Thread : m_GenTexThreads)
+        Thread.join();
 }
 
 void Buildings::ThreadProc()
 {
-    while (m_GenTexThreadLooping.load())
+    for (;;)
     {
-        for (Uint32 i = 0; i < 100; ++i)
+        Uint32 JobIdx = 0;
         {
-            // Check the task status.
-            // If task status is 'NewTask' then change status to GenTex,
-            // invalidate CPU cache to make changes from another thread visible to current thread.
-            TaskStatus Expected = TaskStatus::NewTask;
-            if (m_GenTexTask.Status.compare_exchange_weak(Expected, TaskStatus::GenTex, std::memory_order_acquire, std::memory_order_relaxed))
-            {
-                const auto& TexDesc   = m_OpaqueTexAtlas->GetDesc();
-                const auto  Slice     = m_GenTexTask.ArraySlice;
-                Uint32      SrcOffset = 0;
-                GenTexture(&m_GenTexTask.Pixels[SrcOffset], TexDesc.Width, TexDesc.Height, Slice, m_GenTexTask.Time);
+            std::unique_lock<std::mutex> Lock{m_GenTexMtx};
+            m_GenTexCV.wait(Lock, [this]() { return m_StopGenTexThreads || !m_PendingGenTexJobs.empty(); });
+            if (m_StopGenTexThreads)
+                return;
 
-                for (Uint32 Mipmap = 1; Mipmap < TexDesc.MipLevels; ++Mipmap)
-                {
-                    const Uint32* SrcPixels = &m_GenTexTask.Pixels[SrcOffset];
-                    const auto    SrcW      = std::max(1u, TexDesc.Width >> (Mipmap - 1));
-                    const auto    SrcH      = std::max(1u, TexDesc.Height >> (Mipmap - 1));
-                    const Uint32  DstOffset = SrcOffset + SrcW * SrcH;
-                    Uint32*       DstPixels = &m_GenTexTask.Pixels[DstOffset];
-                    const auto    DstW      = std::max(1u, TexDesc.Width >> Mipmap);
-                    const auto    DstH      = std::max(1u, TexDesc.Height >> Mipmap);
-
-                    GenMipmap(SrcPixels, SrcW, SrcH, DstPixels, DstW, DstH);
-                    SrcOffset = DstOffset;
-                }
+            JobIdx = m_PendingGenTexJobs.front();
+            m_PendingGenTexJobs.pop_front();
+        }
 
-                // Change status to 'TexReady' and flush CPU cache to make local changes visible for other threads.
-                const auto OldStatus = m_GenTexTask.Status.exchange(TaskStatus::TexReady, std::memory_order_release);
-                VERIFY_EXPR(OldStatus == TaskStatus::GenTex);
+        // The job belongs to this thread until it is put into the ready list
+        auto& Job = m_GenTexJobs[JobIdx];
+        GenTextureWithMips(Job.Pixels.data(), m_OpaqueTexAtlas->GetDesc(), Job.ArraySlice, Job.Time);
 
-                break;
-            }
+        {
+            std::lock_guard<std::mutex> Lock{m_GenTexMtx};
+            m_ReadyGenTexJobs.push_back(JobIdx);
         }
-        std::this_thread::sleep_for(std::chrono::microseconds{1});
     }
 }
 
@@ -1181,24 +1297,7 @@ void Buildings::GenerateOpaqueTexture()
     const auto& TexDesc = m_OpaqueTexAtlas->GetDesc();
 
     for (Uint32 Slice = 0; Slice < TexDesc.ArraySize; ++Slice)
-    {
-        Uint32 SrcOffset = (m_OpaqueTexAtlasSliceSize / 4) * Slice;
-        GenTexture(&m_OpaqueTexAtlasPixels[SrcOffset], TexDesc.Width, TexDesc.Height, Slice, 0u);
-
-        for (Uint32 Mipmap = 1; Mipmap < TexDesc.MipLevels; ++Mipmap)
-        {
-            const Uint32* SrcPixels = &m_OpaqueTexAtlasPixels[SrcOffset];
-            const auto    SrcW      = std::max(1u, TexDesc.Width >> (Mipmap - 1));
-            const auto    SrcH      = std::max(1u, TexDesc.Height >> (Mipmap - 1));
-            const Uint32  DstOffset = SrcOffset + SrcW * SrcH;
-            Uint32*       DstPixels = &m_OpaqueTexAtlasPixels[DstOffset];
-            const auto    DstW      = std::max(1u, TexDesc.Width >> Mipmap);
-            const auto    DstH      = std::max(1u, TexDesc.Height >> Mipmap);
-
-            GenMipmap(SrcPixels, SrcW, SrcH, DstPixels, DstW, DstH);
-            SrcOffset = DstOffset;
-        }
-    }
+        GenTextureWithMips(m_OpaqueTexAtlasSlices[Slice].data(), TexDesc, Slice, 0u);
 }
 
 } // namespace Diligent
@@ -26,8 +26,11 @@
 
 #pragma once
 
+#include <vector>
+#include <deque>
 #include <thread>
-#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 #include "Terrain.hpp"
 
@@ -82,27 +85,29 @@ private:
     Uint32      m_m_OpaqueTexAtlasOffset = 0;
 
 
-    std::vector<Uint32> m_OpaqueTexAtlasPixels;
-    Uint32              m_OpaqueTexAtlasSliceSize = 0; // in bytes
+    // Pixels of every atlas slice including all mip levels. UpdateAtlas() swaps generated
+    // slices in, so pixels are never copied between the generator and the atlas.
+    std::vector<std::vector<Uint32>> m_OpaqueTexAtlasSlices;
+    Uint32                           m_OpaqueTexAtlasSliceSize = 0; // in bytes
 
-    enum class TaskStatus : Uint32
+    // Every job owns a slice buffer that is filled by a worker thread while the atlas
+    // uses its own buffer of the same slice. There are two jobs per worker, so a worker
+    // does not wait for the main thread to pick up the previous slice.
+    struct GenTexJob
     {
-        NewTask  = 0,
-        GenTex   = 1,
-        TexReady = 2,
-        CopyTex  = 3,
-        Initial  = ~0u,
+        std::vector<Uint32> Pixels;
+        Uint32              ArraySlice = 0;
+        Uint32              Time       = 0;
     };
-    struct GenTexTask
-    {
-        std::atomic<TaskStatus> Status{TaskStatus::Initial}; // protects access to other fields
-        std::vector<Uint32>     Pixels;
-        Uint32                  ArraySlice = 0;
-        Uint32                  Time       = 0;
-    };
-    GenTexTask        m_GenTexTask;
-    std::thread       m_GenTexThread;
-    std::atomic<bool> m_GenTexThreadLooping{false};
+    std::vector<GenTexJob> m_GenTexJobs;
+    Uint32                 m_NextGenTexSlice = 0;
+
+    std::mutex               m_GenTexMtx; // protects the job queues and the stop flag
+    std::condition_variable  m_GenTexCV;
+    std::deque<Uint32>       m_PendingGenTexJobs;
+    std::vector<Uint32>      m_ReadyGenTexJobs;
+    bool                     m_StopGenTexThreads = false;
+    std::vector<std::thread> m_GenTexThreads;
 
 #if USE_STAGING_TEXTURE
     RefCntAutoPtr<ITexture> m_OpaqueTexAtlasStaging;
@@ -26,6 +26,7 @@
 
 #include "Profiler.hpp"
 #include "imgui.h"
+#include "ImGuiUtils.hpp"
 
 namespace Diligent
 {
@@ -58,6 +59,34 @@ void Profiler::Initialize(IRenderDevice* pDevice)
         m_Device->CreateQuery(queryDesc, &Frame.Transfer.GpuTimeQueryBegin);
         m_Device->CreateQuery(queryDesc, &Frame.Transfer.GpuTimeQueryEnd);
     }
+
+    TraceRecorder::CreateInfo TraceCI;
+    TraceCI.NumFramesInFlight = static_cast<Uint32>(m_FrameHistory.size());
+    m_Trace.Initialize(pDevice, TraceCI);
+
+    // Both graphics passes run on the same queue and share the track
+    m_Tracks[FRAME]      = m_Trace.AddTrack("Frame");
+    m_Tracks[GRAPHICS_1] = m_Trace.AddTrack("Graphics");
+    m_Tracks[GRAPHICS_2] = m_Tracks[GRAPHICS_1];
+    m_Tracks[COMPUTE]    = m_Trace.AddTrack("Compute");
+    m_Tracks[TRANSFER]   = m_Trace.AddTrack("Transfer");
+}
+
+static const char* GetPassName(Profiler::PASS_TYPE PassType)
+{
+    switch (PassType)
+    {
+        // clang-format off
+        case Profiler::FRAME:      return "Frame";
+        case Profiler::GRAPHICS_1: return "Graphics pass 1";
+        case Profiler::GRAPHICS_2: return "Graphics pass 2";
+        case Profiler::COMPUTE:    return "Compute pass";
+        case Profiler::TRANSFER:   return "Transfer pass";
+        // clang-format on
+        default:
+            UNEXPECTED("Unknown pass type");
+            return "";
+    }
 }
 
 void Profiler::Begin(IDeviceContext* pContext, PASS_TYPE PassType)
@@ -96,6 +125,8 @@ void Profiler::Begin(IDeviceContext* pContext, PASS_TYPE PassType)
         default:
             UNEXPECTED("Unknown pass type");
     }
+
+    m_Trace.BeginScope(m_Tracks[PassType], GetPassName(PassType), pContext);
 }
 
 void Profiler::End(IDeviceContext* pContext, PASS_TYPE PassType)
@@ -103,6 +134,8 @@ void Profiler::End(IDeviceContext* pContext, PASS_TYPE PassType)
     if (m_Device == nullptr)
         return;
 
+    m_Trace.EndScope(m_Tracks[PassType], pContext);
+
     const auto EndCounters = [pContext](auto& Pass) //
     {
         if (Pass.QuerySupported)
@@ -147,6 +180,7 @@ void Profiler::Update(double ElapsedTime)
         return;
 
     ++m_FrameId;
+    m_Trace.NextFrame();
 
     // Read query data
     {
@@ -401,6 +435,15 @@ void Profiler::UpdateUI()
             ImGui::SameLine(0.f, 20.f);
             ImGui::TextDisabled("%s", m_CpuCountersStr.c_str());
         }
+
+        if (ImGui::Button("Export trace"))
+        {
+            static constexpr char TraceFileName[] = "Tutorial23_trace.json";
+            if (m_Trace.ExportChromeTrace(TraceFileName))
+                LOG_INFO_MESSAGE("Trace has been written to ", TraceFileName);
+        }
+        ImGui::SameLine();
+        ImGui::HelpMarker("Writes the recent CPU and GPU timeline of all queues to a file\nthat can be opened in chrome://tracing or ui.perfetto.dev");
     }
     ImGui::End();
 }
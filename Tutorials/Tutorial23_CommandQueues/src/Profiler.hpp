@@ -29,6 +29,7 @@
 #include <array>
 #include <chrono>
 #include "SampleBase.hpp"
+#include "TraceRecorder.hpp"
 
 namespace Diligent
 {
@@ -58,6 +59,10 @@ public:
     void UpdateUI();
     void Update(double ElapsedTime);
 
+    // Nested scopes of a pass are recorded to the pass track with TraceRecorder::Scope.
+    TraceRecorder& GetTraceRecorder() { return m_Trace; }
+    Uint32         GetTrack(PASS_TYPE Pass) const { return m_Tracks[Pass]; }
+
 private:
     using TimePoint = std::chrono::high_resolution_clock::time_point;
     using SecondsD  = std::chrono::duration<double>;
@@ -113,6 +118,10 @@ private:
     String m_GpuCountersStr;
     String m_CpuCountersStr;
     double m_AccumTime = 0.0;
+
+    // Timeline of all passes that can be exported as a Chrome trace
+    TraceRecorder                    m_Trace;
+    std::array<Uint32, TRANSFER + 1> m_Tracks = {};
 };
 
 } // namespace Diligent
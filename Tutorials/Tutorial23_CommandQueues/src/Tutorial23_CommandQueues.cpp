@@ -550,8 +550,16 @@ void Tutorial23_CommandQueues::GraphicsPass1()
         m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
 
-        m_Terrain.Draw(m_pImmediateContext);
-        m_Buildings.Draw(m_pImmediateContext);
+        auto&      Trace = m_Profiler.GetTraceRecorder();
+        const auto Track = m_Profiler.GetTrack(Profiler::GRAPHICS_1);
+        {
+            TraceRecorder::Scope Scope{Trace, Track, "Terrain", m_pImmediateContext};
+            m_Terrain.Draw(m_pImmediateContext);
+        }
+        {
+            TraceRecorder::Scope Scope{Trace, Track, "Buildings", m_pImmediateContext};
+            m_Buildings.Draw(m_pImmediateContext);
+        }
 
         m_pImmediateContext->SetRenderTargets(0, nullptr, nullptr, RESOURCE_STATE_TRANSITION_MODE_NONE);
 
@@ -582,11 +590,19 @@ void Tutorial23_CommandQueues::GraphicsPass2()
 
     m_Profiler.Begin(m_pImmediateContext, Profiler::GRAPHICS_2);
 
+    auto&      Trace = m_Profiler.GetTraceRecorder();
+    const auto Track = m_Profiler.GetTrack(Profiler::GRAPHICS_2);
+
     if (m_Glow)
+    {
+        TraceRecorder::Scope Scope{Trace, Track, "Down sample", m_pImmediateContext};
         DownSample();
+    }
 
     // Final pass
     {
+        TraceRecorder::Scope Scope{Trace, Track, "Post process", m_pImmediateContext};
+
         ITextureView* pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
         m_pImmediateContext->SetRenderTargets(1, &pRTV, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
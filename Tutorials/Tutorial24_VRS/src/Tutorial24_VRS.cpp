@@ -27,6 +27,7 @@
 #include "Tutorial24_VRS.hpp"
 
 #include <utility>
+#include <cstring>
 
 #include "Align.hpp"
 #include "MapHelper.hpp"
@@ -34,6 +35,7 @@
 #include "../../Common/src/TexturedCube.hpp"
 #include "imgui.h"
 #include "ImGuiUtils.hpp"
+#include "ShaderMacroHelper.hpp"
 
 namespace Diligent
 {
@@ -41,6 +43,7 @@ namespace HLSL
 {
 #include "../assets/Structures.fxh"
 static_assert(sizeof(Constants) % 16 == 0, "must be aligned to 16 bytes");
+static_assert(sizeof(ShadingRateConstants) % 16 == 0, "must be aligned to 16 bytes");
 } // namespace HLSL
 
 SampleBase* CreateSample()
@@ -264,6 +267,74 @@ void Tutorial24_VRS::CreateBlitPipelineState(IShaderSourceInputStreamFactory* pS
     m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_BlitPSO);
 }
 
+void Tutorial24_VRS::CreateShadingRatePipelineState(IShaderSourceInputStreamFactory* pShaderSourceFactory)
+{
+    // The pattern can only be generated in a compute shader when the shading rate texture
+    // is read on the GPU and may be bound as a UAV.
+    const auto& DeviceInfo = m_pDevice->GetDeviceInfo();
+    const auto& SRProps    = m_pDevice->GetAdapterInfo().ShadingRate;
+    if (DeviceInfo.Type == RENDER_DEVICE_TYPE_METAL ||
+        !DeviceInfo.Features.ComputeShaders ||
+        SRProps.Format != SHADING_RATE_FORMAT_PALETTE ||
+        SRProps.ShadingRateTextureAccess != SHADING_RATE_TEXTURE_ACCESS_ON_GPU ||
+        (SRProps.BindFlags & BIND_UNORDERED_ACCESS) == 0)
+        return;
+
+    ShaderMacroHelper Macros;
+    Macros.AddShaderMacro("THREAD_GROUP_SIZE", static_cast<int>(ShadingRateThreadGroupSize));
+    Macros.AddShaderMacro("AXIS_SHADING_RATE_MAX", static_cast<int>(AXIS_SHADING_RATE_MAX));
+    Macros.AddShaderMacro("SHADING_RATE_X_SHIFT", static_cast<int>(SHADING_RATE_X_SHIFT));
+    Macros.Finalize();
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.ShaderCompiler             = SHADER_COMPILER_DXC;
+    ShaderCI.UseCombinedTextureSamplers = true;
+    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+    ShaderCI.Macros                     = Macros;
+
+    RefCntAutoPtr<IShader> pCS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+        ShaderCI.EntryPoint      = "main";
+        ShaderCI.Desc.Name       = "Shading rate - CS";
+        ShaderCI.FilePath        = "ShadingRate.csh";
+
+        m_pDevice->CreateShader(ShaderCI, &pCS);
+    }
+
+    ComputePipelineStateCreateInfo PSOCreateInfo;
+
+    auto& PSODesc = PSOCreateInfo.PSODesc;
+
+    PSODesc.Name         = "Generate shading rate";
+    PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+
+    PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
+
+    // A different texture of the ring is written every time
+    const ShaderResourceVariableDesc Vars[] = {{SHADER_TYPE_COMPUTE, "g_ShadingRateMap", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC}};
+
+    PSODesc.ResourceLayout.Variables    = Vars;
+    PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+    PSOCreateInfo.pCS = pCS;
+    m_pDevice->CreateComputePipelineState(PSOCreateInfo, &m_ShadingRatePSO);
+    if (!m_ShadingRatePSO)
+        return;
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name           = "Shading rate constants";
+    BuffDesc.Size           = sizeof(HLSL::ShadingRateConstants);
+    BuffDesc.BindFlags      = BIND_UNIFORM_BUFFER;
+    BuffDesc.Usage          = USAGE_DYNAMIC;
+    BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_ShadingRateConstants);
+
+    m_ShadingRatePSO->CreateShaderResourceBinding(&m_ShadingRateSRB, true);
+    m_ShadingRateSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "cbShadingRateConstants")->Set(m_ShadingRateConstants);
+}
+
 void Tutorial24_VRS::LoadTexture()
 {
     TextureLoadInfo loadInfo;
@@ -291,6 +362,13 @@ void Tutorial24_VRS::Initialize(const SampleInitInfo& InitInfo)
         CreateVRSPipelineState(pShaderSourceFactory);
 
     CreateBlitPipelineState(pShaderSourceFactory);
+    CreateShadingRatePipelineState(pShaderSourceFactory);
+
+    {
+        FenceDesc Desc;
+        Desc.Name = "Shading rate fence";
+        m_pDevice->CreateFence(Desc, &m_pShadingRateFence);
+    }
 
     {
         BufferDesc BuffDesc;
@@ -358,6 +436,8 @@ void Tutorial24_VRS::ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Att
 
 void Tutorial24_VRS::Render()
 {
+    SwitchToUpdatedShadingRateMap();
+
     {
         // Map the buffer and write current world-view-projection matrix
         MapHelper<HLSL::Constants> CBConstants{m_pImmediateContext, m_Constants, MAP_WRITE, MAP_FLAG_DISCARD};
@@ -410,6 +490,14 @@ void Tutorial24_VRS::Render()
         DrawAttrs.NumIndices = 36;
         DrawAttrs.Flags      = DRAW_FLAG_VERIFY_ALL;
         m_pImmediateContext->DrawIndexed(DrawAttrs);
+
+        // Lets UpdateVRSPattern() know when the GPU is done with the shading rate texture
+        auto& SRMap = m_ShadingRateMaps[m_CurrShadingRateMap];
+        if (m_VRSMode == VRS_MODE_TEXTURE_BASED && SRMap.pView != nullptr)
+        {
+            m_pImmediateContext->EnqueueSignal(m_pShadingRateFence, ++m_ShadingRateFenceValue);
+            SRMap.LastUseFenceValue = m_ShadingRateFenceValue;
+        }
     }
 
     // Blit or resolve to swapchain
@@ -518,6 +606,19 @@ void Tutorial24_VRS::UpdateUI()
     ImGui::End();
 }
 
+void Tutorial24_VRS::SwitchToUpdatedShadingRateMap()
+{
+    if (m_PendingShadingRateMap == InvalidMapIndex)
+        return;
+
+    if (m_pShadingRateFence->GetCompletedValue() < m_ShadingRateMaps[m_PendingShadingRateMap].ReadyFenceValue)
+        return;
+
+    m_CurrShadingRateMap    = m_PendingShadingRateMap;
+    m_PendingShadingRateMap = InvalidMapIndex;
+    m_pShadingRateMap       = m_ShadingRateMaps[m_CurrShadingRateMap].pView;
+}
+
 #if !(PLATFORM_MACOS || PLATFORM_IOS)
 void Tutorial24_VRS::WindowResize(Uint32 Width, Uint32 Height)
 {
@@ -570,7 +671,7 @@ void Tutorial24_VRS::WindowResize(Uint32 Width, Uint32 Height)
     TexDesc.Type      = RESOURCE_DIM_TEX_2D;
     TexDesc.Width     = (Width + SRProps.MinTileSize[0] - 1) / SRProps.MinTileSize[0];
     TexDesc.Height    = (Height + SRProps.MinTileSize[1] - 1) / SRProps.MinTileSize[1];
-    TexDesc.BindFlags = BIND_SHADING_RATE;
+    TexDesc.BindFlags = BIND_SHADING_RATE | (m_ShadingRatePSO ? BIND_UNORDERED_ACCESS : BIND_NONE);
     TexDesc.MiscFlags = MISC_TEXTURE_FLAG_NONE;
 
     switch (SRProps.Format)
@@ -580,12 +681,23 @@ void Tutorial24_VRS::WindowResize(Uint32 Width, Uint32 Height)
         default: UNEXPECTED("Unexpected shading rate texture format");
     }
 
-    RefCntAutoPtr<ITexture> pSRTex;
-    m_pDevice->CreateTexture(TexDesc, nullptr, &pSRTex);
-    m_pShadingRateMap = pSRTex->GetDefaultView(TEXTURE_VIEW_SHADING_RATE);
+    for (auto& SRMap : m_ShadingRateMaps)
+    {
+        RefCntAutoPtr<ITexture> pSRTex;
+        m_pDevice->CreateTexture(TexDesc, nullptr, &pSRTex);
+        SRMap       = {};
+        SRMap.pView = pSRTex->GetDefaultView(TEXTURE_VIEW_SHADING_RATE);
+    }
+    m_CurrShadingRateMap    = 0;
+    m_PendingShadingRateMap = InvalidMapIndex;
 
     UpdateVRSPattern(m_PrevNormMPos);
 
+    // There is no previous pattern to render with, so wait for the first one
+    if (m_PendingShadingRateMap != InvalidMapIndex)
+        m_pShadingRateFence->Wait(m_ShadingRateMaps[m_PendingShadingRateMap].ReadyFenceValue);
+    SwitchToUpdatedShadingRateMap();
+
     m_BlitSRB = nullptr;
     m_BlitPSO->CreateShaderResourceBinding(&m_BlitSRB);
     m_BlitSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(pRT->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
@@ -593,15 +705,91 @@ void Tutorial24_VRS::WindowResize(Uint32 Width, Uint32 Height)
 
 void Tutorial24_VRS::UpdateVRSPattern(const float2 MPos)
 {
-    if (m_pShadingRateMap == nullptr)
+    if (m_ShadingRateMaps[0].pView == nullptr)
         return;
 
     m_PrevNormMPos = MPos;
 
-    auto*              pVRSTex = m_pShadingRateMap->GetTexture();
-    const auto&        Desc    = pVRSTex->GetDesc();
-    const auto&        SRProps = m_pDevice->GetAdapterInfo().ShadingRate;
-    std::vector<Uint8> SRData;
+    // If shading rate access type is not ON_GPU, access to the texture happens on the CPU
+    // side during SetRenderTargetsExt() or Flush() call, so the texture may only be used
+    // for rendering after the GPU has finished updating it.
+    const auto& SRProps              = m_pDevice->GetAdapterInfo().ShadingRate;
+    const bool  GPUtoCPUSyncRequired = (SRProps.ShadingRateTextureAccess != SHADING_RATE_TEXTURE_ACCESS_ON_GPU);
+
+    // Overwrite the texture that is still waiting for the previous update, or take the next one in the ring.
+    const Uint32 MapIdx = m_PendingShadingRateMap != InvalidMapIndex ?
+        m_PendingShadingRateMap :
+        (m_CurrShadingRateMap + 1) % NumShadingRateMaps;
+
+    auto& Map = m_ShadingRateMaps[MapIdx];
+
+    // The ring is long enough for the frames that used the texture to be normally finished,
+    // so this only waits when the pattern changes faster than the GPU renders frames.
+    if (GPUtoCPUSyncRequired && m_pShadingRateFence->GetCompletedValue() < Map.LastUseFenceValue)
+        m_pShadingRateFence->Wait(Map.LastUseFenceValue);
+
+    GenerateVRSPattern(MPos, Map.pView->GetTexture());
+
+    if (GPUtoCPUSyncRequired)
+    {
+        // Render() switches to the texture when the fence is signaled
+        m_pImmediateContext->EnqueueSignal(m_pShadingRateFence, ++m_ShadingRateFenceValue);
+        m_pImmediateContext->Flush();
+        Map.ReadyFenceValue     = m_ShadingRateFenceValue;
+        m_PendingShadingRateMap = MapIdx;
+    }
+    else
+    {
+        // Accesses on the GPU are ordered after the update
+        m_CurrShadingRateMap = MapIdx;
+        m_pShadingRateMap    = Map.pView;
+    }
+}
+
+void Tutorial24_VRS::GenerateVRSPattern(const float2 MPos, ITexture* pVRSTex)
+{
+    const auto& Desc    = pVRSTex->GetDesc();
+    const auto& SRProps = m_pDevice->GetAdapterInfo().ShadingRate;
+
+    // Maps every combination of axis rates to the nearest rate supported by the device.
+    SHADING_RATE RemapShadingRate[SHADING_RATE_MAX + 1] = {};
+    if (SRProps.Format == SHADING_RATE_FORMAT_PALETTE)
+    {
+        for (Uint32 i = 0; i < _countof(RemapShadingRate); ++i)
+        {
+            // ShadingRates is sorted from higher to lower rate.
+            for (Uint32 j = 0; j < SRProps.NumShadingRates; ++j)
+            {
+                if (static_cast<SHADING_RATE>(i) >= SRProps.ShadingRates[j].Rate)
+                {
+                    RemapShadingRate[i] = SRProps.ShadingRates[j].Rate;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (m_ShadingRatePSO)
+    {
+        {
+            MapHelper<HLSL::ShadingRateConstants> Constants{m_pImmediateContext, m_ShadingRateConstants, MAP_WRITE, MAP_FLAG_DISCARD};
+            Constants->MousePos    = MPos;
+            Constants->TextureSize = uint2{Desc.Width, Desc.Height};
+            for (Uint32 i = 0; i < _countof(RemapShadingRate); ++i)
+                Constants->RemapShadingRate[i / 4][i % 4] = RemapShadingRate[i];
+        }
+
+        m_ShadingRateSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ShadingRateMap")->Set(pVRSTex->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+
+        m_pImmediateContext->SetPipelineState(m_ShadingRatePSO);
+        m_pImmediateContext->CommitShaderResources(m_ShadingRateSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        DispatchComputeAttribs DispatAttribs;
+        DispatAttribs.ThreadGroupCountX = (Desc.Width + ShadingRateThreadGroupSize - 1) / ShadingRateThreadGroupSize;
+        DispatAttribs.ThreadGroupCountY = (Desc.Height + ShadingRateThreadGroupSize - 1) / ShadingRateThreadGroupSize;
+        m_pImmediateContext->DispatchCompute(DispatAttribs);
+        return;
+    }
 
     auto GetAxisShadingRate = [&](Uint32 TileIdx, Uint32 NumTiles, float Origin) {
         float TilePos = (static_cast<float>(TileIdx) + 0.5f) / static_cast<float>(NumTiles);
@@ -610,85 +798,58 @@ void Tutorial24_VRS::UpdateVRSPattern(const float2 MPos)
         return static_cast<AXIS_SHADING_RATE>(Rate);
     };
 
-    switch (SRProps.Format)
+    const Uint32 TexelSize = SRProps.Format == SHADING_RATE_FORMAT_UNORM8 ? 2 : 1;
+    const size_t RowSize   = size_t{Desc.Width} * TexelSize;
+    const size_t RowStride = AlignUp(RowSize, size_t{32});
+    m_ShadingRateData.resize(RowStride * size_t{Desc.Height});
+
+    // The rate of a tile only depends on its X and Y axis rates, so all rows with the same
+    // Y rate are identical. Every run of such rows is generated once and then copied.
+    const Uint8* pPrevRow  = nullptr;
+    Uint32       PrevYRate = ~0u;
+    for (Uint32 y = 0; y < Desc.Height; ++y)
     {
-        case SHADING_RATE_FORMAT_PALETTE:
+        auto* const pRow  = &m_ShadingRateData[size_t{y} * RowStride];
+        const auto  YRate = GetAxisShadingRate(y, Desc.Height, MPos.y);
+        if (YRate == PrevYRate)
         {
-            SHADING_RATE RemapShadingRate[SHADING_RATE_MAX + 1] = {};
-            for (Uint32 i = 0; i < _countof(RemapShadingRate); ++i)
-            {
-                // ShadingRates is sorted from higher to lower rate.
-                for (Uint32 j = 0; j < SRProps.NumShadingRates; ++j)
-                {
-                    if (static_cast<SHADING_RATE>(i) >= SRProps.ShadingRates[j].Rate)
-                    {
-                        RemapShadingRate[i] = SRProps.ShadingRates[j].Rate;
-                        break;
-                    }
-                }
-            }
-
-            const size_t RowStride = AlignUp(Desc.Width, 32u);
-            SRData.resize(RowStride * size_t{Desc.Height});
+            memcpy(pRow, pPrevRow, RowSize);
+            continue;
+        }
 
-            for (Uint32 y = 0; y < Desc.Height; ++y)
-            {
+        switch (SRProps.Format)
+        {
+            case SHADING_RATE_FORMAT_PALETTE:
                 for (Uint32 x = 0; x < Desc.Width; ++x)
                 {
                     auto XRate = GetAxisShadingRate(x, Desc.Width, MPos.x);
-                    auto YRate = GetAxisShadingRate(y, Desc.Height, MPos.y);
-
-                    SRData[size_t{x} + size_t{y} * RowStride] = RemapShadingRate[(XRate << SHADING_RATE_X_SHIFT) | YRate];
+                    pRow[x]    = RemapShadingRate[(XRate << SHADING_RATE_X_SHIFT) | YRate];
                 }
-            }
-            break;
-        }
-        case SHADING_RATE_FORMAT_UNORM8:
-        {
-            const size_t RowStride = AlignUp(Desc.Width * 2, 32u);
-            SRData.resize(RowStride * size_t{Desc.Height});
+                break;
 
-            for (Uint32 y = 0; y < Desc.Height; ++y)
-            {
+            case SHADING_RATE_FORMAT_UNORM8:
                 for (Uint32 x = 0; x < Desc.Width; ++x)
                 {
-                    auto XRate = GetAxisShadingRate(x, Desc.Width, MPos.x);
-                    auto YRate = GetAxisShadingRate(y, Desc.Height, MPos.y);
-
-                    SRData[size_t{x} * 2u + size_t{y} * RowStride + 0u] = 255 >> XRate;
-                    SRData[size_t{x} * 2u + size_t{y} * RowStride + 1u] = 255 >> YRate;
+                    auto XRate        = GetAxisShadingRate(x, Desc.Width, MPos.x);
+                    pRow[x * 2u + 0u] = static_cast<Uint8>(255 >> XRate);
+                    pRow[x * 2u + 1u] = static_cast<Uint8>(255 >> YRate);
                 }
-            }
-            break;
+                break;
+
+            default:
+                UNEXPECTED("Unexpected shading rate texture format");
         }
-        default:
-            UNEXPECTED("Unexpected shading rate texture format");
-    }
 
+        pPrevRow  = pRow;
+        PrevYRate = YRate;
+    }
 
     const Box         TexBox{0, Desc.Width, 0, Desc.Height};
     TextureSubResData SubResData;
-    SubResData.pData  = SRData.data();
-    SubResData.Stride = static_cast<Uint32>(SRData.size() / Desc.Height);
-
-    // If shading rate access type is not ON_GPU, access to the texture happens on the CPU
-    // side during SetRenderTargetsExt() or Flush() call, so we have to wait until the texture
-    // is updated.
-    const bool GPUtoCPUSyncRequired = (SRProps.ShadingRateTextureAccess != SHADING_RATE_TEXTURE_ACCESS_ON_GPU);
-
-    if (GPUtoCPUSyncRequired)
-    {
-        m_pImmediateContext->Flush();
-        m_pImmediateContext->WaitForIdle();
-    }
+    SubResData.pData  = m_ShadingRateData.data();
+    SubResData.Stride = static_cast<Uint32>(RowStride);
 
     m_pImmediateContext->UpdateTexture(pVRSTex, 0, 0, TexBox, SubResData, RESOURCE_STATE_TRANSITION_MODE_NONE, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-
-    if (GPUtoCPUSyncRequired)
-    {
-        m_pImmediateContext->Flush();
-        m_pImmediateContext->WaitForIdle();
-    }
 }
 #endif
 
@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <array>
 #include <utility>
 #include <vector>
 
@@ -55,7 +56,10 @@ private:
     void CreateVRSPipelineState(IShaderSourceInputStreamFactory* pShaderSourceFactory);        // For desktop D3D12 and Vulkan and Metal
     void CreateDensityMapPipelineState(IShaderSourceInputStreamFactory* pShaderSourceFactory); // For mobile Vulkan only
     void CreateBlitPipelineState(IShaderSourceInputStreamFactory* pShaderSourceFactory);
+    void CreateShadingRatePipelineState(IShaderSourceInputStreamFactory* pShaderSourceFactory); // For GPU access to the shading rate texture
     void UpdateVRSPattern(float2 MPos);
+    void GenerateVRSPattern(float2 MPos, ITexture* pVRSTex);
+    void SwitchToUpdatedShadingRateMap();
 
     float GetSurfaceScale() const
     {
@@ -93,6 +97,7 @@ private:
 #if PLATFORM_MACOS || PLATFORM_IOS
     RefCntAutoPtr<IBuffer> m_pShadingRateParamBuffer;
 #endif
+    // Shading rate texture that is used for rendering
     RefCntAutoPtr<ITextureView>           m_pShadingRateMap;
     RefCntAutoPtr<ITextureView>           m_pRTV;
     RefCntAutoPtr<ITextureView>           m_pDSV;
@@ -115,6 +120,34 @@ private:
 
     float    m_fCurrentTime = 0.f;
     float4x4 m_WorldViewProjMatrix;
+
+    // A new shading rate pattern is written to the next texture in the ring, so that
+    // updates never wait for the frames that use the current texture.
+    struct ShadingRateMap
+    {
+        RefCntAutoPtr<ITextureView> pView;
+        Uint64                      LastUseFenceValue = 0; // Signaled when the GPU is done with the last frame that used the texture
+        Uint64                      ReadyFenceValue   = 0; // Signaled when the GPU has finished writing the texture
+    };
+    static constexpr Uint32 NumShadingRateMaps = 3;
+    static constexpr Uint32 InvalidMapIndex    = ~0u;
+
+    std::array<ShadingRateMap, NumShadingRateMaps> m_ShadingRateMaps;
+
+    Uint32                m_CurrShadingRateMap    = 0;
+    Uint32                m_PendingShadingRateMap = InvalidMapIndex; // Written texture that may not be used yet
+    RefCntAutoPtr<IFence> m_pShadingRateFence;
+    Uint64                m_ShadingRateFenceValue = 0;
+
+    // CPU shading rate data, reused between updates
+    std::vector<Uint8> m_ShadingRateData;
+
+    // Shading rate texture is generated by this compute pipeline when it is accessed on the GPU
+    static constexpr Uint32 ShadingRateThreadGroupSize = 8;
+
+    RefCntAutoPtr<IPipelineState>         m_ShadingRatePSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_ShadingRateSRB;
+    RefCntAutoPtr<IBuffer>                m_ShadingRateConstants;
 };
 
 } // namespace Diligent
@@ -9,6 +9,7 @@ void RenderAPI::CreateTextureViews(Diligent::ITexture *pRenderTarget, Diligent::
 {
     m_RTV.Release();
     m_DSV.Release();
+    m_RenderTargetsTransitioned = false;
     {
         const auto &RTDesc = pRenderTarget->GetDesc();
         TextureViewDesc RTVDesc;
@@ -39,6 +39,15 @@ public:
 
     void CreateTextureViews(Diligent::ITexture *pRenderTarget, Diligent::ITexture *pDepthBuffer);
 
+    // Render target states survive InvalidateState(), so they only need to be
+    // transitioned the first time the views are bound after they have been created
+    Diligent::RESOURCE_STATE_TRANSITION_MODE GetRenderTargetTransitionMode()
+    {
+        auto Mode = m_RenderTargetsTransitioned ? Diligent::RESOURCE_STATE_TRANSITION_MODE_VERIFY : Diligent::RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        m_RenderTargetsTransitioned = true;
+        return Mode;
+    }
+
 protected:
     Diligent::RefCntAutoPtr<Diligent::IRenderDevice> m_Device;
     Diligent::RefCntAutoPtr<Diligent::IDeviceContext> m_Context;
@@ -48,4 +57,6 @@ protected:
 
     Diligent::TEXTURE_FORMAT m_RenderTargetFormat = Diligent::TEX_FORMAT_UNKNOWN;
     Diligent::TEXTURE_FORMAT m_DepthBufferFormat = Diligent::TEX_FORMAT_UNKNOWN;
+
+    bool m_RenderTargetsTransitioned = false;
 };
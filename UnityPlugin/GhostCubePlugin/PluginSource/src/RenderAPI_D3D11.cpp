@@ -68,7 +68,7 @@ void RenderAPI_D3D11::ProcessDeviceEvent(UnityGfxDeviceEventType type, IUnityInt
 void RenderAPI_D3D11::BeginRendering()
 {
     ITextureView *RTVs[] = { m_RTV };
-    m_Context->SetRenderTargets(1, RTVs, m_DSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_Context->SetRenderTargets(1, RTVs, m_DSV, GetRenderTargetTransitionMode());
 }
 
 void RenderAPI_D3D11::AttachToNativeRenderTexture(void *nativeRenderTargetHandle, void *nativeDepthTextureHandle)
@@ -119,7 +119,7 @@ void RenderAPI_OpenGLCoreES::BeginRendering()
     }
 
     ITextureView *RTVs[] = { m_RTV };
-    m_Context->SetRenderTargets(1, RTVs, m_DSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_Context->SetRenderTargets(1, RTVs, m_DSV, GetRenderTargetTransitionMode());
 }
 
 void RenderAPI_OpenGLCoreES::AttachToNativeRenderTexture(void *nativeRenderTargetHandle, void *nativeDepthTextureHandle)
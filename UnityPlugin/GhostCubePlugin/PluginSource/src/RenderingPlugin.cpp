@@ -10,6 +10,8 @@
 #endif
 
 #include <vector>
+#include <mutex>
+#include <atomic>
 
 using namespace Diligent;
 
@@ -35,6 +37,23 @@ extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetMatrixFromUnity
         m30, m31, m32, m33); 
 }
 
+// Instance transforms are set from the script thread, but consumed by the render thread
+static std::mutex g_InstanceTransformsMtx;
+static std::vector<float4x4> g_InstanceTransforms;
+static std::atomic<bool> g_InstanceTransformsDirty{false};
+// pMatrices contains numInstances row-major world matrices (16 floats each).
+// Zero instances restores the default single cube drawn with the matrix from SetMatrixFromUnity.
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetInstanceTransformsFromUnity(const float* pMatrices, int numInstances)
+{
+    std::lock_guard<std::mutex> Lock(g_InstanceTransformsMtx);
+    const auto* pTransforms = reinterpret_cast<const float4x4*>(pMatrices);
+    if (pTransforms != nullptr && numInstances > 0)
+        g_InstanceTransforms.assign(pTransforms, pTransforms + numInstances);
+    else
+        g_InstanceTransforms.clear();
+    g_InstanceTransformsDirty = true;
+}
+
 static void* g_RenderTargetHandle = nullptr;
 static void* g_DepthBufferHandle = nullptr;
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTexturesFromUnity(void* renderTargetHandle, void *depthBufferHandle)
@@ -201,6 +220,12 @@ static void UNITY_INTERFACE_API OnRenderEvent(int eventID)
         auto RTFormat = s_CurrentAPI->GetRenderTargetFormat();
         auto DepthFormat = s_CurrentAPI->GetDepthBufferFormat();
         g_SamplePlugin.reset(new SamplePlugin(s_CurrentAPI->GetDevice(), s_CurrentAPI->GetUsesReverseZ(), RTFormat, DepthFormat));
+        g_InstanceTransformsDirty = true;
+    }
+    if (g_InstanceTransformsDirty.exchange(false))
+    {
+        std::lock_guard<std::mutex> Lock(g_InstanceTransformsMtx);
+        g_SamplePlugin->SetInstanceTransforms(g_InstanceTransforms.data(), static_cast<Uint32>(g_InstanceTransforms.size()));
     }
     g_SamplePlugin->Render(s_CurrentAPI->GetDeviceContext(), g_Matrix );
 
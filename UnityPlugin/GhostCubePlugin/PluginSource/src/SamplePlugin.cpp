@@ -3,12 +3,14 @@
 #include "GraphicsUtilities.h"
 #include "MapHelper.hpp"
 
+#include <algorithm>
+
 using namespace Diligent;
 
 static const Char* VSSource = R"(
 cbuffer Constants
 {
-    float4x4 g_WorldViewProj;
+    float4x4 g_ViewProj;
 };
 
 struct PSInput 
@@ -19,9 +21,14 @@ struct PSInput
 
 void main(float3 pos   : ATTRIB0,
           float4 color : ATTRIB1,
+          float4 row0  : ATTRIB2,
+          float4 row1  : ATTRIB3,
+          float4 row2  : ATTRIB4,
+          float4 row3  : ATTRIB5,
           out PSInput PSIn) 
 {
-    PSIn.Pos = mul( float4(pos,1.0), g_WorldViewProj);
+    float4x4 World = MatrixFromRows(row0, row1, row2, row3);
+    PSIn.Pos = mul( mul(float4(pos,1.0), World), g_ViewProj);
     PSIn.Color = color;
 }
 )";
@@ -39,7 +46,9 @@ float4 main(PSInput PSIn) : SV_TARGET
 }
 )";
 
-SamplePlugin::SamplePlugin(Diligent::IRenderDevice *pDevice, bool UseReverseZ, TEXTURE_FORMAT RTVFormat, TEXTURE_FORMAT DSVFormat)
+SamplePlugin::SamplePlugin(Diligent::IRenderDevice *pDevice, bool UseReverseZ, TEXTURE_FORMAT RTVFormat, TEXTURE_FORMAT DSVFormat) :
+    m_pDevice(pDevice),
+    m_InstanceTransforms(1, float4x4::Identity())
 {
     auto deviceType = pDevice->GetDeviceInfo().Type;
     {
@@ -68,7 +77,9 @@ SamplePlugin::SamplePlugin(Diligent::IRenderDevice *pDevice, bool UseReverseZ, T
         ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
         ShaderCI.UseCombinedTextureSamplers = true;
 
-        CreateUniformBuffer(pDevice, sizeof(float4x4), "SamplePlugin: VS constants CB", &m_VSConstants);
+        // The constants only change when the camera moves, so unlike a dynamic buffer that
+        // would have to be mapped every event, a default buffer is updated only when needed
+        CreateUniformBuffer(pDevice, sizeof(float4x4), "SamplePlugin: VS constants CB", &m_VSConstants, USAGE_DEFAULT, BIND_UNIFORM_BUFFER, CPU_ACCESS_NONE);
 
         RefCntAutoPtr<IShader> pVS;
         {
@@ -91,7 +102,12 @@ SamplePlugin::SamplePlugin(Diligent::IRenderDevice *pDevice, bool UseReverseZ, T
         LayoutElement LayoutElems[] =
         {
             LayoutElement{0, 0, 3, VT_FLOAT32, False},
-            LayoutElement{1, 0, 4, VT_FLOAT32, False}
+            LayoutElement{1, 0, 4, VT_FLOAT32, False},
+            // Rows of the instance world matrix
+            LayoutElement{2, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+            LayoutElement{3, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+            LayoutElement{4, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+            LayoutElement{5, 1, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE}
         };
 
         PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
@@ -155,20 +171,72 @@ SamplePlugin::SamplePlugin(Diligent::IRenderDevice *pDevice, bool UseReverseZ, T
     }
 }
 
+void SamplePlugin::SetInstanceTransforms(const float4x4 *pTransforms, Uint32 NumInstances)
+{
+    if (NumInstances != 0)
+        m_InstanceTransforms.assign(pTransforms, pTransforms + NumInstances);
+    else
+        m_InstanceTransforms.assign(1, float4x4::Identity());
+    m_InstancesDirty = true;
+}
+
 void SamplePlugin::Render(Diligent::IDeviceContext *pContext, const float4x4 &ViewProjMatrix)
 {
+    // Unity may issue hundreds of plugin events per frame while the data rarely changes,
+    // so buffers are only updated when their contents change. Resource states are tracked
+    // by the engine and survive InvalidateState(), so after the buffers have been transitioned
+    // once, they are only transitioned again after an update.
+    StateTransitionDesc Barriers[4];
+    Uint32 NumBarriers = 0;
+
+    if (!m_StaticBuffersTransitioned)
+    {
+        Barriers[NumBarriers++] = StateTransitionDesc{m_CubeVertexBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE};
+        Barriers[NumBarriers++] = StateTransitionDesc{m_CubeIndexBuffer,  RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_INDEX_BUFFER,  STATE_TRANSITION_FLAG_UPDATE_STATE};
+        m_StaticBuffersTransitioned = true;
+    }
+
+    if (m_ConstantsDirty || ViewProjMatrix != m_ViewProj)
     {
-        MapHelper<float4x4> CBConstants(pContext, m_VSConstants, MAP_WRITE, MAP_FLAG_DISCARD);
-        *CBConstants = ViewProjMatrix.Transpose();
+        m_ViewProj = ViewProjMatrix;
+        const float4x4 CBConstants = m_ViewProj.Transpose();
+        pContext->UpdateBuffer(m_VSConstants, 0, sizeof(CBConstants), &CBConstants, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        Barriers[NumBarriers++] = StateTransitionDesc{m_VSConstants, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_CONSTANT_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE};
+        m_ConstantsDirty = false;
     }
 
-    IBuffer* pBuffs[] = {m_CubeVertexBuffer};
-    pContext->SetVertexBuffers(0, 1, pBuffs, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
-    pContext->SetIndexBuffer(m_CubeIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    const auto NumInstances = static_cast<Uint32>(m_InstanceTransforms.size());
+    if (m_InstancesDirty)
+    {
+        const auto DataSize = static_cast<Uint64>(sizeof(float4x4)) * NumInstances;
+        if (!m_InstanceBuffer || m_InstanceBuffer->GetDesc().Size < DataSize)
+        {
+            // Grow geometrically to avoid recreating the buffer every time an instance is added
+            BufferDesc InstBuffDesc;
+            InstBuffDesc.Name = "SamplePlugin: instance buffer";
+            InstBuffDesc.Usage = USAGE_DEFAULT;
+            InstBuffDesc.BindFlags = BIND_VERTEX_BUFFER;
+            InstBuffDesc.Size = m_InstanceBuffer ? std::max(DataSize, m_InstanceBuffer->GetDesc().Size * 2) : DataSize;
+            m_InstanceBuffer.Release();
+            m_pDevice->CreateBuffer(InstBuffDesc, nullptr, &m_InstanceBuffer);
+        }
+        pContext->UpdateBuffer(m_InstanceBuffer, 0, DataSize, m_InstanceTransforms.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        Barriers[NumBarriers++] = StateTransitionDesc{m_InstanceBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_VERTEX_BUFFER, STATE_TRANSITION_FLAG_UPDATE_STATE};
+        m_InstancesDirty = false;
+    }
+
+    if (NumBarriers != 0)
+        pContext->TransitionResourceStates(NumBarriers, Barriers);
+
+    // EndRendering() invalidates the context state, so the resources still have to be bound every event
+    IBuffer* pBuffs[] = {m_CubeVertexBuffer, m_InstanceBuffer};
+    pContext->SetVertexBuffers(0, _countof(pBuffs), pBuffs, nullptr, RESOURCE_STATE_TRANSITION_MODE_VERIFY, SET_VERTEX_BUFFERS_FLAG_RESET);
+    pContext->SetIndexBuffer(m_CubeIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
     pContext->SetPipelineState(m_PSO);
-    pContext->CommitShaderResources(m_SRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    pContext->CommitShaderResources(m_SRB, RESOURCE_STATE_TRANSITION_MODE_VERIFY);
 
     DrawIndexedAttribs DrawAttrs(36, VT_UINT32, DRAW_FLAG_VERIFY_ALL);
+    DrawAttrs.NumInstances = NumInstances;
     pContext->DrawIndexed(DrawAttrs);
 }
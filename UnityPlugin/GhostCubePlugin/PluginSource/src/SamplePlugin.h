@@ -6,16 +6,33 @@
 #include "RenderAPI.h"
 #include "BasicMath.hpp"
 
+#include <vector>
+
 class SamplePlugin
 {
 public:
     SamplePlugin(Diligent::IRenderDevice *pDevice, bool UseReverseZ, Diligent::TEXTURE_FORMAT RTVFormat, Diligent::TEXTURE_FORMAT DSVFormat);
+
+    // Sets world transforms of the cube instances that are drawn with a single instanced call.
+    // Empty array restores the default single instance with identity transform.
+    void SetInstanceTransforms(const Diligent::float4x4 *pTransforms, Diligent::Uint32 NumInstances);
+
+    // Buffers are only updated when the view-projection matrix or instance transforms change
     void Render(Diligent::IDeviceContext *pContext, const Diligent::float4x4 &ViewProjMatrix);
 
 private:
+    Diligent::RefCntAutoPtr<Diligent::IRenderDevice> m_pDevice;
     Diligent::RefCntAutoPtr<Diligent::IBuffer> m_CubeVertexBuffer;
     Diligent::RefCntAutoPtr<Diligent::IBuffer> m_CubeIndexBuffer;
     Diligent::RefCntAutoPtr<Diligent::IBuffer> m_VSConstants;
+    Diligent::RefCntAutoPtr<Diligent::IBuffer> m_InstanceBuffer;
     Diligent::RefCntAutoPtr<Diligent::IPipelineState> m_PSO;
     Diligent::RefCntAutoPtr<Diligent::IShaderResourceBinding> m_SRB;
+
+    std::vector<Diligent::float4x4> m_InstanceTransforms;
+    Diligent::float4x4 m_ViewProj;
+
+    bool m_ConstantsDirty = true;
+    bool m_InstancesDirty = true;
+    bool m_StaticBuffersTransitioned = false;
 };
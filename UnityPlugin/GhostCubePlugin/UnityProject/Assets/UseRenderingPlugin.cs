@@ -30,6 +30,13 @@ public class UseRenderingPlugin : MonoBehaviour
 #endif
     private static extern void SetTexturesFromUnity(System.IntPtr renderTexture, System.IntPtr depthTexture);
 
+#if (UNITY_IPHONE || UNITY_WEBGL) && !UNITY_EDITOR
+    [DllImport ("__Internal")]
+#else
+    [DllImport("GhostCubePlugin")]
+#endif
+    private static extern void SetInstanceTransformsFromUnity(float[] matrices, int numInstances);
+
 #if (UNITY_IPHONE || UNITY_WEBGL) && !UNITY_EDITOR
     [DllImport ("__Internal")]
 #else
@@ -55,6 +62,25 @@ public class UseRenderingPlugin : MonoBehaviour
             Debug.Log("Disregard Unity warnings about d3d12 resource leakage. Diligent Engine keeps references to the render target and depth buffer, but releases them after Unity when plugin event is issued. This makes Unity assertions fail, but there are no leaks");
     }
 
+    // Sets local transforms of cube instances that the plugin draws with a single instanced call.
+    // Transforms only need to be set when they change. Empty array draws a single cube.
+    public static void SetInstanceTransforms(Matrix4x4[] transforms)
+    {
+        int numInstances = transforms != null ? transforms.Length : 0;
+        // The plugin expects row-major matrices that transform row vectors, which
+        // is the transpose of the Unity matrix
+        float[] matrices = new float[numInstances * 16];
+        for (int i = 0; i < numInstances; ++i)
+        {
+            for (int row = 0; row < 4; ++row)
+            {
+                for (int col = 0; col < 4; ++col)
+                    matrices[i * 16 + row * 4 + col] = transforms[i][col, row];
+            }
+        }
+        SetInstanceTransformsFromUnity(matrices, numInstances);
+    }
+
     void OnRenderObject()
     {
         if (Camera.current.name == "ReflectionCamera")